@@ -0,0 +1,95 @@
+///
+/// \file BenchData.cxx
+/// \brief Implements BenchData.hxx
+///
+#include <stdint.h>
+#include "BenchData.hxx"
+
+
+// ====== Class BenchBank ====== //
+
+BenchBank::BenchBank()
+{
+	Reset();
+}
+
+BenchBank::~BenchBank()
+{
+	;
+}
+
+void BenchBank::Reset()
+{
+	/// Set everything to zero.
+	nhits = 0;
+	sum   = 0;
+	for(int i=0; i< BENCH_MAX_CHANNELS; ++i) {
+		adc[i] = 0;
+		tdc[i] = 0;
+	}
+}
+
+void BenchBank::Unpack(const void* addr, int nwords)
+{
+	///
+	/// Each hit is one 32-bit word: channel in bits 24-31, time in
+	/// bits 12-23 and pulse height in bits 0-11. Anything past the last
+	/// hit (padding words) has channel 0xff and is skipped.
+	const uint32_t* p = reinterpret_cast<const uint32_t*>(addr);
+	for(int i=0; i< nwords; ++i) {
+		const uint32_t ch = p[i] >> 24;
+		if(ch >= (uint32_t)BENCH_MAX_CHANNELS) continue;
+		adc[ch] = p[i] & 0xfff;
+		tdc[ch] = (p[i] >> 12) & 0xfff;
+		sum += adc[ch];
+		++nhits;
+	}
+}
+
+
+// ====== Class BenchData ====== //
+
+BenchData::BenchData()
+{
+	Reset();
+}
+
+BenchData::~BenchData()
+{
+	;
+}
+
+void BenchData::Reset()
+{
+	/// Reset all banks.
+	serial = 0;
+	for(int i=0; i< BENCH_MAX_BANKS; ++i)
+		bank[i].Reset();
+}
+
+
+// ====== Class BenchFormulaData ====== //
+
+BenchFormulaData::BenchFormulaData():
+	vec(8)
+{
+	Reset();
+}
+
+BenchFormulaData::~BenchFormulaData()
+{
+	;
+}
+
+void BenchFormulaData::Reset()
+{
+	/// Set everything to zero.
+	i = 0;
+	f = 0;
+	d = 0;
+	for(int j=0; j< 16; ++j)
+		arr[j] = 0;
+	for(unsigned j=0; j< vec.size(); ++j)
+		vec[j] = 0;
+	bank.Reset();
+}
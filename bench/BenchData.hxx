@@ -0,0 +1,78 @@
+///
+/// \file BenchData.hxx
+/// \brief Data classes unpacked by the throughput benchmark.
+///
+#ifndef ROOTBEER_BENCH_BENCHDATA_HXX
+#define ROOTBEER_BENCH_BENCHDATA_HXX
+#include <vector>
+
+/// Maximum number of banks in a synthetic event
+static const int BENCH_MAX_BANKS = 8;
+
+/// Maximum number of channels in one bank
+static const int BENCH_MAX_CHANNELS = 64;
+
+/// Data from one synthetic digitizer bank
+class BenchBank {
+public: // Methods
+	/// Calls Reset();
+	BenchBank();
+	/// Empty
+	~BenchBank();
+	/// Unpack _nwords_ hit words into class members
+	void Unpack(const void* addr, int nwords);
+	/// Reset data after an event
+	void Reset();
+public: // Data
+	/// Number of hits in the bank
+	int nhits;
+	/// Pulse heights, by channel
+	double adc[BENCH_MAX_CHANNELS];
+	/// Times, by channel
+	double tdc[BENCH_MAX_CHANNELS];
+	/// Sum of all pulse heights in the bank
+	double sum;
+};
+
+/// Top level class for one synthetic event
+class BenchData {
+public: // Methods
+	/// Empty
+	BenchData();
+	/// Empty
+	~BenchData();
+	/// Resets all data to defaults
+	void Reset();
+public: // Data
+	/// Event serial number
+	int serial;
+	/// Instances of the bank class
+	BenchBank bank[BENCH_MAX_BANKS];
+};
+
+/// Class exercising each kind of member a formula can address
+class BenchFormulaData {
+public: // Methods
+	/// Sizes vec, calls Reset()
+	BenchFormulaData();
+	/// Empty
+	~BenchFormulaData();
+	/// Resets all data to defaults (keeps the size of vec)
+	void Reset();
+public: // Data
+	/// Integer member
+	int i;
+	/// Float member
+	float f;
+	/// Double member
+	double d;
+	/// Fixed-size array
+	double arr[16];
+	/// STL vector, accessed with .at()
+	std::vector<double> vec;
+	/// Nested class
+	BenchBank bank;
+};
+
+
+#endif
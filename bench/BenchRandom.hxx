@@ -0,0 +1,29 @@
+///
+/// \file BenchRandom.hxx
+/// \brief Deterministic random numbers for the benchmark programs.
+///
+#ifndef ROOTBEER_BENCH_BENCHRANDOM_HXX
+#define ROOTBEER_BENCH_BENCHRANDOM_HXX
+#include <stdint.h>
+
+/// Deterministic random number generator (xorshift), independent of the ROOT version
+class BenchRandom
+{
+private:
+	/// Generator state
+	uint32_t fState;
+public:
+	/// Set the seed (zero is replaced by a fixed non-zero value)
+	BenchRandom(uint32_t seed): fState(seed ? seed : 2463534242u) { }
+	/// Return the next random number
+	uint32_t Next()
+		{
+			fState ^= fState << 13;
+			fState ^= fState >> 17;
+			fState ^= fState << 5;
+			return fState;
+		}
+};
+
+
+#endif
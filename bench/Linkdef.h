@@ -0,0 +1,14 @@
+///
+/// \file Linkdef.h
+/// \brief Benchmark linkdef file
+#ifdef __MAKECINT__ 
+
+#pragma link off all globals; 
+#pragma link off all classes; 
+#pragma link off all functions; 
+#pragma link C++ nestedclasses; 
+ 
+
+#pragma link C++ defined_in BenchData.hxx;
+
+#endif // #ifdef __CINT__
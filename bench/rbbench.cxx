@@ -0,0 +1,486 @@
+///
+/// \file rbbench.cxx
+/// \brief Implements rbbench.hxx
+///
+#include <new>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "Rint.hxx"
+#include "Rootbeer.hxx"
+#include "utils/Timer.hxx"
+#include "utils/Error.hxx"
+#include "rbbench.hxx"
+
+
+// ====== Allocation Counting ====== //
+
+namespace {
+/// Number of calls to operator new since the program started
+long long gAllocs = 0;
+}
+
+void* operator new(std::size_t size) throw(std::bad_alloc)
+{
+	///
+	/// Replaces the global operator new so that every allocation
+	/// made by rootbeer and ROOT during a pass is counted.
+	__sync_fetch_and_add(&gAllocs, 1);
+	void* p = malloc(size ? size : 1);
+	if(!p) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size) throw(std::bad_alloc)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) throw()
+{
+	free(p);
+}
+
+void operator delete[](void* p) throw()
+{
+	free(p);
+}
+
+
+// ====== Helper Functions ====== //
+
+namespace {
+
+/// Timing and allocation results from one pass over the file
+struct PassResult
+{
+	/// Wall time (fastest repetition)
+	Double_t seconds;
+	/// Number of events processed
+	Long64_t nevents;
+	/// Number of allocations during the pass
+	Long64_t nallocs;
+	/// BenchEvent checksum
+	Double_t checksum;
+};
+
+void usage(const char* arg0)
+{
+	BenchConfig d;
+	std::cout << "usage: " << arg0 << " [options]\n\n"
+						<< "  --events <n>        number of events to generate [" << d.nevents << "]\n"
+						<< "  --banks <n>         banks per event, max " << BENCH_MAX_BANKS << " [" << d.nbanks << "]\n"
+						<< "  --channels <n>      channels per bank, max " << BENCH_MAX_CHANNELS << " [" << d.nchannels << "]\n"
+						<< "  --multiplicity <n>  hits per bank [" << d.multiplicity << "]\n"
+						<< "  --pad <n>           extra words per bank [" << d.npad << "]\n"
+						<< "  --bank16            use 16-bit bank headers\n"
+						<< "  --compress          write the file through gzip\n"
+						<< "  --seed <n>          random number seed [" << d.seed << "]\n"
+						<< "  --h1 <n>            number of 1d histograms [" << d.nh1 << "]\n"
+						<< "  --h2 <n>            number of 2d histograms [" << d.nh2 << "]\n"
+						<< "  --gate <expr>       gate condition for every histogram\n"
+						<< "  --repeat <n>        repetitions per pass, fastest is kept [" << d.repeat << "]\n"
+						<< "  --file <path>       synthetic MIDAS file [" << d.file << "(.gz)]\n"
+						<< "  --json <path>       write results as JSON\n"
+						<< "  --keep              keep the synthetic file\n\n";
+	exit(1);
+}
+
+Bool_t parse_args(int argc, char** argv, BenchConfig& c)
+{
+	for(int i=1; i< argc; ++i) {
+		std::string arg = argv[i];
+		if(arg == "--bank16")   { c.bank32 = kFALSE; continue; }
+		if(arg == "--compress") { c.compress = kTRUE; continue; }
+		if(arg == "--keep")     { c.keep = kTRUE; continue; }
+		if(i+1 == argc) return kFALSE;
+		std::string val = argv[++i];
+		std::istringstream iss(val);
+		if     (arg == "--events")       iss >> c.nevents;
+		else if(arg == "--banks")        iss >> c.nbanks;
+		else if(arg == "--channels")     iss >> c.nchannels;
+		else if(arg == "--multiplicity") iss >> c.multiplicity;
+		else if(arg == "--pad")          iss >> c.npad;
+		else if(arg == "--seed")         iss >> c.seed;
+		else if(arg == "--h1")           iss >> c.nh1;
+		else if(arg == "--h2")           iss >> c.nh2;
+		else if(arg == "--repeat")       iss >> c.repeat;
+		else if(arg == "--gate")         c.gate = val;
+		else if(arg == "--file")         c.file = val;
+		else if(arg == "--json")         c.json = val;
+		else return kFALSE;
+		if(iss.fail()) return kFALSE;
+	}
+	if(c.compress && c.file.rfind(".gz") != c.file.size() - 3)
+		c.file += ".gz";
+
+	if(c.nevents < 1 || c.repeat < 1 || c.nh1 < 0 || c.nh2 < 0 || c.npad < 0) return kFALSE;
+	if(c.nbanks < 1 || c.nbanks > BENCH_MAX_BANKS) return kFALSE;
+	if(c.nchannels < 1 || c.nchannels > BENCH_MAX_CHANNELS) return kFALSE;
+	if(c.multiplicity < 0 || c.multiplicity > c.nchannels) return kFALSE;
+	if(!c.bank32 && 4*(c.multiplicity + c.npad) > 0xffff) return kFALSE;
+	return kTRUE;
+}
+
+template <class T>
+void append(std::vector<char>& v, const T& t)
+{
+	const char* p = reinterpret_cast<const char*>(&t);
+	v.insert(v.end(), p, p + sizeof(T));
+}
+
+Bool_t generate(const BenchConfig& c, Long64_t& nbytes)
+{
+	///
+	/// Writes c.nevents events, each with c.nbanks TID_DWORD banks named BK00, BK01, ...
+	/// Every bank holds c.multiplicity hits on distinct channels followed by c.npad
+	/// padding words. The contents depend only on the configuration and seed.
+	FILE* out = c.compress ?
+		popen(std::string("gzip -c > " + c.file).c_str(), "w") : fopen(c.file.c_str(), "wb");
+	if(!out) {
+		rb::err::Error("generate") << "Couldn't open \"" << c.file << "\" for writing.";
+		return kFALSE;
+	}
+
+	BenchRandom rng(c.seed);
+	std::vector<Int_t> channels(c.nchannels);
+	for(Int_t i=0; i< c.nchannels; ++i) channels[i] = i;
+
+	std::vector<char> event;
+	const uint32_t nwords = c.multiplicity + c.npad;
+	const uint32_t bankbytes = 4*nwords;
+	const uint32_t padbytes = ((bankbytes + 7) & ~7) - bankbytes;
+
+	Bool_t success = kTRUE;
+	nbytes = 0;
+	for(Long64_t ev = 0; ev < c.nevents && success; ++ev) {
+		event.clear();
+		rb::TMidas_BANK_HEADER bankHeader;
+		bankHeader.fDataSize = 0;
+		bankHeader.fFlags = c.bank32 ? 17 : 1;
+		append(event, bankHeader);
+
+		for(Int_t b = 0; b < c.nbanks; ++b) {
+			char name[5];
+			sprintf(name, "BK%02d", b);
+			if(c.bank32) {
+				rb::TMidas_BANK32 bank;
+				memcpy(bank.fName, name, 4);
+				bank.fType = 6; // TID_DWORD
+				bank.fDataSize = bankbytes;
+				append(event, bank);
+			} else {
+				rb::TMidas_BANK bank;
+				memcpy(bank.fName, name, 4);
+				bank.fType = 6; // TID_DWORD
+				bank.fDataSize = bankbytes;
+				append(event, bank);
+			}
+			for(Int_t h = 0; h < c.multiplicity; ++h) { // partial shuffle -> distinct channels
+				Int_t j = h + rng.Next() % (c.nchannels - h);
+				std::swap(channels[h], channels[j]);
+				uint32_t word = (uint32_t(channels[h]) << 24) | (rng.Next() & 0xffffff);
+				append(event, word);
+			}
+			for(Int_t p = 0; p < c.npad; ++p)
+				append(event, uint32_t(0xffffffff));
+			event.insert(event.end(), std::vector<char>::size_type(padbytes), char(0));
+		}
+		reinterpret_cast<rb::TMidas_BANK_HEADER*>(&event[0])->fDataSize =
+			event.size() - sizeof(rb::TMidas_BANK_HEADER);
+
+		rb::TMidas_EVENT_HEADER header;
+		header.fEventId = 1;
+		header.fTriggerMask = 0;
+		header.fSerialNumber = ev;
+		header.fTimeStamp = 1300000000 + ev / 1000;
+		header.fDataSize = event.size();
+
+		success = fwrite(&header, sizeof(header), 1, out) == 1 &&
+			fwrite(&event[0], event.size(), 1, out) == 1;
+		nbytes += sizeof(header) + event.size();
+	}
+
+	Int_t status = c.compress ? pclose(out) : fclose(out);
+	if(!success || status != 0) {
+		rb::err::Error("generate") << "Error writing to \"" << c.file << "\".";
+		return kFALSE;
+	}
+	return kTRUE;
+}
+
+void create_histograms(const BenchConfig& c)
+{
+	///
+	/// 1d histograms step through every channel of every bank (pulse height),
+	/// 2d histograms plot pulse height vs. time in the same order.
+	char name[64], param[256];
+	for(Int_t i=0; i< c.nh1; ++i) {
+		Int_t b = i % c.nbanks, ch = (i / c.nbanks) % c.nchannels;
+		sprintf(name, "h1_%d", i);
+		sprintf(param, "bench.bank[%d].adc[%d]", b, ch);
+		rb::hist::New(name, "", 512, 0, 4096, param, c.gate.c_str());
+	}
+	for(Int_t i=0; i< c.nh2; ++i) {
+		Int_t b = i % c.nbanks, ch = (i / c.nbanks) % c.nchannels;
+		sprintf(name, "h2_%d", i);
+		sprintf(param, "bench.bank[%d].adc[%d]:bench.bank[%d].tdc[%d]", b, ch, b, ch);
+		rb::hist::New(name, "", 256, 0, 4096, 256, 0, 4096, param, c.gate.c_str());
+	}
+}
+
+Bool_t run_pass(const BenchConfig& c, PassResult& result)
+{
+	///
+	/// Reads the whole file c.repeat times, keeping the fastest.
+	rb::BufferSource* buf = rb::BufferSource::New();
+	BenchEvent* event = rb::Event::Instance<BenchEvent>();
+	result.seconds = -1;
+	for(Int_t r = 0; r < c.repeat; ++r) {
+		if(!buf->OpenFile(c.file.c_str())) {
+			rb::err::Error("run_pass") << "Couldn't open \"" << c.file << "\".";
+			return kFALSE;
+		}
+		event->TakeChecksum();
+		Long64_t nevents = 0;
+		const long long allocs0 = gAllocs;
+		rb::Time start;
+		while(buf->ReadBufferOffline()) {
+			buf->UnpackBuffer();
+			++nevents;
+		}
+		rb::Time stop;
+		const long long allocs1 = gAllocs;
+		buf->CloseFile();
+
+		if(result.seconds < 0 || stop - start < result.seconds) {
+			result.seconds  = stop - start;
+			result.nevents  = nevents;
+			result.nallocs  = allocs1 - allocs0;
+			result.checksum = event->TakeChecksum();
+		}
+	}
+	return kTRUE;
+}
+
+std::string json_escape(const std::string& str)
+{
+	std::string out;
+	for(std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+		if(*it == '"' || *it == '\\') out += '\\';
+		out += *it;
+	}
+	return out;
+}
+
+void write_pass(std::ostream& os, const char* name, const PassResult& p, Long64_t nbytes, Bool_t json)
+{
+	const Double_t evps = p.nevents / p.seconds;
+	const Double_t mbps = nbytes / p.seconds / (1024.*1024.);
+	const Double_t allocs = p.nevents ? Double_t(p.nallocs) / p.nevents : 0;
+	if(json) {
+		os << "  \"" << name << "\": {\"seconds\": " << p.seconds
+			 << ", \"events\": " << p.nevents
+			 << ", \"events_per_second\": " << evps
+			 << ", \"mb_per_second\": " << mbps
+			 << ", \"allocs\": " << p.nallocs
+			 << ", \"allocs_per_event\": " << allocs << "},\n";
+	} else {
+		os << name << ": " << p.nevents << " events in " << p.seconds << " s, "
+			 << evps << " events/s, " << mbps << " MB/s, "
+			 << allocs << " allocs/event\n";
+	}
+}
+
+} // namespace
+
+
+// ====== Struct BenchConfig ====== //
+
+BenchConfig::BenchConfig():
+	nevents(100000), nbanks(4), nchannels(32), multiplicity(8), npad(0),
+	bank32(kTRUE), compress(kFALSE), seed(12345), nh1(32), nh2(8),
+	gate(""), repeat(3), file("rbbench.mid"), json(""), keep(kFALSE)
+{
+	;
+}
+
+
+// ====== Class BenchEvent ====== //
+
+BenchEvent::BenchEvent():
+	fData("bench", this, true, ""), fChecksum(0)
+{
+	;
+}
+
+BenchEvent::~BenchEvent()
+{
+	;
+}
+
+Double_t BenchEvent::TakeChecksum()
+{
+	Double_t out = fChecksum;
+	fChecksum = 0;
+	return out;
+}
+
+Bool_t BenchEvent::DoProcess(const void* pevent, Int_t)
+{
+	///
+	/// Look up each bank by name and unpack it.
+	const rb::TMidasEvent* event = reinterpret_cast<const rb::TMidasEvent*>(pevent);
+	fData->Reset();
+	fData->serial = event->GetSerialNumber();
+	char name[5];
+	for(int b=0; b< BENCH_MAX_BANKS; ++b) {
+		int length, type;
+		void* pbank;
+		sprintf(name, "BK%02d", b);
+		if(!event->FindBank(name, &length, &type, &pbank)) continue;
+		fData->bank[b].Unpack(pbank, length);
+		fChecksum += fData->bank[b].sum;
+	}
+	return kTRUE;
+}
+
+void BenchEvent::HandleBadEvent()
+{
+	rb::err::Error("BenchEvent") << "Error processing event!!";
+}
+
+
+// ====== Class BenchBuffer ====== //
+
+BenchBuffer::BenchBuffer():
+	rb::MidasBuffer(), fEvent()
+{
+	;
+}
+
+BenchBuffer::~BenchBuffer()
+{
+	;
+}
+
+Bool_t BenchBuffer::UnpackEvent(void* header, char* data)
+{
+	///
+	/// Point fEvent at the buffer (no copy) and process it as a BenchEvent.
+	rb::TMidas_EVENT_HEADER* pHeader = reinterpret_cast<rb::TMidas_EVENT_HEADER*>(header);
+	fEvent.Clear();
+	memcpy(fEvent.GetEventHeader(), pHeader, sizeof(rb::TMidas_EVENT_HEADER));
+	fEvent.SetData(pHeader->fDataSize, data);
+	rb::Event::Instance<BenchEvent>()->Process(&fEvent, pHeader->fDataSize);
+	return kTRUE;
+}
+
+
+// ====== Class BenchMain ====== //
+
+int BenchMain::Run(int argc, char** argv)
+{
+	BenchConfig config;
+	for(int i=1; i< argc; ++i)
+		if(!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) usage(argv[0]);
+	if(!parse_args(argc, argv, config)) usage(argv[0]);
+
+	///
+	/// Generate the synthetic file
+	Long64_t nbytes = 0;
+	rb::Time genStart;
+	if(!generate(config, nbytes)) return 1;
+	rb::Time genStop;
+	struct stat st;
+	Long64_t diskBytes = stat(config.file.c_str(), &st) == 0 ? st.st_size : -1;
+
+	///
+	/// Start rootbeer without the GUI
+	char arg1[] = "-ng";
+	char* argv2[] = { argv[0], arg1, 0 };
+	int argc2 = 2;
+	rb::Rint rbApp("Rbbench", &argc2, argv2, 0, 0, true);
+
+	///
+	/// First pass: no histograms, measures reading + unpacking.
+	/// Second pass: with histograms, the difference gives the cost per fill.
+	PassResult unpack, full;
+	if(!run_pass(config, unpack)) return 1;
+	create_histograms(config);
+	if(!run_pass(config, full)) return 1;
+
+	const Long64_t nhists = config.nh1 + config.nh2;
+	const Double_t nsPerFill = nhists ?
+		1e9 * (full.seconds - unpack.seconds) / (Double_t(full.nevents) * nhists) : 0;
+	if(unpack.checksum != full.checksum)
+		rb::err::Warning("rbbench") << "Checksum mismatch between passes: "
+																<< unpack.checksum << " vs. " << full.checksum;
+
+	std::cout << "\nrbbench: " << config.nevents << " events, " << config.nbanks << " banks x "
+						<< config.multiplicity << " hits (+" << config.npad << " pad), "
+						<< nbytes << " bytes (" << diskBytes << " on disk), "
+						<< config.nh1 << " 1d + " << config.nh2 << " 2d histograms\n";
+	write_pass(std::cout, "unpack", unpack, nbytes, kFALSE);
+	write_pass(std::cout, "full  ", full, nbytes, kFALSE);
+	std::cout << "fill: " << nsPerFill << " ns/histogram\n"
+						<< "checksum: " << full.checksum << "\n\n";
+
+	if(!config.json.empty()) {
+		std::ofstream ofs(config.json.c_str());
+		ofs << "{\n"
+				<< "  \"config\": {\"events\": " << config.nevents
+				<< ", \"banks\": " << config.nbanks
+				<< ", \"channels\": " << config.nchannels
+				<< ", \"multiplicity\": " << config.multiplicity
+				<< ", \"pad\": " << config.npad
+				<< ", \"bank32\": " << (config.bank32 ? "true" : "false")
+				<< ", \"compress\": " << (config.compress ? "true" : "false")
+				<< ", \"seed\": " << config.seed
+				<< ", \"h1\": " << config.nh1
+				<< ", \"h2\": " << config.nh2
+				<< ", \"gate\": \"" << json_escape(config.gate) << "\""
+				<< ", \"repeat\": " << config.repeat << "},\n"
+				<< "  \"file\": {\"bytes\": " << nbytes
+				<< ", \"disk_bytes\": " << diskBytes
+				<< ", \"generate_seconds\": " << (genStop - genStart) << "},\n";
+		write_pass(ofs, "unpack", unpack, nbytes, kTRUE);
+		write_pass(ofs, "full", full, nbytes, kTRUE);
+		ofs << "  \"ns_per_fill\": " << nsPerFill << ",\n"
+				<< "  \"checksum\": " << full.checksum << "\n"
+				<< "}\n";
+		if(!ofs.good())
+			rb::err::Error("rbbench") << "Error writing \"" << config.json << "\".";
+	}
+
+	if(!config.keep) unlink(config.file.c_str());
+	rbApp.Terminate(0);
+	return 0;
+}
+
+
+// ====== Required Implementations ====== //
+
+rb::Main* rb::GetMain()
+{
+	///
+	/// Run the benchmark instead of the interactive program
+	return new BenchMain();
+}
+
+void rb::Rint::RegisterEvents()
+{
+	RegisterEvent<BenchEvent> (1, "BenchEvent");
+}
+
+rb::MidasBuffer* rb::MidasBuffer::Create()
+{
+	return new BenchBuffer();
+}
@@ -0,0 +1,115 @@
+#ifndef RB_BENCH_INCLUDE_GUARD
+#define RB_BENCH_INCLUDE_GUARD
+///
+/// \file rbbench.hxx
+/// \brief End-to-end throughput benchmark for the MIDAS unpacking chain.
+/// \details Generates a deterministic synthetic MIDAS file and runs it through
+/// rb::MidasBuffer -> rb::Event::Process() -> rb::hist::Manager::FillAll(), reporting
+/// events/s, MB/s, ns per histogram fill and allocation counts. Run as
+/// \code
+/// ./rbbench --events 200000 --banks 4 --multiplicity 8 --h1 50 --h2 10 --json bench.json
+/// \endcode
+/// and use <tt>./rbbench --help</tt> for the full list of options.
+///
+// C++ / ROOT includes
+#include <string>
+#include <stdint.h>
+// ROOTBEER includes
+#include "Main.hxx"
+#include "Data.hxx"
+#include "Event.hxx"
+#include "midas/MidasBuffer.hxx"
+#include "midas/TMidasEvent.h"
+// Benchmark includes
+#include "BenchData.hxx"
+#include "BenchRandom.hxx"
+
+
+/// Benchmark configuration, set from the command line
+struct BenchConfig
+{
+	/// Number of events to generate
+	Long64_t nevents;
+	/// Number of banks per event
+	Int_t nbanks;
+	/// Number of channels per bank
+	Int_t nchannels;
+	/// Number of hits per bank
+	Int_t multiplicity;
+	/// Extra (ignored) words appended to each bank
+	Int_t npad;
+	/// Use 32-bit bank headers?
+	Bool_t bank32;
+	/// Write the file compressed (gzip)?
+	Bool_t compress;
+	/// Random number seed
+	UInt_t seed;
+	/// Number of 1d histograms
+	Int_t nh1;
+	/// Number of 2d histograms
+	Int_t nh2;
+	/// Gate condition applied to every histogram
+	std::string gate;
+	/// Number of times to repeat each pass (the fastest is reported)
+	Int_t repeat;
+	/// Synthetic MIDAS file name
+	std::string file;
+	/// JSON output file name (empty for none)
+	std::string json;
+	/// Keep the synthetic file after running?
+	Bool_t keep;
+	/// Sets defaults
+	BenchConfig();
+};
+
+/// Buffer source reading the synthetic MIDAS file
+class BenchBuffer: public rb::MidasBuffer
+{
+private:
+	/// Event used to locate banks
+	rb::TMidasEvent fEvent;
+public:
+	/// Empty
+	BenchBuffer();
+	/// Empty
+	virtual ~BenchBuffer();
+	/// Locate the banks and hand the event to BenchEvent
+	virtual Bool_t UnpackEvent(void* header, char* data);
+};
+
+/// Benchmark event
+class BenchEvent : public rb::Event
+{
+private:
+	/// Wrapper of BenchData class
+	rb::data::Wrapper<BenchData> fData;
+	/// Running sum of all unpacked pulse heights (checks that passes agree)
+	Double_t fChecksum;
+public:
+	/// Initializes fData
+	BenchEvent();
+	/// Empty
+	~BenchEvent();
+	/// Return and reset the checksum
+	Double_t TakeChecksum();
+private:
+	/// Unpack the event
+	Bool_t DoProcess(const void*, Int_t);
+	/// What to do in case of an error in event processing
+	void HandleBadEvent();
+};
+
+/// Benchmark main program
+class BenchMain: public rb::Main
+{
+public:
+	/// Empty
+	BenchMain() { }
+	/// Empty
+	virtual ~BenchMain() { }
+	/// Generate, run and report
+	virtual int Run(int argc, char** argv);
+};
+
+
+#endif
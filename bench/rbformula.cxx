@@ -0,0 +1,507 @@
+///
+/// \file rbformula.cxx
+/// \brief Implements rbformula.hxx
+///
+#include <cmath>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <unistd.h>
+#include <TMath.h>
+#include <TTree.h>
+#include <TCutG.h>
+#include "Rint.hxx"
+#include "Buffer.hxx"
+#include "Formula.hxx"
+#include "Polygon.hxx"
+#include "utils/Timer.hxx"
+#include "utils/Error.hxx"
+#include "rbformula.hxx"
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+
+// ====== Helper Functions ====== //
+
+namespace {
+
+/// Formula engines, in the order Event::InitFormula::Operate() tries them
+enum Engine_t { kClass, kConstant, kDirect, kTTree, kNengines };
+
+/// Engine names, indexed by Engine_t
+const char* const kEngineNames[kNengines] =
+	{ "ClassDataFormula", "ConstantDataFormula", "DirectDataFormula", "TTreeDataFormula" };
+
+/// Name of the TCutG used in the gate expression
+const char* const kCutName = "rbformula_cut";
+
+/// One expression to benchmark
+struct Expression
+{
+	/// What kind of access the expression exercises
+	std::string kind;
+	/// The expression
+	std::string formula;
+	Expression(const char* k, const std::string& f): kind(k), formula(f) { }
+};
+
+/// Result for one expression and one engine
+struct Result
+{
+	/// Index into the expression list
+	Int_t expression;
+	/// Engine code
+	Int_t engine;
+	/// Was the engine able to handle the expression?
+	Bool_t valid;
+	/// Nanoseconds per Evaluate() call
+	Double_t ns;
+	/// Cache misses per Evaluate() call (-1 if not counted)
+	Double_t misses;
+	/// Number of events where the value disagreed with the reference engine
+	Long64_t mismatches;
+};
+
+/// Benchmark options
+struct Options
+{
+	/// Number of data states
+	Long64_t nevents;
+	/// Evaluations per data state
+	Long64_t nreps;
+	/// Random number seed
+	UInt_t seed;
+	/// JSON output file name (empty for none)
+	std::string json;
+	/// User expressions
+	std::vector<std::string> extra;
+	/// Sets defaults
+	Options(): nevents(1000), nreps(1000), seed(12345), json("") { }
+};
+
+/// Counts last-level cache misses of this process with a Linux perf counter
+class CacheMissCounter
+{
+private:
+	/// perf_event file descriptor (-1 if unavailable)
+	int fFd;
+public:
+	CacheMissCounter(): fFd(-1)
+		{
+#ifdef __linux__
+			perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.size = sizeof(attr);
+			attr.config = PERF_COUNT_HW_CACHE_MISSES;
+			attr.disabled = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fFd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+		}
+	~CacheMissCounter() { if(fFd >= 0) close(fFd); }
+	Bool_t IsValid() const { return fFd >= 0; }
+#ifdef __linux__
+	void Reset() { if(fFd >= 0) ioctl(fFd, PERF_EVENT_IOC_RESET, 0); }
+	void Start() { if(fFd >= 0) ioctl(fFd, PERF_EVENT_IOC_ENABLE, 0); }
+	void Stop()  { if(fFd >= 0) ioctl(fFd, PERF_EVENT_IOC_DISABLE, 0); }
+	Long64_t Read()
+		{
+			long long count = 0;
+			if(fFd < 0 || read(fFd, &count, sizeof(count)) != sizeof(count)) return -1;
+			return count;
+		}
+#else
+	void Reset() { }
+	void Start() { }
+	void Stop()  { }
+	Long64_t Read() { return -1; }
+#endif
+};
+
+void usage(const char* arg0)
+{
+	Options d;
+	std::cout << "usage: " << arg0 << " [options]\n\n"
+						<< "  --events <n>   number of data states [" << d.nevents << "]\n"
+						<< "  --reps <n>     evaluations per state [" << d.nreps << "]\n"
+						<< "  --seed <n>     random number seed [" << d.seed << "]\n"
+						<< "  --expr <expr>  add an expression (may be repeated)\n"
+						<< "  --json <path>  write results as JSON\n\n";
+	exit(1);
+}
+
+Bool_t parse_args(int argc, char** argv, Options& o)
+{
+	for(int i=1; i< argc; ++i) {
+		std::string arg = argv[i];
+		if(i+1 == argc) return kFALSE;
+		std::string val = argv[++i];
+		std::istringstream iss(val);
+		if     (arg == "--events") iss >> o.nevents;
+		else if(arg == "--reps")   iss >> o.nreps;
+		else if(arg == "--seed")   iss >> o.seed;
+		else if(arg == "--expr")   o.extra.push_back(val);
+		else if(arg == "--json")   o.json = val;
+		else return kFALSE;
+		if(iss.fail()) return kFALSE;
+	}
+	return o.nevents > 0 && o.nreps > 0;
+}
+
+void fill(BenchFormulaData* data, BenchRandom& rng)
+{
+	///
+	/// Sets every member to a new random value (no allocations).
+	data->i = rng.Next() % 200;
+	data->f = (rng.Next() % 4096) / 3.;
+	data->d = rng.Next() % 4096;
+	for(int j=0; j< 16; ++j)
+		data->arr[j] = rng.Next() % 4096;
+	for(unsigned j=0; j< data->vec.size(); ++j)
+		data->vec[j] = rng.Next() % 4096;
+	data->bank.nhits = 0;
+	data->bank.sum = 0;
+	for(int j=0; j< BENCH_MAX_CHANNELS; ++j) {
+		data->bank.adc[j] = rng.Next() & 0xfff;
+		data->bank.tdc[j] = rng.Next() & 0xfff;
+		data->bank.sum += data->bank.adc[j];
+		++data->bank.nhits;
+	}
+}
+
+rb::DataFormula* make_engine(Int_t engine, const char* formula, void* addr, TTree* tree)
+{
+	///
+	/// \returns A new engine for _formula_, or 0 if the engine can't handle it.
+	rb::DataFormula* f = 0;
+	switch(engine) {
+	case kClass:
+		f = new rb::ClassDataFormula(formula, formula, "fdata", "BenchFormulaData", addr); break;
+	case kConstant:
+		f = new rb::ConstantDataFormula(formula); break;
+	case kDirect:
+		f = new rb::DirectDataFormula("fdata", "BenchFormulaData", addr, formula); break;
+	case kTTree:
+		f = new rb::TTreeDataFormula(formula, formula, tree); break;
+	default: break;
+	}
+	if(f && f->IsZombie()) {
+		delete f;
+		f = 0;
+	}
+	return f;
+}
+
+Bool_t agree(Double_t a, Double_t b)
+{
+	return fabs(a - b) <= 1e-9 * std::max(1., std::max(fabs(a), fabs(b)));
+}
+
+Long64_t check_polygons(UInt_t seed, Long64_t npolygons)
+{
+	///
+	/// Compares rb::Polygon::IsInside() with TMath::IsInside() (which TCutG::IsInside() uses) for
+	/// random polygons, with integer vertices on a small and a large grid, and for random points,
+	/// integer points, points on the edges and the vertices themselves.
+	/// \returns The number of points where they disagree.
+	BenchRandom rng(seed);
+	Long64_t mismatches = 0;
+	for(Long64_t ip = 0; ip < npolygons; ++ip) {
+		std::vector<Double_t> x, y;
+		if(ip == 0) { // square: its right and top edges are inside, the left and bottom ones aren't
+			const Double_t sx[] = { 0, 10, 10, 0 }, sy[] = { 0, 0, 10, 10 };
+			x.assign(sx, sx + 4);
+			y.assign(sy, sy + 4);
+		}
+		else {
+			const Int_t n = 3 + rng.Next() % 30;
+			const UInt_t range = ip % 2 ? 20 : 4096;
+			for(Int_t i=0; i< n; ++i) {
+				x.push_back(rng.Next() % range);
+				y.push_back(rng.Next() % range);
+			}
+		}
+		const Int_t n = x.size();
+		rb::Polygon polygon;
+		polygon.Set(n, &x[0], &y[0]);
+		const Int_t xlo = Int_t(*std::min_element(x.begin(), x.end())) - 2;
+		const Int_t ylo = Int_t(*std::min_element(y.begin(), y.end())) - 2;
+		const Int_t xrange = Int_t(*std::max_element(x.begin(), x.end())) + 3 - xlo;
+		const Int_t yrange = Int_t(*std::max_element(y.begin(), y.end())) + 3 - ylo;
+		for(Int_t k = 0; k < 1000; ++k) {
+			Double_t px, py;
+			const Int_t i = rng.Next() % n, j = (i + 1) % n;
+			switch(k % 4) {
+			case 0: // integer point
+				px = xlo + Int_t(rng.Next() % xrange);
+				py = ylo + Int_t(rng.Next() % yrange);
+				break;
+			case 1: // anywhere
+				px = xlo + xrange * (rng.Next() / 4294967296.);
+				py = ylo + yrange * (rng.Next() / 4294967296.);
+				break;
+			case 2: // on an edge
+				{
+					const Double_t f = (rng.Next() % 9) / 8.;
+					px = x[i] + f*(x[j] - x[i]);
+					py = y[i] + f*(y[j] - y[i]);
+				}
+				break;
+			default: // on a vertex
+				px = x[i];
+				py = y[i];
+				break;
+			}
+			const Bool_t fast = polygon.IsInside(px, py);
+			const Bool_t reference = TMath::IsInside(px, py, n, &x[0], &y[0]);
+			if(fast == reference) continue;
+			if(mismatches++ == 0)
+				rb::err::Warning("rbformula")
+					<< "rb::Polygon disagrees with TMath::IsInside() for (" << px << ", " << py
+					<< ") and a polygon of " << n << " vertices: " << fast << " vs. " << reference;
+		}
+	}
+	return mismatches;
+}
+
+std::string json_escape(const std::string& str)
+{
+	std::string out;
+	for(std::string::const_iterator it = str.begin(); it != str.end(); ++it) {
+		if(*it == '"' || *it == '\\') out += '\\';
+		out += *it;
+	}
+	return out;
+}
+
+} // namespace
+
+
+// ====== Class FormulaEvent ====== //
+
+FormulaEvent::FormulaEvent():
+	fData("fdata", this, true, "")
+{
+	;
+}
+
+FormulaEvent::~FormulaEvent()
+{
+	;
+}
+
+void FormulaEvent::HandleBadEvent()
+{
+	rb::err::Error("FormulaEvent") << "Error processing event!!";
+}
+
+
+// ====== Class FormulaMain ====== //
+
+int FormulaMain::Run(int argc, char** argv)
+{
+	Options options;
+	for(int i=1; i< argc; ++i)
+		if(!strcmp(argv[i], "--help") || !strcmp(argv[i], "-h")) usage(argv[0]);
+	if(!parse_args(argc, argv, options)) usage(argv[0]);
+
+	///
+	/// Start rootbeer without the GUI
+	char arg1[] = "-ng";
+	char* argv2[] = { argv[0], arg1, 0 };
+	int argc2 = 2;
+	rb::Rint rbApp("Rbformula", &argc2, argv2, 0, 0, true);
+
+	///
+	/// The TTree engine reads the live data through a branch, the same
+	/// way as rb::Event's internal tree.
+	BenchFormulaData* data = rb::Event::Instance<FormulaEvent>()->GetData();
+	void* addr = data;
+	TTree tree("rbformula", "rbformula");
+	tree.SetDirectory(0);
+	tree.Branch("fdata", "BenchFormulaData", &addr, 32000, 0);
+
+	Double_t cutx[] = { 1000, 3000, 3000, 1000, 1000 };
+	Double_t cuty[] = { 1000, 1000, 3000, 3000, 1000 };
+	TCutG cut(kCutName, 5, cutx, cuty);
+	cut.SetVarX("fdata.arr[0]");
+	cut.SetVarY("fdata.arr[1]");
+
+	std::vector<Expression> expressions;
+	expressions.push_back(Expression("member",        "fdata.d"));
+	expressions.push_back(Expression("int member",    "fdata.i"));
+	expressions.push_back(Expression("float member",  "fdata.f"));
+	expressions.push_back(Expression("array element", "fdata.arr[7]"));
+	expressions.push_back(Expression("nested member", "fdata.bank.adc[3]"));
+	expressions.push_back(Expression("vector at",     "fdata.vec.at(2)"));
+	expressions.push_back(Expression("arithmetic",    "fdata.d*2 + fdata.arr[3]/4 - fdata.f"));
+	expressions.push_back(Expression("gate &&",       "fdata.d > 2048 && fdata.i < 100"));
+	expressions.push_back(Expression("TCutG",         kCutName));
+	expressions.push_back(Expression("constant",      "42.5"));
+	for(UInt_t i=0; i< options.extra.size(); ++i)
+		expressions.push_back(Expression("user", options.extra[i]));
+
+	CacheMissCounter counter;
+	if(!counter.IsValid())
+		rb::err::Info("rbformula") << "Cache miss counter unavailable, not reporting misses.";
+
+	std::vector<Result> results;
+	Long64_t totalMismatches = 0;
+	for(UInt_t ie = 0; ie < expressions.size(); ++ie) {
+		const char* formula = expressions[ie].formula.c_str();
+		rb::DataFormula* engines[kNengines];
+		for(Int_t e = 0; e < kNengines; ++e)
+			engines[e] = make_engine(e, formula, addr, &tree);
+
+		Int_t reference = engines[kTTree] ? kTTree : -1;
+		for(Int_t e = 0; e < kNengines && reference < 0; ++e)
+			if(engines[e]) reference = e;
+
+		///
+		/// Cross-check: every engine must agree with the reference
+		/// (TTreeFormula when it can handle the expression).
+		Long64_t mismatches[kNengines] = { 0, 0, 0, 0 };
+		BenchRandom rngCheck(options.seed);
+		for(Long64_t ev = 0; ev < options.nevents && reference >= 0; ++ev) {
+			fill(data, rngCheck);
+			const Double_t ref = engines[reference]->Evaluate();
+			for(Int_t e = 0; e < kNengines; ++e) {
+				if(!engines[e] || e == reference) continue;
+				const Double_t val = engines[e]->Evaluate();
+				if(agree(val, ref)) continue;
+				if(mismatches[e]++ == 0)
+					rb::err::Warning("rbformula")
+						<< kEngineNames[e] << " disagrees with " << kEngineNames[reference]
+						<< " for \"" << formula << "\": " << val << " vs. " << ref;
+			}
+		}
+
+		///
+		/// Timing: the data change between events, each event is evaluated nreps times.
+		for(Int_t e = 0; e < kNengines; ++e) {
+			Result result;
+			result.expression = ie;
+			result.engine = e;
+			result.valid = engines[e] != 0;
+			result.ns = -1;
+			result.misses = -1;
+			result.mismatches = mismatches[e];
+			totalMismatches += mismatches[e];
+			if(!engines[e]) { results.push_back(result); continue; }
+
+			BenchRandom rng(options.seed);
+			volatile Double_t sink = 0;
+			Double_t seconds = 0;
+			counter.Reset();
+			for(Long64_t ev = 0; ev < options.nevents; ++ev) {
+				fill(data, rng);
+				counter.Start();
+				rb::Time start;
+				for(Long64_t r = 0; r < options.nreps; ++r)
+					sink += engines[e]->Evaluate();
+				rb::Time stop;
+				counter.Stop();
+				seconds += stop - start;
+			}
+			const Double_t nevals = Double_t(options.nevents) * options.nreps;
+			const Long64_t misses = counter.IsValid() ? counter.Read() : -1;
+			result.ns = 1e9 * seconds / nevals;
+			result.misses = misses < 0 ? -1 : misses / nevals;
+			results.push_back(result);
+		}
+
+		for(Int_t e = 0; e < kNengines; ++e)
+			delete engines[e];
+	}
+
+	///
+	/// Cross-check of the polygon test behind TCutG gates, including points on the edges.
+	const Long64_t polygonMismatches = check_polygons(options.seed, 1000);
+	totalMismatches += polygonMismatches;
+
+	printf("\n%-14s %-20s %-38s %10s %12s %10s\n",
+				 "kind", "engine", "expression", "ns/eval", "misses/eval", "mismatch");
+	for(UInt_t i=0; i< results.size(); ++i) {
+		const Result& r = results[i];
+		const Expression& ex = expressions[r.expression];
+		if(!r.valid) {
+			printf("%-14s %-20s %-38s %10s %12s %10s\n", ex.kind.c_str(), kEngineNames[r.engine],
+						 ex.formula.c_str(), "n/a", "n/a", "n/a");
+			continue;
+		}
+		printf("%-14s %-20s %-38s %10.2f %12.4f %10lld\n", ex.kind.c_str(), kEngineNames[r.engine],
+					 ex.formula.c_str(), r.ns, r.misses, (long long)r.mismatches);
+	}
+	printf("\n%lld polygon mismatch(es) with TMath::IsInside()\n", (long long)polygonMismatches);
+	printf("%lld mismatch(es)\n\n", (long long)totalMismatches);
+
+	if(!options.json.empty()) {
+		std::ofstream ofs(options.json.c_str());
+		ofs << "{\n  \"events\": " << options.nevents
+				<< ",\n  \"reps\": " << options.nreps
+				<< ",\n  \"seed\": " << options.seed
+				<< ",\n  \"polygon_mismatches\": " << polygonMismatches
+				<< ",\n  \"mismatches\": " << totalMismatches
+				<< ",\n  \"results\": [\n";
+		for(UInt_t i=0; i< results.size(); ++i) {
+			const Result& r = results[i];
+			const Expression& ex = expressions[r.expression];
+			ofs << "    {\"kind\": \"" << json_escape(ex.kind)
+					<< "\", \"expression\": \"" << json_escape(ex.formula)
+					<< "\", \"engine\": \"" << kEngineNames[r.engine]
+					<< "\", \"valid\": " << (r.valid ? "true" : "false");
+			if(r.valid)
+				ofs << ", \"ns_per_eval\": " << r.ns
+						<< ", \"misses_per_eval\": " << r.misses
+						<< ", \"mismatches\": " << r.mismatches;
+			ofs << "}" << (i+1 < results.size() ? "," : "") << "\n";
+		}
+		ofs << "  ]\n}\n";
+		if(!ofs.good())
+			rb::err::Error("rbformula") << "Error writing \"" << options.json << "\".";
+	}
+
+	rbApp.Terminate(totalMismatches ? 1 : 0);
+	return totalMismatches ? 1 : 0;
+}
+
+
+// ====== Required Implementations ====== //
+
+rb::Main* rb::GetMain()
+{
+	return new FormulaMain();
+}
+
+void rb::Rint::RegisterEvents()
+{
+	RegisterEvent<FormulaEvent> (1, "FormulaEvent");
+}
+
+rb::BufferSource* rb::BufferSource::New()
+{
+	///
+	/// No data source is needed, the data are set directly
+	return 0;
+}
+
+const char** rb::BufferSource::GetDefaultExtensions()
+{
+	static const char* ext[] = {
+		"All files", "*.*",
+		0, 0
+	};
+	return ext;
+}
@@ -0,0 +1,57 @@
+#ifndef RB_FORMULA_BENCH_INCLUDE_GUARD
+#define RB_FORMULA_BENCH_INCLUDE_GUARD
+///
+/// \file rbformula.hxx
+/// \brief Microbenchmark and cross-check of the rb::DataFormula engines.
+/// \details Evaluates a set of representative expressions over BenchFormulaData with each of
+/// rb::ClassDataFormula, rb::ConstantDataFormula, rb::DirectDataFormula and rb::TTreeDataFormula,
+/// reporting ns/eval, cache misses/eval (Linux perf counters, where available) and
+/// any disagreement between engines. Also checks the polygon test of TCutG gates (rb::Polygon)
+/// against TMath::IsInside(), on and off the edges. Run as
+/// \code
+/// ./rbformula --events 1000 --reps 1000 --expr "fdata.arr[2] - fdata.d" --json formula.json
+/// \endcode
+///
+// ROOTBEER includes
+#include "Main.hxx"
+#include "Data.hxx"
+#include "Event.hxx"
+// Benchmark includes
+#include "BenchData.hxx"
+#include "BenchRandom.hxx"
+
+
+/// Event holding the formula data
+class FormulaEvent : public rb::Event
+{
+private:
+	/// Wrapper of BenchFormulaData class
+	rb::data::Wrapper<BenchFormulaData> fData;
+public:
+	/// Initializes fData
+	FormulaEvent();
+	/// Empty
+	~FormulaEvent();
+	/// Return the wrapped data
+	BenchFormulaData* GetData() { return fData.Get(); }
+private:
+	/// Not used (data are set directly)
+	Bool_t DoProcess(const void*, Int_t) { return kTRUE; }
+	/// What to do in case of an error in event processing
+	void HandleBadEvent();
+};
+
+/// Formula benchmark main program
+class FormulaMain: public rb::Main
+{
+public:
+	/// Empty
+	FormulaMain() { }
+	/// Empty
+	virtual ~FormulaMain() { }
+	/// Run all expressions and report
+	virtual int Run(int argc, char** argv);
+};
+
+
+#endif
@@ -11,6 +11,7 @@
 #pragma link C++ namespace rb::data;
 #pragma link C++ namespace rb::hist;
 #pragma link C++ namespace rb::canvas;
+#pragma link C++ namespace rb::gate;
 #pragma link C++ class rb::Rint+;
 #pragma link C++ class rb::Signals+;
 #pragma link C++ class rb::HistSignals+;
@@ -18,6 +19,9 @@
 #pragma link C++ class rb::Event+;
 #pragma link C++ class TGSelectDialog+;
 #pragma link C++ class TGDivideSelect+;
+#pragma link C++ class rb::TGProfileFrame+;
+#pragma link C++ namespace rb::profile;
+#pragma link C++ namespace rb::metrics;
 
 #pragma link C++ defined_in ../src/ClassData.hxx;
 #pragma link C++ class rb::ClassFormula+;
@@ -30,6 +34,9 @@
 #pragma link C++ class rb::hist::Scaler+;
 #pragma link C++ class rb::hist::Gamma+;
 #pragma link C++ class rb::hist::Bit+;
+#pragma link C++ class rb::hist::Rate+;
+#pragma link C++ class rb::hist::Rolling+;
+#pragma link C++ class rb::hist::Decaying+;
 #pragma link C++ class AxisIndices;
 
 // #pragma link C++ class TMidasOnline+;
@@ -2,20 +2,32 @@
 //! \brief Implements Attach.hxx
 //! \file Buffer.cxx
 //! \brief Implements classes defined in Buffer.hxx
+#include <cerrno>
 #include <fstream>
 #include <memory>
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <TH1.h>
+#include <TKey.h>
+#include <TClass.h>
 #include <TFile.h>
 #include <TError.h>
 #include <TString.h>
 #include <TSystem.h>
 #include <TDatime.h>
+#include <TFileMerger.h>
+#include <TParameter.h>
+#include "hist/Hist.hxx"
+#include "hist/Manager.hxx"
 #include "utils/Assorted.hxx"
 #include "Rint.hxx"
 #include "Buffer.hxx"
 #include "Rootbeer.hxx"
+#include "Metrics.hxx"
 #include "Attach.hxx"
 
 
@@ -58,17 +70,26 @@ inline Int_t find_timer(TClass* timerclass, TTimer*& output) {
 	return retval;
 }
 
-void start_save(const std::string& save_fname) {
+// Name of the checkpoint entry holding the number of tree entries of event _code_
+std::string entries_name(Int_t code) {
+	std::stringstream out;
+	out << "rbEntries" << code;
+	return out.str();
+}
+
+// Start saving to _save_fname_; continue the trees in it, as they were at checkpoint _resume_, if given
+void start_save(const std::string& save_fname, const rb::Checkpoint* resume = 0) {
 	TDirectory* current = gDirectory;
 	if(!current) current = gROOT;
-	boost::shared_ptr<TFile> file (new TFile(save_fname.c_str(), "recreate"));
+	boost::shared_ptr<TFile> file (new TFile(save_fname.c_str(), resume ? "update" : "recreate"));
 	current->cd();
 	rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
 	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
 		std::stringstream tname; tname << "t" << it->first;
 		std::stringstream ttitle; ttitle << it->second << " data";
 		rb::Rint::gApp()->GetEvent(it->first)->
-			 StartSave(file, tname.str().c_str(), ttitle.str().c_str(), rb::Rint::gApp()->GetSaveHists());
+			 StartSave(file, tname.str().c_str(), ttitle.str().c_str(), rb::Rint::gApp()->GetSaveHists(),
+								 resume ? resume->GetEntries(it->first) : -1);
 	}
 }
 
@@ -79,6 +100,65 @@ inline void call_begin_run() {
 	std::for_each(events.begin(), events.end(), begin_run_functor);
 }
 
+void read_list(const std::string& listname, std::vector<std::string>& out) {
+	std::ifstream ifs(listname.c_str());
+	std::string line;
+	while(1) {
+		std::getline(ifs, line);
+		if(!ifs.good()) break;
+
+		line = line.substr(0, line.find("#"));
+		if(TString(line.c_str()).IsWhitespace()) continue;
+		out.push_back(line);
+	}
+}
+
+// Name of the .root file corresponding to _path_, in directory _dir_
+// (with ".<index>" before the extension if _index_ isn't negative)
+std::string shard_name(const std::string& dir, const std::string& path, Int_t index = -1) {
+	std::string fname(path);
+	if(fname.find_last_of("/") < fname.size())
+		 fname = fname.substr(fname.find_last_of("/")+1);
+	fname = fname.substr(0, fname.find_last_of("."));
+	std::stringstream out;
+	out << dir << "/" << fname;
+	if(index >= 0) out << "." << index;
+	out << ".root";
+	return out.str();
+}
+
+// Write every histogram to _file_, in subdirectories matching their directories below gROOT
+void write_file_histograms(TFile& file) {
+	TDirectory* current = gDirectory;
+	rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it)
+		rb::Rint::gApp()->GetEvent(it->first)->GetHistManager()->WriteAll(&file);
+	if(current) current->cd();
+	else gROOT->cd();
+}
+
+// Add the contents of every histogram in _dir_ (and its subdirectories) to the current histogram
+// of the same name in the matching directory below _owner_
+void add_file_histograms(TDirectory& dir, TDirectory* owner) {
+	TIter next(dir.GetListOfKeys());
+	while(TKey* key = static_cast<TKey*>(next())) {
+		TClass* cl = TClass::GetClass(key->GetClassName());
+		if(!cl) continue;
+		if(cl->InheritsFrom(TDirectory::Class())) {
+			TDirectory* sub = dir.GetDirectory(key->GetName());
+			TDirectory* subowner = owner->GetDirectory(key->GetName());
+			if(sub && subowner) add_file_histograms(*sub, subowner);
+			continue;
+		}
+		if(!cl->InheritsFrom(TH1::Class())) continue;
+		rb::hist::Base* hist = rb::hist::Manager::FindInDirectory(owner, key->GetName());
+		if(!hist) continue;
+		std::auto_ptr<TH1> h (static_cast<TH1*>(key->ReadObj()));
+		h->SetDirectory(0);
+		hist->Add(h.get());
+	}
+}
+
 template <class T>
 Bool_t check_attached() {
 	TTimer* t;
@@ -98,18 +178,129 @@ Bool_t rb::ListAttached() {
 	return check_attached<rb::ListAttach>();
 }
 
+Bool_t rb::ParallelListAttached() {
+	return check_attached<rb::ParallelListAttach>();
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//\\\\\\\\\\\\ Class rb::Checkpoint \\\\\\\\\\\\//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+Int_t rb::Checkpoint::fgInterval = 0;
+
+rb::Checkpoint::Checkpoint(const char* source):
+	fPath(""),
+	fListName(""),
+	fFileIndex(0),
+	fFileName(""),
+	fOffset(0) {
+	if(strcmp(source, "")) {
+		fPath = shard_name(expand_path_std(kSaveStaticDefault, "$RB_SAVEDIR"), source);
+		fPath = fPath.substr(0, fPath.find_last_of(".")) + ".checkpoint.root";
+	}
+}
+
+Bool_t rb::Checkpoint::Write() {
+	if(fPath.empty()) return kFALSE;
+	fEntries.clear();
+	EventVector_t events = Rint::gApp()->GetEventVector();
+	for(EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		Long64_t entries = Rint::gApp()->GetEvent(it->first)->FlushSave();
+		if(entries >= 0) fEntries[it->first] = entries;
+	}
+
+	TDirectory* current = gDirectory;
+	std::string temp = fPath + ".tmp";
+	Bool_t success = kFALSE;
+	{
+		TFile file(temp.c_str(), "recreate");
+		if(!file.IsZombie()) {
+			TNamed("rbListName", fListName.c_str()).Write();
+			TNamed("rbFileName", fFileName.c_str()).Write();
+			TParameter<Long64_t>("rbFileIndex", fFileIndex).Write();
+			TParameter<Long64_t>("rbOffset", fOffset).Write();
+			for(std::map<Int_t, Long64_t>::iterator it = fEntries.begin(); it != fEntries.end(); ++it)
+				TParameter<Long64_t>(entries_name(it->first).c_str(), it->second).Write();
+			write_file_histograms(file);
+			file.Close();
+			success = kTRUE;
+		}
+	}
+	if(current) current->cd();
+	else gROOT->cd();
+
+	// rename only a complete file, so a crash in here leaves the previous checkpoint
+	if(success) success = !gSystem->Rename(temp.c_str(), fPath.c_str());
+	if(!success) Error("Checkpoint", "Couldn't write checkpoint file %s.", fPath.c_str());
+	return success;
+}
+
+Bool_t rb::Checkpoint::Read(const std::string& restore_for) {
+	if(fPath.empty() || gSystem->AccessPathName(fPath.c_str())) return kFALSE;
+
+	TDirectory* current = gDirectory;
+	Bool_t success = kFALSE;
+	{
+		TFile file(fPath.c_str());
+		std::auto_ptr<TNamed> listname (dynamic_cast<TNamed*>(file.Get("rbListName")));
+		std::auto_ptr<TNamed> filename (dynamic_cast<TNamed*>(file.Get("rbFileName")));
+		std::auto_ptr<TParameter<Long64_t> > index (dynamic_cast<TParameter<Long64_t>*>(file.Get("rbFileIndex")));
+		std::auto_ptr<TParameter<Long64_t> > offset (dynamic_cast<TParameter<Long64_t>*>(file.Get("rbOffset")));
+
+		if(listname.get() && filename.get() && index.get() && offset.get()) {
+			fListName  = listname->GetTitle();
+			fFileName  = filename->GetTitle();
+			fFileIndex = index->GetVal();
+			fOffset    = offset->GetVal();
+			fEntries.clear();
+			EventVector_t events = Rint::gApp()->GetEventVector();
+			for(EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+				std::auto_ptr<TParameter<Long64_t> > entries
+					(dynamic_cast<TParameter<Long64_t>*>(file.Get(entries_name(it->first).c_str())));
+				if(entries.get()) fEntries[it->first] = entries->GetVal();
+			}
+			if(!restore_for.empty() && (fFileName == restore_for || fFileName.empty())) {
+				rb::hist::ClearAll();
+				add_file_histograms(file, gROOT);
+			}
+			success = kTRUE;
+		}
+		file.Close();
+	}
+	if(current) current->cd();
+	else gROOT->cd();
+
+	if(!success) Error("Checkpoint", "Invalid checkpoint file %s.", fPath.c_str());
+	return success;
+}
+
+Long64_t rb::Checkpoint::GetEntries(Int_t code) const {
+	std::map<Int_t, Long64_t>::const_iterator it = fEntries.find(code);
+	return it == fEntries.end() ? -1 : it->second;
+}
+
+void rb::Checkpoint::Remove() {
+	if(!fPath.empty()) gSystem->Unlink(fPath.c_str());
+}
+
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 //\\\\\\\\\\\\ Class rb::FileAttached \\\\\\\\\\\\//
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 
-rb::FileAttach::FileAttach(const char* filename, Bool_t stopAtEnd):
+rb::FileAttach::FileAttach(const char* filename, Bool_t stopAtEnd, Bool_t resume,
+													 const char* listname, Int_t listindex):
 	fTimeout(ATTACH_TIMEOUT),
 	fTimer(0),
 	fBuffer(0),
 	kFileName(filename),
+	fOthers(),
 	kStopAtEnd(stopAtEnd),
-	fNbuffers(0) {
+	fNbuffers(0),
+	fCheckpoint(strcmp(listname, "") ? listname : filename),
+	fStartOffset(0),
+	fLastCheckpoint() {
 
 	TString file1 = kFileName;
 	gSystem->ExpandPathName(file1);
@@ -118,6 +309,20 @@ rb::FileAttach::FileAttach(const char* filename, Bool_t stopAtEnd):
 	if(!ListAttached()) rb::Unattach();
 	call_begin_run(); 	// call begin run on all events
 
+	fCheckpoint.fListName = listname;
+	fCheckpoint.fFileIndex = listindex;
+	fCheckpoint.fFileName = kFileName;
+	rb::Checkpoint saved(fCheckpoint);
+	if(resume) {
+		if(saved.Read(kFileName) && (saved.fFileName == kFileName || saved.fFileName.empty())) {
+			if(!saved.fFileName.empty()) fStartOffset = saved.fOffset;
+			Info("FileAttach", "Resuming %s from offset %lld.", kFileName.c_str(), fStartOffset);
+		}
+		else {
+			Warning("FileAttach", "No checkpoint for %s, starting from the beginning.", kFileName.c_str());
+		}
+	}
+
 	if(!ListAttached()) {
 		if(Rint::gApp()->GetSignals()) Rint::gApp()->GetSignals()->Attaching(); // signal to gui
 	}
@@ -132,7 +337,7 @@ rb::FileAttach::FileAttach(const char* filename, Bool_t stopAtEnd):
 		save_fname += fname;
 		save_fname = save_fname.substr(0, save_fname.find_last_of("."));
 		save_fname += ".root";
-		start_save(save_fname);
+		start_save(save_fname, fStartOffset > 0 ? &saved : 0);
 	}
 }
 
@@ -147,6 +352,22 @@ rb::FileAttach::~FileAttach() {
 	}
 }
 
+void rb::FileAttach::GoMerged(const char* listname) {
+	std::vector<std::string> files;
+	read_list(listname, files);
+	if(files.empty()) {
+		Error("FileAttach", "No files listed in %s.", listname);
+		return;
+	}
+	FileAttach* f = new FileAttach(files[0].c_str(), kTRUE, kFALSE, "", 0);
+	for(size_t i=1; i< files.size(); ++i) {
+		TString file = files[i].c_str();
+		gSystem->ExpandPathName(file);
+		f->fOthers.push_back(file.Data());
+	}
+	f->StartLoop();
+}
+
 void rb::FileAttach::Stop() {
 	TTimer* t;
 	while(find_timer(rb::AttachTimer<rb::FileAttach>::Class(), t)) {
@@ -158,12 +379,20 @@ void rb::FileAttach::TimerAction() {
 	if(!fBuffer.get()) {
 		fNbuffers = 0;
 		fBuffer.reset(rb::BufferSource::New());
-		Bool_t open = fBuffer->OpenFile(kFileName.c_str());
+		std::vector<char*> others;
+		for(size_t i=0; i< fOthers.size(); ++i)
+			others.push_back(const_cast<char*>(fOthers[i].c_str()));
+		Bool_t open = fBuffer->OpenFile(kFileName.c_str(), others.empty() ? 0 : &others[0], others.size());
 		if(!open) {
 			Error("FileAttach", "File %s not readable.", kFileName.c_str());
 			fTimer->TurnOff();
 			return;
 		}
+		if(fStartOffset > 0 && !fBuffer->SetFileOffset(fStartOffset)) {
+			Error("FileAttach", "Couldn't resume %s from offset %lld.", kFileName.c_str(), fStartOffset);
+			fTimer->TurnOff();
+			return;
+		}
 	}
 
 	rb::Timeout timeout(READ_TIME);
@@ -171,9 +400,11 @@ void rb::FileAttach::TimerAction() {
     bool read_success = fBuffer->ReadBufferOffline();
     if (read_success) {
 			fBuffer->UnpackBuffer();
+			rb::metrics::AddBuffer(fBuffer.get());
 			if(Rint::gApp()->GetSignals())
 				Rint::gApp()->GetSignals()->UpdateBufferCounter(fNbuffers++);
 			else printCounter(fNbuffers++);
+			DoCheckpoint();
 		}
     else if (kStopAtEnd)
 			break; // we're done
@@ -189,6 +420,16 @@ void rb::FileAttach::TimerAction() {
 	}
   if(FileAttached()) { // read the complete file
     Info("FileAttach", "Done reading %s", kFileName.c_str());
+		if(Checkpoint::GetInterval() && fOthers.empty()) { // merged files aren't checkpointed
+			if(fCheckpoint.fListName.empty()) // all done
+				fCheckpoint.Remove();
+			else { // between files in the list
+				++fCheckpoint.fFileIndex;
+				fCheckpoint.fFileName = "";
+				fCheckpoint.fOffset = 0;
+				fCheckpoint.Write();
+			}
+		}
 	}
   else {
     if(!ListAttached()) { // told to stop externally
@@ -201,32 +442,45 @@ void rb::FileAttach::TimerAction() {
 	fTimer->TurnOff();
 };
 
+void rb::FileAttach::DoCheckpoint(Bool_t force) {
+	if(!Checkpoint::GetInterval()) return;
+	if(!force && rb::Time() - fLastCheckpoint < Checkpoint::GetInterval()) return;
+	fLastCheckpoint = rb::Time();
+	fCheckpoint.fOffset = fBuffer->GetFileOffset();
+	if(fCheckpoint.fOffset < 0) return; // source can't be resumed
+	fCheckpoint.Write();
+}
+
 
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 //\\\\\\\\\\\\ Class rb::ListAttached \\\\\\\\\\\\//
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 
-rb::ListAttach::ListAttach(const char* filename):
+rb::ListAttach::ListAttach(const char* filename, Bool_t resume):
 	fTimeout(ATTACH_TIMEOUT),
 	fTimer(0),
 	fBuffer(0),
 	kListName(filename),
 	fNbuffers(0),
-	fFileIndex(0) {
+	fFileIndex(0),
+	fResume(kFALSE) {
 	rb::Unattach();
 
 	// parse input file
-	std::ifstream ifs(kListName.c_str());
-	std::string line;
-	while(1) {
-		std::getline(ifs, line);
-		if(!ifs.good()) break;
-
-		line = line.substr(0, line.find("#"));
-		fFileNames.push_back(line);
+	read_list(kListName, fFileNames);
+
+	if(resume) {
+		rb::Checkpoint saved(kListName.c_str());
+		if(saved.Read() && saved.fListName == kListName) {
+			fFileIndex = saved.fFileIndex;
+			fResume = kTRUE;
+			Info("ListAttach", "Resuming %s from file %d.", kListName.c_str(), (Int_t)fFileIndex);
+		}
+		else {
+			Warning("ListAttach", "No checkpoint for %s, starting from the beginning.", kListName.c_str());
+		}
 	}
-
 }
 
 rb::ListAttach::~ListAttach() {
@@ -242,11 +496,176 @@ void rb::ListAttach::Stop() {
 void rb::ListAttach::TimerAction() {
 	if(rb::FileAttached() == false) {
 		size_t index = fFileIndex++;
-		if(index < fFileNames.size())
-			rb::AttachFile(fFileNames.at(index).c_str(), kTRUE);
-		else
+		if(index < fFileNames.size()) {
+			rb::FileAttach::Go(fFileNames.at(index).c_str(), kTRUE, fResume, kListName.c_str(), index);
+			fResume = kFALSE;
+		}
+		else {
+			if(Checkpoint::GetInterval()) rb::Checkpoint(kListName.c_str()).Remove();
 			fTimer->TurnOff();
+		}
+	}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//\\\\\\\\\\\\ Class rb::ParallelListAttached \\\\\\\\\\\\//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace {
+// Body of a worker process: unpack _input_ into the inherited event processors,
+// write histograms (and trees if saving is on) to _shard_. Never returns.
+void run_worker(const std::string& input, const std::string& shard) {
+	rb::hist::ClearAll();
+	call_begin_run();
+
+	boost::shared_ptr<TFile> file (new TFile(shard.c_str(), "recreate"));
+	gROOT->cd();
+	if(file->IsZombie()) _exit(1);
+
+	rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
+	if(rb::Rint::gApp()->GetSaveData()) {
+		for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+			std::stringstream tname; tname << "t" << it->first;
+			std::stringstream ttitle; ttitle << it->second << " data";
+			rb::Rint::gApp()->GetEvent(it->first)->StartSave(file, tname.str().c_str(), ttitle.str().c_str(), false);
+		}
+	}
+
+	boost::scoped_ptr<rb::BufferSource> buffer (rb::BufferSource::New());
+	if(!buffer->OpenFile(input.c_str())) {
+		Error("ParallelListAttach", "File %s not readable.", input.c_str());
+		_exit(1);
+	}
+	while(buffer->ReadBufferOffline())
+		buffer->UnpackBuffer();
+	buffer->CloseFile();
+
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it)
+		rb::Rint::gApp()->GetEvent(it->first)->StopSave();
+	write_file_histograms(*file);
+	file->Close();
+	_exit(0);
+} }
+
+rb::ParallelListAttach::ParallelListAttach(const char* filename, Int_t nworkers, const char* output, Bool_t keep_shards):
+	fTimeout(ATTACH_TIMEOUT),
+	fTimer(0),
+	kListName(filename),
+	kOutputName(output),
+	kNworkers(nworkers),
+	kKeepShards(keep_shards),
+	fFileIndex(0),
+	fNfailed(0) {
+	rb::Unattach();
+
+	// parse input file
+	read_list(kListName, fFileNames);
+
+	if(kOutputName.empty()) {
+		std::string savedir = expand_path_std(kSaveStaticDefault, "$RB_SAVEDIR");
+		kOutputName = shard_name(savedir, kListName);
+	}
+	if(Rint::gApp()->GetSignals()) Rint::gApp()->GetSignals()->Attaching(); // signal to gui
+	Info("ParallelListAttach", "Processing %d files with %d workers, output: %s",
+			 (Int_t)fFileNames.size(), kNworkers, kOutputName.c_str());
+}
+
+rb::ParallelListAttach::~ParallelListAttach() {
+	for(std::map<Int_t, std::string>::iterator it = fWorkers.begin(); it != fWorkers.end(); ++it) {
+		kill(it->first, SIGTERM);
+		waitpid(it->first, 0, 0);
+		gSystem->Unlink(it->second.c_str());
+	}
+	if(Rint::gApp()->GetSignals())
+		 Rint::gApp()->GetSignals()->Unattaching(); // signal to gui
+}
+
+void rb::ParallelListAttach::Stop() {
+	TTimer* t;
+	while(find_timer(rb::AttachTimer<rb::ParallelListAttach>::Class(), t)) {
+		t->TurnOff();
+	}	
+}
+
+void rb::ParallelListAttach::StartWorker() {
+	const Int_t index = fFileIndex++;
+	const std::string& input = fFileNames.at(index);
+	std::string shard = shard_name(gSystem->DirName(kOutputName.c_str()), input, index);
+
+	pid_t pid = fork();
+	if(pid == 0) { // child
+		run_worker(input, shard);
+	}
+	else if(pid < 0) {
+		Error("ParallelListAttach", "Couldn't start a worker for %s.", input.c_str());
+		++fNfailed;
 	}
+	else {
+		fWorkers[pid] = shard;
+	}
+}
+
+void rb::ParallelListAttach::TimerAction() {
+	// reap finished workers (only ours: other children belong to ROOT or the user)
+	for(std::map<Int_t, std::string>::iterator next = fWorkers.begin(); next != fWorkers.end(); ) {
+		std::map<Int_t, std::string>::iterator it = next++;
+		int status = 0;
+		const pid_t pid = waitpid(it->first, &status, WNOHANG);
+		if(pid == 0 || (pid < 0 && errno == EINTR)) continue; // still running
+		if(pid > 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+			fShards.push_back(it->second);
+		}
+		else {
+			Error("ParallelListAttach", "Worker writing %s failed.", it->second.c_str());
+			++fNfailed;
+		}
+		fWorkers.erase(it);
+		Info("ParallelListAttach", "Finished %d of %d files.",
+				 (Int_t)(fShards.size() + fNfailed), (Int_t)fFileNames.size());
+	}
+
+	// keep all workers busy
+	while((Int_t)fWorkers.size() < kNworkers && fFileIndex < fFileNames.size())
+		StartWorker();
+
+	if(fWorkers.empty() && fFileIndex >= fFileNames.size()) {
+		Merge();
+		fTimer->TurnOff();
+	}
+}
+
+void rb::ParallelListAttach::Merge() {
+	if(fShards.empty()) {
+		Error("ParallelListAttach", "No files were processed successfully, nothing to merge.");
+		return;
+	}
+	std::sort(fShards.begin(), fShards.end());
+	{
+		TDirectory* current = gDirectory;
+		TFileMerger merger(kFALSE);
+		merger.OutputFile(kOutputName.c_str());
+		for(size_t i=0; i< fShards.size(); ++i)
+			merger.AddFile(fShards[i].c_str(), kFALSE);
+		if(!merger.Merge())
+			Error("ParallelListAttach", "Failed merging output into %s.", kOutputName.c_str());
+		if(current) current->cd();
+		else gROOT->cd();
+	}
+	if(!kKeepShards) {
+		for(size_t i=0; i< fShards.size(); ++i)
+			gSystem->Unlink(fShards[i].c_str());
+	}
+
+	// add merged contents to the histograms in this session
+	TDirectory* current = gDirectory;
+	TFile merged(kOutputName.c_str());
+	add_file_histograms(merged, gROOT);
+	merged.Close();
+	if(current) current->cd();
+	else gROOT->cd();
+
+	Info("ParallelListAttach", "Done reading %s: %d files merged into %s, %d failed.",
+			 kListName.c_str(), (Int_t)fShards.size(), kOutputName.c_str(), fNfailed);
 }
 
 
@@ -345,6 +764,7 @@ void rb::OnlineAttach::TimerAction() {
 
 		if (haveEvent) {
 			fBuffer->UnpackBuffer();
+			rb::metrics::AddBuffer(fBuffer.get());
 			Rint::gApp()->GetSignals()->UpdateBufferCounter(fNbuffers++);
 		}
 
@@ -2,6 +2,9 @@
 //! \brief Defines classes for attaching to various data sources.
 #ifndef RB_ATTACH_HEADER
 #define RB_ATTACH_HEADER
+#include <map>
+#include <string>
+#include <vector>
 #include "utils/boost_scoped_ptr.h"
 #include "utils/Timer.hxx"
 #include "Buffer.hxx"
@@ -29,6 +32,63 @@ public:
 };
 
 
+// \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// \\\\\\\\\\ CHECKPOINT \\\\\\\\\\//
+// \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//! Snapshot of a long offline sort, for resuming after a crash
+/*!
+ * A checkpoint is a ROOT file holding the contents of every histogram, the list being sorted
+ * (if any), the index of the current file in that list, and the offset in the current file up to
+ * which the histograms are filled. Any event trees being saved are flushed to disk at the same
+ * time, and their number of entries recorded: on resuming, entries the tree got after the
+ * checkpoint (auto-saved by ROOT before a crash) are cut off, since they are read again.
+ * Histograms are written in subdirectories matching their directories, and restored by name
+ * within them. Checkpointing is off unless an interval is set (rb::SetCheckpointInterval()).
+ *
+ * The file is written to a temporary name and then renamed, so a crash while checkpointing leaves
+ * the previous checkpoint intact.
+ */
+class Checkpoint
+{
+public:
+	//! Path of the checkpoint file
+	std::string fPath;
+	//! Name (path) of the list being sorted, empty for a single file
+	std::string fListName;
+	//! Index of fFileName in the list
+	Int_t fFileIndex;
+	//! Name (path) of the file being sorted, empty when between files in a list
+	std::string fFileName;
+	//! Offset in fFileName up to which data have been processed
+	Long64_t fOffset;
+	//! Entries in the tree being saved for each event code, at fOffset
+	std::map<Int_t, Long64_t> fEntries;
+
+private:
+	//! Seconds between checkpoints, 0 means never
+	static Int_t fgInterval;
+
+public:
+	//! Sets fPath from the name of the file or list being sorted.
+	Checkpoint(const char* source = "");
+	//! Write the current state (histograms and the members above) to fPath.
+	Bool_t Write();
+	//! \brief Read fPath into the members above.
+	//! \details If the checkpoint is for file _restore_for_ (or between two files of a list), the current
+	//! histograms are restored from it as well.
+	Bool_t Read(const std::string& restore_for = "");
+	//! Entries the tree of event _code_ had at the checkpoint (-1 if unknown)
+	Long64_t GetEntries(Int_t code) const;
+	//! Delete the checkpoint file
+	void Remove();
+	//! Returns fgInterval
+	static Int_t GetInterval() { return fgInterval; }
+	//! Sets fgInterval
+	static void SetInterval(Int_t seconds) { fgInterval = seconds > 0 ? seconds : 0; }
+};
+
+
 // \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // \\\\\\\\\\\\  FILE  \\\\\\\\\\\\//
 // \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -45,10 +105,18 @@ private:
 	boost::scoped_ptr<BufferSource> fBuffer;
 	//! Name (path) of the offline file.
 	std::string kFileName;
+	//! Further files read together with kFileName and merged in time order (see rb::AttachMerged())
+	std::vector<std::string> fOthers;
 	//! Tells whether to stop reading at EOF (true) or stay connected and wait for more data to come in (false).
 	const Bool_t kStopAtEnd;
 	//! Buffer counter
 	Long_t fNbuffers;
+	//! Checkpoint of the current sort
+	Checkpoint fCheckpoint;
+	//! Offset at which to start reading (resuming from a checkpoint)
+	Long64_t fStartOffset;
+	//! Time of the last checkpoint
+	rb::Time fLastCheckpoint;
 
 public:
 	//! \details Take care of EOF cleanup
@@ -56,14 +124,21 @@ public:
 	//! \brief Open the file, loop contents and use fBuffer to extract and unpack data.
 	void TimerAction();
 		//! \brief Conststructs a \c new instance of rb::FileAttach and calls StartLoop()
-	static void Go(const char* filename, Bool_t stopAtEnd);
+	static void Go(const char* filename, Bool_t stopAtEnd, Bool_t resume = kFALSE,
+								 const char* listname = "", Int_t listindex = 0);
+	//! \brief Read every file in list _listname_ at once, merged in time order by the BufferSource.
+	static void GoMerged(const char* listname);
 	//! \brief Stop timer and end attachment
 	static void Stop();
 
 private:
 	//! \brief Set kFileName and kStopAtEnd, initialize fBuffer to the result
 	//! of BufferSource::New()
-	FileAttach(const char* filename, Bool_t stopAtEnd);
+	//! \details If resuming, restores the histograms and start offset from the checkpoint
+	//! (which belongs to \c listname if this file is part of a list).
+	FileAttach(const char* filename, Bool_t stopAtEnd, Bool_t resume, const char* listname, Int_t listindex);
+	//! Write fCheckpoint, if it's time to
+	void DoCheckpoint(Bool_t force = kFALSE);
 	//! Start running the loop
 	void StartLoop();
 };
@@ -73,8 +148,9 @@ inline void rb::FileAttach::StartLoop() {
 	fTimer->Start();
 }
 
-inline void FileAttach::Go(const char* filename, Bool_t stopAtEnd) {
-	FileAttach * f = new FileAttach(filename, stopAtEnd);
+inline void FileAttach::Go(const char* filename, Bool_t stopAtEnd, Bool_t resume,
+													 const char* listname, Int_t listindex) {
+	FileAttach * f = new FileAttach(filename, stopAtEnd, resume, listname, listindex);
 	f->StartLoop();
 }
 
@@ -101,6 +177,8 @@ private:
 	size_t fFileIndex;
 	//! Buffer counter
 	Long_t fNbuffers;
+	//! Tells whether the next file should resume from the list's checkpoint
+	Bool_t fResume;
 
 public:
 	//! \details Take care of EOF cleanup
@@ -108,14 +186,15 @@ public:
 	//! \brief Open the list, loop contents and use fBuffer to extract and unpack data.
 	void TimerAction();
 		//! \brief Conststructs a \c new instance of rb::ListAttach and calls StartLoop()
-	static void Go(const char* filename);
+	static void Go(const char* filename, Bool_t resume = kFALSE);
 	//! \brief Stop timer and end attachment
 	static void Stop();
 
 private:
 	//! \brief Set kListName, initialize fBuffer to the result
 	//! of BufferSource::New()
-	ListAttach(const char* filename);
+	//! \details If resuming, start from the file index stored in the list's checkpoint.
+	ListAttach(const char* filename, Bool_t resume);
 	//! Start running the loop
 	void StartLoop();
 };
@@ -125,8 +204,80 @@ inline void rb::ListAttach::StartLoop() {
 	fTimer->Start();
 }
 
-inline void ListAttach::Go(const char* listname) {
-	ListAttach * f = new ListAttach(listname);
+inline void ListAttach::Go(const char* listname, Bool_t resume) {
+	ListAttach * f = new ListAttach(listname, resume);
+	f->StartLoop();
+}
+
+
+// \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// \\\\\\\\ PARALLEL LIST \\\\\\\\\//
+// \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//! Class for attaching to offline lists using several worker processes
+/*!
+ * Each file in the list is handed to a \c fork()ed worker process, which inherits
+ * the full state of the session (event processors, histograms, variables), zeroes its
+ * copy of the histograms, unpacks the file with its own BufferSource, and writes its
+ * histograms (and event trees, if saving is on) to a per-run "shard" file, named after the
+ * file and its position in the list ("run123.0.root"). Once every
+ * worker has finished, the shards are merged into a single output file and the merged
+ * histogram contents are added to the histograms in the current session.
+ */
+class ParallelListAttach
+{
+private:
+	//! Timeout time
+	Long_t fTimeout;
+	//! Pointer to TTimer object
+	boost::scoped_ptr<TTimer> fTimer;
+	//! Name (path) of the offline list.
+	std::string kListName;
+	//! Name (path) of the merged output file.
+	std::string kOutputName;
+	//! Maximum number of workers running at once.
+	const Int_t kNworkers;
+	//! Tells whether to keep (true) or delete (false) the per-run shard files after merging.
+	const Bool_t kKeepShards;
+	//! File names in the list
+	std::vector<std::string> fFileNames;
+	//! Index of the next file to hand to a worker
+	size_t fFileIndex;
+	//! Running workers: process id, shard file name
+	std::map<Int_t, std::string> fWorkers;
+	//! Shard files written by successful workers
+	std::vector<std::string> fShards;
+	//! Number of workers which exited with an error
+	Int_t fNfailed;
+
+public:
+	//! \details Kill any running workers
+	virtual ~ParallelListAttach();
+	//! \brief Reap finished workers, start new ones, merge at the end.
+	void TimerAction();
+	//! \brief Conststructs a \c new instance of rb::ParallelListAttach and calls StartLoop()
+	static void Go(const char* filename, Int_t nworkers, const char* output, Bool_t keep_shards);
+	//! \brief Stop timer and end attachment
+	static void Stop();
+
+private:
+	//! \brief Parse the list, set the output name and number of workers.
+	ParallelListAttach(const char* filename, Int_t nworkers, const char* output, Bool_t keep_shards);
+	//! Start a worker process on fFileNames[fFileIndex]
+	void StartWorker();
+	//! Merge shard files into kOutputName
+	void Merge();
+	//! Start running the loop
+	void StartLoop();
+};
+
+inline void rb::ParallelListAttach::StartLoop() {
+	fTimer.reset(new AttachTimer<ParallelListAttach>(fTimeout, this));
+	fTimer->Start();
+}
+
+inline void ParallelListAttach::Go(const char* listname, Int_t nworkers, const char* output, Bool_t keep_shards) {
+	ParallelListAttach * f = new ParallelListAttach(listname, nworkers, output, keep_shards);
 	f->StartLoop();
 }
 
@@ -189,6 +340,7 @@ inline void OnlineAttach::Go(const char* source, const char* other, char** other
 
 Bool_t FileAttached();
 Bool_t ListAttached();
+Bool_t ParallelListAttached();
 Bool_t OnlineAttached();
 
 } // namespace rb
@@ -197,6 +349,7 @@ Bool_t OnlineAttached();
 #ifdef __MAKECINT__
 #pragma link C++ class rb::AttachTimer<rb::FileAttach>+;
 #pragma link C++ class rb::AttachTimer<rb::ListAttach>+;
+#pragma link C++ class rb::AttachTimer<rb::ParallelListAttach>+;
 #pragma link C++ class rb::AttachTimer<rb::OnlineAttach>+;
 #endif
 
@@ -29,6 +29,8 @@ public:
 	//! \param [in] other_args Any other arguments that might be needed.
 	//! \param [in] n_others Number of other (tertiary) arguments.
 	//! \returns true if file successfully opened, false otherwise.
+	//! \note rb::AttachMerged() passes the remaining files of its list as the other arguments;
+	//! sources that can merge them (see rb::Merger) read all of them at once.
 	virtual Bool_t OpenFile(const char* file_name, char** other = 0, int nother = 0) = 0;
 
 	//! Connect to an online data source.
@@ -57,6 +59,30 @@ public:
 	//! \returns true on successful unpack, false otherwise.
 	virtual Bool_t UnpackBuffer() = 0;
 
+	//! Get the current position in an offline data source.
+	//! \returns An offset which can be passed to SetFileOffset() to continue reading from
+	//! the same place, or -1 if the source can't do this (the default).
+	//! \note Used to checkpoint long offline sorts; see rb::Checkpoint.
+	virtual Long64_t GetFileOffset() { return -1; }
+
+	//! Move to a position in an offline data source.
+	//! \param [in] offset Position returned by GetFileOffset().
+	//! \returns true if successful, false otherwise (the default).
+	virtual Bool_t SetFileOffset(Long64_t offset) { return kFALSE; }
+
+	//! Size of the most recently read buffer.
+	//! \returns Number of bytes in the last buffer, or 0 if unknown (the default).
+	//! \note Used for live throughput metrics; see rb::metrics.
+	virtual Long64_t GetBufferSize() { return 0; }
+
+	//! Amount of data waiting to be read from an online source.
+	//! \returns Number of bytes not yet read, or -1 if unknown (the default).
+	virtual Long64_t GetBacklog() { return -1; }
+
+	//! How far the analysis is running behind an online source.
+	//! \returns Seconds between the time stamp of the last buffer and now, or -1 if unknown (the default).
+	virtual Double_t GetLag() { return -1; }
+
 	//! \brief Defines the default file extensions.
 	//! \returns Array of const char*, consisting of a pair of { description, *.extension }
 	//! strings for every desired file type, and terminated by { 0, 0 }.
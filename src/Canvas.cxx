@@ -2,11 +2,14 @@
 //! \brief Implements canvas updating functions.
 //! \details Also defines a number of internal functions to be called by the
 //! user ones.
+#include <map>
+#include <cstring>
 #include <TCanvas.h>
 #include <TArrayL.h>
 #include <TArrayL64.h>
 #include <TException.h>
 #include "Rint.hxx"
+#include "Event.hxx"
 #include "Rootbeer.hxx"
 #include "hist/Hist.hxx"
 #include "utils/Timer.hxx"
@@ -25,29 +28,109 @@ const Int_t kMaxRate = 1;
 // The rate at which canvases are updated (in seconds).
 Int_t gUpdateRate = 0;
 
+// Number of slices the canvases are split into by the refresh timer. Each
+// timer tick checks one slice, so every canvas is checked once per update
+// period but the repaint work is spread over kSlices ticks.
+const Int_t kSlices = 4;
+
+// Slice to be checked by the next timer tick.
+Int_t gSlice = 0;
+
+// What a pad was showing when it was last painted: the summed fill
+// generation of its rb::hist::Base histograms and the number of primitives.
+struct PadState {
+	TPad* fCanvas;
+	ULong64_t fGeneration;
+	Int_t fNprimitives;
+	PadState(TPad* canvas = 0): fCanvas(canvas), fGeneration(0), fNprimitives(-1) { }
+	bool operator== (const PadState& other) const {
+		return fGeneration == other.fGeneration && fNprimitives == other.fNprimitives;
+	}
+};
+typedef std::map<TVirtualPad*, PadState> PadStateMap_t;
+
+// State of every pad when it was last painted.
+PadStateMap_t gPadStates;
+
+// Find the rb::hist::Base wrapping _hst_, or 0 if it isn't one.
+rb::hist::Base* FindBase(TH1* hst) {
+	static const std::string kPrefix = "(rb::hist::Base*)";
+	if(strncmp(hst->GetName(), kPrefix.c_str(), kPrefix.size()) != 0) return 0;
+	rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		rb::hist::Base* base = rb::Rint::gApp()->GetEvent(it->first)->FindHistogram(hst);
+		if(base) return base;
+	}
+	return 0;
+}
+
 // Update whatever histograms are on the current canvas/pad,
-// including any sub-pads owned by this one.
-void RecursiveUpdatePad(TVirtualPad* pad) {
-	{
-		if(!pad || !dynamic_cast<TPad*>(pad)) {
-			std::string cl = pad ? pad->ClassName() : "N/A";
-			rb::err::Error("RecursiveUpdatePad")
-				 << "Passed an invalid TVirtualPad* pointer: "
-				 << pad << ", Class Name: " << cl << ERR_FILE_LINE;
-			return;
-		}
+// including any sub-pads owned by this one. Unless _force_ is set,
+// only pads whose histograms have been filled (or cleared) since
+// they were last painted are marked as modified. Pads showing
+// histograms other than rb::hist::Base ones are always marked.
+// Returns true if any pad was marked.
+Bool_t RecursiveUpdatePad(TVirtualPad* pad, TPad* canvas, Bool_t force) {
+	if(!pad || !dynamic_cast<TPad*>(pad)) {
+		std::string cl = pad ? pad->ClassName() : "N/A";
+		rb::err::Error("RecursiveUpdatePad")
+			 << "Passed an invalid TVirtualPad* pointer: "
+			 << pad << ", Class Name: " << cl << ERR_FILE_LINE;
+		return kFALSE;
+	}
 
-//		pad->cd();
-		TList* primitives = pad->GetListOfPrimitives();
-		for(Int_t i=0; i< primitives->GetEntries(); ++i) {
-			TVirtualPad* subpad = dynamic_cast<TVirtualPad*>(primitives->At(i));
-			if(subpad) {
-				RecursiveUpdatePad(subpad);
-			}
+	Bool_t modified = kFALSE;
+	Bool_t always = kFALSE;
+	PadState state(canvas);
+	TList* primitives = pad->GetListOfPrimitives();
+	state.fNprimitives = primitives->GetEntries();
+	for(Int_t i=0; i< primitives->GetEntries(); ++i) {
+		TObject* obj = primitives->At(i);
+		TVirtualPad* subpad = dynamic_cast<TVirtualPad*>(obj);
+		if(subpad) {
+			if(RecursiveUpdatePad(subpad, canvas, force)) modified = kTRUE;
+		}
+		else if(obj->InheritsFrom(TH1::Class())) {
+			rb::hist::Base* base = FindBase(static_cast<TH1*>(obj));
+			if(base) state.fGeneration += base->GetGeneration();
+			else always = kTRUE;
 		}
 	}
-	pad->Modified();
-	pad->Update();
+
+	PadStateMap_t::iterator it = gPadStates.find(pad);
+	if(force || always || it == gPadStates.end() || !(it->second == state)) {
+		pad->Modified();
+		modified = kTRUE;
+	}
+	gPadStates[pad] = state;
+	return modified;
+}
+
+// Update one canvas, repainting only the pads marked by RecursiveUpdatePad().
+void UpdateCanvas(TPad* canvas, Bool_t force) {
+	if(RecursiveUpdatePad(canvas, canvas, force))
+		canvas->Update();
+}
+
+// Forget the saved state of pads belonging to canvases which have been closed.
+void PrunePadStates() {
+	TSeqCollection* canvases = gROOT->GetListOfCanvases();
+	for(PadStateMap_t::iterator it = gPadStates.begin(); it != gPadStates.end(); ) {
+		if(!canvases->FindObject(it->second.fCanvas)) gPadStates.erase(it++);
+		else ++it;
+	}
+}
+
+// Check the canvases in _slice_ (out of kSlices), repainting those which changed.
+void UpdateSlice(Int_t slice) {
+	if(slice == 0) PrunePadStates();
+	TPad* pInitial = dynamic_cast<TPad*>(gPad);
+	TSeqCollection* canvases = gROOT->GetListOfCanvases();
+	for(Int_t i = slice; i< canvases->GetEntries(); i += kSlices) {
+		TPad* pad = dynamic_cast<TPad*>(canvases->At(i));
+		if(pad) UpdateCanvas(pad, kFALSE);
+	}
+	if(pInitial) pInitial->cd();
 }
 
 // Clear whatever histograms are on the current canvas/pad,
@@ -72,7 +155,7 @@ void RecursiveClearPad(TVirtualPad* pad) {
 
 // Class inheriting from TTimer to perform auto-refresh.
 // Overrides the Notify() method to perform the actions we want
-// (here, refreshing all canvases).
+// (here, refreshing the canvases in one slice that have changed).
 class UpdateTimer: public TTimer
 {
 public:
@@ -81,13 +164,14 @@ public:
 		 TTimer(timeout, mode) { }
 
 	 // Override of the Notify() function
-	 // Gets called whenever the timer times out (i.e. every _rate_ seconds).
+	 // Gets called whenever the timer times out (i.e. kSlices times every _rate_ seconds).
 	 // NOTE: Must call the Reset() function at the end, otherwise this just keeps executing forever.
 	 Bool_t Notify() {
 		 // Use ROOT's macro based try... catch functionality to spot
 		 // X11 errors
 		 TRY {
-			 rb::canvas::UpdateAll();
+			 UpdateSlice(gSlice);
+			 gSlice = (gSlice + 1) % kSlices;
 		 } CATCH(i) {
 			 rb::err::Error("UpdateTimer::Notify")
 				 << "Caught ROOT exception 2, likely due to X11 error. "
@@ -129,9 +213,10 @@ void rb::canvas::UpdateCurrent() {
 void rb::canvas::UpdateAll() {
   TPad* pInitial = dynamic_cast<TPad*>(gPad);
   TPad* pad;
+	PrunePadStates();
   for(Int_t i=0; i< gROOT->GetListOfCanvases()->GetEntries(); ++i) {
     pad = dynamic_cast<TPad*>(gROOT->GetListOfCanvases()->At(i));
-    if(pad) RecursiveUpdatePad(pad);
+    if(pad) UpdateCanvas(pad, kTRUE);
   }
   if(pInitial) pInitial->cd();
 	if(gPad) {
@@ -140,6 +225,14 @@ void rb::canvas::UpdateAll() {
 	}
 }
 
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::canvas::UpdateChanged()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::canvas::UpdateChanged() {
+	for(Int_t i=0; i< kSlices; ++i)
+		UpdateSlice(i);
+}
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::canvas::StopUpdate()                         //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -166,7 +259,8 @@ Int_t rb::canvas::StartUpdate(Int_t rate) {
   else {
     StopUpdate();
     gUpdateRate = rate;
-		gUpdateTimer.Start(rate*1000);
+		gSlice = 0;
+		gUpdateTimer.Start(rate*1000/kSlices);
 		if(Rint::gApp()->GetSignals()) {
 			Rint::gApp()->GetSignals()->StartingUpdate(rate);
 		}
@@ -4,6 +4,7 @@
 #include <TFormulaPrimitive.h>
 #include "Data.hxx"
 #include "ClassFormula.hxx"
+#include "Polygon.hxx"
 /// \todo 2d gates don't properly evaluate.
 
 
@@ -191,6 +192,8 @@ Int_t rb::ClassFormula::DefinedVariable(TString &name, Int_t &action) {
 	 */
 	rb::data::Mapper mapper(fBranchname, fClassname, reinterpret_cast<Long_t>(fAddress), kFALSE);
 	rb::data::MReader* reader = mapper.FindBasicReader(name.Data());
+	if(!reader) // maybe a TCutG on members of the class
+		reader = rb::CutGate::NewReader(name.Data(), fBranchname, fClassname, fAddress);
 
 	if(!reader) return -1; // unrecognized string, return error
 	action = kVariable; // recognized string
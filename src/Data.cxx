@@ -8,7 +8,7 @@
 #include <cassert>
 #include <sstream>
 #include <algorithm>
-#include <TRealData.h>
+#include <TBaseClass.h>
 #include "Rint.hxx"
 #include "Data.hxx"
 #include "mxml/mxml.hxx"
@@ -237,13 +237,37 @@ void rb::data::MBasic::New(const char* name, volatile void* addr, TDataMember* d
 	}
 #undef CHECK_TYPE
 }
+namespace {
+/// All instances of rb::data::MBasic: by handle, and handle by name
+struct Registry {
+	std::vector<rb::data::MBasic*> fHandles;
+	boost::unordered_map<std::string, rb::data::MBasic::Handle_t> fIndex;
+};
+
+Registry& registry() {
+	static Registry* r = new Registry();
+	return *r;
+}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::MBasic::Register()           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::MBasic::Register(const char* name) {
+	fName = name;
+	Registry& r = registry();
+	if(r.fIndex.count(fName)) return; // name taken
+	fHandle = r.fHandles.size();
+	r.fHandles.push_back(this);
+	r.fIndex.insert(std::make_pair(fName, fHandle));
+}
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // rb::data::MBasic::GetAll() [static]         //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 std::vector<std::string> rb::data::MBasic::GetAll() {
 	std::vector<std::string> out;
-	for(Map_t::iterator it = fgAll().begin(); it != fgAll().end(); ++it) {
-		out.push_back(it->first);
+	out.reserve(registry().fHandles.size());
+	for(size_t i=0; i< registry().fHandles.size(); ++i) {
+		out.push_back(registry().fHandles[i]->fName);
 	}
 	return out;
 }
@@ -251,8 +275,21 @@ std::vector<std::string> rb::data::MBasic::GetAll() {
 // MBasic* rb::data::MBasic::Find() [static]   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::data::MBasic* rb::data::MBasic::Find(const char* name) {
-  rb::data::MBasic::Map_t::iterator it = fgAll().find(std::string(name));
-  return it != fgAll().end() ? it->second : 0;
+	return Get(FindHandle(name));
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Handle_t rb::data::MBasic::FindHandle() [static]  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::data::MBasic::Handle_t rb::data::MBasic::FindHandle(const char* name) {
+	boost::unordered_map<std::string, Handle_t>::iterator it = registry().fIndex.find(name);
+	return it != registry().fIndex.end() ? it->second : Handle_t(kInvalidHandle);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// MBasic* rb::data::MBasic::Get() [static]    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::data::MBasic* rb::data::MBasic::Get(Handle_t handle) {
+	if(handle < 0 || handle >= (Handle_t)registry().fHandles.size()) return 0;
+	return registry().fHandles[handle];
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Sub Class                             //
@@ -263,21 +300,17 @@ rb::data::MBasic* rb::data::MBasic::Find(const char* name) {
 // void rb::data::MBasic::Printer::SaveXML(XmlWriter*) //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::data::MBasic::Printer::SaveXML(rb::XmlWriter* writer) {
-  if(fgAll().empty()) return;
+  if(registry().fHandles.empty()) return;
 	ANSort ansort;
-  rb::data::MBasic::Map_t::iterator it;
-	std::vector<std::string> names;
-  for(it = fgAll().begin(); it != fgAll().end(); ++it) {
-		names.push_back(it->first);
-	}
+	std::vector<std::string> names = GetAll();
 	std::sort(names.begin(), names.end(), ansort);
 	for(UInt_t i=0; i< names.size(); ++i) {
-		it = fgAll().find(names[i]);
+		MBasic* m = Find(names[i].c_str());
 		std::stringstream val;
-		val << it->second->GetValue();
+		val << m->GetValue();
 		mxml_start_element(writer, "var");
-		mxml_write_attribute(writer, "name", it->first.c_str());
-		mxml_write_attribute(writer, "type", it->second->fDataMember->GetTrueTypeName());
+		mxml_write_attribute(writer, "name", m->fName.c_str());
+		mxml_write_attribute(writer, "type", m->fDataMember->GetTrueTypeName());
 		mxml_write_value(writer, val.str().c_str());
 		mxml_end_element(writer);
   }
@@ -287,17 +320,13 @@ void rb::data::MBasic::Printer::SaveXML(rb::XmlWriter* writer) {
 // void rb::data::MBasic::Printer::SavePrimitive()   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::data::MBasic::Printer::SavePrimitive(std::ostream& strm) {
-  if(fgAll().empty()) return;
+  if(registry().fHandles.empty()) return;
 	ANSort ansort;
-  rb::data::MBasic::Map_t::iterator it;
-	std::vector<std::string> names;
-  for(it = fgAll().begin(); it != fgAll().end(); ++it) {
-		names.push_back(it->first);
-	}
+	std::vector<std::string> names = GetAll();
 	std::sort(names.begin(), names.end(), ansort);
 	for(UInt_t i=0; i< names.size(); ++i) {
-		it = fgAll().find(names[i]);
-    strm << "  rb::Rb::Data::SetValue(\"" << it->first << "\", " << it->second->GetValue() << ");\n";
+		MBasic* m = Find(names[i].c_str());
+    strm << "  rb::Rb::Data::SetValue(\"" << names[i] << "\", " << m->GetValue() << ");\n";
   }
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -313,20 +342,15 @@ inline std::string double2str(Double_t d) {
 	return sstr.str();
 } }
 void rb::data::MBasic::Printer::PrintAll() {
-  if(fgAll().empty()) return;
-  std::vector<std::string> names, values, classes;
-
-  rb::data::MBasic::Map_t::iterator it = fgAll().begin();
-  while(it != fgAll().end()) {
-    names.push_back(it->first); ++it;
-	}
+  if(registry().fHandles.empty()) return;
+  std::vector<std::string> names = GetAll(), values, classes;
 	ANSort ansort;
 	std::sort(names.begin(), names.end(), ansort);
 
 	for(UInt_t i=0; i< names.size(); ++i) {
-		it = fgAll().find(names[i]);
-    values.push_back(double2str(it->second->GetValue()));
-    classes.push_back(it->second->fDataMember->GetTrueTypeName());
+		MBasic* m = Find(names[i].c_str());
+    values.push_back(double2str(m->GetValue()));
+    classes.push_back(m->fDataMember->GetTrueTypeName());
   }
   Int_t maxName  = max_element(names.begin(), names.end(), string_len_compare)->size();
   maxName = maxName > 4 ? maxName : 4;
@@ -341,20 +365,79 @@ void rb::data::MBasic::Printer::PrintAll() {
   } printf("\n");
 }
 
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                 //
+// rb::data::Transaction Implementation  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace {
+typedef std::vector<std::pair<rb::data::MBasic*, Double_t> > ChangeList_t;
+}
+Int_t rb::data::Transaction::fgDepth = 0;
+Int_t rb::data::Transaction::fgInEvent = 0;
+ULong64_t rb::data::Transaction::fgEpoch = 0;
+
+ChangeList_t& rb::data::Transaction::Staged() {
+	static ChangeList_t* v = new ChangeList_t();
+	return *v;
+}
+
+ChangeList_t& rb::data::Transaction::Committed() {
+	static ChangeList_t* v = new ChangeList_t();
+	return *v;
+}
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// const char* rb::data::MBasic::GetLeafName() //
+// void rb::data::Transaction::Begin() [static]//
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-const char* rb::data::MBasic::GetLeafName() {
-	for (Map_t::iterator it = fgAll().begin(); it != fgAll().end(); ++it) {
-		if(it->second == this) return it->first.c_str();
+void rb::data::Transaction::Begin() {
+	++fgDepth;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::data::Transaction::Commit() [static]//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::data::Transaction::Commit() {
+	if(fgDepth == 0) {
+		rb::err::Warning("rb::data::Transaction::Commit") << "No transaction is open.";
+		return false;
 	}
-	return "NOT FOUND";
+	if(--fgDepth > 0) return false;
+	Committed().insert(Committed().end(), Staged().begin(), Staged().end());
+	Staged().clear();
+	if(fgInEvent) return false;
+	Publish();
+	return true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Transaction::Abort() [static]//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Transaction::Abort() {
+	Staged().clear();
+	fgDepth = 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::data::Transaction::Stage() [static]//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::data::Transaction::Stage(MBasic* basic, Double_t value) {
+	if(fgDepth == 0) return false;
+	Staged().push_back(std::make_pair(basic, value));
+	return true;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Transaction::Publish() [static]//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Transaction::Publish() {
+	if(Committed().empty()) return;
+	for(ChangeList_t::iterator it = Committed().begin(); it != Committed().end(); ++it)
+		it->first->SetValue(it->second);
+	Committed().clear();
+	++fgEpoch;
 }
 
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Class                                 //
-// rb::data::Mapper Implementation       //
+// rb::data::Layout Implementation       //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 namespace { // Helper Functions & Class //
 inline Bool_t ShouldBeMapped(TDataMember* d, bool exclude_hash = true) {
@@ -376,359 +459,221 @@ private:
 	 Int_t fArrayLength;
 }; // class ArrayConverter
 }
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// void rb::data::Mapper::HandleBasic()   //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::data::Mapper::HandleBasic(TDataMember* d, const char* name) {
-	if(d->IsPersistent() == false) return;
-  Long_t addr = kBase + d->GetOffset();
-  Int_t nDim = d->GetArrayDim();
-  if(nDim == 0) { // not an array
-    rb::data::MBasic::New(name, reinterpret_cast<void*>(addr), d);
-  }
-  else if(d->GetArrayDim() > 4) { // too big
-		ERR_ARRAY_GREATER("HandleBasic", name, d, 4);
-	}
-  else {
-    ArrayConverter ac(d);
-    Int_t arrayLen = ac.GetArrayLength();
-    Int_t size = d->GetUnitSize();
-    for(Int_t i=0; i< arrayLen; ++i) {
-      addr += size*(i>0);
-      rb::data::MBasic::New(ac.GetFullName(name, i).c_str(), reinterpret_cast<void*>(addr), d);
-    }
-  }
-}
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// void rb::data::Mapper::HandleSTL()     //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::data::Mapper::HandleSTL(TDataMember* d, const char* name) {
-	if(d->IsPersistent() == false) return;
-  Long_t addr = kBase + d->GetOffset();
-  Int_t nDim = d->GetArrayDim();
-  if(nDim == 0) { // not an array
-    rb::data::MBasic::New(name, reinterpret_cast<void*>(addr), d);
-  }
-  else if(d->GetArrayDim() > 4) { // too big
-		ERR_ARRAY_GREATER("HandleSTL", name, d, 4);
-	}
-  else {
-    ArrayConverter ac(d);
-    Int_t arrayLen = ac.GetArrayLength();
-    Int_t size = d->GetUnitSize();
-    for(Int_t i=0; i< arrayLen; ++i) {
-      addr += size*(i>0);
-      rb::data::MBasic::New(ac.GetFullName(name, i).c_str(), reinterpret_cast<void*>(addr), d);
-    }
-  }
-}
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// void rb::data::Mapper::InsertBasic()   //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::data::Mapper::InsertBasic(TDataMember* d, std::vector<std::string>& v_names, const char* name) {
-	if(d->IsPersistent() == false) return;
-  Long_t addr = kBase + d->GetOffset();
-  Int_t nDim = d->GetArrayDim();
-  if(nDim == 0) { // not an array
-		v_names.push_back(name);
-  }
-  else if(d->GetArrayDim() > 4) { // too big
-		ERR_ARRAY_GREATER("InsertBasic", name, d, 4);
-	}
-  else {
-    ArrayConverter ac(d);
-    Int_t arrayLen = ac.GetArrayLength();
-    Int_t size = d->GetUnitSize();
-    for(Int_t i=0; i< arrayLen; ++i) {
-      addr += size*(i>0);
-			v_names.push_back(ac.GetFullName(name, i).c_str());
-    }
-  }
-}
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// void rb::data::Mapper::InsertSTL()     //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::data::Mapper::InsertSTL(TDataMember* d, std::vector<std::string>& v_names, const char* name) {
-	if(d->IsPersistent() == false) return;
-	static STLMaps stlMaps;
+namespace {
+typedef boost::unordered_map<std::string, rb::data::Layout*> LayoutMap_t;
 
-  Long_t addr = kBase + d->GetOffset();
-  Int_t nDim = d->GetArrayDim();
-  if(nDim == 0) { // not an array
-		v_names.push_back(name);
-  }
-  else if(d->GetArrayDim() > 4) { // too big
-		ERR_ARRAY_GREATER("InsertSTL", name, d, 4);
-	}
-  else {
-    ArrayConverter ac(d);
-    Int_t arrayLen = ac.GetArrayLength();
-		Int_t size = d->GetUnitSize();
-
-		// Loop over array elements
-    for(Int_t i=0; i< arrayLen; ++i) {
-			addr += size*(i>0); // address of the STL container
-			size_t lengthSTL = 0; // STL container length
-			STLLengthMap_t::iterator it =
-				stlMaps.GetLengthMap()->find(TClass::GetClass(d->GetTrueTypeName()));
-
-			if(it == stlMaps.GetLengthMap()->end()) { // no support for the requested STL container
-				rb::err::Error("MReader::New") << "No support for STL class: \"" << d->GetTrueTypeName()
-																	 << "\"." << ERR_FILE_LINE;
-				return;
-			}
-
-			lengthSTL = it->second((volatile void*)addr);
-			for(size_t j=0; j< lengthSTL; ++j) {
-				std::stringstream fullname;
-				fullname << ac.GetFullName(name, i) << "[" << j << "]";
-				v_names.push_back(fullname.str());
-			}
-    }
-  }
+/// Layouts built so far, by class name (never deleted)
+LayoutMap_t& layouts() {
+	static LayoutMap_t* m = new LayoutMap_t();
+	return *m;
 }
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// void rb::data::Mapper::MapClass()      //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-namespace {
+
 inline std::string append_name(const std::string& base, const char* toAppend) {
   std::stringstream out;
   out << base << "." << toAppend;
   return out.str();
 }
 }
-void rb::data::Mapper::MapClass() {
-  TClass* cl = TClass::GetClass(kClassName.c_str());
-  if(!cl) {
-		if(0)	rb::err::Warning("MapClass")
-						<< "Unable to map the class \"" << kClassName << "\" because it does not "
-						<< "have a ROOT Dictionary." << ERR_FILE_LINE;
-		return;
-	}
-  TList* dataMembers = cl->GetListOfDataMembers();
-  for(Int_t i=0; i< dataMembers->GetEntries(); ++i) {
-    TDataMember* d = reinterpret_cast<TDataMember*>(dataMembers->At(i));
-    if(!ShouldBeMapped(d)) continue;
-    std::string newName = append_name(kBranchName, d->GetName());
-    if(d->IsBasic())
-			HandleBasic(d, newName.c_str());
-		else if(d->IsSTLContainer())
-			HandleSTL(d, newName.c_str());
-    else {
-			Int_t nDim = d->GetArrayDim();
-			Long_t addr = kBase + d->GetOffset();
-			if(nDim == 0) { // single element, recurse into this class
-				Mapper sub_mapper(newName.c_str(), d->GetTrueTypeName(), addr, false);
-				sub_mapper.MapClass();
-			}
-			else if (nDim > 4) { // array to many dimensions - bail out
-				ERR_ARRAY_GREATER("MapClass", newName, d, 4);
-			}
-			else { // valid array, recurse into every element
-				ArrayConverter ac(d);
-				Int_t arrayLen = ac.GetArrayLength();
-				Int_t size = d->GetUnitSize();
-				for(Int_t i=0; i< arrayLen; ++i) {
-					Long_t addr_i = addr + size*i;
-					std::string name_i = ac.GetFullName(newName.c_str(), i); 
-					Mapper sub_mapper_i(name_i.c_str(), d->GetTrueTypeName(), addr_i, false);
-					sub_mapper_i.MapClass();
-				}
-			}
-    }
-  }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// const rb::data::Layout* rb::data::Layout::Get() [static]  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+const rb::data::Layout* rb::data::Layout::Get(const char* classname) {
+	LayoutMap_t::iterator it = layouts().find(classname);
+	if(it != layouts().end()) return it->second;
+	TClass* cl = TClass::GetClass(classname);
+	if(!cl) return 0; // not cached, the dictionary might still be loaded later
+	Layout* layout = new Layout(cl);
+	layouts().insert(std::make_pair(std::string(classname), layout));
+	return layout;
 }
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// void rb::data::Mapper::ReadBranches()  //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::data::Mapper::ReadBranches(std::vector<std::string>& branches) {
-  TClass* cl = TClass::GetClass(kClassName.c_str());
-  if(!cl) return;
-  TList* dataMembers = cl->GetListOfDataMembers();
-  for(Int_t i=0; i< dataMembers->GetEntries(); ++i) {
-    TDataMember* d = reinterpret_cast<TDataMember*>(dataMembers->At(i));
-    if(!ShouldBeMapped(d, false)) continue;
-
-    std::string newName = append_name(kBranchName, d->GetName());
-    if(d->IsBasic())
-			InsertBasic(d, branches, newName.c_str());
-		else if(d->IsSTLContainer())
-			InsertSTL(d, branches, newName.c_str());
-    else {
-			Int_t nDim = d->GetArrayDim();		
-      Long_t addr = kBase + d->GetOffset();
-			if (nDim == 0) { // single element
-				Mapper sub_mapper(newName.c_str(), d->GetTrueTypeName(), addr, false);
-				sub_mapper.ReadBranches(branches);
-			}
-			else if (nDim > 4) { // too large, error message and bail out
-				ERR_ARRAY_GREATER("ReadBranches", newName, d, 4);
-			}
-			else { // valid array
-				ArrayConverter ac(d);
-				Int_t arrayLen = ac.GetArrayLength();
-				Int_t size = d->GetUnitSize();
-				for(Int_t i=0; i< arrayLen; ++i) {
-					Long_t addr_i = addr + size*i;
-					std::string name_i = ac.GetFullName(newName.c_str(), i); 
-					Mapper sub_mapper_i(name_i.c_str(), d->GetTrueTypeName(), addr_i, false);
-					sub_mapper_i.ReadBranches(branches);
-				}				
-			}
-    }
-  }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::data::Layout::Layout(TClass* cl) {
+	AddClass(cl, "", 0, false, false, false);
 }
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// Long_t rb::data::Mapper::FindBasicAddr()   //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Layout::AddClass()    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Layout::AddClass(TClass* cl, const std::string& prefix, Long_t offset, Bool_t hidden, Bool_t transient, Bool_t inherited) {
+	// inherited members have no prefix of their own
+	TIter nextBase(cl->GetListOfBases());
+	while(TBaseClass* base = static_cast<TBaseClass*>(nextBase())) {
+		if(base->GetClassPointer())
+			AddClass(base->GetClassPointer(), prefix, offset + base->GetDelta(), hidden, transient, true);
+	}
 
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// Helper Function for STL containers         //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-namespace {
-inline Long_t FindSTLAddr(const char* name, Long_t baseAddr, TDataMember* dataMember, TRealData* realData) {
-	Long_t retval = 0;
-	Int_t nDim = dataMember->GetArrayDim();
-	static STLMaps stlMaps;
+	TList* dataMembers = cl->GetListOfDataMembers();
+	for(Int_t i=0; i< dataMembers->GetEntries(); ++i) {
+		TDataMember* d = reinterpret_cast<TDataMember*>(dataMembers->At(i));
+		std::string name = prefix.empty() ? std::string(d->GetName()) : append_name(prefix, d->GetName());
+		Bool_t isHidden = hidden || !ShouldBeMapped(d, true);
+		Bool_t isTransient = transient || !ShouldBeMapped(d, false);
+		Long_t addr = offset + d->GetOffset();
+
+		if(d->IsBasic() || d->IsSTLContainer()) {
+			AddMember(d, name, addr, isHidden, isTransient, inherited);
+			continue;
+		}
+		if(d->IsaPointer()) continue; // the pointee isn't part of the class
+		TClass* memberClass = TClass::GetClass(d->GetTrueTypeName());
+		if(!memberClass) continue;
 
-	if(nDim > 4) { // too big
-		ERR_ARRAY_GREATER("FindSTLAddr", name, dataMember, 4);
-	}
-	else if (nDim == 0) { // single element
-		STLAddrMap_t::iterator it = stlMaps.GetAddrMap()->find(TClass::GetClass(dataMember->GetTrueTypeName()));
-		if (it == stlMaps.GetAddrMap()->end()) {
-			rb::err::Error("FindSTLAddr")
-				<< "No support for the STL class: " << dataMember->GetTrueTypeName() << ERR_FILE_LINE;
+		Int_t nDim = d->GetArrayDim();
+		if(nDim == 0) { // single element, recurse into this class
+			AddClass(memberClass, name, addr, isHidden, isTransient, inherited);
 		}
-		else {
-			Long_t thisAddr = baseAddr + realData->GetThisOffset();
-			std::string strName(name);
-			int indx = get_final_index(&strName);
-			retval = it->second((volatile void*)thisAddr, indx);
+		else if (nDim > 4) { // array to many dimensions - bail out
+			ERR_ARRAY_GREATER("Layout", name, d, 4);
 		}
-	}
-	else { // valid aray
-		ArrayConverter ac(dataMember);
-		Int_t arrayLen = ac.GetArrayLength();
-		Int_t size = dataMember->GetUnitSize();
-		Long_t thisAddr = baseAddr + realData->GetThisOffset();
-
-		std::string name0 = name, name0_2 = name;
-		std::string strName = name0.substr(0, name0.rfind("["));
-		int indx = get_final_index(&name0_2);
-
-		for(Int_t i=0; i< arrayLen; ++i) {
-			thisAddr += size*(i>0);
-			std::string nnn = name0.rfind(".") < name0.size() ? name0.substr(0, name0.rfind(".") + 1) : "";
-			nnn += dataMember->GetName();
-
-			if(ac.GetFullName(nnn.c_str(), i) == strName) {
-				STLAddrMap_t::iterator it = stlMaps.GetAddrMap()->find(TClass::GetClass(dataMember->GetTrueTypeName()));
-				if (it == stlMaps.GetAddrMap()->end()) {
-					rb::err::Error("FindSTLAddr")
-						<< "No support for the STL class: " << dataMember->GetTrueTypeName() << ERR_FILE_LINE;
-				}
-				else {
-					retval = it->second((volatile void*)thisAddr, indx);
-					break;
-				}
-			}
+		else { // valid array, recurse into every element
+			ArrayConverter ac(d);
+			Int_t size = d->GetUnitSize();
+			for(Int_t j=0; j< ac.GetArrayLength(); ++j)
+				AddClass(memberClass, ac.GetFullName(name.c_str(), j), addr + size*j, isHidden, isTransient, inherited);
 		}
 	}
-	return retval;
 }
-} // namespace
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Layout::AddMember()   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Layout::AddMember(TDataMember* d, const std::string& name, Long_t offset, Bool_t hidden, Bool_t transient, Bool_t inherited) {
+	if(d->IsPersistent() == false) return;
+	Entry entry;
+	entry.fMember = d;
+	entry.fSTLAddr = 0;
+	entry.fSTLLength = 0;
+	entry.fHidden = hidden;
+	entry.fTransient = transient;
+	entry.fInherited = inherited;
 
-Long_t rb::data::Mapper::FindBasicAddr(const char* name, TDataMember** data_member) {
-  TClass* cl = TClass::GetClass(kClassName.c_str());
-	TRealData* realData = cl ? cl->GetRealData(name) : 0;
-	if(!realData && cl) { // try w/o brackets
-		std::string name2 = std::string(name).substr(0, std::string(name).find("["));
-		realData = cl->GetRealData(name2.c_str());
+	if(d->IsBasic()) {
+		entry.fReaderType = d->GetTrueTypeName();
 	}
-	TDataMember* dataMember = realData ? realData->GetDataMember() : 0;
-	if(!dataMember) return 0;
-
-	if(data_member) *data_member = dataMember;
-	Long_t retval = 0;
-
-	if( dataMember->IsBasic() && dataMember->IsPersistent() ) { // Handle Basic Data Types inline
-		Int_t nDim = dataMember->GetArrayDim();
-		if(nDim == 0) { // not an array
-			retval = kBase + realData->GetThisOffset();
-		}
-		else if(dataMember->GetArrayDim() > 4) { // too big
-			ERR_ARRAY_GREATER("FindBasic", name, dataMember, 4);
-		}
-		else {
-			ArrayConverter ac(dataMember);
-			Int_t arrayLen = ac.GetArrayLength();
-			Int_t size = dataMember->GetUnitSize();
-			Long_t addr = kBase + realData->GetThisOffset();
-			for(Int_t i=0; i< arrayLen; ++i) {
-				addr += size*(i>0);
-				std::string strName(name);
-				std::string nnn = strName.rfind(".") < strName.size() ? strName.substr(0, strName.rfind(".") + 1) : "";
-				nnn += dataMember->GetName();
-				if(ac.GetFullName(nnn.c_str(), i) == strName) {
-					retval = addr;
-					break;
-				}
-			}
+	else {
+		static STLMaps stlMaps;
+		TClass* stl = TClass::GetClass(d->GetTrueTypeName());
+		STLAddrMap_t::iterator it = stlMaps.GetAddrMap()->find(stl);
+		if(it == stlMaps.GetAddrMap()->end()) { // no support for the requested STL container
+			rb::err::Error("Layout") << "No support for STL class: \"" << d->GetTrueTypeName()
+															 << "\"." << ERR_FILE_LINE;
+			return;
 		}
+		entry.fSTLAddr = it->second;
+		entry.fSTLLength = (*stlMaps.GetLengthMap())[stl];
+		entry.fReaderType = (*stlMaps.GetBasicTypeMap())[stl];
 	}
 
-	else if (dataMember->IsSTLContainer()  && dataMember->IsPersistent() ) { // delegate to FindSTLAddr function
-		retval = FindSTLAddr(name, kBase, dataMember, realData);
+	Int_t nDim = d->GetArrayDim();
+	if(nDim > 4) { // too big
+		ERR_ARRAY_GREATER("Layout", name, d, 4);
+		return;
+	}
+	if(nDim == 0) { // not an array
+		entry.fName = name;
+		entry.fOffset = offset;
+		fIndex[entry.fName] = fEntries.size();
+		fEntries.push_back(entry);
+		return;
 	}
+	ArrayConverter ac(d);
+	Int_t size = d->GetUnitSize();
+	for(Int_t i=0; i< ac.GetArrayLength(); ++i) {
+		entry.fName = ac.GetFullName(name.c_str(), i);
+		entry.fOffset = offset + size*i;
+		fIndex[entry.fName] = fEntries.size();
+		fEntries.push_back(entry);
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::data::Layout::Find()             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+const rb::data::Layout::Entry* rb::data::Layout::Find(const std::string& name) const {
+	boost::unordered_map<std::string, size_t>::const_iterator it = fIndex.find(name);
+	return it == fIndex.end() ? 0 : &fEntries[it->second];
+}
+
 
-	else if (dataMember->GetArrayDim() > 0) { // upper-level array
-		if(dataMember->GetArrayDim() > 4) { // to large
-			ERR_ARRAY_GREATER("FindBasic", name, dataMember, 4);
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                //
+// rb::data::Mapper Implementation      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Mapper::MapClass()    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Mapper::MapClass() {
+	const Layout* layout = Layout::Get(kClassName.c_str());
+	if(!layout) return;
+	std::vector<Layout::Entry>::const_iterator it;
+	for(it = layout->GetEntries().begin(); it != layout->GetEntries().end(); ++it) {
+		if(it->fHidden || it->fInherited) continue;
+		std::string name = append_name(kBranchName, it->fName.c_str());
+		rb::data::MBasic::New(name.c_str(), reinterpret_cast<void*>(kBase + it->fOffset), it->fMember);
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::Mapper::ReadBranches()  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::Mapper::ReadBranches(std::vector<std::string>& branches) {
+	const Layout* layout = Layout::Get(kClassName.c_str());
+	if(!layout) return;
+	std::vector<Layout::Entry>::const_iterator it;
+	for(it = layout->GetEntries().begin(); it != layout->GetEntries().end(); ++it) {
+		if(it->fTransient || it->fInherited) continue;
+		std::string name = append_name(kBranchName, it->fName.c_str());
+		if(!it->fSTLLength) {
+			branches.push_back(name);
+			continue;
 		}
-		else { // okay - parse as array
-			std::string strName = name, strName2(name), strName3(name);
-			strName = strName.substr(0, strName.find("]") + 1); // name of this element
-			strName2 = strName2.substr(strName2.find("]") + 2); // name of next elements
-			strName3 = strName2.substr(0, strName2.find("."));  // name of next element, top level only
-
-			size_t index = get_final_index(&strName);
-			Long_t addr = kBase + realData->GetThisOffset() + index*dataMember->GetUnitSize();
-			Mapper sub_mapper(strName3.c_str(), dataMember->GetTrueTypeName(), addr, false);
-			retval = sub_mapper.FindBasicAddr(strName2.c_str(), data_member);
+		if(!kBase) continue; // STL lengths are only known for an actual instance
+		size_t lengthSTL = it->fSTLLength(reinterpret_cast<volatile void*>(kBase + it->fOffset));
+		for(size_t j=0; j< lengthSTL; ++j) {
+			std::stringstream fullname;
+			fullname << name << "[" << j << "]";
+			branches.push_back(fullname.str());
 		}
 	}
-
-	else { // bail out
-		rb::err::Error("FindBasicAddr") << "Unsupported \"final\" data type: "
-																<< dataMember->GetTrueTypeName() << ERR_FILE_LINE;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Long_t rb::data::Mapper::Find()      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Long_t rb::data::Mapper::Find(const char* name, const Layout::Entry** entry) {
+	*entry = 0;
+	const Layout* layout = Layout::Get(kClassName.c_str());
+	if(!layout) return 0;
+
+	std::string strName(name);
+	*entry = layout->Find(strName);
+	if(*entry) return (*entry)->fSTLAddr ? 0 : kBase + (*entry)->fOffset;
+
+	// element of an STL container: "name[i]"
+	int indx = get_final_index(&strName);
+	if(indx < 0) return 0;
+	*entry = layout->Find(strName);
+	if(!*entry || !(*entry)->fSTLAddr) {
+		*entry = 0;
+		return 0;
 	}
+	return kBase ? (*entry)->fSTLAddr(reinterpret_cast<volatile void*>(kBase + (*entry)->fOffset), indx) : 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Long_t rb::data::Mapper::FindBasicAddr()  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Long_t rb::data::Mapper::FindBasicAddr(const char* name, TDataMember** data_member) {
+	const Layout::Entry* entry = 0;
+	Long_t retval = Find(name, &entry);
+	if(entry && data_member) *data_member = entry->fMember;
 	return retval;
 }
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-// rb::data::MReader* rb::data::Mapper::FindBasicReader()   //
-//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::data::MReader* rb::data::Mapper::FindBasicReader()  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::data::MReader* rb::data::Mapper::FindBasicReader(const char* name, TDataMember** data_member) {
-	TDataMember* d = 0;
-	Long_t retval = FindBasicAddr(name, &d);
+	const Layout::Entry* entry = 0;
+	Long_t retval = Find(name, &entry);
 	if(!retval) return 0;
-	assert(retval);
-	if(data_member) *data_member = d;
-	if(d && d->IsBasic()) {
-		return retval ? rb::data::MReader::New(d->GetTrueTypeName(), retval) : 0;
-	}
-	else {
-		static STLMaps stlMaps;
-		STLBasicTypeMap_t::iterator it = stlMaps.GetBasicTypeMap()->find(TClass::GetClass(d->GetTrueTypeName()));
-		if(it == stlMaps.GetBasicTypeMap()->end()) {
-			rb::err::Error("FindBasicReader")
-				<< "Couldn't figure out the basic type stored in container: \""
-				<< d->GetTrueTypeName() << "\"" << ERR_FILE_LINE;
-			return 0;
-		}
-		std::string strType = it->second;
-		return retval ? rb::data::MReader::New(strType.c_str(), retval) : 0;
-	}
+	if(data_member) *data_member = entry->fMember;
+	return rb::data::MReader::New(entry->fReaderType.c_str(), retval);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::data::Mapper::Message()       //
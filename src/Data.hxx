@@ -19,6 +19,7 @@
 #include "utils/LockingPointer.hxx"
 #ifndef __MAKECINT__
 #include "boost/scoped_ptr.hpp"
+#include "boost/unordered_map.hpp"
 #else
 namspace boost { template <class T> class scoped_ptr; }
 #endif
@@ -33,23 +34,29 @@ typedef struct mxml_writer XmlWriter;
 namespace data
 {
 /// \brief Abstract base class facilitating access to the values of basic data members of user's classes in CINT.
-//! \details See data::Basic <T> documentation for more info.
+//! \details See data::Basic <T> documentation for more info. Every instance is kept in a registry
+//! indexed by a hash of its (leaf) name, and gets a handle - its position in the registry - which never
+//! changes, so scripts and the GUI can look a variable up once and then use the handle.
 class MBasic
 {
 public:
-	typedef std::map<std::string, MBasic*> Map_t;
+	/// Stable handle of a variable, see rb::data::GetHandle()
+	typedef Int_t Handle_t;
+	/// Handle returned for names that aren't registered
+	static const Handle_t kInvalidHandle = -1;
 protected:
-	//! Maps the base name of each data class to a pointer to its corresponding
-	//! data::MBasic instance
-	static MBasic::Map_t& fgAll() {
-		static MBasic::Map_t* m = new MBasic::Map_t();
-		return *m;
-	}
+	//! Leaf name, also the registry key
+	std::string fName;
+	//! Position in the registry
+	Handle_t fHandle;
 	//! The type of basic data (int, double, etc.)
 	const TDataMember* fDataMember;
+	//! \brief Add \c this to the registry under _name_
+	//! \details If the name is taken, the instance registered first keeps it (and \c this gets no handle).
+	void Register(const char* name);
 public:
 	//! Sets fDataMember
-	MBasic(const TDataMember* d): fDataMember(d) {}
+	MBasic(const TDataMember* d): fName(), fHandle(kInvalidHandle), fDataMember(d) {}
 	//! Nothing to do
 	virtual ~MBasic() {}
 	//! Pure virtual, see rb::data::Basic
@@ -59,18 +66,24 @@ public:
 	//! Pure virtual, see rb::data::Basic
 	virtual Long_t GetAddress() = 0;
 	//! Returns the leaf name of this instance
-	const char* GetLeafName();
+	const char* GetLeafName() { return fName.c_str(); }
+	//! Returns the handle of this instance
+	Handle_t GetHandle() { return fHandle; }
 	//! Returns a vector containing the names of all variables.
 	static std::vector<std::string> GetAll();
 	//! Search for an instance of Basic*
 	//! \param [in] leafName The name (how it would be referred to in TTree::Draw) of the class instance being searched for.
 	static MBasic* Find(const char* leafName);
+	//! Handle of the instance called _leafName_, kInvalidHandle if there is none
+	static Handle_t FindHandle(const char* leafName);
+	//! Instance with handle _handle_, 0 if the handle is invalid
+	static MBasic* Get(Handle_t handle);
 	//! Allocate a \c new instance of data::MBasic.
 	//! \returns A heap allocated instance of a data::MBasic-derived class (i.e. some data::Basic template class). It is
 	//! automatically caseted to the correct type based on the <i>basic_type_name</i> input parameter.
 	static void New(const char* name, volatile void* addr, TDataMember* element);
 
-  //! Prints or writes to a stream information on each entry in fgAll.
+  //! Prints or writes to a stream information on each registered variable.
 	class Printer
 	{
  public:
@@ -145,12 +158,13 @@ public:
 //!
 //! The basic funtion of this template class is three-fold:
 //!    -# It encapsulates the memory address of the each basic data member.
-//!    -# A pointer to each instance of data::Basic<T> is stored in the global std::map
-//!       data::MBasic::fgAll, keyed by the "name" (leaf name) of its corresponding basic
-//!       data member.
+//!    -# A pointer to each instance of data::Basic<T> is stored in the data::MBasic registry,
+//!       keyed by the "name" (leaf name) of its corresponding basic data member.
 //!    -# The class allows (read and write) access to the values of its encapsulated basic data
-//!       through SetValue() and GetValue() member functions. Note that each of these functions
-//!       locks a mutex, ensuring thread safety.
+//!       through SetValue() and GetValue() member functions. Values that fit in a machine word are
+//!       read and written with a single (untearable) access and without taking a lock; events are
+//!       processed from the attach timers on the main thread, so a change made from CINT always lands
+//!       between two events.
 //!
 //! Instances of this class are created from the constructor of rb::data::Wrapper <T>, whenever the user
 //! requests that his/her class be mapped by specifying the <i>makeVisible</i> argument of rb::data::Wrapper::Wrapper
@@ -212,7 +226,7 @@ private:
 	//! \note Marked volatile so that all access has to be through LockingPointers.
 	volatile T * fAddress;
 public:
-	/// \brief Sets fAddress and inserts \c this into data::MBasic::fgAll.
+	/// \brief Sets fAddress and inserts \c this into the data::MBasic registry.
 	//! \details Also, in the case of an array, it iterates through the whole array and
 	//! creates a new instance of data::Basic for each element.
 	Basic(const char* name, volatile void* addr, const TDataMember* d);
@@ -235,7 +249,7 @@ private:
 	//! \note Marked volatile so that all access has to be through LockingPointers.
 	const T* const fAddress;
 public:
-	/// \brief Sets fAddress and inserts \c this into data::MBasic::fgAll.
+	/// \brief Sets fAddress and inserts \c this into the data::MBasic registry.
 	//! \details Also, in the case of an array, it iterates through the whole array and
 	//! creates a new instance of data::Basic for each element.
 	ConstBasic(const char* name, volatile void* addr, const TDataMember* d);
@@ -249,7 +263,122 @@ public:
 	virtual ~ConstBasic();
 };
 
-//! Helper class to perform the actual mapping of name -> address for basic data members of user classes.
+#ifndef __MAKECINT__
+/// \brief Staging area for variable changes that have to take effect together.
+//! \details Between Begin() and Commit(), rb::data::SetValue() only records the new values. Commit()
+//! then publishes all of them in one pass between two events: right away if no event is being
+//! processed, otherwise as soon as that event is done (see EventScope). Every publication
+//! increments the epoch, which rb::Event::Save writes with each event ("rb_epoch" branch), so events
+//! can be matched to the calibration they were processed with.
+class Transaction
+{
+private:
+	/// Changes recorded since Begin(), in order
+	static std::vector<std::pair<MBasic*, Double_t> >& Staged();
+	/// Changes committed but not yet published
+	static std::vector<std::pair<MBasic*, Double_t> >& Committed();
+	/// Nesting depth of Begin() calls
+	static Int_t fgDepth;
+	/// Number of events currently being processed
+	static Int_t fgInEvent;
+	/// Number of publications so far
+	static ULong64_t fgEpoch;
+	/// Apply the committed changes (if any)
+	static void Publish();
+	/// Static members only
+	Transaction();
+
+public:
+	/// \brief Start recording changes.
+	//! \details Calls nest: only the outermost Commit() publishes.
+	static void Begin();
+	/// \brief Publish the changes recorded since Begin().
+	//! \returns true if they were applied right away, false if they wait for the current event to end
+	//! (or if this closed a nested transaction).
+	static Bool_t Commit();
+	/// Drop the changes recorded since Begin() and close all open transactions
+	static void Abort();
+	/// Is a transaction open?
+	static Bool_t IsOpen() { return fgDepth > 0; }
+	/// Record a change of _basic_ if a transaction is open; returns false (and does nothing) otherwise
+	static Bool_t Stage(MBasic* basic, Double_t value);
+	/// Number of publications so far
+	static ULong64_t GetEpoch() { return fgEpoch; }
+	/// Address of the epoch, for branching
+	static ULong64_t* GetEpochAddress() { return &fgEpoch; }
+
+	/// \brief Marks the processing of one event (see rb::Event::Process()).
+	//! \details Holds back changes committed while the event is processed, and publishes them once
+	//! it is done (so they don't wait for another event, which may never come).
+	struct EventScope
+	{
+		EventScope() { Publish(); ++fgInEvent; }
+		~EventScope() { if(--fgInEvent == 0) Publish(); }
+	};
+};
+
+/// \brief Flattened layout of a class: every basic (or STL container) data member below it, by name.
+//! \details Built from the TClass/TDataMember metadata the first time a class is needed, and kept for the
+//! rest of the session, so looking up a formula variable is a single hash lookup rather than a walk
+//! through the dictionary. Names are relative to the class and spelled as in TTree::Draw(), e.g.
+//! "a.b[2].c"; arrays are expanded into one entry per element, while STL containers get one entry whose
+//! elements are looked up as "name[i]" when needed (their length changes event by event).
+//! \note Not thread safe: layouts are built from the main thread (histogram, formula and GUI creation).
+class Layout
+{
+public:
+	/// Address of element _i_ of the STL container at _addr_ (0 if out of range)
+	typedef Long_t (*STLAddr_t)(volatile void* addr, size_t i);
+	/// Length of the STL container at _addr_
+	typedef size_t (*STLLength_t)(volatile void* addr);
+
+	/// One basic data member or STL container
+	struct Entry {
+		/// Name relative to the class
+		std::string fName;
+		/// Offset from the start of the class
+		Long_t fOffset;
+		/// Data member describing the entry
+		TDataMember* fMember;
+		/// Type to pass to MReader::New() (the element type for STL containers)
+		std::string fReaderType;
+		/// Element address function for STL containers, 0 otherwise
+		STLAddr_t fSTLAddr;
+		/// Length function for STL containers, 0 otherwise
+		STLLength_t fSTLLength;
+		/// Is it inside a member excluded from CINT with a <tt>//#</tt> comment?
+		Bool_t fHidden;
+		/// Is it inside a member excluded from trees with a <tt>//!</tt> comment?
+		Bool_t fTransient;
+		/// Does it come from a base class? (found by name, but not listed or mapped for CINT)
+		Bool_t fInherited;
+	};
+
+private:
+	/// Entries in declaration order
+	std::vector<Entry> fEntries;
+	/// Index into fEntries by name
+	boost::unordered_map<std::string, size_t> fIndex;
+
+	/// Walk the members of _cl_
+	Layout(TClass* cl);
+	/// Add the members of _cl_, located at _offset_ and named _prefix_._member_
+	void AddClass(TClass* cl, const std::string& prefix, Long_t offset, Bool_t hidden, Bool_t transient, Bool_t inherited);
+	/// Add one basic or STL member (one entry per array element)
+	void AddMember(TDataMember* d, const std::string& name, Long_t offset, Bool_t hidden, Bool_t transient, Bool_t inherited);
+
+public:
+	/// Layout of _classname_, built on first use; 0 if ROOT has no dictionary for it
+	static const Layout* Get(const char* classname);
+	/// All entries, in declaration order
+	const std::vector<Entry>& GetEntries() const { return fEntries; }
+	/// Entry called _name_, 0 if there is none
+	const Entry* Find(const std::string& name) const;
+};
+#endif
+
+//! \brief Helper class to perform the actual mapping of name -> address for basic data members of user classes.
+//! \details All lookups are served from the class's rb::data::Layout, which is only built once.
 class Mapper
 {
 private:
@@ -278,14 +407,11 @@ public:
 	//! \param [out] data_member Optional, is set to the TDataMember corresponding to \e name
 	MReader* FindBasicReader(const char* name, TDataMember** data_member = 0);
 private:
-	//! Handle a basic element, create a new instance of MBasic data for each array element.
-	void HandleBasic(TDataMember* d, const char* name);
-	//! Insert basic element names into a vector of strings, handles arrays similar to HandleBasic
-	void InsertBasic(TDataMember* d, std::vector<std::string>& v_names, const char* name);
-	//! Handle a STL element, create a new instance of MBasic data for each array element.
-	void HandleSTL(TDataMember* d, const char* name);
-	//! Insert STL element names into a vector of strings, handles arrays similar to HandleSTL
-	void InsertSTL(TDataMember* d, std::vector<std::string>& v_names, const char* name);
+#ifndef __MAKECINT__
+	//! \brief Look up _name_ in the class's Layout.
+	//! \returns The address of the datum (0 if not found); _entry_ is set to the entry it belongs to.
+	Long_t Find(const char* name, const Layout::Entry** entry);
+#endif
 	//! Adds a message to rb::Rint::fMessage indicating that a class's basic data has been mapped out.
 	void Message();
 };
@@ -428,7 +554,7 @@ public:
 template <class T>
 inline rb::data::Basic<T>::Basic(const char* name, volatile void* addr, const TDataMember* d) :
   MBasic(d), fAddress(reinterpret_cast<volatile T*>(addr)) {
-  fgAll().insert(std::make_pair<std::string, MBasic*>(name, this));
+  Register(name);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Destructor                 //
@@ -441,6 +567,7 @@ inline rb::data::Basic<T>::~Basic() {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 template <class T>
 inline Double_t rb::data::Basic<T>::GetValue() {
+  if(sizeof(T) <= sizeof(Long_t)) return static_cast<Double_t>(*fAddress); // single load
   LockingPointer<T> p(fAddress, gDataMutex);
   return *p;
 }
@@ -449,6 +576,7 @@ inline Double_t rb::data::Basic<T>::GetValue() {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 template <class T>
 inline void rb::data::Basic<T>::SetValue(Double_t newval) {
+  if(sizeof(T) <= sizeof(Long_t)) { *fAddress = T(newval); return; } // single store
   LockingPointer<T> p(fAddress, gDataMutex);
   *p = T(newval);
 }
@@ -457,8 +585,7 @@ inline void rb::data::Basic<T>::SetValue(Double_t newval) {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 template <class T>
 inline Long_t rb::data::Basic<T>::GetAddress() {
-  LockingPointer<T> p(fAddress, gDataMutex);
-  return reinterpret_cast<Long_t>(p.Get());
+  return reinterpret_cast<Long_t>(fAddress);
 }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -472,7 +599,7 @@ inline Long_t rb::data::Basic<T>::GetAddress() {
 template <class T>
 inline rb::data::ConstBasic<T>::ConstBasic(const char* name, volatile void* addr, const TDataMember* d) :
   MBasic(d), fAddress((const T*)addr) {
-  fgAll().insert(std::make_pair<std::string, MBasic*>(name, this));
+  Register(name);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Destructor                 //
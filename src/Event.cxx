@@ -1,17 +1,44 @@
 //! \file Event.cxx
 //! \brief Implements Event.hxx
 #include <cassert>
+#include <TKey.h>
 #include "Event.hxx"
 #include "Rint.hxx"
+#include "Data.hxx"
+#include "Gate.hxx"
 #include "hist/Hist.hxx"
 #include "utils/Logger.hxx"
+#include "utils/Timer.hxx"
+#include "Profile.hxx"
 
 namespace {
 const bool formulaPrint = true;
+
+// Periodically snapshots the histograms of every event being saved.
+class SnapshotTimer: public rb::Timer
+{
+public:
+	// Seconds between snapshots (0 if off)
+	Int_t fInterval;
+	SnapshotTimer(): rb::Timer(0), fInterval(0) { }
+private:
+	void DoAction() {
+		rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
+		for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+			rb::Event* event = rb::Rint::gApp()->GetEvent(it->first);
+			if(event) event->SnapshotSave();
+		}
+	}
+};
+
+// Global (file scope) snapshot timer instance
+SnapshotTimer gSnapshotTimer;
 }
 
 namespace rb { rb::Mutex gDataMutex("gDataMutex"); }
 
+ULong64_t rb::Event::fgSerial = 0;
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Class                                                 //
 // rb::Event                                             //
@@ -21,7 +48,8 @@ namespace rb { rb::Mutex gDataMutex("gDataMutex"); }
 // Constructor                                           //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::Event::Event(): fTree(new TTree("tree", "Rootbeer event tree")),
-										fHistManager(), fSave(new rb::Event::Save(this))
+										fHistManager(), fNevents(0), fNfailed(0),
+										fSave(new rb::Event::Save(this))
 {									
   LockingPointer<TTree> pTree(fTree, gDataMutex);
   pTree->SetDirectory(0);
@@ -32,6 +60,13 @@ rb::Event::Event(): fTree(new TTree("tree", "Rootbeer event tree")),
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::Event::Process(const void* event_address, Int_t nchar) {
 	RB_LOG << "Processing new event...\n";
+	++fNevents;
+	++fgSerial;
+	// Committed variable changes take effect here, never in the middle of an event
+	rb::data::Transaction::EventScope transaction;
+#ifdef RB_PROFILE
+	if(rb::profile::BeginEvent()) { ProcessProfiled(event_address, nchar); return; }
+#endif
   Bool_t success = false;
   {
     rb::ScopedLock<TVirtualMutex> cint_lock (gCINTMutex);
@@ -45,14 +80,50 @@ void rb::Event::Process(const void* event_address, Int_t nchar) {
     }
   } // Locks go out of scope & unlock
  if(success) fHistManager.FillAll();
- else HandleBadEvent();
+ else { ++fNfailed; HandleBadEvent(); }
 }
+#ifdef RB_PROFILE
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::Event::ProcessProfiled()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::Event::ProcessProfiled(const void* event_address, Int_t nchar) {
+	ULong64_t cycles[rb::profile::kNstages] = { 0, 0, 0, 0 };
+  Bool_t success = false;
+  {
+    rb::ScopedLock<TVirtualMutex> cint_lock (gCINTMutex);
+    LockingPointer<TTree> pTree(fTree, gDataMutex);
+		LockFreePointer<rb::Event::Save> pSave(fSave);
+		ULong64_t t0 = rb::profile::Cycles();
+    success = DoProcess(event_address, nchar);
+		ULong64_t t1 = rb::profile::Cycles();
+		cycles[rb::profile::kUnpack] = t1 - t0;
+    if(success) {
+      pTree->Fill();
+      pTree->LoadTree(0);
+			ULong64_t t2 = rb::profile::Cycles();
+			pSave->Fill();
+			ULong64_t t3 = rb::profile::Cycles();
+			cycles[rb::profile::kTreeFill] = t2 - t1;
+			cycles[rb::profile::kSave] = t3 - t2;
+    }
+  } // Locks go out of scope & unlock
+ if(success) {
+	 ULong64_t t4 = rb::profile::Cycles();
+	 fHistManager.FillAll();
+	 cycles[rb::profile::kHistograms] = rb::profile::Cycles() - t4;
+ }
+ else { ++fNfailed; HandleBadEvent(); }
+ rb::profile::EndEvent();
+ rb::profile::AddEvent(this, cycles);
+}
+#endif
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::Event::StartSave()                           //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::Event::StartSave(boost::shared_ptr<TFile> file, const char* name, const char* title, Bool_t save_hists) {
+void rb::Event::StartSave(boost::shared_ptr<TFile> file, const char* name, const char* title, Bool_t save_hists,
+												 Long64_t entries) {
 	LockingPointer<rb::Event::Save> pSave(fSave, gDataMutex);
-	pSave->Start(file, name, title, save_hists);
+	pSave->Start(file, name, title, save_hists, entries);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::Event::StopSave()                            //
@@ -62,6 +133,34 @@ void rb::Event::StopSave() {
 	pSave->Stop();
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Long64_t rb::Event::FlushSave()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Long64_t rb::Event::FlushSave() {
+	LockingPointer<rb::Event::Save> pSave(fSave, gDataMutex);
+	return pSave->Flush();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::Event::SnapshotSave()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::Event::SnapshotSave() {
+	LockingPointer<rb::Event::Save> pSave(fSave, gDataMutex);
+	return pSave->Snapshot();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::Event::SetSnapshotInterval() [static]        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::Event::SetSnapshotInterval(Int_t seconds) {
+	gSnapshotTimer.Stop();
+	gSnapshotTimer.fInterval = seconds > 0 ? seconds : 0;
+	if(gSnapshotTimer.fInterval) gSnapshotTimer.Start(1000*gSnapshotTimer.fInterval);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::Event::GetSnapshotInterval() [static]       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::Event::GetSnapshotInterval() {
+	return gSnapshotTimer.fInterval;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // rb::Event::GetBranchList()                            //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 std::vector< std::pair<std::string, std::string> > rb::Event::GetBranchList() {
@@ -89,6 +188,14 @@ rb::hist::Base* rb::Event::FindHistogram(const char* name, TDirectory* owner) {
 // Bool_t rb::Event::InitFormula::Operate()              //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::DataFormula* rb::Event::InitFormula::Operate(rb::Event* const event, const char* formula_arg) {
+	// Expressions using named gates are nodes of the gate graph (see rb::gate::New())
+	rb::gate::Graph* gates = rb::gate::Graph::Get(event, kFALSE);
+	const Int_t node = gates ? gates->Compile(formula_arg) : -1;
+	if(node >= 0) {
+		if(formulaPrint) rb::err::Info("InitFormula") << "Using gate graph to evaluate \"" << formula_arg << "\"";
+		return new rb::gate::GateDataFormula(gates, node);
+	}
+
   LockFreePointer<TTree> pTree(event->fTree);
 	TBranch* branch = reinterpret_cast<TBranch*>(pTree->GetListOfBranches()->At(0));
 	assert(branch);
@@ -143,23 +250,47 @@ Bool_t rb::Event::BranchAdd::Operate(rb::Event* const event, const char* name, c
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::Event::Save::Start()                         //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::Event::Save::Start(boost::shared_ptr<TFile> file, const char* name, const char* title, Bool_t save_hists) {
+void rb::Event::Save::Start(boost::shared_ptr<TFile> file, const char* name, const char* title, Bool_t save_hists,
+														Long64_t entries) {
 	TDirectory* current = gDirectory;
 	fFile = file;
 	fFile->cd();
 	fSaveHistograms = save_hists;
+	fEvent->fHistManager.ForgetWritten();
 	LockFreePointer<TTree> pEventTree(fEvent->fTree);
-	fTree = new TTree(pEventTree->GetName(), pEventTree->GetTitle());
+	// Continue a tree already in the file (resuming from a checkpoint), or make a new one.
+	TTree* existing = strcmp(name, "") ? dynamic_cast<TTree*>(fFile->Get(name)) : 0;
+	if(existing && entries >= 0 && existing->GetEntries() > entries) {
+		// Entries auto-saved after the checkpoint are read again: keep only the ones before it, in a
+		// copy, and drop the old tree headers (their baskets are left as unused space).
+		TTree* kept = existing->CloneTree(entries);
+		delete existing;
+		std::vector<TKey*> old;
+		TIter next(fFile->GetListOfKeys());
+		while(TKey* key = static_cast<TKey*>(next()))
+			if(!strcmp(key->GetName(), name)) old.push_back(key);
+		for(size_t i=0; i< old.size(); ++i) {
+			old[i]->Delete();
+			delete old[i];
+		}
+		existing = kept;
+	}
+	fTree = existing ? existing : new TTree(pEventTree->GetName(), pEventTree->GetTitle());
 	if(strcmp(name, "")) fTree->SetName(name);
 	if(strcmp(title, "")) fTree->SetTitle(title);
 	std::string br_name = "", br_clname = "";
+	fBranchAddr.clear();
 	for(int i=0; i< pEventTree->GetListOfBranches()->GetEntries(); ++i) {
 		TBranch* branch = static_cast<TBranch*>(pEventTree->GetListOfBranches()->At(i));
 		br_name = branch->GetName();
 		br_clname = branch->GetClassName();
 		fBranchAddr.push_back(reinterpret_cast<void**>(branch->GetAddress()));
-		fTree->Branch(br_name.c_str(), br_clname.c_str(), fBranchAddr.at(i));
+		if(existing) fTree->SetBranchAddress(br_name.c_str(), fBranchAddr.at(i));
+		else fTree->Branch(br_name.c_str(), br_clname.c_str(), fBranchAddr.at(i));
 	}
+	// Number of variable updates published before each event (see rb::data::GetEpoch())
+	if(!existing) fTree->Branch("rb_epoch", rb::data::Transaction::GetEpochAddress(), "rb_epoch/l");
+	else if(fTree->GetBranch("rb_epoch")) fTree->SetBranchAddress("rb_epoch", rb::data::Transaction::GetEpochAddress());
 	fIsActive = true;
 	if(current) current->cd();
 	else gROOT->cd();
@@ -175,7 +306,9 @@ void rb::Event::Save::Stop() {
 	fTree->GetCurrentFile();
 	fTree->AutoSave();
 	fTree->ResetBranchAddresses();
-	if(fSaveHistograms) fEvent->fHistManager.WriteAll(fFile.get());
+	// Only what changed since the last snapshot (everything if there was none)
+	if(fSaveHistograms) fEvent->fHistManager.WriteChanged(fFile.get());
+	fEvent->fHistManager.ForgetWritten();
 	if(current) current->cd();
 	else gROOT->cd();
 	if(fFile.get()) fFile.reset();
@@ -188,6 +321,32 @@ void rb::Event::Save::Fill() {
 	if(fIsActive && fTree) fTree->Fill();
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Long64_t rb::Event::Save::Flush()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Long64_t rb::Event::Save::Flush() {
+	if(!fIsActive || !fTree) return -1;
+	TDirectory* current = gDirectory;
+	fFile->cd();
+	fTree->AutoSave("SaveSelf");
+	if(current) current->cd();
+	else gROOT->cd();
+	return fTree->GetEntries();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::Event::Save::Snapshot()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::Event::Save::Snapshot() {
+	if(!fIsActive || !fSaveHistograms || !fFile.get()) return 0;
+	TDirectory* current = gDirectory;
+	fFile->cd();
+	if(fTree) fTree->AutoSave("SaveSelf");
+	Int_t nwritten = fEvent->fHistManager.WriteChanged(fFile.get());
+	fFile->SaveSelf(kTRUE); // so the new keys can be read back after a crash
+	if(current) current->cd();
+	else gROOT->cd();
+	return nwritten;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::Event::RunBegin::operator()                  //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::Event::RunBegin::operator() (const std::pair<Int_t, std::string>& e) {
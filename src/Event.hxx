@@ -3,6 +3,7 @@
 #ifndef EVENT_HXX
 #define EVENT_HXX
 #include <set>
+#include <map>
 #include <memory>
 #include <vector>
 #include <utility>
@@ -56,13 +57,39 @@ private:
 	//! Manages histograms associated with the event
 	hist::Manager fHistManager;
 
+	//! Number of events processed (successfully or not)
+	ULong64_t fNevents;
+
+	//! Number of events for which DoProcess() failed
+	ULong64_t fNfailed;
+
+	//! Number of events processed by every event processor together
+	static ULong64_t fgSerial;
+
 public:
-	//! Start saving the output to a root tree on disk.
-	void StartSave(boost::shared_ptr<TFile> file, const char* name, const char* title, Bool_t save_hists = false);
+	//! \brief Start saving the output to a root tree on disk.
+	//! \details If _file_ already has a tree called _name_ (resuming from a checkpoint), it is continued,
+	//! with only its first _entries_ entries (all of them if negative).
+	void StartSave(boost::shared_ptr<TFile> file, const char* name, const char* title, Bool_t save_hists = false,
+								 Long64_t entries = -1);
 
 	//! Stop saving the output to a root tree on disk.
 	void StopSave();
 
+	//! \brief Flush the tree being saved to disk, so that it can be recovered after a crash.
+	//! \returns The number of entries in the tree, -1 if not saving
+	Long64_t FlushSave();
+
+	//! Write the histograms changed since the last snapshot to the file being saved (see SetSnapshotInterval()).
+	Int_t SnapshotSave();
+
+	//! \brief Set how often every event snapshots its histograms to the file being saved.
+	//! \param seconds Time between snapshots, 0 turns snapshots off (the default).
+	static void SetSnapshotInterval(Int_t seconds);
+
+	//! Return the snapshot interval in seconds (0 if off)
+	static Int_t GetSnapshotInterval();
+
 	//! Return a pointer to fHistManager
 	hist::Manager* const GetHistManager();
 
@@ -74,6 +101,15 @@ public:
 	//! \param [in] nchar length of the event in bytes.
 	void Process(const void* event_address, Int_t nchar);
 
+	//! Number of events passed to Process() so far
+	ULong64_t GetNevents() const { return fNevents; }
+
+	//! Serial number of the event being processed, counted over all event processors
+	static ULong64_t GetSerial() { return fgSerial; }
+
+	//! Number of events that failed to unpack (i.e. went to HandleBadEvent()) so far
+	ULong64_t GetNfailed() const { return fNfailed; }
+
 	//! \brief Singleton instance function.
 	//! \details Each derived class is a singleton, with only one instance allowed.
 	//!  Use this function to get a pointer to the single instance of derived class <i>Derived</i>.
@@ -117,6 +153,11 @@ private:
 	//! here but can optionally be overridden in derived classes.
 	virtual void BeginRun() { };
 
+#if defined(RB_PROFILE) && !defined(__MAKECINT__)
+	//! Version of Process() that records the cycles spent in each stage (see Profile.hxx).
+	void ProcessProfiled(const void* event_address, Int_t nchar);
+#endif
+
 public:
 	/// Adds a branch to the event tree.
 	class BranchAdd
@@ -170,12 +211,17 @@ public:
 		//! Vector of branch addresses (for fSaveTree)
 		std::vector<void**> fBranchAddr;
  public:
-		//! Start saving
-		void Start(boost::shared_ptr<TFile> file, const char* name, const char* title, Bool_t save_hists = false);
+		//! Start saving (see rb::Event::StartSave())
+		void Start(boost::shared_ptr<TFile> file, const char* name, const char* title, Bool_t save_hists = false,
+							 Long64_t entries = -1);
 		//! Stop saving
 		void Stop();
 		//! Fill fTree (if active)
 		void Fill();
+		//! Write fTree's header and baskets to disk (if active), returns the number of entries (-1 if not active)
+		Long64_t Flush();
+		//! Flush fTree and write the histograms changed since the last snapshot (if active and saving histograms)
+		Int_t Snapshot();
 		//! Constructor
 		Save(rb::Event* event): fEvent(event), fIsActive(false), fSaveHistograms(false), fTree(0), fBranchAddr(0) { }
 		//! Destructor
@@ -0,0 +1,170 @@
+//! \file EventBuilder.cxx
+//! \brief Implements EventBuilder.hxx
+#include <cfloat>
+#include <algorithm>
+#include "utils/Error.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "EventBuilder.hxx"
+
+
+size_t rb::EventBuilder::Ring::LowerBound(Double_t time) {
+	size_t first = 0, count = fSize;
+	while(count > 0) {
+		size_t step = count / 2;
+		if(At(first + step).fTime < time) {
+			first += step + 1;
+			count -= step + 1;
+		}
+		else count = step;
+	}
+	return first;
+}
+
+rb::EventBuilder::EventBuilder(Int_t coincCode, Double_t low, Double_t high,
+															 Int_t headCode, Int_t tailCode, Int_t depth):
+	fCoincCode(coincCode),
+	fLow(0.),
+	fHigh(0.),
+	fRandomsDelay(0.),
+	fTailTimes(),
+	fNow(-DBL_MAX) {
+	fSinglesCodes[kHead] = headCode;
+	fSinglesCodes[kTail] = tailCode;
+	for(Int_t side = 0; side< 2; ++side)
+		fRings[side].SetCapacity(depth > 0 ? depth : 1);
+	SetWindow(low, high);
+	ResetStatistics();
+}
+
+void rb::EventBuilder::SetWindow(Double_t low, Double_t high, Double_t randomsDelay) {
+	/*!
+	 * The randoms window has to end before the coincidence window starts, i.e. _randomsDelay_
+	 * should be larger than _high_ - _low_ (and than _high_).
+	 */
+	if(low > high) std::swap(low, high);
+	fLow = low;
+	fHigh = high;
+	fRandomsDelay = randomsDelay > 0. ? randomsDelay : std::max(high, 0.) + 10.*(high - low);
+}
+
+void rb::EventBuilder::ResetStatistics() {
+	fNsingles[kHead] = fNsingles[kTail] = 0;
+	fNcoinc = fNrandoms = fNlate = fNoverflow = 0;
+}
+
+void rb::EventBuilder::Coincidence(const char* head, Int_t headSize, Double_t headTime,
+																	 const char* tail, Int_t tailSize, Double_t tailTime) {
+	CoincEvent coinc;
+	coinc.fHead = head;
+	coinc.fHeadSize = headSize;
+	coinc.fHeadTime = headTime;
+	coinc.fTail = tail;
+	coinc.fTailSize = tailSize;
+	coinc.fTailTime = tailTime;
+	++fNcoinc;
+	rb::Event* event = rb::Rint::gApp()->GetEvent(fCoincCode);
+	if(event) event->Process(&coinc, sizeof(coinc));
+}
+
+void rb::EventBuilder::Release(Int_t side) {
+	Slot& slot = fRings[side].Front();
+	if(!slot.fMatched) {
+		++fNsingles[side];
+		rb::Event* event = fSinglesCodes[side] < 0 ? 0 : rb::Rint::gApp()->GetEvent(fSinglesCodes[side]);
+		if(event) event->Process(slot.fData.empty() ? 0 : &slot.fData[0], slot.fData.size());
+	}
+	fRings[side].Pop();
+}
+
+void rb::EventBuilder::Expire(Double_t now) {
+	/*!
+	 * A head at t can still pair with a tail arriving from _now_ on while t + high >= now, a tail
+	 * at u with a head while u - low >= now.
+	 */
+	Ring& heads = fRings[kHead];
+	while(heads.Size() && (heads.Front().fMatched || heads.Front().fTime + fHigh < now))
+		Release(kHead);
+	Ring& tails = fRings[kTail];
+	while(tails.Size() && (tails.Front().fMatched || tails.Front().fTime - fLow < now))
+		Release(kTail);
+	const Double_t oldest = now + fLow - fRandomsDelay;
+	while(!fTailTimes.empty() && fTailTimes.front() < oldest)
+		fTailTimes.pop_front();
+}
+
+rb::EventBuilder::Slot* rb::EventBuilder::Match(Int_t side, Double_t low, Double_t high) {
+	Ring& ring = fRings[side];
+	for(size_t i = ring.LowerBound(low); i< ring.Size() && ring.At(i).fTime <= high; ++i)
+		if(!ring.At(i).fMatched) return &ring.At(i);
+	return 0;
+}
+
+void rb::EventBuilder::Add(Int_t side, Double_t time, const void* data, Int_t size) {
+	const char* cdata = static_cast<const char*>(data);
+	if(time < fNow) {
+		++fNlate;
+		++fNsingles[side];
+		rb::Event* event = fSinglesCodes[side] < 0 ? 0 : rb::Rint::gApp()->GetEvent(fSinglesCodes[side]);
+		if(event) event->Process(cdata, size);
+		return;
+	}
+	fNow = time;
+	Expire(time);
+
+	Slot* partner;
+	if(side == kHead) {
+		const Double_t rlow = time + fLow - fRandomsDelay, rhigh = time + fHigh - fRandomsDelay;
+		std::deque<Double_t>::iterator it = std::lower_bound(fTailTimes.begin(), fTailTimes.end(), rlow);
+		if(it != fTailTimes.end() && *it <= rhigh) ++fNrandoms;
+
+		partner = Match(kTail, time + fLow, time + fHigh);
+		if(partner)
+			Coincidence(cdata, size, time, partner->fData.empty() ? 0 : &partner->fData[0],
+									partner->fData.size(), partner->fTime);
+	}
+	else {
+		fTailTimes.push_back(time);
+		partner = Match(kHead, time - fHigh, time - fLow);
+		if(partner)
+			Coincidence(partner->fData.empty() ? 0 : &partner->fData[0], partner->fData.size(),
+									partner->fTime, cdata, size, time);
+	}
+	if(partner) {
+		partner->fMatched = kTRUE;
+		return;
+	}
+
+	Ring& ring = fRings[side];
+	if(ring.Full()) {
+		if(!ring.Front().fMatched) ++fNoverflow;
+		Release(side);
+	}
+	Slot& slot = ring.Push();
+	slot.fTime = time;
+	slot.fMatched = kFALSE;
+	slot.fData.assign(cdata, cdata + size);
+}
+
+void rb::EventBuilder::Flush() {
+	/*! Unmatched events are processed as singles in time order */
+	Ring& heads = fRings[kHead];
+	Ring& tails = fRings[kTail];
+	while(heads.Size() || tails.Size()) {
+		if(!tails.Size() || (heads.Size() && heads.Front().fTime <= tails.Front().fTime))
+			Release(kHead);
+		else
+			Release(kTail);
+	}
+	fTailTimes.clear();
+	fNow = -DBL_MAX;
+}
+
+void rb::EventBuilder::PrintStatistics() const {
+	err::Info("rb::EventBuilder")
+		<< "Coincidences: " << fNcoinc << " (estimated randoms: " << fNrandoms << "), "
+		<< "head singles: " << fNsingles[kHead] << ", tail singles: " << fNsingles[kTail];
+	if(fNlate || fNoverflow)
+		err::Warning("rb::EventBuilder")
+			<< fNlate << " events out of time order, " << fNoverflow << " pushed out of a full buffer";
+}
@@ -0,0 +1,181 @@
+//! \file EventBuilder.hxx
+//! \brief Builds coincidence events out of a time-ordered stream of head and tail events.
+//! \details Meant to sit after a time-ordered merge (see rb::AttachMerged()): the buffer source
+//! passes each head (e.g. gamma) and tail (e.g. heavy ion) event to rb::EventBuilder::Add() as it
+//! unpacks it, and the builder hands coincident pairs to the event processor of its choice as one
+//! rb::CoincEvent, and (optionally) unmatched events to their own processors as singles.
+//! \code
+//! class MyBuffer: public rb::MidasBuffer {
+//! 	rb::EventBuilder fBuilder;
+//! public:
+//! 	MyBuffer(): fBuilder(COINC_EVENT, 0., 10., GAMMA_EVENT, HI_EVENT) { }
+//! 	Bool_t UnpackEvent(void* header, char* data) {
+//! 		rb::TMidas_EVENT_HEADER* h = static_cast<rb::TMidas_EVENT_HEADER*>(header);
+//! 		if(h->fEventId >= 0x8000) return kTRUE;
+//! 		Int_t side = h->fEventId == 1 ? rb::EventBuilder::kHead : rb::EventBuilder::kTail;
+//! 		fBuilder.Add(side, GetEventTime(header, data), data, h->fDataSize);
+//! 		return kTRUE;
+//! 	}
+//! 	void RunStopTransition(Int_t) { fBuilder.Flush(); fBuilder.PrintStatistics(); }
+//! };
+//! \endcode
+#ifndef RB_EVENTBUILDER_HXX
+#define RB_EVENTBUILDER_HXX
+#include <deque>
+#include <vector>
+#include <Rtypes.h>
+
+namespace rb
+{
+/// \brief Combined event handed to the coincidence event processor.
+//! \details The Process() address of the coincidence rb::Event points to one of these (and the
+//! size is its sizeof()), so its DoProcess() starts with
+//! <tt>const rb::CoincEvent* coinc = static_cast<const rb::CoincEvent*>(event_address);</tt>
+//! The pointers are only valid during the call.
+struct CoincEvent {
+	/// Data of the head event
+	const char* fHead;
+	/// Size of fHead in bytes
+	Int_t fHeadSize;
+	/// Time stamp of the head event
+	Double_t fHeadTime;
+	/// Data of the tail event
+	const char* fTail;
+	/// Size of fTail in bytes
+	Int_t fTailSize;
+	/// Time stamp of the tail event
+	Double_t fTailTime;
+};
+
+/// \brief Coincidence matching of time-ordered head and tail events.
+//! \details A head at time t and a tail at time u are in coincidence if
+//! <tt>low <= u - t <= high</tt>. Each event waits in the ring buffer of its kind until no later
+//! event can match it any more, so the window may reach into the past or the future of either kind.
+//! Pairs are found by a binary search of the waiting events of the other kind, first come first
+//! served; an event that leaves its ring unmatched is a single.
+//!
+//! Randoms are estimated the usual way, by counting the heads that have a tail in a window of the
+//! same width but delayed by a fixed time (far enough back that nothing in it can be truly
+//! coincident).
+//!
+//! Events have to be passed in time order; any that aren't are counted and treated as singles.
+//! Coincidences and singles are processed as soon as they are known, which isn't exactly time order.
+class EventBuilder
+{
+public:
+	/// Which side of the coincidence an event is
+	enum ESide { kHead = 0, kTail = 1 };
+
+private:
+	/// Event waiting for a partner
+	struct Slot {
+		/// Time stamp
+		Double_t fTime;
+		/// Has it been paired?
+		Bool_t fMatched;
+		/// Copy of the data
+		std::vector<char> fData;
+	};
+	/// Fixed-size ring of waiting events, in time order
+	class Ring {
+	private:
+		/// Storage, reused from event to event
+		std::vector<Slot> fSlots;
+		/// Index of the oldest slot
+		size_t fFirst;
+		/// Slots in use
+		size_t fSize;
+	public:
+		Ring(): fSlots(), fFirst(0), fSize(0) { }
+		/// Empty the ring and make room for _capacity_ events
+		void SetCapacity(size_t capacity) { fSlots.assign(capacity, Slot()); fFirst = fSize = 0; }
+		size_t Size() const { return fSize; }
+		Bool_t Full() const { return fSize == fSlots.size(); }
+		Slot& At(size_t i) { return fSlots[(fFirst + i) % fSlots.size()]; }
+		Slot& Front() { return At(0); }
+		Slot& Push() { return At(fSize++); }
+		void Pop() { fFirst = (fFirst + 1) % fSlots.size(); --fSize; }
+		/// Index of the first slot with time >= _time_
+		size_t LowerBound(Double_t time);
+	};
+
+	/// Waiting heads and tails
+	Ring fRings[2];
+	/// Event code of the coincidence processor
+	Int_t fCoincCode;
+	/// Event codes of the singles processors (-1 to only count them)
+	Int_t fSinglesCodes[2];
+	/// Lower edge of the window (tail minus head time)
+	Double_t fLow;
+	/// Upper edge of the window
+	Double_t fHigh;
+	/// Delay of the randoms window
+	Double_t fRandomsDelay;
+	/// Recent tail times, for the randoms window
+	std::deque<Double_t> fTailTimes;
+	/// Latest time stamp added
+	Double_t fNow;
+	/// Singles of each side
+	ULong64_t fNsingles[2];
+	/// Coincidences
+	ULong64_t fNcoinc;
+	/// Heads with a tail in the randoms window
+	ULong64_t fNrandoms;
+	/// Events added out of time order
+	ULong64_t fNlate;
+	/// Events pushed out of a full ring before their window closed
+	ULong64_t fNoverflow;
+
+	/// Process the coincidence of _head_ and _tail_
+	void Coincidence(const char* head, Int_t headSize, Double_t headTime,
+									 const char* tail, Int_t tailSize, Double_t tailTime);
+	/// Process the front of ring _side_ as a single, if unmatched, and drop it
+	void Release(Int_t side);
+	/// Release every waiting event that can no longer be matched at time _now_
+	void Expire(Double_t now);
+	/// Find a waiting, unmatched event of _side_ with time in [low, high]
+	Slot* Match(Int_t side, Double_t low, Double_t high);
+
+	/// Disallow copy
+	EventBuilder(const EventBuilder&);
+	/// Disallow assign
+	EventBuilder& operator= (const EventBuilder&);
+
+public:
+	/// \brief Set up the matching.
+	//! \param coincCode Code of the event processor that receives the rb::CoincEvent of each pair
+	//! \param low Lower edge of the window, tail time minus head time
+	//! \param high Upper edge of the window
+	//! \param headCode Code of the processor for head singles, -1 to skip them
+	//! \param tailCode Code of the processor for tail singles, -1 to skip them
+	//! \param depth Events of each kind that can wait for a partner
+	EventBuilder(Int_t coincCode, Double_t low, Double_t high,
+							 Int_t headCode = -1, Int_t tailCode = -1, Int_t depth = 1024);
+	/// \brief Change the window.
+	//! \param randomsDelay Delay of the randoms window; 0 for ten window widths past the window
+	void SetWindow(Double_t low, Double_t high, Double_t randomsDelay = 0.);
+	/// \brief Add one event (in time order).
+	//! \details Data are copied only if the event has to wait for a partner.
+	void Add(Int_t side, Double_t time, const void* data, Int_t size);
+	/// Release every waiting event (at the end of a run)
+	void Flush();
+	/// Reset the statistics
+	void ResetStatistics();
+	/// Singles of _side_ so far
+	ULong64_t GetNsingles(Int_t side) const { return fNsingles[side]; }
+	/// Coincidences so far
+	ULong64_t GetNcoinc() const { return fNcoinc; }
+	/// Estimated random coincidences so far
+	ULong64_t GetNrandoms() const { return fNrandoms; }
+	/// Events added out of time order
+	ULong64_t GetNlate() const { return fNlate; }
+	/// Events that had to leave a full ring early (raise the depth if nonzero)
+	ULong64_t GetNoverflow() const { return fNoverflow; }
+	/// Print the statistics
+	void PrintStatistics() const;
+};
+
+} // namespace rb
+
+
+#endif
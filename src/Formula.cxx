@@ -1,6 +1,7 @@
 //! \file Formula.cxx
 //! \brief Implements Formula.hxx
 #include <cassert>
+#include <map>
 #include <vector>
 #include <sstream>
 #include <stdexcept>
@@ -26,6 +27,32 @@ namespace
     // else if (f == "0") formula ="!1";  // Somehow "0" evaluates to true, should be false.
     // else;                              // don't modify
   }
+
+	typedef std::map<std::pair<Int_t, std::string>, boost::shared_ptr<rb::DataFormula> > FormulaCache_t;
+
+	/// Formulae shared within rb::TreeFormulae::Cache scopes (only touched with gDataMutex locked)
+	FormulaCache_t& formula_cache() {
+		static FormulaCache_t* cache = new FormulaCache_t();
+		return *cache;
+	}
+
+	/// Number of open rb::TreeFormulae::Cache scopes
+	Int_t cache_depth = 0;
+
+	/// \brief Create the formula for _formula_arg_ in event _event_code_.
+	//! \details Returns the cached copy when inside a rb::TreeFormulae::Cache scope, and caches newly
+	//! created (valid) formulae there.
+	boost::shared_ptr<rb::DataFormula> make_formula(Int_t event_code, const std::string& formula_arg) {
+		if(cache_depth) {
+			FormulaCache_t::iterator it = formula_cache().find(std::make_pair(event_code, formula_arg));
+			if(it != formula_cache().end()) return it->second;
+		}
+		boost::shared_ptr<rb::DataFormula> formula
+			(rb::Event::InitFormula::Operate(rb::Rint::gApp()->GetEvent(event_code), formula_arg.c_str()));
+		if(cache_depth && !formula->IsZombie())
+			formula_cache()[std::make_pair(event_code, formula_arg)] = formula;
+		return formula;
+	}
 }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -99,21 +126,31 @@ rb::TTreeDataFormula::TTreeDataFormula(const char* name, const char* formula, TT
 // Constructor                                           //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::TreeFormulae::TreeFormulae(std::vector<std::string>& params, Int_t event_code):
-  kEventCode(event_code), fDataFormulae(new boost::ptr_vector<rb::DataFormula>(), gDataMutex) {
+  kEventCode(event_code), fDataFormulae(new FormulaVector_t(), gDataMutex) {
 
   RB_LOCKGUARD(gDataMutex);
   std::vector<std::string>::iterator it;
   for(it = params.begin(); it != params.end(); ++it) {
     modify_formula_arg(*it);
     fFormulaArgs.push_back(*it);
-    rb::DataFormula* formula = 
-      rb::Event::InitFormula::Operate(rb::Rint::gApp()->GetEvent(kEventCode), it->c_str());
+    boost::shared_ptr<rb::DataFormula> formula = make_formula(kEventCode, *it);
 
     if(formula->IsZombie()) ThrowBad(it->c_str(), it-params.begin());
     else fDataFormulae->push_back(formula);
   }
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::TreeFormulae::Cache                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::TreeFormulae::Cache::Cache() {
+	RB_LOCKGUARD(gDataMutex);
+	++cache_depth;
+}
+rb::TreeFormulae::Cache::~Cache() {
+	RB_LOCKGUARD(gDataMutex);
+	if(--cache_depth == 0) formula_cache().clear();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void ThrowBad()                                       //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::TreeFormulae::ThrowBad(const char* formula, Int_t index) {
@@ -131,7 +168,7 @@ Bool_t rb::TreeFormulae::Change(Int_t index, std::string new_formula) {
   modify_formula_arg(new_formula);
 
   // check that new gate formula is valid
-  boost::scoped_ptr<rb::DataFormula>
+  boost::shared_ptr<rb::DataFormula>
     temp (rb::Event::InitFormula::Operate(rb::Rint::gApp()->GetEvent(kEventCode), new_formula.c_str()));
 
   if(temp->IsZombie())
@@ -139,7 +176,7 @@ Bool_t rb::TreeFormulae::Change(Int_t index, std::string new_formula) {
   else {
     try {
       RB_LOCKGUARD(gDataMutex);
-      fDataFormulae->replace(index, rb::Event::InitFormula::Operate(rb::Rint::gApp()->GetEvent(kEventCode), new_formula.c_str()));
+      fDataFormulae->at(index) = temp;
       fFormulaArgs.at(index) = new_formula;
     } catch(std::exception& e) {
       rb::err::Error("rb::TreeFormulae::Change()") << "Invalid index " << index;
@@ -169,7 +206,7 @@ Double_t rb::TreeFormulae::Eval(Int_t index) {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 Double_t rb::TreeFormulae::EvalUnlocked(Int_t index) {
   Double_t ret = -1;
-  try { ret = fDataFormulae->at(index).Evaluate(); }
+  try { ret = fDataFormulae->at(index)->Evaluate(); }
   catch (std::exception& e) {
     rb::err::Error("rb::TreeFormulae::Eval") << "Invalid index " << index;
     ret = -1;
@@ -187,8 +224,8 @@ void rb::TreeFormulae::EvalAll(std::vector<Double_t>& out) {
 // void rb::TreeFormulae::EvalAllUnlocked()              //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::TreeFormulae::EvalAllUnlocked(std::vector<Double_t>& out) {
-  boost::ptr_vector<rb::DataFormula>::iterator it;
+  FormulaVector_t::iterator it;
   out.clear();
   for(it = fDataFormulae->begin(); it != fDataFormulae->end(); ++it)
-    out.push_back(it->Evaluate());
+    out.push_back((*it)->Evaluate());
 }
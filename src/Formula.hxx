@@ -3,8 +3,9 @@
 #ifndef FORMULA_HXX
 #define FORMULA_HXX
 #include <string>
+#include <vector>
 #include "utils/boost_scoped_ptr.h"
-#include "utils/boost_ptr_vector.h"
+#include "utils/boost_shared_ptr.h"
 #include "utils/Critical.hxx"
 #include "ClassFormula.hxx"
 
@@ -122,11 +123,34 @@ public:
 
 
 /// \brief Wrapper for histogram TTreeFormulae
+//! \details The DataFormula objects are reference counted so that histograms created inside the
+//! same TreeFormulae::Cache scope can share one formula per (event, formula string).
 class TreeFormulae
 {
+public:
+	/// Formulae owned (or shared) by one TreeFormulae
+	typedef std::vector<boost::shared_ptr<rb::DataFormula> > FormulaVector_t;
+
+#ifndef __MAKECINT__
+	/// \brief Shares formulae between TreeFormulae constructed while it exists.
+	//! \details Meant for creating many histograms at once (e.g. rb::ReadHistXML()), where the same
+	//! parameters and gates appear over and over: each distinct formula is then parsed and mapped onto
+	//! the event class only once. Scopes nest; the cache is emptied when the outermost one ends
+	//! (formulae already handed out stay alive for as long as their histograms do).
+	class Cache
+	{
+		RB_NOCOPY(Cache)
+	public:
+		/// Open a cache scope
+		Cache();
+		/// Close the scope, emptying the cache if it was the outermost one
+		~Cache();
+	};
+#endif
+
 private:
 	const Int_t kEventCode;
-	rb::Critical<boost::ptr_vector<rb::DataFormula> > fDataFormulae;
+	rb::Critical<FormulaVector_t> fDataFormulae;
 	std::vector<std::string> fFormulaArgs;
 public:
 	TreeFormulae(): kEventCode(-1001), fDataFormulae(0, gDataMutex) {}
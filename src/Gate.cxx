@@ -0,0 +1,244 @@
+//! \file Gate.cxx
+//! \brief Implements Gate.hxx
+#include <cctype>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include "utils/Error.hxx"
+#include "Gate.hxx"
+
+
+namespace {
+/// _str_ without leading and trailing white space
+std::string trim(const std::string& str) {
+	const size_t first = str.find_first_not_of(" \t\n");
+	if(first == std::string::npos) return "";
+	return str.substr(first, str.find_last_not_of(" \t\n") - first + 1);
+}
+
+/// Split _expr_ at the occurrences of _op_ ("&&" or "||") outside of parentheses and brackets
+std::vector<std::string> split_top(const std::string& expr, const char* op) {
+	std::vector<std::string> parts;
+	Int_t depth = 0;
+	size_t start = 0;
+	for(size_t i = 0; i< expr.size(); ++i) {
+		const char c = expr[i];
+		if(c == '(' || c == '[') ++depth;
+		else if(c == ')' || c == ']') --depth;
+		else if(depth == 0 && expr.compare(i, 2, op) == 0) {
+			parts.push_back(trim(expr.substr(start, i - start)));
+			start = ++i + 1;
+		}
+	}
+	parts.push_back(trim(expr.substr(start)));
+	return parts;
+}
+
+/// Is _expr_ a single parenthesized group, like "(a || b)" but not "(a) && (b)"?
+Bool_t enclosed(const std::string& expr) {
+	if(expr.size() < 2 || expr[0] != '(' || expr[expr.size()-1] != ')') return kFALSE;
+	Int_t depth = 0;
+	for(size_t i = 0; i< expr.size() - 1; ++i) {
+		if(expr[i] == '(') ++depth;
+		else if(expr[i] == ')' && --depth == 0) return kFALSE;
+	}
+	return kTRUE;
+}
+
+/// Can _c_ be part of a name?
+inline Bool_t is_name_char(char c) { return isalnum(c) || c == '_'; }
+
+/// Is _name_ a valid identifier?
+Bool_t is_name(const char* name) {
+	if(!name || !(isalpha(*name) || *name == '_')) return kFALSE;
+	for(; *name; ++name)
+		if(!is_name_char(*name)) return kFALSE;
+	return kTRUE;
+}
+
+typedef std::map<rb::Event*, rb::gate::Graph*> Graphs_t;
+
+/// Graphs of every event processor (never deleted, like the processors)
+Graphs_t& graphs() {
+	static Graphs_t* graphs = new Graphs_t();
+	return *graphs;
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::gate::Graph                                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::gate::Graph::Graph(rb::Event* event):
+	fEvent(event), fNodes(), fNames(), fKeys(), fKnown(), fValue(), fSerial(0) { }
+
+rb::gate::Graph* rb::gate::Graph::Get(rb::Event* event, Bool_t create) {
+	Graphs_t::iterator it = graphs().find(event);
+	if(it != graphs().end()) return it->second;
+	if(!create || !event) return 0;
+	return graphs()[event] = new Graph(event);
+}
+
+void rb::gate::Graph::Reset() {
+	std::fill(fKnown.begin(), fKnown.end(), 0);
+	fSerial = rb::Event::GetSerial();
+}
+
+Int_t rb::gate::Graph::AddNode(EOp op, const std::vector<Int_t>& inputs, const std::string& text) {
+	std::stringstream key;
+	key << op << ':' << text;
+	for(size_t i = 0; i< inputs.size(); ++i) key << ',' << inputs[i];
+	if(op != kName) {
+		std::map<std::string, Int_t>::iterator it = fKeys.find(key.str());
+		if(it != fKeys.end()) return it->second;
+	}
+
+	Node node;
+	node.fOp = op;
+	node.fInputs = inputs;
+	node.fText = text;
+	if(op == kCondition) {
+		node.fFormula.reset(rb::Event::InitFormula::Operate(fEvent, text.c_str()));
+		if(!node.fFormula.get() || node.fFormula->IsZombie()) return -1;
+	}
+	const Int_t index = fNodes.size();
+	fNodes.push_back(node);
+	fKnown.resize(index / 64 + 1, 0);
+	fValue.resize(index / 64 + 1, 0);
+	if(op != kName) fKeys[key.str()] = index;
+	return index;
+}
+
+Int_t rb::gate::Graph::Parse(const std::string& expr_) {
+	/*!
+	 * Precedence is the usual one (! over && over ||). Anything that isn't a named gate or one of
+	 * those operations on parts that are becomes a leaf formula, so "pid && bgo.e[0] > 100" is the
+	 * "and" of gate "pid" and formula "bgo.e[0] > 100".
+	 */
+	const std::string expr = trim(expr_);
+	const char* ops[2] = { "||", "&&" };
+	const EOp eops[2] = { kOr, kAnd };
+	for(Int_t i = 0; i< 2; ++i) {
+		std::vector<std::string> parts = split_top(expr, ops[i]);
+		if(parts.size() == 1) continue;
+		std::vector<Int_t> inputs;
+		for(size_t j = 0; j< parts.size(); ++j) {
+			const Int_t input = Parse(parts[j]);
+			if(input < 0) return -1;
+			inputs.push_back(input);
+		}
+		return AddNode(eops[i], inputs, "");
+	}
+	if(enclosed(expr))
+		return Parse(expr.substr(1, expr.size() - 2));
+	if(expr.size() > 1 && expr[0] == '!' && expr[1] != '=') {
+		const Int_t input = Parse(expr.substr(1));
+		return input < 0 ? -1 : AddNode(kNot, std::vector<Int_t>(1, input), "");
+	}
+	std::map<std::string, Int_t>::iterator it = fNames.find(expr);
+	if(it != fNames.end()) return it->second;
+	if(MentionsName(expr)) return -1; // gates can't be used as numbers, e.g. "pid + 1"
+	return AddNode(kCondition, std::vector<Int_t>(), expr);
+}
+
+Bool_t rb::gate::Graph::DependsOn(Int_t index, Int_t on) const {
+	if(index == on) return kTRUE;
+	const std::vector<Int_t>& inputs = fNodes[index].fInputs;
+	for(size_t i = 0; i< inputs.size(); ++i)
+		if(DependsOn(inputs[i], on)) return kTRUE;
+	return kFALSE;
+}
+
+Bool_t rb::gate::Graph::MentionsName(const std::string& expr) const {
+	if(fNames.empty()) return kFALSE;
+	for(size_t i = 0; i< expr.size(); ) {
+		if(!is_name_char(expr[i])) { ++i; continue; }
+		size_t end = i;
+		while(end < expr.size() && is_name_char(expr[end])) ++end;
+		// skip members ("a.pid") and the start of numbers
+		const Bool_t member = i > 0 && expr[i-1] == '.';
+		if(!member && fNames.count(expr.substr(i, end - i))) return kTRUE;
+		i = end;
+	}
+	return kFALSE;
+}
+
+Bool_t rb::gate::Graph::Eval(Int_t index) {
+	const Node& node = fNodes[index];
+	Bool_t value = kFALSE;
+	switch(node.fOp) {
+	case kCondition:
+		value = node.fFormula->Evaluate() != 0.;
+		break;
+	case kName:
+		value = Lookup(node.fInputs[0]);
+		break;
+	case kNot:
+		value = !Lookup(node.fInputs[0]);
+		break;
+	case kAnd:
+		value = kTRUE;
+		for(size_t i = 0; i< node.fInputs.size() && value; ++i)
+			value = Lookup(node.fInputs[i]);
+		break;
+	case kOr:
+		for(size_t i = 0; i< node.fInputs.size() && !value; ++i)
+			value = Lookup(node.fInputs[i]);
+		break;
+	}
+	const ULong64_t bit = 1ULL << (index & 63);
+	fKnown[index >> 6] |= bit;
+	if(value) fValue[index >> 6] |= bit;
+	else      fValue[index >> 6] &= ~bit;
+	return value;
+}
+
+Int_t rb::gate::Graph::Define(const char* name, const char* condition) {
+	if(!is_name(name)) {
+		err::Error("rb::gate::New") << "Invalid gate name \"" << (name ? name : "") << "\"";
+		return -1;
+	}
+	// formulae like "name.member > 0" would read the gate instead of the branch
+	std::vector<std::pair<std::string, std::string> > branches = fEvent->GetBranchList();
+	for(size_t i = 0; i< branches.size(); ++i) {
+		if(branches[i].first == name) {
+			err::Error("rb::gate::New") << "Gate name \"" << name << "\" is the name of a branch";
+			return -1;
+		}
+	}
+	if(!condition) condition = "";
+	const Int_t root = Parse(condition);
+	if(root < 0) {
+		err::Error("rb::gate::New") << "Invalid condition \"" << condition << "\"";
+		return -1;
+	}
+
+	std::map<std::string, Int_t>::iterator it = fNames.find(name);
+	Int_t index;
+	if(it != fNames.end()) {
+		index = it->second;
+		if(DependsOn(root, index)) {
+			err::Error("rb::gate::New") << "Condition \"" << condition << "\" depends on gate " << name;
+			return -1;
+		}
+		fNodes[index].fInputs.assign(1, root);
+		fNodes[index].fText = condition;
+	}
+	else {
+		index = AddNode(kName, std::vector<Int_t>(1, root), condition);
+		fNames[name] = index;
+	}
+	Reset();
+	return index;
+}
+
+Int_t rb::gate::Graph::Compile(const char* expr) {
+	return expr && MentionsName(expr) ? Parse(expr) : -1;
+}
+
+void rb::gate::Graph::Print() const {
+	std::cout << fNames.size() << " gates (" << fNodes.size() << " nodes):\n";
+	for(std::map<std::string, Int_t>::const_iterator it = fNames.begin(); it != fNames.end(); ++it)
+		std::cout << "  " << it->first << ": " << fNodes[it->second].fText << "\n";
+}
@@ -0,0 +1,133 @@
+//! \file Gate.hxx
+//! \brief Named gates, shared between histograms and evaluated at most once per event.
+//! \details A gate defined with rb::gate::New() can be used by name in any histogram gate, alone or
+//! combined with <tt>&&</tt>, <tt>||</tt>, <tt>!</tt> and parentheses (e.g. "pid_alpha && tof_ok && !pileup").
+//! Such histogram gates become nodes of the event processor's rb::gate::Graph instead of separate
+//! formulae, so a condition shared by many histograms is only evaluated once per event.
+#ifndef RB_GATE_HXX
+#define RB_GATE_HXX
+#include <map>
+#include <string>
+#include <vector>
+#include <Rtypes.h>
+#include "utils/boost_shared_ptr.h"
+#include "Formula.hxx"
+#include "Event.hxx"
+
+namespace rb
+{
+namespace gate
+{
+/// \brief Directed acyclic graph of the gates of one event processor.
+//! \details Leaves are ordinary formulae (anything rb::Event::InitFormula::Operate() understands);
+//! inner nodes combine other nodes with and, or and not, and a named gate is a node pointing to the
+//! root of its definition. Identical sub-expressions are the same node, whichever gate uses them.
+//!
+//! Results are kept in two bitsets (evaluated, and value) that are cleared when a new event starts
+//! (see rb::Event::GetSerial()). A node is evaluated the first time it is tested in an event, after
+//! its inputs, and "and" / "or" nodes stop at the first input that decides them; every later test
+//! in the same event is a bit lookup.
+class Graph
+{
+private:
+	/// What a node computes
+	enum EOp { kCondition, kAnd, kOr, kNot, kName };
+	/// One node
+	struct Node {
+		/// Operation
+		EOp fOp;
+		/// Input nodes (the definition, for kName)
+		std::vector<Int_t> fInputs;
+		/// Formula (kCondition only)
+		boost::shared_ptr<rb::DataFormula> fFormula;
+		/// Formula text (kCondition), or definition (kName)
+		std::string fText;
+	};
+
+	/// Event processor evaluating the formulae
+	rb::Event* const fEvent;
+	/// Every node; indices never change
+	std::vector<Node> fNodes;
+	/// Named gates (index of their kName node)
+	std::map<std::string, Int_t> fNames;
+	/// Unnamed nodes by operation and inputs (or formula text), for sharing
+	std::map<std::string, Int_t> fKeys;
+	/// Bit set for every node evaluated in the current event
+	std::vector<ULong64_t> fKnown;
+	/// Result of every node evaluated in the current event
+	std::vector<ULong64_t> fValue;
+	/// rb::Event::GetSerial() of fKnown
+	ULong64_t fSerial;
+
+	/// Make a node (or find the identical one)
+	Int_t AddNode(EOp op, const std::vector<Int_t>& inputs, const std::string& text);
+	/// Node for boolean expression _expr_, -1 if a part of it isn't a valid formula
+	Int_t Parse(const std::string& expr);
+	/// Does node _index_ depend on node _on_?
+	Bool_t DependsOn(Int_t index, Int_t on) const;
+	/// Does _expr_ mention a named gate?
+	Bool_t MentionsName(const std::string& expr) const;
+	/// Value of node _index_ in the current event
+	Bool_t Lookup(Int_t index) {
+		const ULong64_t bit = 1ULL << (index & 63);
+		if(fKnown[index >> 6] & bit) return (fValue[index >> 6] & bit) != 0;
+		return Eval(index);
+	}
+	/// Evaluate node _index_ and record the result
+	Bool_t Eval(Int_t index);
+	/// Forget the results of the current event
+	void Reset();
+
+	/// Disallow copy
+	Graph(const Graph&);
+	/// Disallow assign
+	Graph& operator= (const Graph&);
+
+public:
+	/// Empty graph for _event_
+	explicit Graph(rb::Event* event);
+	/// \brief Graph of _event_.
+	//! \returns 0 if there is none yet and _create_ is false
+	static Graph* Get(rb::Event* event, Bool_t create = kTRUE);
+	/// \brief Define (or redefine) the named gate _name_.
+	//! \details Histograms using the gate follow a redefinition.
+	//! \returns The index of the gate, or -1 if _name_ is invalid or the name of a branch, or if
+	//! _condition_ is invalid or refers back to _name_
+	Int_t Define(const char* name, const char* condition);
+	/// \brief Node for a histogram gate that uses named gates.
+	//! \returns -1 if _expr_ doesn't mention any (or isn't valid)
+	Int_t Compile(const char* expr);
+	/// Value of node _index_ in the current event
+	Bool_t Test(Int_t index) {
+		if(fSerial != rb::Event::GetSerial()) Reset();
+		return Lookup(index);
+	}
+	/// Print the named gates
+	void Print() const;
+};
+
+/// \brief DataFormula reading a node of a rb::gate::Graph.
+//! \details Used for histogram gates that use named gates, so regating a histogram to a named
+//! gate just points it to that node.
+class GateDataFormula : public rb::DataFormula
+{
+private:
+	/// The graph
+	Graph* fGraph;
+	/// The node
+	Int_t fIndex;
+public:
+	/// Read node _index_ of _graph_
+	GateDataFormula(Graph* graph, Int_t index): fGraph(graph), fIndex(index) { }
+	/// \brief Graph::Test() of the node
+	virtual Double_t Evaluate() { return fGraph->Test(fIndex); }
+	/// \brief Always valid
+	virtual Bool_t IsZombie() { return kFALSE; }
+};
+
+} // namespace gate
+
+} // namespace rb
+
+
+#endif
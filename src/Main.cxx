@@ -16,12 +16,17 @@ void usage(const char* arg0) {
 	unsigned long slashPos = progname.rfind('/');
 	if (slashPos < progname.size())
 		progname = progname.substr (slashPos + 1);
-	std::cout << "usage: " << progname << " --unpack <input file>\n\n";
+	std::cout << "usage: " << progname << " --unpack <input file> [--resume]\n\n";
 	exit(1);
 }
-void handle_args(int argc, char** argv, std::string& fin) {
-	if(argc != 3) usage(argv[0]);
+void handle_args(int argc, char** argv, std::string& fin, bool& resume) {
+	if(argc != 3 && argc != 4) usage(argv[0]);
 	fin  = argv[2];
+	resume = false;
+	if(argc == 4) {
+		if(strcmp(argv[3], "--resume")) usage(argv[0]);
+		resume = true;
+	}
 } }
 
 /// \brief The \c main ROOTBEER function.
@@ -32,7 +37,8 @@ int rb::Main::Run(int argc, char** argv)
  if (argc > 1 && !strcmp(argv[1], "--unpack")) { // 'rbunpack'
 
 	 std::string fin;
-	 handle_args(argc, argv, fin);
+	 bool resume;
+	 handle_args(argc, argv, fin, resume);
 	 int argc2 = argc + 1;
 	 char** argv2 = (char**)malloc(argc2*sizeof(char*));
 	 for(int i=0; i< argc; ++i) {
@@ -44,7 +50,7 @@ int rb::Main::Run(int argc, char** argv)
 
 	 rb::Rint rbApp("Rbunpack", &argc2, argv2, 0, 0, true);
 	 rbApp.StartSave(false);
-	 rb::AttachFile(fin.c_str());
+	 rb::AttachFile(fin.c_str(), kTRUE, resume);
 	 gSystem->Sleep(1e2);
 	 while(rb::FileAttached())
 		 assert(0);
@@ -0,0 +1,90 @@
+//! \file Merger.cxx
+//! \brief Implements Merger.hxx
+#include <algorithm>
+#include "Merger.hxx"
+
+
+rb::Merger::Merger(Double_t window, Int_t depth):
+	fInputs(),
+	fHeap(),
+	fFree(),
+	fWindow(window > 0. ? window : 0.),
+	fDepth(depth > 0 ? depth : 1),
+	fNread(0),
+	fNmerged(0),
+	fNlate(0),
+	fLast(0.) { }
+
+rb::Merger::~Merger() {
+	for(size_t i=0; i< fInputs.size(); ++i) delete fInputs[i].fStream;
+	for(size_t i=0; i< fHeap.size(); ++i) delete fHeap[i].fEvent;
+	for(size_t i=0; i< fFree.size(); ++i) delete fFree[i];
+}
+
+void rb::Merger::AddStream(Stream* stream) {
+	Input input;
+	input.fStream = stream;
+	input.fDone = kFALSE;
+	input.fStarted = kFALSE;
+	input.fLatest = 0.;
+	input.fNwaiting = 0;
+	input.fNread = 0;
+	fInputs.push_back(input);
+}
+
+Bool_t rb::Merger::Next(std::vector<char>& event, Int_t* stream) {
+	/*!
+	 * Reads only from the input that is furthest behind (one that hasn't been read yet first),
+	 * until the earliest waiting event is safe to hand out.
+	 */
+	while(1) {
+		Int_t lag = -1;
+		for(size_t i=0; i< fInputs.size(); ++i) {
+			const Input& in = fInputs[i];
+			if(in.fDone) continue;
+			if(lag < 0 || !in.fStarted ||
+				 (fInputs[lag].fStarted && in.fLatest < fInputs[lag].fLatest)) lag = i;
+			if(!in.fStarted) break;
+		}
+
+		if(!fHeap.empty()) {
+			const Item& top = fHeap.front();
+			Bool_t ready = lag < 0 ||
+				(fInputs[lag].fStarted && top.fTime <= fInputs[lag].fLatest - fWindow) ||
+				fInputs[lag].fNwaiting >= fDepth;
+			if(ready) {
+				std::pop_heap(fHeap.begin(), fHeap.end(), Later());
+				Item item = fHeap.back();
+				fHeap.pop_back();
+				if(fNmerged && item.fTime < fLast) ++fNlate;
+				else fLast = item.fTime;
+				++fNmerged;
+				--fInputs[item.fStream].fNwaiting;
+				if(stream) *stream = item.fStream;
+				event.swap(*item.fEvent);
+				fFree.push_back(item.fEvent);
+				return kTRUE;
+			}
+		}
+		else if(lag < 0) return kFALSE; // all done
+
+		Input& in = fInputs[lag];
+		Item item;
+		item.fStream = lag;
+		item.fSerial = fNread;
+		if(fFree.empty()) item.fEvent = new std::vector<char>();
+		else { item.fEvent = fFree.back(); fFree.pop_back(); }
+		if(!in.fStream->Read(*item.fEvent, item.fTime)) {
+			in.fDone = kTRUE;
+			fFree.push_back(item.fEvent);
+			continue;
+		}
+		if(!in.fStarted || item.fTime > in.fLatest) in.fLatest = item.fTime;
+		in.fStarted = kTRUE;
+		++in.fNwaiting;
+		++in.fNread;
+		++fNread;
+		fHeap.push_back(item);
+		std::push_heap(fHeap.begin(), fHeap.end(), Later());
+	}
+}
@@ -0,0 +1,127 @@
+//! \file Merger.hxx
+//! \brief Time-ordered merge of several event streams.
+//! \details Used by BufferSource implementations that read more than one file at once (see
+//! rb::AttachMerged()), e.g. one file per DAQ frontend. Each input keeps arriving in its own order;
+//! the merger reads ahead on every input and hands out events in order of a time stamp extracted by
+//! the input, so events from different inputs reach rb::Event::Process() interleaved the way they
+//! happened.
+#ifndef RB_MERGER_HXX
+#define RB_MERGER_HXX
+#include <cstddef>
+#include <vector>
+#include <Rtypes.h>
+
+namespace rb
+{
+/// \brief k-way merge of event streams by time stamp.
+//! \details Events read from the inputs wait in a heap ordered by time stamp. The earliest one is
+//! handed out as soon as every input that is still open has read past its time stamp by more than
+//! the look-ahead window, so events that are out of order by less than the window inside one input
+//! are still sorted correctly. If the inputs are too far apart in time to meet that condition, an
+//! input's read-ahead depth caps the memory used: once it is reached, the earliest event is released
+//! anyway. Events that come out earlier than one already handed out are counted as late (they are
+//! still delivered).
+class Merger
+{
+public:
+	/// One input to the merge
+	class Stream
+	{
+	public:
+		virtual ~Stream() { }
+		/// \brief Read the next event of this input.
+		//! \param [out] event Raw event (resized to fit)
+		//! \param [out] time Time stamp of the event, in whatever unit is common to all inputs
+		//! \returns false at the end of the input
+		virtual Bool_t Read(std::vector<char>& event, Double_t& time) = 0;
+	};
+
+private:
+	/// Event waiting in the heap
+	struct Item {
+		/// Time stamp
+		Double_t fTime;
+		/// Read order, breaks ties between equal time stamps
+		ULong64_t fSerial;
+		/// Index of the input
+		Int_t fStream;
+		/// The event
+		std::vector<char>* fEvent;
+	};
+	/// Orders the heap with the earliest item on top
+	struct Later {
+		bool operator() (const Item& lhs, const Item& rhs) const {
+			return lhs.fTime > rhs.fTime || (lhs.fTime == rhs.fTime && lhs.fSerial > rhs.fSerial);
+		}
+	};
+	/// State of one input
+	struct Input {
+		/// The input (owned)
+		Stream* fStream;
+		/// Has it ended?
+		Bool_t fDone;
+		/// Has anything been read from it?
+		Bool_t fStarted;
+		/// Latest time stamp read from it
+		Double_t fLatest;
+		/// Events of it waiting in the heap
+		size_t fNwaiting;
+		/// Events read from it
+		ULong64_t fNread;
+	};
+
+	/// Inputs
+	std::vector<Input> fInputs;
+	/// Events read but not handed out
+	std::vector<Item> fHeap;
+	/// Event buffers for reuse
+	std::vector<std::vector<char>*> fFree;
+	/// Look-ahead window
+	Double_t fWindow;
+	/// Maximum events waiting per input
+	size_t fDepth;
+	/// Events read so far
+	ULong64_t fNread;
+	/// Events handed out so far
+	ULong64_t fNmerged;
+	/// Events handed out after a later one
+	ULong64_t fNlate;
+	/// Time stamp of the last event handed out
+	Double_t fLast;
+
+	/// Disallow copy
+	Merger(const Merger&);
+	/// Disallow assign
+	Merger& operator= (const Merger&);
+
+public:
+	/// \param window Look-ahead window (same unit as the time stamps)
+	//! \param depth Maximum number of events read ahead on one input
+	Merger(Double_t window = 0., Int_t depth = 10000);
+	/// Deletes the inputs
+	~Merger();
+	/// Add an input (takes ownership)
+	void AddStream(Stream* stream);
+	/// \brief Get the next event in time order.
+	//! \param [out] event The event (swapped in, so no copy is made)
+	//! \param [out] stream Index of the input it came from (if not null)
+	//! \returns false once every input has ended and every event has been handed out
+	Bool_t Next(std::vector<char>& event, Int_t* stream = 0);
+	/// Number of inputs
+	Int_t GetNstreams() const { return fInputs.size(); }
+	/// Events read from input _stream_
+	ULong64_t GetNread(Int_t stream) const { return fInputs.at(stream).fNread; }
+	/// Events handed out so far
+	ULong64_t GetNmerged() const { return fNmerged; }
+	/// Events handed out with a time stamp earlier than a previous one
+	ULong64_t GetNlate() const { return fNlate; }
+	/// Events read but not handed out
+	size_t GetNwaiting() const { return fHeap.size(); }
+	/// Look-ahead window
+	Double_t GetWindow() const { return fWindow; }
+};
+
+} // namespace rb
+
+
+#endif
@@ -0,0 +1,372 @@
+//! \file Metrics.cxx
+//! \brief Implements Metrics.hxx
+#include <map>
+#include <vector>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <sys/time.h>
+#include "utils/Timer.hxx"
+#include "utils/Error.hxx"
+#include "utils/Socket.hxx"
+#include "hist/Manager.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "Buffer.hxx"
+#include "Attach.hxx"
+#include "Metrics.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions and Classes                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace {
+/// Poll the endpoint every 100 ms
+const Long_t POLL_TIME = 100;
+/// Sample the source backlog and lag once every 256 buffers
+const ULong64_t kSampleMask = 0xff;
+/// Accept at most this many connections per poll
+const Int_t kMaxConnections = 16;
+/// Keep at most this many connections open
+const size_t kMaxOpen = 64;
+/// Longest request read (bytes)
+const size_t kMaxRequest = 8192;
+/// Answer a client that hasn't sent a complete request after this long (seconds), e.g. socat/nc
+const Double_t kRequestWait = 0.1;
+/// Drop a client that hasn't taken its whole answer after this long (seconds)
+const Double_t kMaxAge = 5;
+
+/// Buffers read since startup
+ULong64_t gBuffers = 0;
+/// Bytes read since startup
+ULong64_t gBytes = 0;
+/// Last sampled backlog of the source (bytes), -1 if unknown
+Long64_t gBacklog = -1;
+/// Last sampled lag of the source (seconds), -1 if unknown
+Double_t gLag = -1;
+
+/// Event counts for one event code
+struct EventCount {
+	std::string fName;
+	ULong64_t fEvents;
+	ULong64_t fFailed;
+	EventCount(): fName(), fEvents(0), fFailed(0) { }
+};
+typedef std::map<Int_t, EventCount> EventCountMap_t;
+
+/// Event rates for one event code
+struct EventRate {
+	Double_t fEvents;
+	Double_t fFailed;
+	EventRate(): fEvents(0), fFailed(0) { }
+};
+typedef std::map<Int_t, EventRate> EventRateMap_t;
+
+/// Snapshot of all counters
+struct Totals {
+	rb::Time fTime;
+	ULong64_t fBuffers;
+	ULong64_t fBytes;
+	ULong64_t fFills;
+	EventCountMap_t fEvents;
+	Totals(): fTime(), fBuffers(gBuffers), fBytes(gBytes), fFills(0), fEvents() {
+		rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
+		for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+			rb::Event* event = rb::Rint::gApp()->GetEvent(it->first);
+			if(!event) continue;
+			EventCount& count = fEvents[it->first];
+			count.fName = it->second;
+			count.fEvents = event->GetNevents();
+			count.fFailed = event->GetNfailed();
+			fFills += event->GetHistManager()->GetNfills();
+		}
+	}
+};
+
+/// Rates between the last two snapshots
+struct Rates {
+	Double_t fBuffers;
+	Double_t fBytes;
+	Double_t fFills;
+	EventRateMap_t fEvents;
+	Rates(): fBuffers(0), fBytes(0), fFills(0), fEvents() { }
+	Rates(const Totals& now, const Totals& then): fEvents() {
+		Double_t dt = now.fTime - then.fTime;
+		if(dt <= 0) dt = 1;
+		fBuffers = (now.fBuffers - then.fBuffers) / dt;
+		fBytes = (now.fBytes - then.fBytes) / dt;
+		fFills = (now.fFills - then.fFills) / dt;
+		for(EventCountMap_t::const_iterator it = now.fEvents.begin(); it != now.fEvents.end(); ++it) {
+			EventCountMap_t::const_iterator itThen = then.fEvents.find(it->first);
+			ULong64_t events0 = itThen == then.fEvents.end() ? 0 : itThen->second.fEvents;
+			ULong64_t failed0 = itThen == then.fEvents.end() ? 0 : itThen->second.fFailed;
+			fEvents[it->first].fEvents = (it->second.fEvents - events0) / dt;
+			fEvents[it->first].fFailed = (it->second.fFailed - failed0) / dt;
+		}
+	}
+};
+
+/// Most recent rates (zero until the server has run for one interval)
+Rates gRates;
+
+/// Write the HELP and TYPE lines of a metric
+void header(std::ostream& out, const char* name, const char* type, const char* help) {
+	out << "# HELP " << name << " " << help << "\n" << "# TYPE " << name << " " << type << "\n";
+}
+
+/// Labels identifying an event processor
+std::string labels(Int_t code, const std::string& name) {
+	std::stringstream out;
+	out << "{event=\"" << name << "\",code=\"" << code << "\"}";
+	return out.str();
+}
+
+/// Polls the endpoint and updates the rates on the main thread
+class MetricsTimer: public rb::Timer
+{
+private:
+	/// One connected client (its socket is non-blocking)
+	struct Connection {
+		/// Socket
+		int fFd;
+		/// Request read so far
+		std::string fIn;
+		/// Answer not yet sent
+		std::string fOut;
+		/// Has the answer been made?
+		Bool_t fAnswered;
+		/// Time of the connection
+		rb::Time fOpened;
+		Connection(int fd): fFd(fd), fIn(), fOut(), fAnswered(kFALSE), fOpened() { }
+	};
+
+	/// Listening socket, -1 if only logging
+	int fSocket;
+	/// Path of the Unix socket (empty for TCP)
+	std::string fPath;
+	/// Seconds between rate updates
+	Double_t fInterval;
+	/// Print a summary at each update?
+	Bool_t fLog;
+	/// Counters at the last update
+	Totals fLast;
+	/// Clients being answered
+	std::vector<Connection*> fConnections;
+public:
+	MetricsTimer(int sock, const std::string& path, Int_t interval, Bool_t log):
+		rb::Timer(POLL_TIME), fSocket(sock), fPath(path), fInterval(interval > 0 ? interval : 10),
+		fLog(log), fLast(), fConnections() { }
+	~MetricsTimer() {
+		TurnOff();
+		for(size_t i=0; i< fConnections.size(); ++i) {
+			close(fConnections[i]->fFd);
+			delete fConnections[i];
+		}
+		if(fSocket >= 0) close(fSocket);
+		if(!fPath.empty()) unlink(fPath.c_str());
+	}
+private:
+	/// \brief Make the answer: HTTP if the client sent a GET, plain text otherwise (e.g. from socat/nc)
+	void Answer(Connection* connection) {
+		std::string body = rb::metrics::Format();
+		if(connection->fIn.compare(0, 4, "GET ") == 0) {
+			std::stringstream head;
+			head << "HTTP/1.0 200 OK\r\n"
+					 << "Content-Type: text/plain; version=0.0.4\r\n"
+					 << "Content-Length: " << body.size() << "\r\n"
+					 << "Connection: close\r\n\r\n";
+			connection->fOut = head.str();
+		}
+		connection->fOut += body;
+		connection->fAnswered = kTRUE;
+	}
+	/// \brief Read what the client sent, answer once the request is complete, send what the socket takes.
+	//! \details Never waits: this runs on the main thread. Clients too slow to take their answer are dropped.
+	//! \returns false once the connection is done with (answered or dropped)
+	Bool_t Serve(Connection* connection, const rb::Time& now) {
+		Bool_t eof = kFALSE;
+		char buf[1024];
+		while(!connection->fAnswered) {
+			ssize_t n = recv(connection->fFd, buf, sizeof(buf), 0);
+			if(n < 0 && errno == EINTR) continue;
+			if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			if(n < 0) return kFALSE;
+			if(n == 0) { eof = kTRUE; break; }
+			connection->fIn.append(buf, n);
+			if(connection->fIn.size() >= kMaxRequest) break;
+		}
+		if(!connection->fAnswered &&
+			 (eof || connection->fIn.size() >= kMaxRequest ||
+				connection->fIn.find("\r\n\r\n") != std::string::npos ||
+				now - connection->fOpened >= kRequestWait))
+			Answer(connection);
+		if(!connection->fAnswered) return kTRUE;
+
+		size_t sent = 0;
+		while(sent < connection->fOut.size()) {
+			ssize_t n = send(connection->fFd, connection->fOut.data() + sent, connection->fOut.size() - sent, MSG_NOSIGNAL);
+			if(n < 0 && errno == EINTR) continue;
+			if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			if(n <= 0) return kFALSE;
+			sent += n;
+		}
+		connection->fOut.erase(0, sent);
+		return !connection->fOut.empty() && now - connection->fOpened < kMaxAge;
+	}
+	/// Accept pending connections, serve the open ones, update the rates once per interval
+	void DoAction() {
+		if(fSocket >= 0) {
+			for(Int_t i=0; i< kMaxConnections && fConnections.size() < kMaxOpen; ++i) {
+				int fd = accept(fSocket, 0, 0);
+				if(fd < 0) break;
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+				fConnections.push_back(new Connection(fd));
+			}
+		}
+		rb::Time time;
+		for(std::vector<Connection*>::iterator it = fConnections.begin(); it != fConnections.end(); ) {
+			if(Serve(*it, time)) { ++it; continue; }
+			close((*it)->fFd);
+			delete *it;
+			it = fConnections.erase(it);
+		}
+		Totals now;
+		if(now.fTime - fLast.fTime < fInterval) return;
+		gRates = Rates(now, fLast);
+		fLast = now;
+		if(fLog) err::Info("rb::metrics") << rb::metrics::Summary();
+	}
+};
+
+/// The running server, if any
+MetricsTimer* gTimer = 0;
+
+} // namespace
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::metrics::AddBuffer()                         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::metrics::AddBuffer(rb::BufferSource* source) {
+	++gBuffers;
+	gBytes += source->GetBufferSize();
+	if((gBuffers & kSampleMask) == 1) {
+		gBacklog = source->GetBacklog();
+		gLag = source->GetLag();
+	}
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::metrics::Start()                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::metrics::Start(const char* endpoint, Int_t interval, Bool_t log) {
+	Stop();
+	int sock = -1;
+	std::string path;
+	if(endpoint && *endpoint) {
+		sock = rb::net::Listen(endpoint, path);
+		if(sock < 0) {
+			err::Error("rb::metrics::Start")
+				<< "Couldn't listen on \"" << endpoint << "\": " << strerror(errno);
+			return kFALSE;
+		}
+		err::Info("rb::metrics::Start")
+			<< "Serving metrics on " << (path.empty() ? "http://" : "")
+			<< (rb::net::IsPort(endpoint) ? "127.0.0.1:" : "") << endpoint;
+	}
+	gTimer = new MetricsTimer(sock, path, interval, log);
+	gTimer->TurnOn();
+	return kTRUE;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::metrics::Stop()                              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::metrics::Stop() {
+	delete gTimer;
+	gTimer = 0;
+	gRates = Rates();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::metrics::IsRunning()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::metrics::IsRunning() {
+	return gTimer != 0;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::metrics::Format()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::metrics::Format() {
+	Totals now;
+	Bool_t online = rb::OnlineAttached();
+	std::stringstream out;
+	out << std::setprecision(12);
+
+	header(out, "rootbeer_attached", "gauge", "Whether a data source of each type is attached.");
+	out << "rootbeer_attached{source=\"online\"} " << online << "\n"
+			<< "rootbeer_attached{source=\"file\"} " << rb::FileAttached() << "\n"
+			<< "rootbeer_attached{source=\"list\"} " << rb::ListAttached() << "\n"
+			<< "rootbeer_attached{source=\"parallel_list\"} " << rb::ParallelListAttached() << "\n";
+
+	header(out, "rootbeer_buffers_total", "counter", "Buffers read from the data source.");
+	out << "rootbeer_buffers_total " << now.fBuffers << "\n";
+	header(out, "rootbeer_bytes_total", "counter", "Bytes read from the data source.");
+	out << "rootbeer_bytes_total " << now.fBytes << "\n";
+	header(out, "rootbeer_events_total", "counter", "Events processed, by event type.");
+	for(EventCountMap_t::iterator it = now.fEvents.begin(); it != now.fEvents.end(); ++it)
+		out << "rootbeer_events_total" << labels(it->first, it->second.fName) << " " << it->second.fEvents << "\n";
+	header(out, "rootbeer_events_failed_total", "counter", "Events that failed to unpack, by event type.");
+	for(EventCountMap_t::iterator it = now.fEvents.begin(); it != now.fEvents.end(); ++it)
+		out << "rootbeer_events_failed_total" << labels(it->first, it->second.fName) << " " << it->second.fFailed << "\n";
+	header(out, "rootbeer_histogram_fills_total", "counter", "Histogram fills attempted.");
+	out << "rootbeer_histogram_fills_total " << now.fFills << "\n";
+
+	header(out, "rootbeer_buffers_per_second", "gauge", "Buffer rate over the last interval.");
+	out << "rootbeer_buffers_per_second " << gRates.fBuffers << "\n";
+	header(out, "rootbeer_bytes_per_second", "gauge", "Byte rate over the last interval.");
+	out << "rootbeer_bytes_per_second " << gRates.fBytes << "\n";
+	header(out, "rootbeer_events_per_second", "gauge", "Event rate over the last interval, by event type.");
+	for(EventCountMap_t::iterator it = now.fEvents.begin(); it != now.fEvents.end(); ++it)
+		out << "rootbeer_events_per_second" << labels(it->first, it->second.fName) << " " << gRates.fEvents[it->first].fEvents << "\n";
+	header(out, "rootbeer_events_failed_per_second", "gauge", "Unpack failure rate over the last interval, by event type.");
+	for(EventCountMap_t::iterator it = now.fEvents.begin(); it != now.fEvents.end(); ++it)
+		out << "rootbeer_events_failed_per_second" << labels(it->first, it->second.fName) << " " << gRates.fEvents[it->first].fFailed << "\n";
+	header(out, "rootbeer_histogram_fills_per_second", "gauge", "Histogram fill rate over the last interval.");
+	out << "rootbeer_histogram_fills_per_second " << gRates.fFills << "\n";
+
+	header(out, "rootbeer_source_backlog_bytes", "gauge", "Bytes waiting to be read from the online source (NaN if unknown).");
+	out << "rootbeer_source_backlog_bytes ";
+	if(online && gBacklog >= 0) out << gBacklog << "\n"; else out << "NaN\n";
+	header(out, "rootbeer_source_lag_seconds", "gauge", "Time between the last online event's time stamp and now (NaN if unknown).");
+	out << "rootbeer_source_lag_seconds ";
+	if(online && gLag >= 0) out << gLag << "\n"; else out << "NaN\n";
+
+	return out.str();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::metrics::Summary()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::metrics::Summary() {
+	Double_t events = 0, failed = 0;
+	for(EventRateMap_t::iterator it = gRates.fEvents.begin(); it != gRates.fEvents.end(); ++it) {
+		events += it->second.fEvents;
+		failed += it->second.fFailed;
+	}
+	std::stringstream out;
+	out << std::fixed << std::setprecision(1)
+			<< gRates.fBuffers << " buffers/s, "
+			<< gRates.fBytes / (1024.*1024.) << " MB/s, "
+			<< events << " events/s, "
+			<< failed << " failed/s, "
+			<< gRates.fFills << " fills/s";
+	if(rb::OnlineAttached()) {
+		if(gBacklog >= 0) out << ", backlog " << gBacklog / 1024. << " kB";
+		if(gLag >= 0) out << ", lag " << gLag << " s";
+	}
+	return out.str();
+}
@@ -0,0 +1,43 @@
+//! \file Metrics.hxx
+//! \brief Live throughput metrics, served in Prometheus text format.
+//! \details Counts buffers, bytes, events (per event code), unpack failures and histogram fills
+//! as data are read, and samples the backlog and lag of an online source. rb::StartMetrics()
+//! serves the current values on a local TCP port or Unix socket, so that a dashboard can scrape
+//! them over HTTP, and optionally prints a summary line at a fixed interval. All counting happens
+//! on the thread that reads the data, and the endpoint is polled from a timer on the same thread,
+//! so no locking is needed.
+#ifndef RB_METRICS_HXX
+#define RB_METRICS_HXX
+#include <string>
+#include <Rtypes.h>
+
+namespace rb
+{
+class BufferSource;
+
+/// Live throughput metrics.
+namespace metrics
+{
+/// Count a buffer that has just been read and unpacked from _source_
+void AddBuffer(rb::BufferSource* source);
+
+/// Start serving on _endpoint_, updating rates every _interval_ seconds
+Bool_t Start(const char* endpoint, Int_t interval, Bool_t log);
+
+/// Stop serving and close the endpoint
+void Stop();
+
+/// Is the endpoint (or the log timer) running?
+Bool_t IsRunning();
+
+/// Format the current values as Prometheus text
+std::string Format();
+
+/// Format the current values as a one-line summary
+std::string Summary();
+
+} // namespace metrics
+} // namespace rb
+
+
+#endif
@@ -0,0 +1,277 @@
+//! \file Polygon.cxx
+//! \brief Implements Polygon.hxx
+#include <map>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <TROOT.h>
+#include <TCutG.h>
+#include "utils/boost_shared_ptr.h"
+#include "utils/boost_scoped_ptr.h"
+#include "ClassFormula.hxx"
+#include "Data.hxx"
+#include "Event.hxx"
+#include "Polygon.hxx"
+
+
+namespace {
+/// Twice the signed area of triangle (a, b, c)
+inline Double_t orient(Double_t ax, Double_t ay, Double_t bx, Double_t by, Double_t cx, Double_t cy) {
+	return (bx - ax)*(cy - ay) - (by - ay)*(cx - ax);
+}
+
+/// Does segment (x0,y0)-(x1,y1) touch the box [xlo,xhi] x [ylo,yhi]? (Liang-Barsky clip)
+bool segment_hits_box(Double_t x0, Double_t y0, Double_t x1, Double_t y1,
+											Double_t xlo, Double_t xhi, Double_t ylo, Double_t yhi) {
+	Double_t t0 = 0., t1 = 1.;
+	const Double_t d[2] = { x1 - x0, y1 - y0 };
+	const Double_t p[4] = { -d[0], d[0], -d[1], d[1] };
+	const Double_t q[4] = { x0 - xlo, xhi - x0, y0 - ylo, yhi - y0 };
+	for(int i=0; i< 4; ++i) {
+		if(p[i] == 0.) {
+			if(q[i] < 0.) return false;
+			continue;
+		}
+		Double_t t = q[i] / p[i];
+		if(p[i] < 0.) { if(t > t1) return false; if(t > t0) t0 = t; }
+		else          { if(t < t0) return false; if(t < t1) t1 = t; }
+	}
+	return true;
+}
+
+/// Grid cell along one axis
+inline Int_t cell_index(Double_t v, Double_t lo, Double_t d, Int_t n) {
+	if(d <= 0.) return 0;
+	Int_t i = Int_t((v - lo) / d);
+	return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::Polygon                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::Polygon::Polygon():
+	fX(), fY(),
+	fXmin(0.), fXmax(0.), fYmin(0.), fYmax(0.),
+	fNx(0), fNy(0), fDx(0.), fDy(0.),
+	fCells(), fCellStart(), fCellEdges() { }
+
+void rb::Polygon::Set(Int_t n, const Double_t* x, const Double_t* y) {
+	fX.assign(x, x + (n > 0 ? n : 0));
+	fY.assign(y, y + (n > 0 ? n : 0));
+	fCells.clear();
+	fCellStart.clear();
+	fCellEdges.clear();
+	fNx = fNy = 0;
+	if(n < 3) return;
+
+	fXmin = *std::min_element(fX.begin(), fX.end());
+	fXmax = *std::max_element(fX.begin(), fX.end());
+	fYmin = *std::min_element(fY.begin(), fY.end());
+	fYmax = *std::max_element(fY.begin(), fY.end());
+
+	// about two cells per edge on each axis, so most cells hold no edge at all
+	Int_t ncells = Int_t(2.*sqrt(Double_t(n)) + 0.5);
+	ncells = std::max(4, std::min(128, ncells));
+	fNx = fXmax > fXmin ? ncells : 1;
+	fNy = fYmax > fYmin ? ncells : 1;
+	fDx = (fXmax - fXmin) / fNx;
+	fDy = (fYmax - fYmin) / fNy;
+
+	// edges through each cell, as a compressed list (count, then fill)
+	const Double_t ex = 1e-9*(fDx + fDy), ey = ex; // rounding margin: listing an edge too many is harmless
+	std::vector<Int_t> count(fNx*fNy + 1, 0);
+	for(int pass = 0; pass< 2; ++pass) {
+		for(Int_t i=0; i< n; ++i) {
+			Int_t j = (i + 1) % n;
+			Int_t ix0 = cell_index(std::min(fX[i], fX[j]), fXmin, fDx, fNx);
+			Int_t ix1 = cell_index(std::max(fX[i], fX[j]), fXmin, fDx, fNx);
+			Int_t iy0 = cell_index(std::min(fY[i], fY[j]), fYmin, fDy, fNy);
+			Int_t iy1 = cell_index(std::max(fY[i], fY[j]), fYmin, fDy, fNy);
+			for(Int_t iy = iy0; iy <= iy1; ++iy) {
+				for(Int_t ix = ix0; ix <= ix1; ++ix) {
+					Double_t xlo = fXmin + ix*fDx, ylo = fYmin + iy*fDy;
+					if(!segment_hits_box(fX[i], fY[i], fX[j], fY[j], xlo - ex, xlo + fDx + ex, ylo - ey, ylo + fDy + ey))
+						continue;
+					Int_t cell = iy*fNx + ix;
+					if(pass == 0) ++count[cell];
+					else fCellEdges[fCellStart[cell] + count[cell]++] = i;
+				}
+			}
+		}
+		if(pass == 0) {
+			fCellStart.assign(fNx*fNy + 1, 0);
+			for(Int_t c = 0; c< fNx*fNy; ++c) fCellStart[c+1] = fCellStart[c] + count[c];
+			fCellEdges.resize(fCellStart.back());
+			std::fill(count.begin(), count.end(), 0);
+		}
+	}
+
+	// the crossing count from the center is ambiguous if the center is on (or very near) an edge
+	const Double_t tiny = 1e-9*(fDx + fDy);
+	fCells.resize(fNx*fNy);
+	for(Int_t iy = 0; iy< fNy; ++iy) {
+		for(Int_t ix = 0; ix< fNx; ++ix) {
+			const Int_t cell = iy*fNx + ix;
+			const Double_t cx = fXmin + (ix + 0.5)*fDx, cy = fYmin + (iy + 0.5)*fDy;
+			fCells[cell] = IsInsideSlow(cx, cy) ? kInside : kOutside;
+			for(Int_t k = fCellStart[cell]; k< fCellStart[cell+1]; ++k) {
+				const Int_t i = fCellEdges[k], j = (i + 1) % n;
+				const Double_t len = fabs(fX[j] - fX[i]) + fabs(fY[j] - fY[i]);
+				if(fabs(orient(fX[i], fY[i], fX[j], fY[j], cx, cy)) <= tiny*len) { fCells[cell] = kOnEdge; break; }
+			}
+		}
+	}
+}
+
+Bool_t rb::Polygon::IsInsideSlow(Double_t xp, Double_t yp) const {
+	/*! Same as TMath::IsInside() */
+	Bool_t odd = kFALSE;
+	const Int_t n = fX.size();
+	for(Int_t i = 0, j = n - 1; i< n; j = i++) {
+		if((fY[i] < yp && fY[j] >= yp) || (fY[j] < yp && fY[i] >= yp)) {
+			if(fX[i] + (yp - fY[i])/(fY[j] - fY[i])*(fX[j] - fX[i]) < xp) odd = !odd;
+		}
+	}
+	return odd;
+}
+
+Bool_t rb::Polygon::IsInside(Double_t x, Double_t y) const {
+	/*!
+	 * Count the edges crossed on the way from the center of the cell, where the answer is known,
+	 * to (x, y). Any edge crossed lies in the cell, as the path does. Points on (or within rounding
+	 * of) an edge get the full test, for the half-open rule of TMath::IsInside() there: e.g. the
+	 * right and top edges of a rectangle are inside, the left and bottom ones outside.
+	 */
+	if(!fNx || x < fXmin || x > fXmax || y < fYmin || y > fYmax) return kFALSE;
+	const Int_t ix = cell_index(x, fXmin, fDx, fNx), iy = cell_index(y, fYmin, fDy, fNy);
+	const Int_t cell = iy*fNx + ix;
+	if(fCells[cell] == kOnEdge) return IsInsideSlow(x, y);
+	Bool_t inside = fCells[cell] == kInside;
+	const Int_t first = fCellStart[cell], last = fCellStart[cell+1];
+	if(first == last) return inside;
+
+	const Double_t cx = fXmin + (ix + 0.5)*fDx, cy = fYmin + (iy + 0.5)*fDy;
+	const Double_t tiny = 1e-9*(fDx + fDy);
+	const Int_t n = fX.size();
+	for(Int_t k = first; k< last; ++k) {
+		const Int_t i = fCellEdges[k], j = (i + 1) % n;
+		const Double_t op = orient(fX[i], fY[i], fX[j], fY[j], x, y);
+		const Double_t len = fabs(fX[j] - fX[i]) + fabs(fY[j] - fY[i]);
+		if(fabs(op) <= tiny*len &&
+			 x >= std::min(fX[i], fX[j]) - tiny && x <= std::max(fX[i], fX[j]) + tiny &&
+			 y >= std::min(fY[i], fY[j]) - tiny && y <= std::max(fY[i], fY[j]) + tiny)
+			return IsInsideSlow(x, y);
+		// vertices exactly on the path count as being on one side, so shared ones aren't counted twice
+		const Bool_t si = orient(cx, cy, x, y, fX[i], fY[i]) > 0.;
+		const Bool_t sj = orient(cx, cy, x, y, fX[j], fY[j]) > 0.;
+		if(si == sj) continue;
+		const Double_t oc = orient(fX[i], fY[i], fX[j], fY[j], cx, cy);
+		if((oc > 0. && op <= 0.) || (oc <= 0. && op > 0.)) inside = !inside;
+	}
+	return inside;
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::CutGate                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace {
+/// Reads the value of a ClassFormula (for cut variables that aren't plain members)
+class FormulaReader: public rb::data::MReader {
+	boost::shared_ptr<rb::ClassFormula> fFormula;
+public:
+	FormulaReader(const boost::shared_ptr<rb::ClassFormula>& formula): fFormula(formula) { }
+	Double_t ReadValue() { return fFormula->Eval(); }
+	rb::data::MReader* Clone() { return new FormulaReader(fFormula); }
+};
+
+/// Reader of the event class value _var_, 0 if it can't be evaluated
+rb::data::MReader* new_var_reader(const char* var, const char* branchName, const char* className, void* classAddr) {
+	if(!var || !*var) return 0;
+	rb::data::Mapper mapper(branchName, className, reinterpret_cast<Long_t>(classAddr), kFALSE);
+	rb::data::MReader* reader = mapper.FindBasicReader(var);
+	if(reader) return reader;
+	boost::shared_ptr<rb::ClassFormula> formula(new rb::ClassFormula(var, var, branchName, className, classAddr));
+	return formula->GetNdim() ? new FormulaReader(formula) : 0;
+}
+
+/// One cut on one event class, shared by all formulae using it
+struct CutState {
+	rb::Polygon fPolygon;
+	boost::scoped_ptr<rb::data::MReader> fX;
+	boost::scoped_ptr<rb::data::MReader> fY;
+	/// rb::Event::GetSerial() of fValue
+	ULong64_t fSerial;
+	/// Is fValue set?
+	Bool_t fValid;
+	/// Result for event fSerial
+	Bool_t fValue;
+	CutState(): fPolygon(), fX(0), fY(0), fSerial(0), fValid(kFALSE), fValue(kFALSE) { }
+	Double_t Eval() {
+		const ULong64_t serial = rb::Event::GetSerial();
+		if(!fValid || serial != fSerial) {
+			fValue = fPolygon.IsInside(fX->ReadValue(), fY->ReadValue());
+			fSerial = serial;
+			fValid = kTRUE;
+		}
+		return fValue;
+	}
+};
+
+typedef std::map<std::pair<std::string, Long_t>, boost::shared_ptr<CutState> > CutStates_t;
+
+/// Every cut in use, by name and event class address
+CutStates_t& cut_states() {
+	static CutStates_t* states = new CutStates_t();
+	return *states;
+}
+
+/// Reader handed to ClassFormula
+class CutReader: public rb::data::MReader {
+	boost::shared_ptr<CutState> fState;
+public:
+	CutReader(const boost::shared_ptr<CutState>& state): fState(state) { }
+	Double_t ReadValue() { return fState->Eval(); }
+	rb::data::MReader* Clone() { return new CutReader(fState); }
+};
+
+/// TCutG called _name_, 0 if none
+TCutG* find_cut(const char* name) {
+	TObject* obj = gROOT->GetListOfSpecials()->FindObject(name);
+	return obj && obj->InheritsFrom(TCutG::Class()) ? static_cast<TCutG*>(obj) : 0;
+}
+}
+
+rb::data::MReader* rb::CutGate::NewReader(const char* name, const char* branchName,
+																					const char* className, void* classAddr) {
+	std::pair<std::string, Long_t> key(name, reinterpret_cast<Long_t>(classAddr));
+	CutStates_t::iterator it = cut_states().find(key);
+	if(it != cut_states().end()) return new CutReader(it->second);
+
+	TCutG* cut = find_cut(name);
+	if(!cut) return 0;
+	boost::shared_ptr<CutState> state(new CutState());
+	state->fX.reset(new_var_reader(cut->GetVarX(), branchName, className, classAddr));
+	state->fY.reset(new_var_reader(cut->GetVarY(), branchName, className, classAddr));
+	if(!state->fX.get() || !state->fY.get()) return 0;
+	state->fPolygon.Set(cut->GetN(), cut->GetX(), cut->GetY());
+	cut_states()[key] = state;
+	return new CutReader(state);
+}
+
+Int_t rb::CutGate::Update(const char* name) {
+	Int_t n = 0;
+	for(CutStates_t::iterator it = cut_states().begin(); it != cut_states().end(); ++it) {
+		if(*name && it->first.first != name) continue;
+		TCutG* cut = find_cut(it->first.first.c_str());
+		if(!cut) continue; // keep the last vertices
+		it->second->fPolygon.Set(cut->GetN(), cut->GetX(), cut->GetY());
+		it->second->fValid = kFALSE;
+		++n;
+	}
+	return n;
+}
@@ -0,0 +1,77 @@
+//! \file Polygon.hxx
+//! \brief Fast point-in-polygon tests for two-dimensional (TCutG) gates.
+//! \details Gate formulae that name a TCutG (e.g. "pid && bgo.e[0] > 100", with a TCutG called
+//! "pid" whose VarX and VarY are members of the event class) are evaluated by rb::ClassFormula
+//! through a rb::CutGate instead of TCutG::IsInside(), which tests every vertex of the polygon for
+//! every histogram on every event.
+#ifndef RB_POLYGON_HXX
+#define RB_POLYGON_HXX
+#include <vector>
+#include <Rtypes.h>
+
+namespace rb
+{
+namespace data { class MReader; }
+
+/// \brief Polygon with a precomputed grid for constant-time inside tests on average.
+//! \details The bounding box is divided into a grid of about as many cells as the polygon has
+//! edges. Each cell stores whether its center is inside, and the edges that pass through it;
+//! most cells have none, so the center answers for the whole cell. In the others, only the few
+//! edges in the cell are tested for crossings between the center and the point (or all of them, in
+//! the rare cell whose center lies on an edge, or for a point on an edge). The rule is the even-odd
+//! one of TMath::IsInside() (and so TCutG::IsInside()), with the same answer for points on the edges.
+class Polygon
+{
+private:
+	/// What is known about the center of a cell
+	enum ECell { kOutside = 0, kInside = 1, kOnEdge = 2 };
+	/// Vertices
+	std::vector<Double_t> fX, fY;
+	/// Bounding box
+	Double_t fXmin, fXmax, fYmin, fYmax;
+	/// Grid cells per axis
+	Int_t fNx, fNy;
+	/// Cell size
+	Double_t fDx, fDy;
+	/// State of the center of each cell (see ECell)
+	std::vector<Char_t> fCells;
+	/// Index into fCellEdges of the first edge of each cell (and one past the last cell)
+	std::vector<Int_t> fCellStart;
+	/// Edges (index of the first vertex) passing through each cell
+	std::vector<Int_t> fCellEdges;
+
+	/// Full even-odd test against every edge
+	Bool_t IsInsideSlow(Double_t x, Double_t y) const;
+
+public:
+	/// Empty polygon (nothing is inside)
+	Polygon();
+	/// Set the vertices (the last one connects back to the first) and build the grid
+	void Set(Int_t n, const Double_t* x, const Double_t* y);
+	/// Number of vertices
+	Int_t GetN() const { return fX.size(); }
+	/// Is (x, y) inside?
+	Bool_t IsInside(Double_t x, Double_t y) const;
+};
+
+/// \brief Evaluation of a named TCutG on event class members, shared between formulae.
+//! \details Every formula that uses the same cut on the same event processor shares one state,
+//! which remembers the result for the event being processed (see rb::Event::GetSerial()), so a
+//! cut used by many histograms is only evaluated once per event. The vertices are copied from
+//! the TCutG when the first formula using it is made; call Update() after editing the TCutG.
+class CutGate
+{
+public:
+	/// \brief Make a reader for ClassFormula of cut _name_ on the given event class.
+	//! \returns 0 if there is no TCutG called _name_, or its VarX or VarY isn't a member of the class.
+	static rb::data::MReader* NewReader(const char* name, const char* branchName, const char* className, void* classAddr);
+
+	/// \brief Copy the vertices of TCutG _name_ again (of every cut in use if _name_ is empty).
+	//! \returns The number of cuts updated
+	static Int_t Update(const char* name = "");
+};
+
+} // namespace rb
+
+
+#endif
@@ -0,0 +1,343 @@
+//! \file Profile.cxx
+//! \brief Implements Profile.hxx
+#include <map>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <TSystem.h>
+#include <TGComboBox.h>
+#include <TGTextView.h>
+#include <TGButton.h>
+#include <TGLabel.h>
+#include "hist/Hist.hxx"
+#include "utils/Mutex.hxx"
+#include "utils/Timer.hxx"
+#include "utils/Error.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "Profile.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions and Classes                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace {
+typedef std::map<rb::Event*, rb::profile::Counters> EventCounterMap_t;
+typedef std::map<rb::hist::Base*, rb::profile::Counters> HistCounterMap_t;
+
+/// Protects the counter maps
+rb::Mutex gProfileMutex("gProfileMutex");
+/// Is sampling switched on?
+Bool_t gEnabled = kFALSE;
+/// Sample every gInterval-th event
+ULong64_t gInterval = 64;
+/// Events seen since sampling was switched on
+ULong64_t gEventCount = 0;
+/// Cycle counter ticks per nanosecond
+Double_t gCyclesPerNs = 1.;
+/// Counters for each event processor
+EventCounterMap_t gEvents;
+/// Counters for each histogram
+HistCounterMap_t gHists;
+
+const char* const kStageNames[rb::profile::kNstages] =
+	{ "unpack", "tree fill", "save", "histograms" };
+const char* const kHistStageNames[rb::profile::kNhistStages] =
+	{ "gate", "params", "bins" };
+const char* const kSortNames[rb::profile::kNsortKeys] =
+	{ "total", "gate", "params", "bins", "calls", "name" };
+
+Double_t calibrate() {
+	rb::Time t0;
+	ULong64_t c0 = rb::profile::Cycles();
+	gSystem->Sleep(50);
+	ULong64_t c1 = rb::profile::Cycles();
+	rb::Time t1;
+	Double_t ns = 1e9 * (t1 - t0);
+	return ns > 0 ? (c1 - c0) / ns : 1.;
+}
+
+/// One line of the histogram table
+struct HistRow {
+	std::string fName;
+	rb::profile::Counters fCounters;
+};
+
+/// Orders HistRow by the chosen key (largest first, or alphabetical for names)
+class HistRowSort {
+private:
+	Int_t fKey;
+public:
+	HistRowSort(Int_t key): fKey(key) { }
+	bool operator() (const HistRow& lhs, const HistRow& rhs) const {
+		switch(fKey) {
+		case rb::profile::kSortGate:
+			return lhs.fCounters.fCycles[rb::profile::kGate] > rhs.fCounters.fCycles[rb::profile::kGate];
+		case rb::profile::kSortParams:
+			return lhs.fCounters.fCycles[rb::profile::kParams] > rhs.fCounters.fCycles[rb::profile::kParams];
+		case rb::profile::kSortBins:
+			return lhs.fCounters.fCycles[rb::profile::kBins] > rhs.fCounters.fCycles[rb::profile::kBins];
+		case rb::profile::kSortCalls:
+			return lhs.fCounters.fCalls > rhs.fCounters.fCalls;
+		case rb::profile::kSortName:
+			return lhs.fName < rhs.fName;
+		default:
+			return lhs.fCounters.Total() > rhs.fCounters.Total();
+		}
+	}
+};
+
+/// Mean nanoseconds per sampled call
+Double_t per_call(ULong64_t cycles, ULong64_t calls) {
+	return calls ? cycles / gCyclesPerNs / calls : 0;
+}
+
+std::string event_name(rb::Event* event) {
+	rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it) {
+		if(rb::Rint::gApp()->GetEvent(it->first) == event) return it->second;
+	}
+	return "(unknown)";
+} }
+
+namespace rb { namespace profile { volatile Bool_t gSampling = kFALSE; } }
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::profile::Enable()                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::profile::Enable(Bool_t on, Int_t interval) {
+	if(!IsCompiled()) {
+		rb::err::Warning("rb::SetProfile")
+			<< "Profiling is not compiled in, rebuild rootbeer with -DRB_PROFILE to use it.";
+		return;
+	}
+	if(on && !gEnabled) gCyclesPerNs = calibrate();
+	rb::ScopedLock<rb::Mutex> lock(gProfileMutex);
+	gInterval = interval > 0 ? interval : 1;
+	gEventCount = 0;
+	gEnabled = on;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::profile::IsEnabled()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::profile::IsEnabled() {
+	return gEnabled;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::profile::IsCompiled()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::profile::IsCompiled() {
+#ifdef RB_PROFILE
+	return kTRUE;
+#else
+	return kFALSE;
+#endif
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::profile::BeginEvent()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::profile::BeginEvent() {
+	if(!gEnabled) return kFALSE;
+	gSampling = (++gEventCount % gInterval == 0);
+	return gSampling;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::profile::EndEvent()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::profile::EndEvent() {
+	gSampling = kFALSE;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::profile::AddEvent()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::profile::AddEvent(rb::Event* event, const ULong64_t* cycles) {
+	rb::ScopedLock<rb::Mutex> lock(gProfileMutex);
+	Counters& c = gEvents[event];
+	++c.fCalls;
+	for(Int_t i=0; i< kNstages; ++i) c.fCycles[i] += cycles[i];
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::profile::AddHist()                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::profile::AddHist(rb::hist::Base* hist, const ULong64_t* cycles) {
+	rb::ScopedLock<rb::Mutex> lock(gProfileMutex);
+	Counters& c = gHists[hist];
+	++c.fCalls;
+	for(Int_t i=0; i< kNhistStages; ++i) c.fCycles[i] += cycles[i];
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::profile::Forget()                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::profile::Forget(rb::hist::Base* hist) {
+	rb::ScopedLock<rb::Mutex> lock(gProfileMutex);
+	gHists.erase(hist);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::profile::Reset()                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::profile::Reset() {
+	rb::ScopedLock<rb::Mutex> lock(gProfileMutex);
+	gEvents.clear();
+	gHists.clear();
+	gEventCount = 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::profile::SortKey()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::profile::SortKey(const char* name) {
+	for(Int_t i=0; i< kNsortKeys; ++i)
+		if(!strcmp(name, kSortNames[i])) return i;
+	rb::err::Warning("rb::PrintProfile") << "Unknown sort key \"" << name << "\", using \"total\".";
+	return kSortTotal;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// std::string rb::profile::Format()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::profile::Format(Int_t sortkey, Int_t nhists) {
+	/*!
+	 * All times are mean nanoseconds per sampled call, converted from cycles
+	 * with a calibration made when profiling was switched on.
+	 */
+	std::vector<std::pair<std::string, Counters> > events;
+	std::vector<HistRow> hists;
+	ULong64_t histTotal = 0;
+	{
+		rb::ScopedLock<rb::Mutex> lock(gProfileMutex);
+		for(EventCounterMap_t::iterator it = gEvents.begin(); it != gEvents.end(); ++it)
+			events.push_back(std::make_pair(event_name(it->first), it->second));
+		for(HistCounterMap_t::iterator it = gHists.begin(); it != gHists.end(); ++it) {
+			HistRow row;
+			row.fName = it->first->GetName();
+			row.fCounters = it->second;
+			histTotal += row.fCounters.Total();
+			hists.push_back(row);
+		}
+	}
+	std::sort(hists.begin(), hists.end(), HistRowSort(sortkey));
+
+	char line[256];
+	std::stringstream out;
+	if(!IsCompiled())
+		out << "Profiling is not compiled in (rebuild with -DRB_PROFILE).\n";
+	else if(!gEnabled)
+		out << "Profiling is off (rb::SetProfile() to turn it on).\n";
+	out << "Sampling 1 in " << gInterval << " events, " << gCyclesPerNs << " cycles/ns.\n\n";
+
+	sprintf(line, "%-24s %10s %12s %12s %12s %12s %12s\n", "Event [ns/event]", "samples",
+					kStageNames[0], kStageNames[1], kStageNames[2], kStageNames[3], "total");
+	out << line;
+	for(UInt_t i=0; i< events.size(); ++i) {
+		const Counters& c = events[i].second;
+		sprintf(line, "%-24s %10llu %12.1f %12.1f %12.1f %12.1f %12.1f\n", events[i].first.c_str(),
+						(unsigned long long)c.fCalls,
+						per_call(c.fCycles[kUnpack], c.fCalls), per_call(c.fCycles[kTreeFill], c.fCalls),
+						per_call(c.fCycles[kSave], c.fCalls), per_call(c.fCycles[kHistograms], c.fCalls),
+						per_call(c.Total(), c.fCalls));
+		out << line;
+	}
+
+	sprintf(line, "\n%-24s %10s %12s %12s %12s %12s %8s\n", "Histogram [ns/fill]", "samples",
+					kHistStageNames[0], kHistStageNames[1], kHistStageNames[2], "total", "share");
+	out << line;
+	UInt_t nrows = (nhists > 0 && UInt_t(nhists) < hists.size()) ? nhists : hists.size();
+	for(UInt_t i=0; i< nrows; ++i) {
+		const Counters& c = hists[i].fCounters;
+		sprintf(line, "%-24s %10llu %12.1f %12.1f %12.1f %12.1f %7.2f%%\n", hists[i].fName.c_str(),
+						(unsigned long long)c.fCalls,
+						per_call(c.fCycles[kGate], c.fCalls), per_call(c.fCycles[kParams], c.fCalls),
+						per_call(c.fCycles[kBins], c.fCalls), per_call(c.Total(), c.fCalls),
+						histTotal ? 100. * c.Total() / histTotal : 0.);
+		out << line;
+	}
+	if(nrows < hists.size())
+		out << "... " << hists.size() - nrows << " more\n";
+	return out.str();
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::TGProfileFrame                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::TGProfileFrame* rb::TGProfileFrame::fgInstance = 0;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::TGProfileFrame::Open() [static]              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::TGProfileFrame::Open() {
+	if(!gClient) {
+		rb::err::Error("rb::ShowProfile") << "No graphics available, use rb::PrintProfile() instead.";
+		return;
+	}
+	if(!fgInstance) fgInstance = new TGProfileFrame();
+	fgInstance->Refresh();
+	fgInstance->MapRaised();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::TGProfileFrame::TGProfileFrame():
+	TGMainFrame(gClient->GetRoot(), 800, 600, kMainFrame | kVerticalFrame),
+	fSortKey(profile::kSortTotal) {
+	SetCleanup(kDeepCleanup);
+	SetWindowName("rootbeer profile");
+
+	TGHorizontalFrame* controls = new TGHorizontalFrame(this);
+	controls->AddFrame(new TGLabel(controls, "Sort histograms by:"),
+										 new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 2, 2, 2, 2));
+	fSort = new TGComboBox(controls);
+	for(Int_t i=0; i< profile::kNsortKeys; ++i) fSort->AddEntry(kSortNames[i], i);
+	fSort->Select(fSortKey, kFALSE);
+	fSort->Resize(100, 22);
+	fSort->Connect("Selected(Int_t)", "rb::TGProfileFrame", this, "SetSortKey(Int_t)");
+	controls->AddFrame(fSort, new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 2, 2, 2, 2));
+
+	fRefresh = new TGTextButton(controls, "Refresh");
+	fRefresh->Connect("Clicked()", "rb::TGProfileFrame", this, "Refresh()");
+	controls->AddFrame(fRefresh, new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 2, 2, 2, 2));
+	fReset = new TGTextButton(controls, "Reset");
+	fReset->Connect("Clicked()", "rb::TGProfileFrame", this, "ResetCounters()");
+	controls->AddFrame(fReset, new TGLayoutHints(kLHintsLeft | kLHintsCenterY, 2, 2, 2, 2));
+	AddFrame(controls, new TGLayoutHints(kLHintsTop | kLHintsExpandX));
+
+	fText = new TGTextView(this, 800, 560);
+	AddFrame(fText, new TGLayoutHints(kLHintsExpandX | kLHintsExpandY, 2, 2, 2, 2));
+
+	MapSubwindows();
+	Resize(GetDefaultSize());
+	Resize(800, 600);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::TGProfileFrame::~TGProfileFrame() {
+	fgInstance = 0;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::TGProfileFrame::Refresh()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::TGProfileFrame::Refresh() {
+	std::string text = profile::Format(fSortKey, 0);
+	fText->LoadBuffer(text.c_str());
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::TGProfileFrame::SetSortKey()                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::TGProfileFrame::SetSortKey(Int_t key) {
+	fSortKey = key;
+	Refresh();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::TGProfileFrame::ResetCounters()              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::TGProfileFrame::ResetCounters() {
+	profile::Reset();
+	Refresh();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::TGProfileFrame::CloseWindow()                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::TGProfileFrame::CloseWindow() {
+	DeleteWindow();
+}
@@ -0,0 +1,144 @@
+//! \file Profile.hxx
+//! \brief Optional sampling profiler for event processing and histogram filling.
+//! \details The instrumentation hooks in rb::Event::Process() and rb::hist::Base::Fill() are
+//! only compiled in when rootbeer is built with <tt>-DRB_PROFILE</tt>; without it they do not
+//! exist and processing is unchanged. When compiled in, profiling is switched on at run time with
+//! rb::SetProfile(). Only every n-th event is timed, by reading the CPU cycle counter at the
+//! boundaries of each stage, so the cost of the unsampled events is a single counter increment.
+#ifndef RB_PROFILE_HXX
+#define RB_PROFILE_HXX
+#include <string>
+#include <vector>
+#include <Rtypes.h>
+#include <TGFrame.h>
+#ifndef __MAKECINT__
+#include <time.h>
+#endif
+
+class TGComboBox;
+class TGTextView;
+class TGTextButton;
+
+namespace rb
+{
+class Event;
+namespace hist { class Base; }
+
+/// Cycle-count profiling of event processing and histogram filling.
+namespace profile
+{
+/// Event processing stages
+enum EStage { kUnpack, kTreeFill, kSave, kHistograms, kNstages };
+
+/// Histogram filling stages
+enum EHistStage { kGate, kParams, kBins, kNhistStages };
+
+/// Sort keys for the histogram table
+enum ESortKey { kSortTotal, kSortGate, kSortParams, kSortBins, kSortCalls, kSortName, kNsortKeys };
+
+/// Accumulated cycles for one event processor or histogram
+struct Counters
+{
+	/// Number of sampled calls
+	ULong64_t fCalls;
+	/// Cycles per stage (EStage or EHistStage)
+	ULong64_t fCycles[kNstages];
+	/// Zeros everything
+	Counters(): fCalls(0) { for(Int_t i=0; i< kNstages; ++i) fCycles[i] = 0; }
+	/// Sum of all stages
+	ULong64_t Total() const { ULong64_t t = 0; for(Int_t i=0; i< kNstages; ++i) t += fCycles[i]; return t; }
+};
+
+#ifndef __MAKECINT__
+/// Read the CPU cycle counter (nanosecond clock where there isn't one)
+inline ULong64_t Cycles() {
+#if defined(__i386__) || defined(__x86_64__)
+	UInt_t lo, hi;
+	__asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+	return (ULong64_t(hi) << 32) | lo;
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ULong64_t(ts.tv_sec)*1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/// True while the event currently being processed is sampled
+extern volatile Bool_t gSampling;
+#endif
+
+/// Turn sampling on or off, timing every _interval_-th event
+void Enable(Bool_t on, Int_t interval);
+
+/// Is sampling switched on?
+Bool_t IsEnabled();
+
+/// Was the profiler compiled in (-DRB_PROFILE)?
+Bool_t IsCompiled();
+
+/// Count an event; returns true (and sets gSampling) if it should be timed
+Bool_t BeginEvent();
+
+/// Clear gSampling at the end of a sampled event
+void EndEvent();
+
+/// Add the stage cycles (kNstages entries) of one sampled event
+void AddEvent(rb::Event* event, const ULong64_t* cycles);
+
+/// Add the stage cycles (kNhistStages entries) of one sampled histogram fill
+void AddHist(rb::hist::Base* hist, const ULong64_t* cycles);
+
+/// Remove a histogram that is being deleted
+void Forget(rb::hist::Base* hist);
+
+/// Zero all counters
+void Reset();
+
+/// Format the profile tables, histograms sorted by _sortkey_ (ESortKey), at most _nhists_ rows (0 for all)
+std::string Format(Int_t sortkey, Int_t nhists);
+
+/// Convert a sort key name ("total", "gate", "params", "bins", "calls", "name") to ESortKey
+Int_t SortKey(const char* name);
+
+} // namespace profile
+
+
+/// \brief Window showing the profile tables, with a choice of sort order.
+class TGProfileFrame: public TGMainFrame
+{
+private:
+	/// Sort key selection
+	TGComboBox* fSort;
+	/// Text of the profile tables
+	TGTextView* fText;
+	/// Refreshes the text
+	TGTextButton* fRefresh;
+	/// Zeros the counters
+	TGTextButton* fReset;
+	/// Current sort key
+	Int_t fSortKey;
+	/// The single open instance
+	static TGProfileFrame* fgInstance;
+public:
+	/// Open the window (or raise it if already open)
+	static void Open();
+	/// Lays out the window
+	TGProfileFrame();
+	/// Clears fgInstance
+	virtual ~TGProfileFrame();
+	/// Re-format the tables
+	void Refresh();
+	/// Change the sort key and refresh
+	void SetSortKey(Int_t key);
+	/// Zero the counters and refresh
+	void ResetCounters();
+	/// Delete the window
+	virtual void CloseWindow();
+
+	ClassDef(rb::TGProfileFrame, 0);
+};
+
+} // namespace rb
+
+
+#endif
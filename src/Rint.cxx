@@ -45,6 +45,7 @@ void rb::Rint::Terminate(Int_t status) {
   }
 	DeleteSignals();
 	DeleteHistSignals();
+	rb::log::Stop();
   TRint::Terminate(status);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
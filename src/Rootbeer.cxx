@@ -3,6 +3,7 @@
 #include <memory>
 #include <iostream>
 #include <TString.h>
+#include <TSystem.h>
 #include <TObjArray.h>
 #include <TVirtualPad.h>
 #include "hist/Hist.hxx"
@@ -12,6 +13,12 @@
 #include "Data.hxx"
 #include "Signals.hxx"
 #include "Attach.hxx"
+#include "Profile.hxx"
+#include "Metrics.hxx"
+#include "Polygon.hxx"
+#include "Gate.hxx"
+#include "shm/Server.hxx"
+#include "stream/Server.hxx"
 #include "Rootbeer.hxx"
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -29,17 +36,52 @@ void rb::AttachOnline(const char* host, const char* other, char** others, int no
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::AttachFile                                   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::AttachFile(const char* filename, Bool_t stop_at_end) {
+void rb::AttachFile(const char* filename, Bool_t stop_at_end, Bool_t resume) {
   if(!ListAttached()) rb::Unattach();
-	rb::FileAttach::Go(filename, stop_at_end);
+	rb::FileAttach::Go(filename, stop_at_end, resume);
 }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::AttachList                                   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::AttachList(const char* filename) {
+void rb::AttachList(const char* filename, Bool_t resume) {
   rb::Unattach();
-  rb::ListAttach::Go(filename);
+  rb::ListAttach::Go(filename, resume);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::AttachMerged                                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::AttachMerged(const char* filename) {
+  rb::Unattach();
+  rb::FileAttach::GoMerged(filename);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::SetCheckpointInterval                        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::SetCheckpointInterval(Int_t seconds) {
+	rb::Checkpoint::SetInterval(seconds);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::SetSnapshotInterval                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::SetSnapshotInterval(Int_t seconds) {
+	rb::Event::SetSnapshotInterval(seconds);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::AttachListParallel                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::AttachListParallel(const char* filename, Int_t nworkers, const char* output, Bool_t keep_per_run) {
+  rb::Unattach();
+	if(nworkers <= 0) {
+		SysInfo_t info;
+		gSystem->GetSysInfo(&info);
+		nworkers = info.fCpus > 0 ? info.fCpus : 1;
+	}
+  rb::ParallelListAttach::Go(filename, nworkers, output, keep_per_run);
 }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -49,6 +91,91 @@ void rb::Unattach() {
 	rb::OnlineAttach::Stop();
 	rb::FileAttach::Stop();
 	rb::ListAttach::Stop();
+	rb::ParallelListAttach::Stop();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::SetProfile()                                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::SetProfile(Bool_t on, Int_t interval) {
+	rb::profile::Enable(on, interval);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::PrintProfile()                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::PrintProfile(const char* sortby, Int_t nhists) {
+	std::cout << rb::profile::Format(rb::profile::SortKey(sortby), nhists);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::ShowProfile()                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::ShowProfile() {
+	rb::TGProfileFrame::Open();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::ResetProfile()                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::ResetProfile() {
+	rb::profile::Reset();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::StartMetrics()                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::StartMetrics(const char* endpoint, Int_t interval, Bool_t log) {
+	return rb::metrics::Start(endpoint, interval, log);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::StopMetrics()                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::StopMetrics() {
+	rb::metrics::Stop();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::PrintMetrics()                               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::PrintMetrics() {
+	std::cout << rb::metrics::Format();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::StartHistServer()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::StartHistServer(const char* name, Int_t interval) {
+	return rb::shm::Server::Start(name, interval);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::StopHistServer()                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::StopHistServer() {
+	rb::shm::Server::Stop();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::StartHistStream()                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::StartHistStream(const char* endpoint) {
+	return rb::stream::Server::Start(endpoint);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::StopHistStream()                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::StopHistStream() {
+	rb::stream::Server::Stop();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::UpdateCuts()                                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::UpdateCuts(const char* name) {
+	return rb::CutGate::Update(name);
 }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -164,7 +291,68 @@ void rb::data::SetValue(const char* name, Double_t newvalue) {
     Error("SetData", "Data object: %s not found.", name);
     return;
   }
-  basicData->SetValue(newvalue);
+  if(!data::Transaction::Stage(basicData, newvalue))
+    basicData->SetValue(newvalue);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::data::GetHandle                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::data::GetHandle(const char* name) {
+  return data::MBasic::FindHandle(name);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Double_t rb::data::GetValue (handle)                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Double_t rb::data::GetValue(Int_t handle) {
+  data::MBasic* basicData = data::MBasic::Get(handle);
+  if(!basicData) {
+    Error("GetValue", "Invalid handle: %d.", handle);
+    return -1.;
+  }
+  return (Double_t)basicData->GetValue();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::SetValue (handle)                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::SetValue(Int_t handle, Double_t newvalue) {
+  data::MBasic* basicData = data::MBasic::Get(handle);
+  if(!basicData) {
+    Error("SetData", "Invalid handle: %d.", handle);
+    return;
+  }
+  if(!data::Transaction::Stage(basicData, newvalue))
+    basicData->SetValue(newvalue);
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::BeginUpdate                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::BeginUpdate() {
+  data::Transaction::Begin();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::data::CommitUpdate                         //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::data::CommitUpdate() {
+  return data::Transaction::Commit();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::data::AbortUpdate                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::data::AbortUpdate() {
+  data::Transaction::Abort();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// ULong64_t rb::data::GetEpoch                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+ULong64_t rb::data::GetEpoch() {
+  return data::Transaction::GetEpoch();
 }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -175,6 +363,27 @@ void rb::data::PrintAll() {
   p.PrintAll();
 }
 
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::gate::New                                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::gate::New(const char* name, const char* condition, Int_t event_code) {
+	rb::Event* event = rb::Rint::gApp()->GetEvent(event_code);
+	if(!event) {
+		rb::err::Error("rb::gate::New") << "Invalid event code: " << event_code;
+		return kFALSE;
+	}
+	return rb::gate::Graph::Get(event)->Define(name, condition) >= 0;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::gate::Print                                  //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::gate::Print(Int_t event_code) {
+	rb::gate::Graph* gates = rb::gate::Graph::Get(rb::Rint::gApp()->GetEvent(event_code), kFALSE);
+	if(gates) gates->Print();
+	else std::cout << "No gates defined for event code " << event_code << "\n";
+}
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Histogram Creation Helper Function                    //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -370,6 +579,102 @@ rb::hist::Base* rb::hist::NewBit(const char* name, const char* title, Int_t nbit
   return hist;
 }
 
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::NewRate                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::NewRate(const char* name, const char* title, Int_t nbins, Double_t width,
+																	const char* param, const char* gate, Int_t event_code) {
+	Bool_t from_gui =
+		 Rint::gApp()->GetHistSignals() ? Rint::gApp()->GetHistSignals()->IsHistFromGui() : 0;
+  rb::hist::Base* hist = 0;
+  try {
+    hist = find_manager(event_code)->Create<Rate>(name, title, param, gate, event_code, nbins, 0., 1., width);
+  }
+  catch (std::exception& e) {
+		if(!from_gui) rb::err::Error("rb::hist::New") << e.what();
+		else throw;
+  }
+  return hist;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::NewRolling (One-dimensional)               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::NewRolling(const char* name, const char* title, Double_t window,
+								Int_t bx, Double_t xl, Double_t xh,
+								const char* param, const char* gate, Int_t event_code) {
+	Bool_t from_gui =
+		 Rint::gApp()->GetHistSignals() ? Rint::gApp()->GetHistSignals()->IsHistFromGui() : 0;
+  rb::hist::Base* hist = 0;
+  try {
+    hist = find_manager(event_code)->Create<Rolling>(name, title, param, gate, event_code, bx, xl, xh, window);
+  }
+  catch (std::exception& e) {
+		if(!from_gui) rb::err::Error("rb::hist::New") << e.what();
+		else throw;
+  }
+  return hist;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::NewRolling (Two-dimensional)               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::NewRolling(const char* name, const char* title, Double_t window,
+								Int_t bx, Double_t xl, Double_t xh,
+								Int_t by, Double_t yl, Double_t yh,
+								const char* param, const char* gate, Int_t event_code) {
+	Bool_t from_gui =
+		 Rint::gApp()->GetHistSignals() ? Rint::gApp()->GetHistSignals()->IsHistFromGui() : 0;
+  rb::hist::Base* hist = 0;
+  try {
+    hist = find_manager(event_code)->Create<Rolling>(name, title, param, gate, event_code, bx, xl, xh, by, yl, yh, window);
+  }
+  catch (std::exception& e) {
+		if(!from_gui) rb::err::Error("rb::hist::New") << e.what();
+		else throw;
+  }
+  return hist;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::NewDecaying (One-dimensional)              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::NewDecaying(const char* name, const char* title, Double_t tau,
+									Int_t bx, Double_t xl, Double_t xh,
+									const char* param, const char* gate, Int_t event_code) {
+	Bool_t from_gui =
+		 Rint::gApp()->GetHistSignals() ? Rint::gApp()->GetHistSignals()->IsHistFromGui() : 0;
+  rb::hist::Base* hist = 0;
+  try {
+    hist = find_manager(event_code)->Create<Decaying>(name, title, param, gate, event_code, bx, xl, xh, tau);
+  }
+  catch (std::exception& e) {
+		if(!from_gui) rb::err::Error("rb::hist::New") << e.what();
+		else throw;
+  }
+  return hist;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+//  rb::hist::NewDecaying (Two-dimensional)              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::NewDecaying(const char* name, const char* title, Double_t tau,
+									Int_t bx, Double_t xl, Double_t xh,
+									Int_t by, Double_t yl, Double_t yh,
+									const char* param, const char* gate, Int_t event_code) {
+	Bool_t from_gui =
+		 Rint::gApp()->GetHistSignals() ? Rint::gApp()->GetHistSignals()->IsHistFromGui() : 0;
+  rb::hist::Base* hist = 0;
+  try {
+    hist = find_manager(event_code)->Create<Decaying>(name, title, param, gate, event_code, bx, xl, xh, by, yl, yh, tau);
+  }
+  catch (std::exception& e) {
+		if(!from_gui) rb::err::Error("rb::hist::New") << e.what();
+		else throw;
+  }
+  return hist;
+}
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 //  rb::hist::ClearAll                                   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
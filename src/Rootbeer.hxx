@@ -24,17 +24,115 @@ void AttachOnline(const char* host, const char* other_arg = "", char** others =
 //! \param filename Path of the file to which you want to attach.
 //! \param stop_at_end Specifies whether to Unattach() upon reaaching the
 //! end of the file [true] or to stay attached and wait for more data [false].
-void AttachFile(const char* filename, Bool_t stop_at_end = kTRUE);
+//! \param resume Pick up from the last checkpoint of this file, if there is one (see SetCheckpointInterval()).
+void AttachFile(const char* filename, Bool_t stop_at_end = kTRUE, Bool_t resume = kFALSE);
 
 /// \brief Attach to a series of offline data sources.
 //! \param filename Path of a text file listing the files you want to attach to, one per line.
 //! Blank lines and whitespace are ignored, as are lines beginning with <tt>#</tt>.
-void AttachList(const char* filename);
+//! \param resume Pick up from the last checkpoint of this list, if there is one (see SetCheckpointInterval()).
+void AttachList(const char* filename, Bool_t resume = kFALSE);
+
+/// \brief Attach to several offline data sources at once, merging their events in time order.
+//! \details For data taken in separate streams (e.g. one file per DAQ frontend): the files are
+//! read side by side and their events are processed in the order of a time stamp taken from each
+//! event, rather than file by file. How the time stamp is found, and how far ahead of the
+//! slowest file events are held back, is up to the BufferSource (for MIDAS files see
+//! rb::MidasBuffer::GetEventTime() and rb::MidasBuffer::SetMergeWindow()). Merged sorts aren't
+//! checkpointed, and any saved data go to the file named after the first one listed.
+//! \param filename Path of a text file listing the files to merge (see AttachList()).
+void AttachMerged(const char* filename);
+
+/// \brief Set how often offline sorts are checkpointed.
+//! \details While reading an offline file or list, the histogram contents and the position in the
+//! file (and list) are written every \c seconds to <tt>$RB_SAVEDIR/<file or list name>.checkpoint.root</tt>,
+//! and any trees being saved are flushed to disk. AttachFile() or AttachList() with <tt>resume = true</tt>
+//! picks up from there. The checkpoint is deleted once the file or list has been read completely.
+//! \param seconds Time between checkpoints, 0 turns checkpointing off (the default).
+void SetCheckpointInterval(Int_t seconds);
+
+/// \brief Set how often histograms are snapshotted to the file data are being saved to.
+//! \details While saving (with histograms), every \c seconds the histograms which have been filled,
+//! cleared or otherwise changed since the previous snapshot are written to the output file (in
+//! directories matching their own), replacing the earlier copy, and the file header is updated so
+//! that they can be read back after a crash. Unchanged histograms are skipped, also when saving stops.
+//! \param seconds Time between snapshots, 0 turns snapshots off (the default).
+void SetSnapshotInterval(Int_t seconds);
+
+/// \brief Attach to a series of offline data sources, processing several at once.
+//! \details Each file is unpacked in a separate worker process with its own copy of the
+//! histograms; at the end, the per-run outputs are merged into a single file and the merged
+//! histogram contents are added to the histograms in the current session.
+//! \param filename Path of a text file listing the files you want to attach to (see AttachList()).
+//! \param nworkers Maximum number of files to process at once; <= 0 means one per CPU core.
+//! \param output Path of the merged output file. An empty string means <tt>$RB_SAVEDIR/<list name>.root</tt>
+//! \param keep_per_run Keep the per-run output files [true] or delete them after merging [false].
+//! They are placed in the directory of \c output and named like the ones made by AttachFile(), plus the
+//! position of the file in the list (from 0): <tt>run123.mid</tt>, listed first, gives <tt>run123.0.root</tt>.
+//! The position keeps files of the same name from different directories apart.
+void AttachListParallel(const char* filename, Int_t nworkers = 0, const char* output = "", Bool_t keep_per_run = kFALSE);
 
 /// \brief Disconnect from a data source.
 //! Stops all reading of data and closes out the relevant threads.
 void Unattach();
 
+/// \brief Turn the sampling profiler on or off.
+//! \details Records the CPU cycles spent unpacking, filling the tree, saving and filling
+//! histograms for each event type, and in gate evaluation, parameter evaluation and bin
+//! increment for each histogram. Only available when rootbeer is built with <tt>-DRB_PROFILE</tt>.
+//! \param on Switch profiling on [true] or off [false].
+//! \param interval Time one event out of every \c interval.
+void SetProfile(Bool_t on = kTRUE, Int_t interval = 64);
+
+/// \brief Print the profile recorded since SetProfile() or ResetProfile().
+//! \param sortby How to order the histograms: "total", "gate", "params", "bins", "calls" or "name".
+//! \param nhists Print only the first \c nhists histograms (0 prints all of them).
+void PrintProfile(const char* sortby = "total", Int_t nhists = 50);
+
+/// \brief Open a window showing the profile, sortable by any column.
+void ShowProfile();
+
+/// \brief Zero the profile counters.
+void ResetProfile();
+
+/// \brief Start exporting live throughput metrics.
+//! \details Serves buffer, byte, event (per event type), unpack failure and histogram fill counts
+//! and rates, plus the backlog and lag of an online source, in Prometheus text format.
+//! \param endpoint Where to serve: a port number listens for HTTP on 127.0.0.1:\c endpoint,
+//! "address:port" on the given address, any other string is the path of a Unix socket, and ""
+//! serves nothing (log only).
+//! \param interval Seconds between updates of the rates.
+//! \param log Print a summary line at every update.
+Bool_t StartMetrics(const char* endpoint = "9101", Int_t interval = 10, Bool_t log = kTRUE);
+
+/// \brief Stop exporting metrics.
+void StopMetrics();
+
+/// \brief Print the current metrics.
+void PrintMetrics();
+
+/// \brief Publish histograms to shared memory for external viewers.
+//! \details Copies the contents of every histogram filled since the last pass into a shared segment
+//! every \c interval milliseconds. Other processes read it without blocking rootbeer, using the
+//! stand-alone (no ROOT) librbShm.so library or the \c rbshm command-line tool.
+//! \param name "/name" for a POSIX shared memory segment, otherwise the path of a file to map.
+//! \param interval Milliseconds between publishing passes.
+Bool_t StartHistServer(const char* name = "/rootbeer", Int_t interval = 1000);
+
+/// \brief Stop publishing histograms and remove the shared memory segment.
+void StopHistServer();
+
+/// \brief Stream histograms to remote viewers.
+//! \details Clients subscribe to histograms by path ("dir/subdir/name") and receive a snapshot, then
+//! only the bins that changed, at a rate each client chooses. Use librbShm.so (rb::stream::Client)
+//! or <tt>rbshm -s endpoint histogram</tt> to receive them.
+//! \param endpoint A port number listens on 127.0.0.1 (reach it through an ssh tunnel),
+//! "address:port" on the given address, any other string is the path of a Unix socket.
+Bool_t StartHistStream(const char* endpoint = "9102");
+
+/// \brief Stop streaming histograms and disconnect all clients.
+void StopHistStream();
+
 /// \brief Write canvas configuration file.
 Int_t WriteCanvasXML(const char* filename, Bool_t prompt = kTRUE);
 
@@ -69,6 +167,13 @@ void ReadVariablesXML(const char* filename);
 //!  Note that the option string is not case sensitive.
 void ReadConfigXML(const char* filename, Option_t* option = "r");
 
+/// \brief Use the current vertices of a TCutG in gates.
+//! \details Gates copy the vertices of the TCutG objects they use when they are made; after
+//! moving points of a cut (e.g. in the graphical editor), call this to have gates follow.
+//! \param name Name of the TCutG, or empty for every cut in use
+//! \returns The number of cuts updated
+Int_t UpdateCuts(const char* name = "");
+
 /// Cd to a directory by its pathname
 TVirtualPad* CdPad(TVirtualPad* owner, Int_t* subpad_numbers, Int_t depth);
 
@@ -86,6 +191,10 @@ namespace canvas
 //! \details
 void UpdateAll();
 
+/// \brief Update only the pads whose histograms have been filled or cleared since they were last drawn.
+//! \details This is what the automatic refresh (StartUpdate()) does.
+void UpdateChanged();
+
 /// \brief Update the currently selected pad only.
 //! \details
 void UpdateCurrent();
@@ -99,7 +208,8 @@ void ClearAll();
 void ClearCurrent();
 
 /// \brief Start updating canvases in a separate thread from the main one running CINT.
-//! \details
+//! \details Only pads whose histograms have changed are repainted, and the canvases are checked
+//! in several groups spread over the update period rather than all at once.
 //! \param rate How often the canvases should refresh (in seconds).
 Int_t StartUpdate(Int_t rate = 5);
 
@@ -137,12 +247,68 @@ Double_t GetValue(const char* name);
 //! \param [in] newvalue What you want to set the data keyed by <i>name</i> to.
 void SetValue(const char* name, Double_t newvalue);
 
+/// \brief Get the handle of a user class data member.
+//! \details A handle never changes once a variable exists, so a script that sets the same variables
+//! over and over can look each one up once and then use GetValue(Int_t) and SetValue(Int_t, Double_t),
+//! which skip the name lookup:
+//! \code
+//! Int_t h = rb::data::GetHandle("mine.a");
+//! for(int i=0; i< 100; ++i) rb::data::SetValue(h, i);
+//! \endcode
+//! \returns The handle, or -1 if there is no data member called <i>name</i>.
+Int_t GetHandle(const char* name);
+
+/// Get the value of the data member with handle <i>handle</i> (see GetHandle()).
+Double_t GetValue(Int_t handle);
+
+/// Set the value of the data member with handle <i>handle</i> (see GetHandle()).
+void SetValue(Int_t handle, Double_t newvalue);
+
+/// \brief Start a group of changes that take effect together.
+//! \details Until CommitUpdate(), SetValue() only records the new values. Committing applies all of
+//! them between two events, so no event is processed with half of a new calibration:
+//! \code
+//! rb::data::BeginUpdate();
+//! rb::data::SetValue("cal.slope", 1.02);
+//! rb::data::SetValue("cal.offset", -3.5);
+//! rb::data::CommitUpdate();
+//! \endcode
+void BeginUpdate();
+
+/// \brief Apply the changes recorded since BeginUpdate().
+//! \returns true if they were applied right away, false if they wait for the event being processed
+//! to finish.
+Bool_t CommitUpdate();
+
+/// Drop the changes recorded since BeginUpdate()
+void AbortUpdate();
+
+/// \brief Number of committed updates applied so far.
+//! \details Saved with every event in the "rb_epoch" branch of the output tree.
+ULong64_t GetEpoch();
+
 
 /// Print the fill name and current value of every data member in every listed class.
 void PrintAll();
 
 } // namespace data
 
+/// \brief Named gates
+//! \details A named gate can be used in histogram gates like a data member, alone or combined with
+//! &&, || and ! (e.g. "pid_alpha && tof_ok && !pileup"). Each named gate (and each part of one) is
+//! evaluated at most once per event, however many histograms use it.
+namespace gate
+{
+/// \brief Define (or redefine) a named gate.
+//! \details _condition_ may use other named gates. Histograms using _name_ follow a redefinition.
+//! \returns true if successful
+Bool_t New(const char* name, const char* condition, Int_t event_code = 1);
+
+/// Print the named gates of an event processor
+void Print(Int_t event_code = 1);
+
+} // namespace gate
+
 /// Creation functions for histograms
 namespace hist
 {
@@ -200,6 +366,37 @@ rb::hist::Base* NewScaler(const char* name, const char* title,
 rb::hist::Base* NewBit (const char* name, const char* title, Int_t nbits, const char* param,
 												const char* gate = "", Int_t event_code = 1);
 
+/// \brief Rate (strip chart) hist creation
+//! \details See rb::hist::Rate
+//! \param nbins Number of buckets shown
+//! \param width Width of the finest buckets in seconds
+rb::hist::Base* NewRate(const char* name, const char* title, Int_t nbins, Double_t width,
+												const char* param, const char* gate = "", Int_t event_code = 1);
+
+/// \brief Rolling hist creation (1d), showing only the last _window_ seconds
+//! \details See rb::hist::Rolling
+rb::hist::Base* NewRolling(const char* name, const char* title, Double_t window,
+													 Int_t nbinsx, Double_t xlow, Double_t xhigh,
+													 const char* param, const char* gate = "", Int_t event_code = 1);
+
+/// Rolling hist creation (2d)
+rb::hist::Base* NewRolling(const char* name, const char* title, Double_t window,
+													 Int_t nbinsx, Double_t xlow, Double_t xhigh,
+													 Int_t nbinsy, Double_t ylow, Double_t yhigh,
+													 const char* param, const char* gate = "", Int_t event_code = 1);
+
+/// \brief Decaying hist creation (1d), counts fading with time constant _tau_ seconds
+//! \details See rb::hist::Decaying
+rb::hist::Base* NewDecaying(const char* name, const char* title, Double_t tau,
+														Int_t nbinsx, Double_t xlow, Double_t xhigh,
+														const char* param, const char* gate = "", Int_t event_code = 1);
+
+/// Decaying hist creation (2d)
+rb::hist::Base* NewDecaying(const char* name, const char* title, Double_t tau,
+														Int_t nbinsx, Double_t xlow, Double_t xhigh,
+														Int_t nbinsy, Double_t ylow, Double_t yhigh,
+														const char* param, const char* gate = "", Int_t event_code = 1);
+
 /// Zero all histograms
 void ClearAll();
 
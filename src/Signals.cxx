@@ -842,12 +842,11 @@ void rb::HistSignals::HistMemberFn() {
 
 // =========== VARIABLES / CONFIG ============ //
 std::string rb::HistSignals::get_variable(TGListTreeItem* item) {
-	static std::vector<std::string> variables = rb::data::MBasic::GetAll();
 	char path[1000];
 	rb::Rint::gApp()->fHistFrame->fVariablesTree->GetPathnameFromItem(item, path);
 	TString sPath(&path[1]);
 	sPath.ReplaceAll("/", ".");
-	if(std::find(variables.begin(), variables.end(), sPath.Data()) == variables.end())
+	if(!rb::data::MBasic::Find(sPath.Data()))
 		 return "";
 	return sPath.Data();
 }
@@ -10,6 +10,7 @@
 #include "Rootbeer.hxx"
 #include "Rint.hxx"
 #include "Data.hxx"
+#include "Polygon.hxx"
 #include "Signals.hxx"
 #include "utils/Assorted.hxx"
 #include "hist/Hist.hxx"
@@ -124,6 +125,8 @@ void read_variables_tree(rb::XmlNode* tree, bool quiet) {
 		return;
 	}
 	
+	// Apply the whole file at once, between events
+	rb::data::BeginUpdate();
 	for(int i=0; i< rb::mxml_get_number_of_children(varsnode); ++i) {
 		rb::XmlNode* child = rb::mxml_subnode(varsnode, i);
 		if(!strcmp(rb::mxml_get_name(child), "var")) {
@@ -135,6 +138,7 @@ void read_variables_tree(rb::XmlNode* tree, bool quiet) {
 				rb::data::SetValue(name, value.Atof());
 		}
 	}
+	rb::data::CommitUpdate();
 } }
 
 void rb::ReadVariablesXML(const char* filename) {
@@ -264,7 +268,7 @@ void delete_all_hists_and_dirs() {
 	for(int i=0; i< gROOT->GetList()->GetEntries(); ++i) {
 		delete gROOT->GetList()->At(i);
 	}
-	rb::Rint::gApp()->GetHistSignals()->SyncHistTree(); 
+	rb::hist::BulkLoad::Changed();
 }
 
 void read_cut(rb::XmlNode* node, bool replace) {
@@ -300,9 +304,13 @@ void read_cut(rb::XmlNode* node, bool replace) {
 	cut->SetTitle(title);
 	cut->SetLineWidth(lw);
 	cut->SetLineColor(lc);
+	rb::CutGate::Update(name);
 } 
 
 void read_hist_tree(rb::XmlNode* tree, Option_t* option, bool quiet) {
+	// one GUI refresh and one parse per distinct formula for the whole file
+	rb::hist::BulkLoad bulk;
+
 	// figure out option
 	Int_t replace;
 	TString opt1(option);
@@ -1,14 +1,17 @@
 //! \file Hist.cxx
 //! \brief Implements the histogram class member functions.
+#include <cmath>
 #include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <TTimeStamp.h>
 #include "boost/dynamic_bitset.hpp"
 #include "Hist.hxx"
 #include "Formula.hxx"
 #include "Rint.hxx"
 #include "Signals.hxx"
 #include "Rootbeer.hxx"
+#include "Profile.hxx"
 #include "mxml/mxml.hxx"
 
 typedef std::vector<std::string> StringVector_t;
@@ -18,22 +21,31 @@ typedef std::vector<std::string> StringVector_t;
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 namespace
 {
+  // Is the name taken? Histogram names are unique in the whole session, which the hashed name
+  // count answers; gROOT->FindObject() (other objects) only runs for names no histogram has.
+  inline bool name_in_use(const char* name) {
+    return rb::hist::Manager::NameInUse(name) || gROOT->FindObject(name);
+  }
   // Name checking function
   inline std::string check_name(const char* name) {
     std::string ret = name;
-    if(gROOT->FindObject(name)) {
+    if(name_in_use(name)) {
       Int_t n = 1;
       while(1) {
 	std::stringstream sstr;
 	sstr << name << "_" << n++;
 	ret = sstr.str();
-	if(!gROOT->FindObject(ret.c_str())) break;
+	if(!name_in_use(ret.c_str())) break;
       }
       rb::err::Info("rb::hist::Base") << "The name " << name <<
 	" is already in use, creating " << name << "_" << n-1 << " instead.";
     }
     return ret;
   }
+  // Wall-clock time in seconds, for the time-dependent histograms
+  inline Double_t wall_time() {
+    return TTimeStamp().AsDouble();
+  }
   // Reverset the order of a vector
   template <typename T>
   void reverse_vector(std::vector<T>& vect) {
@@ -67,6 +79,32 @@ namespace
 }
 
 
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::BulkLoad                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+Int_t  rb::hist::BulkLoad::fgDepth = 0;
+Bool_t rb::hist::BulkLoad::fgChanged = false;
+
+rb::hist::BulkLoad::BulkLoad(): fCache() {
+	++fgDepth;
+}
+
+rb::hist::BulkLoad::~BulkLoad() {
+	if(--fgDepth) return;
+	if(fgChanged) {
+		fgChanged = false;
+		Changed();
+	}
+}
+
+void rb::hist::BulkLoad::Changed() {
+	if(fgDepth) fgChanged = true;
+	else if(Rint::gApp()->GetHistSignals()) Rint::gApp()->GetHistSignals()->NewOrDeleteHist();
+}
+
+
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Class                                                 //
 // rb::hist::Base                                        //
@@ -81,7 +119,7 @@ rb::hist::Base::Base(const char* name, const char* title, const char* param, con
 		     hist::Manager* manager, Int_t event_code,
 		     Int_t nbinsx, Double_t xlow, Double_t xhigh):
   kEventCode(event_code), kDimensions(1), fManager(manager), fHistogramClone(0), kInitialParams(param), fParams(0), fGate(0),
-  fHistVariant(TH1D(name, title, nbinsx, xlow, xhigh))
+  fHistVariant(TH1D(name, title, nbinsx, xlow, xhigh)), fGeneration(0)
 {  }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -92,7 +130,7 @@ rb::hist::Base::Base(const char* name, const char* title, const char* param, con
 		     Int_t nbinsx, Double_t xlow, Double_t xhigh,
 		     Int_t nbinsy, Double_t ylow, Double_t yhigh):
   kEventCode(event_code), kDimensions(2), fManager(manager), fHistogramClone(0), kInitialParams(param), fParams(0), fGate(0),
-  fHistVariant(TH2D(name, title, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh))
+  fHistVariant(TH2D(name, title, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh)), fGeneration(0)
 {  }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -104,7 +142,7 @@ rb::hist::Base::Base(const char* name, const char* title, const char* param, con
 		     Int_t nbinsy, Double_t ylow, Double_t yhigh,
 		     Int_t nbinsz, Double_t zlow, Double_t zhigh):
   kEventCode(event_code), kDimensions(3), fManager(manager), fHistogramClone(0), kInitialParams(param), fParams(0), fGate(0),
-  fHistVariant(TH3D(name, title, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh, nbinsz, zlow, zhigh))
+  fHistVariant(TH3D(name, title, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh, nbinsz, zlow, zhigh)), fGeneration(0)
 {  }
 
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -114,7 +152,7 @@ void rb::hist::Base::Init(const char* name, const char* title, const char* param
   // Set name & title
   if(!fgOverwrite) fName = check_name(name).c_str();
 	else {
-		Base* hist_base = dynamic_cast<Base*>(gROOT->FindObject(name));
+		Base* hist_base = hist::Manager::FindInDirectory(gDirectory, name);
 		if(hist_base) delete hist_base;
 		fName = name;
 	}
@@ -134,7 +172,7 @@ void rb::hist::Base::Init(const char* name, const char* title, const char* param
   if(gDirectory) {
     fDirectory = gDirectory;
     fDirectory->Append(this, kTRUE);
-		if(Rint::gApp()->GetHistSignals()) Rint::gApp()->GetHistSignals()->NewOrDeleteHist();
+		BulkLoad::Changed();
   }
   else {
     rb::err::Warning("Hist::Init") << "gDirectory == 0; not adding to any ROOT collections.";
@@ -145,8 +183,11 @@ void rb::hist::Base::Init(const char* name, const char* title, const char* param
 // Destructor                                            //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::hist::Base::~Base() {
+#ifdef RB_PROFILE
+	rb::profile::Forget(this);
+#endif
 	fManager->Remove(this); // locks TTHREAD_GLOBAL_MUTEX while running
-	if(Rint::gApp()->GetHistSignals()) Rint::gApp()->GetHistSignals()->NewOrDeleteHist();
+	BulkLoad::Changed();
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Base::InitParams()                     //
@@ -196,10 +237,14 @@ Int_t rb::hist::Base::DoFill(const std::vector<Double_t>& params) {
 // rb::hist::Base::FillUnlocked()                        //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 Int_t rb::hist::Base::FillUnlocked() {
+#ifdef RB_PROFILE
+	if(rb::profile::gSampling) return FillProfiled(kFALSE);
+#endif
   Double_t gate = fGate->EvalUnlocked(0);
   if(!Bool_t(gate)) return 0;
   std::vector<Double_t> axes;
   fParams->EvalAllUnlocked(axes);
+	++fGeneration;
   return DoFill(axes);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -207,12 +252,82 @@ Int_t rb::hist::Base::FillUnlocked() {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 Int_t rb::hist::Base::Fill() {
 	RB_LOG << "Filling...\n";
+#ifdef RB_PROFILE
+	if(rb::profile::gSampling) return FillProfiled(kTRUE);
+#endif
   Double_t gate = fGate->Eval(0);
   if(!Bool_t(gate)) return 0;
   std::vector<Double_t> axes;
   fParams->EvalAll(axes);
+	++fGeneration;
   return DoFill(axes);
 }
+#ifdef RB_PROFILE
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::FillProfiled()                        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Base::FillProfiled(Bool_t locked) {
+	ULong64_t cycles[rb::profile::kNhistStages] = { 0, 0, 0 };
+	ULong64_t t0 = rb::profile::Cycles();
+  Double_t gate = locked ? fGate->Eval(0) : fGate->EvalUnlocked(0);
+	ULong64_t t1 = rb::profile::Cycles();
+	cycles[rb::profile::kGate] = t1 - t0;
+	Int_t ret = 0;
+  if(Bool_t(gate)) {
+		std::vector<Double_t> axes;
+		if(locked) fParams->EvalAll(axes);
+		else fParams->EvalAllUnlocked(axes);
+		ULong64_t t2 = rb::profile::Cycles();
+		++fGeneration;
+		ret = DoFill(axes);
+		cycles[rb::profile::kParams] = t2 - t1;
+		cycles[rb::profile::kBins] = rb::profile::Cycles() - t2;
+	}
+	rb::profile::AddHist(this, cycles);
+	return ret;
+}
+#endif
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::CopyBins()                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::CopyBins(Double_t* out) {
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	TH1* hst = visit::hist::Cast::Do(fHistVariant);
+	TArrayD* arr = dynamic_cast<TArrayD*>(hst);
+	if(arr) std::copy(arr->GetArray(), arr->GetArray() + arr->GetSize(), out);
+	else {
+		Int_t ncells = (hst->GetNbinsX()+2) * (kDimensions > 1 ? hst->GetNbinsY()+2 : 1) * (kDimensions > 2 ? hst->GetNbinsZ()+2 : 1);
+		for(Int_t i=0; i< ncells; ++i) out[i] = hst->GetBinContent(i);
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::GetAxes()                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Base::GetAxes(Int_t* nbins, Double_t* low, Double_t* high) {
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	TH1* hst = visit::hist::Cast::Do(fHistVariant);
+	TAxis* axes[3] = { hst->GetXaxis(), hst->GetYaxis(), hst->GetZaxis() };
+	for(UInt_t i=0; i< 3; ++i) {
+		if(i < kDimensions) {
+			nbins[i] = axes[i]->GetNbins();
+			low[i]   = axes[i]->GetXmin();
+			high[i]  = axes[i]->GetXmax();
+		}
+		else { nbins[i] = 1; low[i] = 0; high[i] = 1; }
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// rb::hist::Base::GetPath()                             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+std::string rb::hist::Base::GetPath() const {
+	std::string path = GetName();
+	TDirectory* dir = fDirectory;
+	while(dir && dir->GetMotherDir()) {
+		path = std::string(dir->GetName()) + "/" + path;
+		dir = dir->GetMotherDir();
+	}
+	return path;
+}
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // rb::hist::Base::Write()                               //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
@@ -498,6 +613,355 @@ void rb::hist::Scaler::Extend(double factor) {
 	}
 }
 
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Rolling                                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor (1d)                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Rolling::Rolling(const char* name, const char* title, const char* param, const char* gate,
+													 hist::Manager* manager, Int_t event_code,
+													 Int_t nbinsx, Double_t xlow, Double_t xhigh, Double_t window):
+  Base(name, title, param, gate, manager, event_code, nbinsx, xlow, xhigh),
+	kWindow(window > 0. ? window : 1.), fSlices(kNslices),
+	fCurrent(Long64_t(wall_time() * kNslices / kWindow))
+{  }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor (2d)                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Rolling::Rolling(const char* name, const char* title, const char* param, const char* gate,
+													 hist::Manager* manager, Int_t event_code,
+													 Int_t nbinsx, Double_t xlow, Double_t xhigh,
+													 Int_t nbinsy, Double_t ylow, Double_t yhigh, Double_t window):
+  Base(name, title, param, gate, manager, event_code, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh),
+	kWindow(window > 0. ? window : 1.), fSlices(kNslices),
+	fCurrent(Long64_t(wall_time() * kNslices / kWindow))
+{  }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Rolling::Clear() [virtual]             //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Rolling::Clear() {
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	rb::hist::Base::Clear();
+	fSlices.assign(kNslices, Slice());
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// ULong64_t rb::hist::Rolling::GetGeneration() [virtual]//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+ULong64_t rb::hist::Rolling::GetGeneration() {
+	Advance(wall_time());
+	return fGeneration;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::hist::Rolling::DoFill() [virtual]           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Rolling::DoFill(const std::vector<Double_t>& params) {
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	Advance(wall_time());
+	std::vector<Double_t> axes(params.begin(), params.end());
+	for(Int_t i=axes.size(); i< 3; ++i) axes.push_back(0);
+	const Int_t bin = visit::hist::Fill::Do(fHistVariant, axes[0], axes[1], axes[2]);
+	if(bin < 0) return bin;
+
+	Slice& slice = fSlices[fCurrent % kNslices];
+	++slice.fEntries;
+	if(!slice.fCounts.empty()) ++slice.fCounts[bin];
+	else {
+		slice.fBins.push_back(bin);
+		TH1* hist = visit::hist::Cast::Do(fHistVariant);
+		const size_t ncells = (hist->GetNbinsX()+2) * (kDimensions > 1 ? hist->GetNbinsY()+2 : 1);
+		if(slice.fBins.size() > ncells) { // switch to counts per bin
+			slice.fCounts.assign(ncells, 0.);
+			for(size_t i = 0; i< slice.fBins.size(); ++i) ++slice.fCounts[slice.fBins[i]];
+			slice.fBins.clear();
+		}
+	}
+	return bin;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Rolling::Advance() [private]           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Rolling::Advance(Double_t now) {
+	/*!
+	 * Slice number n covers [n, n+1) times the slice width. Moving from slice fCurrent to _current_
+	 * reuses the ring positions of slices fCurrent+1 to _current_, which held slices that are now
+	 * out of the window (at most the whole ring, however long it has been).
+	 */
+	const Long64_t current = Long64_t(now * kNslices / kWindow);
+	if(current <= fCurrent) return;
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	TH1* hist = visit::hist::Cast::Do(fHistVariant);
+	Long64_t nexpired = 0;
+	for(Long64_t n = std::max(fCurrent + 1, current - kNslices + 1); n <= current; ++n) {
+		Slice& slice = fSlices[n % kNslices];
+		nexpired += slice.fEntries;
+		Expire(slice, hist);
+	}
+	fCurrent = current;
+	if(nexpired) {
+		hist->ResetStats();
+		++fGeneration;
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Rolling::Expire() [private]            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Rolling::Expire(Slice& slice, TH1* hist) {
+	if(!slice.fEntries) return;
+	if(slice.fCounts.empty()) {
+		for(size_t i = 0; i< slice.fBins.size(); ++i)
+			hist->AddBinContent(slice.fBins[i], -1.);
+	}
+	else {
+		for(size_t bin = 0; bin< slice.fCounts.size(); ++bin)
+			if(slice.fCounts[bin]) hist->AddBinContent(bin, -slice.fCounts[bin]);
+	}
+	slice.fBins.clear();
+	slice.fCounts.clear();
+	slice.fEntries = 0;
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Decaying                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor (1d)                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Decaying::Decaying(const char* name, const char* title, const char* param, const char* gate,
+														 hist::Manager* manager, Int_t event_code,
+														 Int_t nbinsx, Double_t xlow, Double_t xhigh, Double_t tau):
+  Base(name, title, param, gate, manager, event_code, nbinsx, xlow, xhigh),
+	kTau(tau > 0. ? tau : 1.), fT0(wall_time())
+{  }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor (2d)                                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Decaying::Decaying(const char* name, const char* title, const char* param, const char* gate,
+														 hist::Manager* manager, Int_t event_code,
+														 Int_t nbinsx, Double_t xlow, Double_t xhigh,
+														 Int_t nbinsy, Double_t ylow, Double_t yhigh, Double_t tau):
+  Base(name, title, param, gate, manager, event_code, nbinsx, xlow, xhigh, nbinsy, ylow, yhigh),
+	kTau(tau > 0. ? tau : 1.), fT0(wall_time())
+{  }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// ULong64_t rb::hist::Decaying::GetGeneration() [virtual]//
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+ULong64_t rb::hist::Decaying::GetGeneration() {
+	// rescaling more often than every 1% of tau changes nothing visible
+	const Double_t now = wall_time();
+	if(now - fT0 > 0.01*kTau) Rescale(now);
+	return fGeneration;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::hist::Decaying::DoFill() [virtual]          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Decaying::DoFill(const std::vector<Double_t>& params) {
+	// keep the weights well inside double precision
+	const Double_t now = wall_time();
+	if(now - fT0 > 20.*kTau) Rescale(now);
+	std::vector<Double_t> axes(params.begin(), params.end());
+	for(Int_t i=axes.size(); i< 3; ++i) axes.push_back(0);
+	return visit::hist::FillWeighted::Do(fHistVariant, exp((now - fT0) / kTau), axes[0], axes[1], axes[2]);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Decaying::Rescale() [private]          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Decaying::Rescale(Double_t now) {
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	TH1* hist = visit::hist::Cast::Do(fHistVariant);
+	if(hist->GetEntries()) {
+		const Double_t entries = hist->GetEntries();
+		hist->Scale(exp((fT0 - now) / kTau));
+		hist->SetEntries(entries);
+		++fGeneration;
+	}
+	fT0 = now;
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::hist::Rate                                        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Rate::Rate(const char* name, const char* title, const char* param, const char* gate,
+										 hist::Manager* manager, Int_t event_code,
+										 Int_t nbins, Double_t ignored1, Double_t ignored2, Double_t width):
+  Base(name, title, param, gate, manager, event_code, nbins, -nbins*(width > 0. ? width : 1.), 0.),
+	kWidth(width > 0. ? width : 1.), fLevels(kNlevels), fShown(0), fNfills(0)
+{
+	Reset(wall_time());
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Double_t rb::hist::Rate::GetWidth()                   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Double_t rb::hist::Rate::GetWidth(Int_t level) const {
+	Double_t width = kWidth;
+	for(Int_t i=0; i< level; ++i) width *= kFactor;
+	return width;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Rate::Reset() [private]                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Rate::Reset(Double_t now) {
+	Long64_t current = Long64_t(now / kWidth);
+	const Int_t nbins = visit::hist::Cast::Do(fHistVariant)->GetNbinsX();
+	for(Int_t i=0; i< kNlevels; ++i) {
+		Level& level = fLevels[i];
+		level.fRing.assign(nbins, Bucket());
+		level.fCurrent = current;
+		level.fSum = level.fMin = level.fMax = 0.;
+		level.fN = 0;
+		current /= kFactor;
+	}
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Rate::Clear() [virtual]                //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Rate::Clear() {
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	rb::hist::Base::Clear();
+	fNfills = 0;
+	Reset(wall_time());
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// ULong64_t rb::hist::Rate::GetGeneration() [virtual]   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+ULong64_t rb::hist::Rate::GetGeneration() {
+	Advance(wall_time());
+	return fGeneration;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::hist::Rate::DoFill() [virtual]              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Rate::DoFill(const std::vector<Double_t>& params) {
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	Advance(wall_time());
+	fLevels[0].fSum += params[0];
+	++fNfills;
+	TH1* hist = visit::hist::Cast::Do(fHistVariant);
+	const Int_t last = hist->GetNbinsX();
+	if(fShown == 0) hist->AddBinContent(last, params[0] / kWidth);
+	hist->SetEntries(fNfills);
+	return last;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Rate::Advance() [private]              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Rate::Advance(Double_t now) {
+	/*!
+	 * Every level 0 bucket that has ended is completed in turn, including the empty ones of a
+	 * pause, unless the pause is longer than everything kept, in which case all levels start over.
+	 */
+	const Long64_t current = Long64_t(now / kWidth);
+	Level& level0 = fLevels[0];
+	if(current <= level0.fCurrent) return;
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	const Long64_t kept = level0.fRing.size() * Long64_t(GetWidth(kNlevels - 1) / kWidth);
+	if(current - level0.fCurrent > kept) Reset(now);
+	else {
+		while(level0.fCurrent < current) {
+			const Double_t rate = level0.fSum / kWidth;
+			Bucket& bucket = level0.fRing[level0.fCurrent % level0.fRing.size()];
+			bucket.fMean = bucket.fMin = bucket.fMax = rate;
+			Push(1, level0.fCurrent, rate, rate, rate);
+			++level0.fCurrent;
+			level0.fSum = 0.;
+		}
+	}
+	Render();
+	++fGeneration;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Rate::Push() [private]                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Rate::Push(Int_t ilevel, Long64_t fine, Double_t mean, Double_t min, Double_t max) {
+	if(ilevel >= kNlevels) return;
+	Level& level = fLevels[ilevel];
+	const Long64_t current = fine / kFactor;
+	if(current != level.fCurrent) { // finer buckets come in order, so this one is complete
+		Bucket& bucket = level.fRing[level.fCurrent % level.fRing.size()];
+		bucket.fMean = level.fN ? level.fSum / level.fN : 0.;
+		bucket.fMin = level.fMin;
+		bucket.fMax = level.fMax;
+		Push(ilevel + 1, level.fCurrent, bucket.fMean, bucket.fMin, bucket.fMax);
+		level.fCurrent = current;
+		level.fSum = 0.;
+		level.fN = 0;
+	}
+	if(!level.fN || min < level.fMin) level.fMin = min;
+	if(!level.fN || max > level.fMax) level.fMax = max;
+	level.fSum += mean;
+	++level.fN;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bucket rb::hist::Rate::GetShown() [private]           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Rate::Bucket rb::hist::Rate::GetShown(Int_t bin) const {
+	const Level& level = fLevels[fShown];
+	const Long64_t nbins = level.fRing.size();
+	if(bin < nbins) {
+		const Long64_t number = level.fCurrent - nbins + bin;
+		return number < 0 ? Bucket() : level.fRing[number % nbins];
+	}
+	Bucket current;
+	if(fShown == 0)
+		current.fMean = current.fMin = current.fMax = level.fSum / kWidth;
+	else if(level.fN) {
+		current.fMean = level.fSum / level.fN;
+		current.fMin = level.fMin;
+		current.fMax = level.fMax;
+	}
+	return current;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Rate::Render() [private]               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Rate::Render() {
+	TH1* hist = visit::hist::Cast::Do(fHistVariant);
+	const Int_t nbins = hist->GetNbinsX();
+	for(Int_t bin = 1; bin<= nbins; ++bin)
+		hist->SetBinContent(bin, GetShown(bin).fMean);
+	hist->SetEntries(fNfills);
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Rate::SetLevel()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Rate::SetLevel(Int_t level) {
+	if(level < 0 || level >= kNlevels) {
+		err::Error("rb::hist::Rate::SetLevel") << "Invalid level " << level << " (must be 0 - " << kNlevels-1 << ")";
+		return kFALSE;
+	}
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	TH1* hist = visit::hist::Cast::Do(fHistVariant);
+	const Int_t nbins = hist->GetNbinsX();
+	fShown = level;
+	hist->SetBins(nbins, -nbins*GetWidth(level), 0.);
+	Render();
+	++fGeneration;
+	return kTRUE;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Rate::GetBucket()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Rate::GetBucket(Int_t bin, Double_t& mean, Double_t& min, Double_t& max) {
+	rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+	if(bin < 1 || bin > Int_t(fLevels[fShown].fRing.size())) return kFALSE;
+	Bucket bucket = GetShown(bin);
+	mean = bucket.fMean;
+	min = bucket.fMin;
+	max = bucket.fMax;
+	return kTRUE;
+}
+
 
 
 
@@ -533,9 +997,10 @@ void write_attributes(rb::XmlWriter* w, rb::hist::Base* hist) {
 	rb::mxml_write_attribute(w, "fillstyle",   Form("%d", hist->GetHist()->GetFillStyle()));
 }
 
-void write_xml(rb::XmlWriter* w, rb::hist::Base* h, Int_t ndim) {
+void write_xml(rb::XmlWriter* w, rb::hist::Base* h, Int_t ndim,
+							 const char* element = 0, const char* time_name = 0, Double_t time = 0.) {
 	std::string title = h->UseDefaultTitle() ? "" : h->GetTitle();
-	mxml_start_element(w, Form("rb_hist_D%d", ndim));
+	mxml_start_element(w, element ? element : Form("rb_hist_D%d", ndim));
 	mxml_write_attribute(w, "name", h->GetName());
 	mxml_write_attribute(w, "title", title.c_str());
 
@@ -549,6 +1014,7 @@ void write_xml(rb::XmlWriter* w, rb::hist::Base* h, Int_t ndim) {
 	mxml_write_attribute(w, "param", h->GetInitialParams());
 	mxml_write_attribute(w, "gate",  h->GetGate().c_str());
 	mxml_write_attribute(w, "event", Form("%d", h->GetEventCode()));
+	if(time_name) mxml_write_attribute(w, time_name, Form("%f", time));
 
 	write_attributes(w, h);
 	mxml_end_element(w);
@@ -566,6 +1032,33 @@ void rb::hist::D3::WriteXML(rb::XmlWriter* w) {
 	write_xml(w, this, 3);
 }
 
+void rb::hist::Rate::WriteXML(rb::XmlWriter* w) {
+	std::string title = UseDefaultTitle() ? "" : GetTitle();
+
+	mxml_start_element(w, "rb_hist_Rate");
+	mxml_write_attribute(w, "name", GetName());
+	mxml_write_attribute(w, "title", title.c_str());
+
+	mxml_write_attribute(w, "bins",  Form("%d", GetXaxis()->GetNbins()));
+	mxml_write_attribute(w, "width", Form("%f", GetWidth()));
+	mxml_write_attribute(w, "level", Form("%d", GetLevel()));
+
+	mxml_write_attribute(w, "param", GetInitialParams());
+	mxml_write_attribute(w, "gate",  GetGate().c_str());
+	mxml_write_attribute(w, "event", Form("%d", GetEventCode()));
+
+	write_attributes(w, this);
+	mxml_end_element(w);
+}
+
+void rb::hist::Rolling::WriteXML(rb::XmlWriter* w) {
+	write_xml(w, this, GetNdimensions(), "rb_hist_Rolling", "window", GetWindow());
+}
+
+void rb::hist::Decaying::WriteXML(rb::XmlWriter* w) {
+	write_xml(w, this, GetNdimensions(), "rb_hist_Decaying", "tau", GetTau());
+}
+
 void rb::hist::Summary::WriteXML(rb::XmlWriter* w) {
 	std::string title = UseDefaultTitle() ? "" : GetTitle();
 
@@ -703,6 +1196,51 @@ rb::hist::Base* construct_hist1(rb::XmlNode* node) {
 	return hst;
 }
 
+template <Bool_t DECAYING>
+rb::hist::Base* construct_timed(rb::XmlNode* node) {
+	const char* name  = mxml_get_attribute(node, "name");
+	const char* title = mxml_get_attribute(node, "title");
+	const Int_t ndim = mxml_get_attribute(node, "ybins") ? 2 : 1;
+
+	Int_t bins[2]; Double_t low[2], high[2];
+	for(int i=0; i< ndim; ++i) {
+		bins[i]  = atoi(mxml_get_attribute(node, Form("%sbins",   get_axis(i))));
+		low[i]   = atof(mxml_get_attribute(node, Form("%slow",    get_axis(i))));
+		high[i]  = atof(mxml_get_attribute(node, Form("%shigh",   get_axis(i))));
+	}
+
+	const char* param = mxml_get_attribute(node, "param");
+	const char* gate  = mxml_get_attribute(node, "gate");
+	Int_t event  = atoi(mxml_get_attribute(node, "event"));
+	Double_t time = atof(mxml_get_attribute(node, DECAYING ? "tau" : "window"));
+
+	if(ndim == 1)
+		return DECAYING ?
+			rb::hist::NewDecaying(name, title, time, bins[0], low[0], high[0], param, gate, event) :
+			rb::hist::NewRolling (name, title, time, bins[0], low[0], high[0], param, gate, event);
+	else
+		return DECAYING ?
+			rb::hist::NewDecaying(name, title, time, bins[0], low[0], high[0], bins[1], low[1], high[1], param, gate, event) :
+			rb::hist::NewRolling (name, title, time, bins[0], low[0], high[0], bins[1], low[1], high[1], param, gate, event);
+}
+
+rb::hist::Base* construct_rate(rb::XmlNode* node) {
+	const char* name  = mxml_get_attribute(node, "name");
+	const char* title = mxml_get_attribute(node, "title");
+	Int_t bins     = atoi(mxml_get_attribute(node, "bins"));
+	Double_t width = atof(mxml_get_attribute(node, "width"));
+	const char* level = mxml_get_attribute(node, "level");
+
+	const char* param  = mxml_get_attribute(node, "param");
+	const char* gate   = mxml_get_attribute(node, "gate");
+	Int_t event   = atoi(mxml_get_attribute(node, "event"));
+
+	rb::hist::Base* hst = rb::hist::NewRate(name, title, bins, width, param, gate, event);
+	rb::hist::Rate* rate = dynamic_cast<rb::hist::Rate*>(hst);
+	if(rate && level) rate->SetLevel(atoi(level));
+	return hst;
+}
+
 void set_attributes(rb::XmlNode* node, rb::hist::Base* hist) {
 	const char* lc = rb::mxml_get_attribute(node, "linecolor");
 	const char* lw = rb::mxml_get_attribute(node, "linewidth");
@@ -740,6 +1278,9 @@ rb::hist::Base* rb::hist::Base::ConstructXML(rb::XmlNode* node, Bool_t replace)
 		readers.insert(std::make_pair("rb_hist_Summary", construct_hist1<1>));
 		readers.insert(std::make_pair("rb_hist_Scaler",  construct_hist1<2>));
 		readers.insert(std::make_pair("rb_hist_Bit",     construct_hist1<3>));
+		readers.insert(std::make_pair("rb_hist_Rate",    construct_rate));
+		readers.insert(std::make_pair("rb_hist_Rolling", construct_timed<kFALSE>));
+		readers.insert(std::make_pair("rb_hist_Decaying", construct_timed<kTRUE>));
 	}
 
 	rb::hist::Base* hist = 0;
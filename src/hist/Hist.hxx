@@ -74,6 +74,32 @@ struct LockOnConstruction
 	}
 };
 
+#ifndef __MAKECINT__
+/// \brief Scope for creating (or deleting) many histograms at once.
+//! \details While one exists, histograms don't ask the GUI to rebuild its histogram tree one at a
+//! time; a single NewOrDeleteHist() signal is emitted when the outermost scope ends, if anything
+//! changed. It also holds a rb::TreeFormulae::Cache, so repeated parameters and gates are only
+//! parsed once. Used by rb::ReadHistXML() and rb::ReadConfigXML().
+class BulkLoad
+{
+	RB_NOCOPY(BulkLoad)
+private:
+	/// Shares formulae between the histograms created in the scope
+	rb::TreeFormulae::Cache fCache;
+	/// Number of open scopes
+	static Int_t fgDepth;
+	/// Was a histogram created or deleted in the current scope?
+	static Bool_t fgChanged;
+public:
+	/// Open a scope
+	BulkLoad();
+	/// Close the scope, signalling the GUI if it was the outermost one and histograms changed
+	~BulkLoad();
+	/// Signal the GUI that a histogram was created or deleted (deferred inside a scope)
+	static void Changed();
+};
+#endif
+
 /// Rootbeer Base histogram class.
 
 //! This class extends the stock ROOT TH*D histograms to allow additional functionality.
@@ -134,6 +160,12 @@ protected:
 	//! \details Variant class covers all possible dimensions from 1-3 in one object.
 	HistVariant fHistVariant;
 
+	/// \brief Fill generation.
+	//! \details Incremented every time the histogram contents may have changed (a fill that passes the
+	//! gate, a clear, or a call to a wrapped TH1 function that changes them), so that the canvas
+	//! refresher and snapshots can skip histograms which are unchanged.
+	ULong64_t fGeneration;
+
 	/// \brief Construction mode for duplicates
 	//! \details true means overwrite duplicate names in the same directory, false means append _1, _2, etc. until unique
 	static Bool_t fgOverwrite;
@@ -159,7 +191,7 @@ protected:
 public:
 	/// \brief Default constructor.
 	//! \details Does nothing, just here to make rootcint happy.
-	Base() : kEventCode(0), kDimensions(0), fManager(0) {}
+	Base() : kEventCode(0), kDimensions(0), fManager(0), fGeneration(0) {}
 
 public:
 	/// Construct a new histogram from an XML node
@@ -198,6 +230,17 @@ public:
 #ifndef __MAKECINT__
 	/// Unlocked version of Fill().
 	Int_t FillUnlocked();
+
+	/// \brief Copy the bin contents, including underflow and overflow, into _out_.
+	//! \details _out_ must have room for one value per bin as numbered by TH1::GetBin().
+	//! Used to publish histograms to external viewers (see rb::shm::Server).
+	void CopyBins(Double_t* out);
+
+	/// Get the number of bins and the range of each axis (1 bin from 0 to 1 for unused axes)
+	void GetAxes(Int_t* nbins, Double_t* low, Double_t* high);
+
+	/// Path below the top directory, e.g. "dir/subdir/name" (as written by rb::WriteCanvasXML())
+	std::string GetPath() const;
 #endif
 
 	/// \brief Returns a copy of fHistogram.
@@ -207,7 +250,15 @@ public:
 	TH1* GetHist();
 
 	/// Clear function, zeros-out all axes of the internal histogram
-	virtual void Clear() { visit::hist::Clear::Do(fHistVariant); }
+	virtual void Clear() { ++fGeneration; visit::hist::Clear::Do(fHistVariant); }
+
+	/// \brief Return the fill generation (changes whenever the contents may have changed).
+	//! \details Histograms whose contents change with time alone (rb::hist::Rolling,
+	//! rb::hist::Decaying) bring them up to date here, since everything that displays or publishes
+	//! histograms checks the generation first.
+	//! \note Changes made through the wrapped TH1 member functions (Reset(), Scale(), Add(), ...)
+	//! count as well.
+	virtual ULong64_t GetGeneration() { return fGeneration; }
 
 	/// Return the number of dimensions.
 	UInt_t GetNdimensions() { return kDimensions; }
@@ -258,11 +309,15 @@ private:
 	/// Prevent assigmnent
 	Base& operator= (const Base& other) { return *this; }
 	/// Prevent copying
-	Base(const Base& other) : kEventCode(other.kEventCode), kDimensions(other.kDimensions), fManager(other.fManager) {}
+	Base(const Base& other) : kEventCode(other.kEventCode), kDimensions(other.kDimensions), fManager(other.fManager), fGeneration(0) {}
 	/// \brief Internal function to fill the histogram.
 	//! \details Called from the public Fill() and FillAll(), does not do any mutex locking,
 	//! instead relies on being passed already locked components.
 	virtual Int_t DoFill(const std::vector<Double_t>& params);
+#if defined(RB_PROFILE) && !defined(__MAKECINT__)
+	/// Version of Fill() and FillUnlocked() that records the cycles spent in each stage (see Profile.hxx).
+	Int_t FillProfiled(Bool_t locked);
+#endif
 public:
 #include "WrapTH1.hxx"
 	friend class rb::hist::Manager;
@@ -473,6 +528,216 @@ public:
 	ClassDef(rb::hist::Scaler, 0);
 };
 
+
+/// \brief Rate (strip chart) histogram.
+//! \details Sums the parameter (e.g. "1" to count events, or a scaler read out as counts since the
+//! last read) into fixed time buckets and shows the sum per second against time, the right edge
+//! being now. Level 0 keeps the last _nbins_ buckets of the width given at creation; each further
+//! level keeps as many buckets kFactor times wider, holding the mean, minimum and maximum of the
+//! rates of the finer buckets they cover. Memory is therefore fixed however long the run, and
+//! SetLevel() switches the display to a coarser level to look further back.
+//!
+//! A fill only adds to the bucket being filled (and to the last bin if level 0 is shown); the
+//! display is rebuilt once per level-0 bucket, as time moves on, when checked by the canvases or
+//! servers (GetGeneration()) or by the next fill.
+class Rate: public Base
+{
+public:
+	/// Number of resolution levels
+	static const Int_t kNlevels = 4;
+	/// Ratio between the bucket widths of successive levels
+	static const Int_t kFactor = 10;
+private:
+	/// Completed bucket
+	struct Bucket {
+		/// Rate (mean of the finer rates above level 0)
+		Double_t fMean;
+		/// Smallest finer rate
+		Double_t fMin;
+		/// Largest finer rate
+		Double_t fMax;
+		Bucket(): fMean(0.), fMin(0.), fMax(0.) { }
+	};
+	/// One resolution level
+	struct Level {
+		/// Completed buckets, bucket number n at n % size
+		std::vector<Bucket> fRing;
+		/// Number (time over bucket width) of the bucket being filled
+		Long64_t fCurrent;
+		/// Sum of the parameter (level 0) or of the finer rates (other levels) so far
+		Double_t fSum;
+		/// Number of finer rates so far
+		Int_t fN;
+		/// Smallest finer rate so far
+		Double_t fMin;
+		/// Largest finer rate so far
+		Double_t fMax;
+		Level(): fRing(), fCurrent(0), fSum(0.), fN(0), fMin(0.), fMax(0.) { }
+	};
+	/// Width of the level 0 buckets in seconds
+	const Double_t kWidth;
+	/// The levels
+	std::vector<Level> fLevels;
+	/// Level shown
+	Int_t fShown;
+	/// Total number of fills
+	Long64_t fNfills;
+
+public:
+	/// \brief Show level _level_ (0 is the finest).
+	//! \returns false if there is no such level
+	Bool_t SetLevel(Int_t level);
+	/// Level shown
+	Int_t GetLevel() const { return fShown; }
+	/// Width of the buckets of _level_ in seconds
+	Double_t GetWidth(Int_t level = 0) const;
+	/// \brief Mean, minimum and maximum rate of bin _bin_ of the histogram as shown.
+	//! \returns false if _bin_ is out of range
+	Bool_t GetBucket(Int_t bin, Double_t& mean, Double_t& min, Double_t& max);
+	/// Moves the buckets on first
+	virtual ULong64_t GetGeneration();
+	/// Also empties the buckets
+	virtual void Clear();
+  /// \brief XML constructor output
+	virtual void WriteXML(rb::XmlWriter*);
+protected:
+	/// Constructor, _width_ is the width of the level 0 buckets (x limits are set from it)
+	Rate (const char* name, const char* title, const char* param, const char* gate,
+				hist::Manager* manager, Int_t event_code,
+				Int_t nbins, Double_t ignored1, Double_t ignored2, Double_t width);
+	/// Sets the axis title in addition to calling Base::Init()
+	virtual void Init(const char* name, const char* title, const char* param, const char* gate, Int_t event_code)
+		{
+			rb::hist::Base::Init(name, title, param, gate, event_code);
+			visit::hist::Cast::Do(fHistVariant)->GetXaxis()->SetTitle("time [s]");
+		}
+	/// Override filling procedure
+	virtual Int_t DoFill(const std::vector<Double_t>& params);
+private:
+	/// Start every level afresh at time _now_
+	void Reset(Double_t now);
+	/// Complete the level 0 buckets that have ended by time _now_
+	void Advance(Double_t now);
+	/// Add the rates of completed bucket _fine_ of level _level_ - 1 to level _level_
+	void Push(Int_t level, Long64_t fine, Double_t mean, Double_t min, Double_t max);
+	/// Bucket shown in bin _bin_ (completing the current one from the running sums)
+	Bucket GetShown(Int_t bin) const;
+	/// Rebuild the histogram from the level shown
+	void Render();
+
+public:
+	friend class rb::hist::Manager;
+	ClassDef(rb::hist::Rate, 0);
+};
+
+
+/// \brief Histogram of the last few seconds only.
+//! \details The window is divided into kNslices time slices. Each fill goes into the histogram
+//! and is recorded, by bin, in the current slice; when a slice leaves the window its fills are
+//! subtracted again. Filling stays O(1), and expiring a slice costs one subtraction per fill in it
+//! (or per bin, once it has more fills than bins). The window moves on with the wall clock even
+//! when no events come in, whenever the canvases or servers check the histogram (GetGeneration()).
+//!
+//! The window covers the last kNslices - 1 slices in full, plus the current one so far. Create
+//! an ordinary histogram of the same parameters alongside for the run-integrated spectrum.
+class Rolling: public Base
+{
+public:
+	/// Number of time slices in the window
+	static const Int_t kNslices = 30;
+private:
+	/// Fills of one time slice
+	struct Slice {
+		/// Filled bins, one entry per fill (while there are fewer fills than bins)
+		std::vector<Int_t> fBins;
+		/// Fills per bin (once there are more)
+		std::vector<Double_t> fCounts;
+		/// Number of fills
+		Long64_t fEntries;
+		Slice(): fBins(), fCounts(), fEntries(0) { }
+	};
+	/// Length of the window in seconds
+	const Double_t kWindow;
+	/// Ring of slices, slice number n at n % kNslices
+	std::vector<Slice> fSlices;
+	/// Number (time over slice width) of the current slice
+	Long64_t fCurrent;
+
+public:
+	/// Length of the window in seconds
+	Double_t GetWindow() const { return kWindow; }
+	/// Expires old slices first
+	virtual ULong64_t GetGeneration();
+	/// Also forgets the slices
+	virtual void Clear();
+  /// \brief XML constructor output
+	virtual void WriteXML(rb::XmlWriter*);
+protected:
+	/// Constructor (1d)
+	Rolling (const char* name, const char* title, const char* param, const char* gate,
+					 hist::Manager* manager, Int_t event_code,
+					 Int_t nbinsx, Double_t xlow, Double_t xhigh, Double_t window);
+	/// Constructor (2d)
+	Rolling (const char* name, const char* title, const char* param, const char* gate,
+					 hist::Manager* manager, Int_t event_code,
+					 Int_t nbinsx, Double_t xlow, Double_t xhigh,
+					 Int_t nbinsy, Double_t ylow, Double_t yhigh, Double_t window);
+	/// Override filling procedure
+	virtual Int_t DoFill(const std::vector<Double_t>& params);
+private:
+	/// Subtract the slices that have left the window at time _now_
+	void Advance(Double_t now);
+	/// Subtract the fills of _slice_ from _hist_ and empty it
+	void Expire(Slice& slice, TH1* hist);
+
+public:
+	friend class rb::hist::Manager;
+	ClassDef(rb::hist::Rolling, 0);
+};
+
+
+/// \brief Histogram whose contents decay exponentially with time.
+//! \details Each count fades away with a time constant tau, so the histogram shows the recent
+//! spectrum, weighted towards the present, without ever being zeroed. Instead of scaling every bin
+//! on every event, fills are weighted up by exp((t - t0)/tau) and the whole histogram is scaled
+//! down to the present (and t0 moved) only when it is checked by the canvases or servers
+//! (GetGeneration()), or when the weights get too large.
+class Decaying: public Base
+{
+private:
+	/// Time constant in seconds
+	const Double_t kTau;
+	/// Time at which the contents are exact
+	Double_t fT0;
+
+public:
+	/// Time constant in seconds
+	Double_t GetTau() const { return kTau; }
+	/// Scales the contents to the present first
+	virtual ULong64_t GetGeneration();
+  /// \brief XML constructor output
+	virtual void WriteXML(rb::XmlWriter*);
+protected:
+	/// Constructor (1d)
+	Decaying (const char* name, const char* title, const char* param, const char* gate,
+						hist::Manager* manager, Int_t event_code,
+						Int_t nbinsx, Double_t xlow, Double_t xhigh, Double_t tau);
+	/// Constructor (2d)
+	Decaying (const char* name, const char* title, const char* param, const char* gate,
+						hist::Manager* manager, Int_t event_code,
+						Int_t nbinsx, Double_t xlow, Double_t xhigh,
+						Int_t nbinsy, Double_t ylow, Double_t yhigh, Double_t tau);
+	/// Override filling procedure
+	virtual Int_t DoFill(const std::vector<Double_t>& params);
+private:
+	/// Scale the contents to time _now_
+	void Rescale(Double_t now);
+
+public:
+	friend class rb::hist::Manager;
+	ClassDef(rb::hist::Decaying, 0);
+};
+
 } // namespace hist
 
 } // namespace rb
@@ -1,5 +1,6 @@
 //! \file Manager.cxx
 //! \brief Implements manager.hxx
+#include <sstream>
 #include "Hist.hxx"
 #include "hist/Manager.hxx"
 
@@ -9,6 +10,77 @@
 // Helper Functions and Classes                          //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 namespace {
+typedef std::pair<TDirectory*, std::string> DirectoryKey_t;
+typedef boost::unordered_map<DirectoryKey_t, rb::hist::Base*> DirectoryIndex_t;
+
+/// Every histogram in every manager, by (directory, name); never destroyed, so it outlives all managers
+DirectoryIndex_t& directory_index() {
+	static DirectoryIndex_t* index = new DirectoryIndex_t();
+	return *index;
+}
+
+typedef boost::unordered_map<std::string, Int_t> NameCount_t;
+
+/// Number of histograms with each name, in every directory of every manager (keys as in directory_index())
+NameCount_t& name_count() {
+	static NameCount_t* count = new NameCount_t();
+	return *count;
+}
+
+/// Protects directory_index() and name_count()
+rb::Mutex& directory_mutex() {
+	static rb::Mutex* mutex = new rb::Mutex("DirectoryIndexMutex");
+	return *mutex;
+}
+
+/// Path of _dir_ below gROOT, e.g. "a/b" ("" for gROOT itself)
+std::string directory_path(TDirectory* dir) {
+	std::string path;
+	for(; dir && dir->GetMotherDir(); dir = dir->GetMotherDir())
+		path = path.empty() ? dir->GetName() : std::string(dir->GetName()) + "/" + path;
+	return path;
+}
+
+/// Key of _hist_ in Manager::fWritten: where HistWrite puts it in the file, e.g. "a/b/name"
+std::string full_path(rb::hist::Base* hist) {
+	const std::string path = directory_path(hist->GetDirectory());
+	return path.empty() ? hist->GetName() : path + "/" + hist->GetName();
+}
+
+/// Remove the entry of _hist_ from _names_, wherever it is (the name may have changed since it was added)
+void erase_name(boost::unordered_multimap<std::string, rb::hist::Base*>& names, rb::hist::Base* hist) {
+	typedef boost::unordered_multimap<std::string, rb::hist::Base*>::iterator Iterator_t;
+	std::pair<Iterator_t, Iterator_t> range = names.equal_range(hist->GetName());
+	for(Iterator_t it = range.first; it != range.second; ++it)
+		if(it->second == hist) { names.erase(it); return; }
+	for(Iterator_t it = names.begin(); it != names.end(); ++it)
+		if(it->second == hist) { names.erase(it); return; }
+}
+
+/// Remove the entry of _hist_ from _written_, wherever it is (the path may have changed since it was written)
+void erase_written(std::map<std::string, std::pair<rb::hist::Base*, ULong64_t> >& written, rb::hist::Base* hist) {
+	typedef std::map<std::string, std::pair<rb::hist::Base*, ULong64_t> >::iterator Iterator_t;
+	Iterator_t it = written.find(full_path(hist));
+	if(it != written.end() && it->second.first == hist) { written.erase(it); return; }
+	for(it = written.begin(); it != written.end(); ++it)
+		if(it->second.first == hist) { written.erase(it); return; }
+}
+
+/// Remove the entry of _hist_ from directory_index(), wherever it is, and uncount its name
+void erase_directory(rb::hist::Base* hist) {
+	rb::ScopedLock<rb::Mutex> lock(directory_mutex());
+	DirectoryIndex_t& index = directory_index();
+	DirectoryIndex_t::iterator it = index.find(DirectoryKey_t(hist->GetDirectory(), hist->GetName()));
+	if(it == index.end() || it->second != hist) {
+		for(it = index.begin(); it != index.end(); ++it)
+			if(it->second == hist) break;
+		if(it == index.end()) return;
+	}
+	NameCount_t::iterator itCount = name_count().find(it->first.second);
+	if(itCount != name_count().end() && --itCount->second <= 0) name_count().erase(itCount);
+	index.erase(it);
+}
+
 struct HistFill { Int_t operator() (rb::hist::Base* const& hist) {
 	return hist->Fill();
 } } fill_hist;
@@ -16,14 +88,24 @@ class HistWrite
 {
 private:
 	 TFile* fFile;
+	 Int_t fOption;
 public:
-	 HistWrite(TFile* file): fFile(file) { }
+	 HistWrite(TFile* file, Int_t option = 0): fFile(file), fOption(option) { }
+	 /// Write _hist_ into the directory of fFile matching its own directory below gROOT (made if needed)
 	 void operator() (rb::hist::Base* const& hist) {
 		 TDirectory* current = hist->GetDirectory();
 		 if(!current) return;
-		 fFile->cd();
-		 hist->SetDirectory(fFile);
-		 hist->Write(hist->GetName());
+		 TDirectory* dir = fFile;
+		 std::stringstream path(directory_path(current));
+		 std::string part;
+		 while(dir && std::getline(path, part, '/')) {
+			 TDirectory* sub = dir->GetDirectory(part.c_str());
+			 dir = sub ? sub : dir->mkdir(part.c_str());
+		 }
+		 if(!dir) return;
+		 dir->cd();
+		 hist->SetDirectory(dir);
+		 hist->Write(hist->GetName(), fOption);
 		 hist->SetDirectory(current);
 		 current->cd();
 	 }
@@ -41,16 +123,59 @@ public:
 void rb::hist::Manager::FillAll() {
   LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
   std::for_each(pSet->begin(), pSet->end(), fill_hist);
+	fNfills += pSet->size();
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Manager::WriteAll()                    //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
-void rb::hist::Manager::WriteAll(TFile* file) {
-	HistWrite write_hist(file);
+void rb::hist::Manager::WriteAll(TFile* file, Int_t option) {
+	HistWrite write_hist(file, option);
   LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
   std::for_each(pSet->begin(), pSet->end(), write_hist);
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::hist::Manager::WriteChanged()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::hist::Manager::WriteChanged(TFile* file) {
+	/*!
+	 * Writes (overwriting any earlier copy in _file_) every histogram which isn't recorded in
+	 * fWritten under its current path, as itself, with its current fill generation. On return
+	 * fWritten holds exactly the histograms in fSet.
+	 * \returns The number of histograms written.
+	 */
+	typedef std::map<std::string, std::pair<Base*, ULong64_t> > Written_t;
+	HistWrite write_hist(file, TObject::kOverwrite);
+	Written_t current;
+	Int_t nwritten = 0;
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+	for(Container_t::iterator it = pSet->begin(); it != pSet->end(); ++it) {
+		const std::pair<Base*, ULong64_t> entry(*it, (*it)->GetGeneration());
+		const std::string path = full_path(*it);
+		Written_t::iterator itWritten = fWritten.find(path);
+		if(itWritten == fWritten.end() || itWritten->second != entry) {
+			write_hist(*it);
+			++nwritten;
+		}
+		current[path] = entry;
+	}
+	fWritten.swap(current);
+	return nwritten;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::ForgetWritten()               //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::ForgetWritten() {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+	fWritten.clear();
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::hist::Manager::GetAll()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::hist::Manager::GetAll(std::vector<Base*>& out) {
+  LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
+	out.insert(out.end(), pSet->begin(), pSet->end());
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Manager::DeleteAll()                   //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::hist::Manager::DeleteAll() {
@@ -74,8 +199,18 @@ void rb::hist::Manager::ClearAll() {
 // void rb::hist::Manager::Add()                         //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 void rb::hist::Manager::Add(rb::hist::Base* hist) {
+	/*!
+	 * Also indexes _hist_ by name, by TH1 address and (for all managers) by directory and name.
+	 * The keys are taken now, so they stay valid as long as the name isn't changed through TNamed::SetName().
+	 */
   LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
   pSet->insert(hist);
+	fNames.insert(std::make_pair(std::string(hist->GetName()), hist));
+	fTH1s[visit::hist::Cast::Do(hist->fHistVariant)] = hist;
+	rb::ScopedLock<rb::Mutex> lock(directory_mutex());
+	rb::hist::Base*& entry = directory_index()[DirectoryKey_t(hist->fDirectory, hist->GetName())];
+	if(!entry) ++name_count()[hist->GetName()];
+	entry = hist;
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // void rb::hist::Manager::Remove()                      //
@@ -84,6 +219,10 @@ void rb::hist::Manager::Remove(rb::hist::Base* hist) {
   LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
 	if(pSet->count(hist)) {
 		pSet->erase(hist);
+		erase_name(fNames, hist);
+		fTH1s.erase(visit::hist::Cast::Do(hist->fHistVariant));
+		erase_directory(hist);
+		erase_written(fWritten, hist);
 		TDirectory* directory = hist->fDirectory;
 		if(directory) directory->Remove(hist);
 	}
@@ -93,20 +232,33 @@ void rb::hist::Manager::Remove(rb::hist::Base* hist) {
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::hist::Base* rb::hist::Manager::FindByTH1(TH1* hist) {
 	LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
-	for(hist::Container_t::iterator it = pSet->begin(); it != pSet->end(); ++it)
-	 	 if((*it)->CompareTH1(hist)) return *it;
-	return 0;
+	boost::unordered_map<TH1*, Base*>::iterator it = fTH1s.find(hist);
+	return it == fTH1s.end() ? 0 : it->second;
 }
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 // Base* rb::hist::Manager::FindByName()                 //
 //\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
 rb::hist::Base* rb::hist::Manager::FindByName(const char* name, TDirectory* owner) {
+	typedef boost::unordered_multimap<std::string, Base*>::iterator Iterator_t;
 	LockingPointer<hist::Container_t> pSet(fSet, fSetMutex);
-	for(hist::Container_t::iterator it = pSet->begin(); it != pSet->end(); ++it)
-		 if(!strcmp((*it)->GetName(), name)) {
-			 if(!owner || (*it)->GetDirectory() == owner) {
-				 return *it;
-			 }
-		 }
+	std::pair<Iterator_t, Iterator_t> range = fNames.equal_range(name);
+	for(Iterator_t it = range.first; it != range.second; ++it)
+		if(!strcmp(it->second->GetName(), name) && (!owner || it->second->GetDirectory() == owner))
+			return it->second;
 	return 0;
 }
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Base* rb::hist::Manager::FindInDirectory() [static]   //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::hist::Base* rb::hist::Manager::FindInDirectory(TDirectory* owner, const char* name) {
+	rb::ScopedLock<rb::Mutex> lock(directory_mutex());
+	DirectoryIndex_t::iterator it = directory_index().find(DirectoryKey_t(owner, name));
+	return it == directory_index().end() ? 0 : it->second;
+}
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::hist::Manager::NameInUse() [static]        //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::hist::Manager::NameInUse(const char* name) {
+	rb::ScopedLock<rb::Mutex> lock(directory_mutex());
+	return name_count().count(name) != 0;
+}
@@ -3,9 +3,13 @@
 //! and storage in a container.
 #ifndef HIST_MANAGER_HXX
 #define HIST_MANAGER_HXX
+#include <map>
 #include <typeinfo>
 #include "utils/Mutex.hxx"
 #include "Hist.hxx"
+#ifndef __MAKECINT__
+#include "boost/unordered_map.hpp"
+#endif
 
 namespace rb
 {
@@ -23,6 +27,21 @@ private:
 	//! Container of pointers to histograms registered to this event type.
 	volatile Container_t fSet;
 
+	//! Number of histogram fills attempted by FillAll()
+	ULong64_t fNfills;
+
+#ifndef __MAKECINT__
+	//! Histograms in fSet by name (protected by fSetMutex)
+	boost::unordered_multimap<std::string, Base*> fNames;
+
+	//! Histograms in fSet by the address of their internal TH1 (protected by fSetMutex)
+	boost::unordered_map<TH1*, Base*> fTH1s;
+
+	//! \brief Histogram and fill generation written by WriteChanged(), by full path (protected by fSetMutex)
+	//! \details Entries are removed with the histogram (Remove())
+	std::map<std::string, std::pair<Base*, ULong64_t> > fWritten;
+#endif
+
 	//! Mutex to protect access to fSet
 public:
 	rb::Mutex fSetMutex;
@@ -30,8 +49,16 @@ public:
 public:
 	//! Fill all histograms in fSet
 	void FillAll();
-	//! Write all histograms in fSet
-	void WriteAll(TFile* file);
+	//! Number of histogram fills attempted so far
+	ULong64_t GetNfills() const { return fNfills; }
+	//! Write all histograms in fSet to directories of _file_ matching theirs below gROOT (_option_ as in TObject::Write())
+	void WriteAll(TFile* file, Int_t option = 0);
+	//! Write the histograms in fSet which changed since WriteChanged() last wrote them
+	Int_t WriteChanged(TFile* file);
+	//! Forget what WriteChanged() wrote, so the next call writes everything
+	void ForgetWritten();
+	//! Append every histogram in fSet to _out_
+	void GetAll(std::vector<Base*>& out);
 	//! Does nothing
 	Manager();
 	//! Deletes all entries in fSet
@@ -40,6 +67,10 @@ public:
 	Base* FindByTH1(TH1* hist);
 	//! Searches for a histogram by it's name.
 	Base* FindByName(const char* name, TDirectory* owner);
+	//! Searches all managers for the histogram named _name_ in directory _owner_
+	static Base* FindInDirectory(TDirectory* owner, const char* name);
+	//! Is there a histogram named _name_ in any directory of any manager?
+	static Bool_t NameInUse(const char* name);
 	//! Create a new 1d histogram and add to fSet
 	template<typename T>
 	rb::hist::Base* Create(const char* name, const char* title, const char* param, const char* gate, Int_t event_code,
@@ -123,7 +154,7 @@ private:
 
 
 // ========= Inlined Functions ========= //
-inline rb::hist::Manager::Manager(): fSetMutex("SetMutex", true) {
+inline rb::hist::Manager::Manager(): fNfills(0), fSetMutex("SetMutex", true) {
 }
 
 inline rb::hist::Manager::~Manager() {
@@ -131,6 +131,21 @@ private:
 	 Double_t x_, y_, z_;
 };
 
+/// Performs the weighted Fill() function
+struct FillWeighted : public rb::visit::Locked<Int_t>
+{
+public:
+	 Int_t operator() (TH1D& hst) const { return hst.Fill(x_,w_); }
+	 Int_t operator() (TH2D& hst) const { return hst.Fill(x_,y_,w_); }
+	 Int_t operator() (TH3D& hst) const { return hst.Fill(x_,y_,z_,w_); }
+	 static Int_t Do(HistVariant& hist, Double_t w, Double_t x, Double_t y=0, Double_t z=0) {
+		 return boost::apply_visitor(FillWeighted(w,x,y,z), hist);
+	 }
+	 FillWeighted(Double_t w, Double_t x, Double_t y, Double_t z): w_(w), x_(x), y_(y), z_(z) {}
+private:
+	 Double_t w_, x_, y_, z_;
+};
+
 /// Sets bin content
 struct SetBinContent : public rb::visit::Locked<void>
 {
@@ -8,37 +8,43 @@
 //! The file was generated using wrap.py, operating on the XML file TH1.xml, which was
 //! produced by running the program gccxml on the root v5.32/01 version of TH1.h
 //! Subsequently, member functions that we did not want transferred to rb::hist::Base
-//! (or which would not compile) were commented out by hand.
+//! (or which would not compile) were commented out by hand, and the wrappers of functions which
+//! change the contents got a "++fGeneration" (see Base::GetGeneration()).
 #define AS_TH1 visit::hist::Cast::Do(fHistVariant)
 
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Add">*** TH1 Member Function ***</a>
 virtual void Add(TF1* h1, Double_t c1 = 1, Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Add(h1, c1, option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Add">*** TH1 Member Function ***</a>
 virtual void Add(const TH1* h1, Double_t c1 = 1)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Add(h1, c1);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Add">*** TH1 Member Function ***</a>
 virtual void Add(const TH1* h, const TH1* h2, Double_t c1 = 1, Double_t c2 = 1)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Add(h, h2, c1, c2);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:AddBinContent">*** TH1 Member Function ***</a>
 virtual void AddBinContent(Int_t bin)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->AddBinContent(bin);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:AddBinContent">*** TH1 Member Function ***</a>
 virtual void AddBinContent(Int_t bin, Double_t w)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->AddBinContent(bin, w);
 }
 // /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Browse">*** TH1 Member Function ***</a>
@@ -81,18 +87,21 @@ virtual Int_t DistancetoPrimitive(Int_t px, Int_t py)
 virtual void Divide(TF1* f1, Double_t c1 = 1)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Divide(f1, c1);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Divide">*** TH1 Member Function ***</a>
 virtual void Divide(const TH1* h1)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Divide(h1);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Divide">*** TH1 Member Function ***</a>
 virtual void Divide(const TH1* h1, const TH1* h2, Double_t c1 = 1, Double_t c2 = 1, Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Divide(h1, h2, c1, c2, option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Draw">*** TH1 Member Function ***</a>
@@ -123,12 +132,14 @@ virtual void DrawPanel()
 virtual Int_t BufferEmpty(Int_t action = 0)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->BufferEmpty(action);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Eval">*** TH1 Member Function ***</a>
 virtual void Eval(TF1* f1, Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Eval(f1, option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:ExecuteEvent">*** TH1 Member Function ***</a>
@@ -147,42 +158,49 @@ virtual TH1* FFT(TH1* h_output, Option_t* option)
 virtual Int_t Fill(Double_t x)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Fill(x);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Fill">*** TH1 Member Function ***</a>
 virtual Int_t Fill(Double_t x, Double_t w)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Fill(x, w);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Fill">*** TH1 Member Function ***</a>
 virtual Int_t Fill(const char* name, Double_t w)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Fill(name, w);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:FillN">*** TH1 Member Function ***</a>
 virtual void FillN(Int_t ntimes, const Double_t* x, const Double_t* w, Int_t stride = 1)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->FillN(ntimes, x, w, stride);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:FillN">*** TH1 Member Function ***</a>
 virtual void FillN(Int_t arg0, const Double_t* arg1, const Double_t* arg2, const Double_t* arg3, Int_t arg4)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->FillN(arg0, arg1, arg2, arg3, arg4);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:FillRandom">*** TH1 Member Function ***</a>
 virtual void FillRandom(const char* fname, Int_t ntimes = 5000)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->FillRandom(fname, ntimes);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:FillRandom">*** TH1 Member Function ***</a>
 virtual void FillRandom(TH1* h, Int_t ntimes = 5000)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->FillRandom(h, ntimes);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:FindBin">*** TH1 Member Function ***</a>
@@ -225,12 +243,14 @@ virtual TObject* FindObject(const TObject* obj) const
 virtual TFitResultPtr Fit(const char* formula, Option_t* option = "", Option_t* goption = "", Double_t xmin = 0, Double_t xmax = 0)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Fit(formula, option, goption, xmin, xmax);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Fit">*** TH1 Member Function ***</a>
 virtual TFitResultPtr Fit(TF1* f1, Option_t* option = "", Option_t* goption = "", Double_t xmin = 0, Double_t xmax = 0)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Fit(f1, option, goption, xmin, xmax);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:FitPanel">*** TH1 Member Function ***</a>
@@ -735,12 +755,14 @@ virtual Double_t KolmogorovTest(const TH1* h2, Option_t* option = "") const
 virtual void LabelsDeflate(Option_t* axis = "X")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->LabelsDeflate(axis);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:LabelsInflate">*** TH1 Member Function ***</a>
 virtual void LabelsInflate(Option_t* axis = "X")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->LabelsInflate(axis);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:LabelsOption">*** TH1 Member Function ***</a>
@@ -753,24 +775,28 @@ virtual void LabelsOption(Option_t* option = "h", Option_t* axis = "X")
 virtual Long64_t Merge(TCollection* list)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Merge(list);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Multiply">*** TH1 Member Function ***</a>
 virtual void Multiply(TF1* h1, Double_t c1 = 1)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Multiply(h1, c1);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Multiply">*** TH1 Member Function ***</a>
 virtual void Multiply(const TH1* h1)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Multiply(h1);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Multiply">*** TH1 Member Function ***</a>
 virtual void Multiply(const TH1* h1, const TH1* h2, Double_t c1 = 1, Double_t c2 = 1, Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   /*return*/ AS_TH1->Multiply(h1, h2, c1, c2, option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Paint">*** TH1 Member Function ***</a>
@@ -789,24 +815,28 @@ virtual void Print(Option_t* option = "") const
 virtual void PutStats(Double_t* stats)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->PutStats(stats);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Rebin">*** TH1 Member Function ***</a>
 virtual TH1* Rebin(Int_t ngroup = 2, const char* newname = "", const Double_t* xbins = 0)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Rebin(ngroup, newname, xbins);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:RebinAxis">*** TH1 Member Function ***</a>
 virtual void RebinAxis(Double_t x, TAxis* axis)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->RebinAxis(x, axis);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Rebuild">*** TH1 Member Function ***</a>
 virtual void Rebuild(Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Rebuild(option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:RecursiveRemove">*** TH1 Member Function ***</a>
@@ -819,12 +849,14 @@ virtual void RecursiveRemove(TObject* obj)
 virtual void Reset(Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Reset(option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:ResetStats">*** TH1 Member Function ***</a>
 virtual void ResetStats()
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->ResetStats();
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SavePrimitive">*** TH1 Member Function ***</a>
@@ -837,6 +869,7 @@ virtual void SavePrimitive(ostream& out, Option_t* option = "")
 virtual void Scale(Double_t c1 = 1, Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Scale(c1, option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetAxisColor">*** TH1 Member Function ***</a>
@@ -867,102 +900,119 @@ virtual void SetBarWidth(Float_t width = 5.0e-1)
 virtual void SetBinContent(Int_t bin, Double_t content)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBinContent(bin, content);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBinContent">*** TH1 Member Function ***</a>
 virtual void SetBinContent(Int_t binx, Int_t biny, Double_t content)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBinContent(binx, biny, content);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBinContent">*** TH1 Member Function ***</a>
 virtual void SetBinContent(Int_t binx, Int_t biny, Int_t binz, Double_t content)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBinContent(binx, biny, binz, content);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBinError">*** TH1 Member Function ***</a>
 virtual void SetBinError(Int_t bin, Double_t error)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBinError(bin, error);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBinError">*** TH1 Member Function ***</a>
 virtual void SetBinError(Int_t binx, Int_t biny, Double_t error)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBinError(binx, biny, error);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBinError">*** TH1 Member Function ***</a>
 virtual void SetBinError(Int_t binx, Int_t biny, Int_t binz, Double_t error)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBinError(binx, biny, binz, error);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBins">*** TH1 Member Function ***</a>
 virtual void SetBins(Int_t nx, Double_t xmin, Double_t xmax)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBins(nx, xmin, xmax);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBins">*** TH1 Member Function ***</a>
 virtual void SetBins(Int_t nx, const Double_t* xBins)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBins(nx, xBins);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBins">*** TH1 Member Function ***</a>
 virtual void SetBins(Int_t nx, Double_t xmin, Double_t xmax, Int_t ny, Double_t ymin, Double_t ymax)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBins(nx, xmin, xmax, ny, ymin, ymax);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBins">*** TH1 Member Function ***</a>
 virtual void SetBins(Int_t nx, const Double_t* xBins, Int_t ny, const Double_t* yBins)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBins(nx, xBins, ny, yBins);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBins">*** TH1 Member Function ***</a>
 virtual void SetBins(Int_t nx, Double_t xmin, Double_t xmax, Int_t ny, Double_t ymin, Double_t ymax, Int_t nz, Double_t zmin, Double_t zmax)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBins(nx, xmin, xmax, ny, ymin, ymax, nz, zmin, zmax);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBins">*** TH1 Member Function ***</a>
 virtual void SetBins(Int_t nx, const Double_t* xBins, Int_t ny, const Double_t* yBins, Int_t nz, const Double_t* zBins)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBins(nx, xBins, ny, yBins, nz, zBins);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBinsLength">*** TH1 Member Function ***</a>
 virtual void SetBinsLength(Int_t arg0 = -0x00000000000000001)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBinsLength(arg0);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetBuffer">*** TH1 Member Function ***</a>
 virtual void SetBuffer(Int_t buffersize, Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetBuffer(buffersize, option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetCellContent">*** TH1 Member Function ***</a>
 virtual void SetCellContent(Int_t binx, Int_t biny, Double_t content)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetCellContent(binx, biny, content);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetCellError">*** TH1 Member Function ***</a>
 virtual void SetCellError(Int_t binx, Int_t biny, Double_t content)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetCellError(binx, biny, content);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetContent">*** TH1 Member Function ***</a>
 virtual void SetContent(const Double_t* content)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetContent(content);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetContour">*** TH1 Member Function ***</a>
@@ -987,12 +1037,14 @@ virtual void SetDirectory(TDirectory* dir)
 virtual void SetEntries(Double_t n)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetEntries(n);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetError">*** TH1 Member Function ***</a>
 virtual void SetError(const Double_t* error)
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->SetError(error);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:SetLabelColor">*** TH1 Member Function ***</a>
@@ -1131,12 +1183,14 @@ virtual Int_t ShowPeaks(Double_t sigma = 2, Option_t* option = "", Double_t thre
 virtual void Smooth(Int_t ntimes = 1, Option_t* option = "")
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Smooth(ntimes, option);
 }
 /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:Sumw2">*** TH1 Member Function ***</a>
 virtual void Sumw2()
 {
   rb::ScopedLock<rb::Mutex> LOCK (TTHREAD_GLOBAL_MUTEX);
+  ++fGeneration;
   return AS_TH1->Sumw2();
 }
 // /// <a href = "http://root.cern.ch/root/html/TH1.html#TH1:UseCurrentStyle">*** TH1 Member Function ***</a>
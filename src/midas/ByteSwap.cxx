@@ -0,0 +1,135 @@
+/// \file ByteSwap.cxx
+/// \author G. Christian
+/// \brief Implements ByteSwap.hxx
+#include "ByteSwap.hxx"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+namespace {
+// Scalar kernels, also used for the tail of the vector loops
+inline void swap16(unsigned char* p, uint32_t n) {
+	for(uint32_t i=0; i< n; ++i, p += 2) {
+		unsigned char t = p[0]; p[0] = p[1]; p[1] = t;
+	}
+}
+inline void swap32(unsigned char* p, uint32_t n) {
+	for(uint32_t i=0; i< n; ++i, p += 4) {
+		unsigned char t0 = p[0], t1 = p[1];
+		p[0] = p[3]; p[1] = p[2]; p[2] = t1; p[3] = t0;
+	}
+}
+inline void swap64(unsigned char* p, uint32_t n) {
+	for(uint32_t i=0; i< n; ++i, p += 8)
+		for(int j=0; j< 4; ++j) {
+			unsigned char t = p[j]; p[j] = p[7-j]; p[7-j] = t;
+		}
+}
+
+#if defined(__SSSE3__) || defined(__AVX2__)
+// Byte shuffle masks reversing each 2-, 4- and 8-byte element of a 16-byte lane
+const char kMask16[16] = { 1,0, 3,2, 5,4, 7,6, 9,8, 11,10, 13,12, 15,14 };
+const char kMask32[16] = { 3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12 };
+const char kMask64[16] = { 7,6,5,4,3,2,1,0, 15,14,13,12,11,10,9,8 };
+
+/// Shuffle _nbytes_ at _p_ with _mask_; returns the number of bytes done (a multiple of 16)
+inline uint32_t shuffle(unsigned char* p, uint32_t nbytes, const char* mask) {
+	uint32_t done = 0;
+#ifdef __AVX2__
+	const __m256i m256 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(mask)));
+	for(; done + 32 <= nbytes; done += 32) {
+		__m256i* q = reinterpret_cast<__m256i*>(p + done);
+		_mm256_storeu_si256(q, _mm256_shuffle_epi8(_mm256_loadu_si256(q), m256));
+	}
+#endif
+	const __m128i m128 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+	for(; done + 16 <= nbytes; done += 16) {
+		__m128i* q = reinterpret_cast<__m128i*>(p + done);
+		_mm_storeu_si128(q, _mm_shuffle_epi8(_mm_loadu_si128(q), m128));
+	}
+	return done;
+}
+#elif defined(__SSE2__)
+// Swap the bytes within each 16-bit word
+inline __m128i swap_words(__m128i v) {
+	return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+/// Swap 16-byte blocks at _p_ (elements of _width_ bytes); returns the number of bytes done
+inline uint32_t shuffle(unsigned char* p, uint32_t nbytes, int width) {
+	uint32_t done = 0;
+	for(; done + 16 <= nbytes; done += 16) {
+		__m128i* q = reinterpret_cast<__m128i*>(p + done);
+		__m128i v = _mm_loadu_si128(q);
+		if(width == 4) { // reverse the words of each dword
+			v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2,3,0,1));
+			v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2,3,0,1));
+		}
+		else if(width == 8) { // reverse the words of each qword
+			v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0,1,2,3));
+			v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0,1,2,3));
+		}
+		_mm_storeu_si128(q, swap_words(v));
+	}
+	return done;
+}
+#endif
+}
+
+void rb::SwapBytes16(void* data, uint32_t n)
+{
+	unsigned char* p = static_cast<unsigned char*>(data);
+	uint32_t done = 0;
+#if defined(__SSSE3__) || defined(__AVX2__)
+	done = shuffle(p, n*2, kMask16);
+#elif defined(__SSE2__)
+	done = shuffle(p, n*2, 2);
+#endif
+	swap16(p + done, n - done/2);
+}
+
+void rb::SwapBytes32(void* data, uint32_t n)
+{
+	unsigned char* p = static_cast<unsigned char*>(data);
+	uint32_t done = 0;
+#if defined(__SSSE3__) || defined(__AVX2__)
+	done = shuffle(p, n*4, kMask32);
+#elif defined(__SSE2__)
+	done = shuffle(p, n*4, 4);
+#endif
+	swap32(p + done, n - done/4);
+}
+
+void rb::SwapBytes64(void* data, uint32_t n)
+{
+	unsigned char* p = static_cast<unsigned char*>(data);
+	uint32_t done = 0;
+#if defined(__SSSE3__) || defined(__AVX2__)
+	done = shuffle(p, n*8, kMask64);
+#elif defined(__SSE2__)
+	done = shuffle(p, n*8, 8);
+#endif
+	swap64(p + done, n - done/8);
+}
+
+void rb::SwapBankData(void* data, uint32_t size, uint32_t type)
+{
+	switch (type & 0xFFFF) {
+	case 4: case 5:                  // TID_WORD, TID_SHORT
+		SwapBytes16(data, size/2);
+		break;
+	case 6: case 7: case 8: case 9:  // TID_DWORD, TID_INT, TID_BOOL, TID_FLOAT
+		SwapBytes32(data, size/4);
+		break;
+	case 10:                         // TID_DOUBLE
+		SwapBytes64(data, size/8);
+		break;
+	default:
+		break;
+	}
+}
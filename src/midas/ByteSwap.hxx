@@ -0,0 +1,29 @@
+/// \file ByteSwap.hxx
+/// \author G. Christian
+/// \brief In-place byte order conversion of MIDAS bank data.
+/// \details The kernels use AVX2 or SSSE3 byte shuffles when the compiler targets them
+/// (e.g. with -march=native), SSE2 on any other x86-64, and plain shifts elsewhere.
+#ifndef DRAGON_RB_BYTESWAP_HXX
+#define DRAGON_RB_BYTESWAP_HXX
+#include <stdint.h>
+
+
+namespace rb {
+
+/// Reverse the bytes of _n_ 16-bit words at _data_
+void SwapBytes16(void* data, uint32_t n);
+
+/// Reverse the bytes of _n_ 32-bit words at _data_
+void SwapBytes32(void* data, uint32_t n);
+
+/// Reverse the bytes of _n_ 64-bit words at _data_
+void SwapBytes64(void* data, uint32_t n);
+
+/// \brief Convert the data of one bank (_size_ bytes of MIDAS type _type_).
+//! \details Types without a multi-byte element (characters, bytes, structures) are left alone.
+void SwapBankData(void* data, uint32_t size, uint32_t type);
+
+} // namespace rb
+
+
+#endif
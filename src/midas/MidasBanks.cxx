@@ -0,0 +1,148 @@
+/// \file MidasBanks.cxx
+/// \author G. Christian
+/// \brief Implements MidasBanks.hxx
+#include "TMidasStructs.h"
+#include "ByteSwap.hxx"
+#include "MidasBanks.hxx"
+
+
+namespace {
+// Element sizes of the MIDAS TID_xxx types (same as TMidasEvent.cxx)
+const unsigned kTypeSize[] = {0, 1, 1, 1, 2, 2, 4, 4, 4, 4, 8, 1, 0, 0, 0, 0, 0};
+const unsigned kNtypes = sizeof(kTypeSize)/sizeof(kTypeSize[0]);
+}
+
+unsigned rb::MidasBanks::TypeSize(uint32_t type)
+{
+	return (type & 0xFF) < kNtypes ? kTypeSize[type & 0xFF] : 0;
+}
+
+rb::MidasBanks::MidasBanks():
+	fNpending(0),
+	fNbanks(0),
+	fEvent(0),
+	fOverflow(false),
+	fBank32(false)
+{
+	memset(fSlots, 0, sizeof(fSlots));
+}
+
+void rb::MidasBanks::Clear()
+{
+	if(fNbanks) memset(fSlots, 0, sizeof(fSlots));
+	fNbanks = 0;
+	fNpending = 0;
+	fEvent = 0;
+	fOverflow = false;
+	fBank32 = false;
+}
+
+char* rb::MidasBanks::Read(char* pbk, Bank* bank) const
+{
+	/*!
+	 * Reads the bank header at pbk into bank.
+	 * \returns The following bank header, or 0 if the header runs past the end of the event.
+	 */
+	const TMidas_BANK_HEADER* event = reinterpret_cast<const TMidas_BANK_HEADER*>(fEvent);
+	const char* end = fEvent + sizeof(TMidas_BANK_HEADER) + event->fDataSize;
+	if(fBank32) {
+		if(pbk + sizeof(TMidas_BANK32) > end) return 0;
+		TMidas_BANK32* pbk32 = reinterpret_cast<TMidas_BANK32*>(pbk);
+		if(pbk32->fType > kNtypes) { // malformed T2K/ND280 data, see TMidasEvent::IterateBank32()
+			pbk32 = reinterpret_cast<TMidas_BANK32*>(pbk + 4);
+			if(pbk + 4 + sizeof(TMidas_BANK32) > end || pbk32->fType > kNtypes) return 0;
+		}
+		bank->fName = MakeName(pbk32->fName);
+		bank->fType = pbk32->fType;
+		bank->fSize = pbk32->fDataSize;
+		bank->fData = reinterpret_cast<char*>(pbk32 + 1);
+	}
+	else {
+		if(pbk + sizeof(TMidas_BANK) > end) return 0;
+		TMidas_BANK* pbk16 = reinterpret_cast<TMidas_BANK*>(pbk);
+		bank->fName = MakeName(pbk16->fName);
+		bank->fType = pbk16->fType;
+		bank->fSize = pbk16->fDataSize;
+		bank->fData = reinterpret_cast<char*>(pbk16 + 1);
+	}
+	if(bank->fData + bank->fSize > end) return 0;
+	unsigned size = TypeSize(bank->fType);
+	bank->fLength = size ? bank->fSize / size : bank->fSize;
+	return bank->fData + ((bank->fSize + 7) & ~7);
+}
+
+int rb::MidasBanks::Set(char* data, uint32_t size, bool swap)
+{
+	/*!
+	 * Walks the bank list once, filling the table and the hash index. Headers in the
+	 * wrong byte order (see TMidasEvent::SwapBytes()) or a bank list that runs past
+	 * _size_ leave the directory empty. With _swap_, the bank data is converted lazily
+	 * (banks past kMaxBanks right away).
+	 */
+	Clear();
+	if(!data || size < sizeof(TMidas_BANK_HEADER)) return -1;
+	const TMidas_BANK_HEADER* event = reinterpret_cast<const TMidas_BANK_HEADER*>(data);
+	if(event->fFlags >= 0x10000) return -1; // not swapped yet
+	if(event->fDataSize > size - sizeof(TMidas_BANK_HEADER)) return -1;
+
+	fEvent = data;
+	fBank32 = event->fFlags & (1<<4);
+	char* pbk = data + sizeof(TMidas_BANK_HEADER);
+	while(pbk) {
+		if(fNbanks == kMaxBanks) {
+			Bank next;
+			while((pbk = Read(pbk, &next))) {
+				fOverflow = true;
+				if(swap) SwapBankData(next.fData, next.fSize, next.fType);
+			}
+			break;
+		}
+		Bank& bank = fBanks[fNbanks];
+		pbk = Read(pbk, &bank);
+		if(!pbk) break;
+		fPending[fNbanks] = swap;
+		if(swap) ++fNpending;
+		int slot = Slot(bank.fName);
+		while(fSlots[slot] && fBanks[fSlots[slot] - 1].fName != bank.fName)
+			slot = (slot + 1) & (kNslots - 1);
+		if(!fSlots[slot]) fSlots[slot] = fNbanks + 1; // first bank of a given name wins, like FindBank()
+		++fNbanks;
+	}
+	return fNbanks;
+}
+
+const rb::MidasBanks::Bank* rb::MidasBanks::Find(uint32_t name) const
+{
+	for(int slot = Slot(name); fSlots[slot]; slot = (slot + 1) & (kNslots - 1)) {
+		const Bank& bank = fBanks[fSlots[slot] - 1];
+		if(bank.fName == name) {
+			Ready(fSlots[slot] - 1);
+			return &bank;
+		}
+	}
+	return fOverflow ? FindOverflow(name) : 0;
+}
+
+const rb::MidasBanks::Bank* rb::MidasBanks::FindOverflow(uint32_t name) const
+{
+	const Bank& last = fBanks[kMaxBanks - 1];
+	char* pbk = last.fData + ((last.fSize + 7) & ~7);
+	while(pbk) {
+		pbk = Read(pbk, &fOverflowBank);
+		if(pbk && fOverflowBank.fName == name) return &fOverflowBank;
+	}
+	return 0;
+}
+
+void rb::MidasBanks::Ready(int i) const
+{
+	if(!fNpending || !fPending[i]) return;
+	SwapBankData(fBanks[i].fData, fBanks[i].fSize, fBanks[i].fType);
+	fPending[i] = false;
+	--fNpending;
+}
+
+void rb::MidasBanks::SwapAll() const
+{
+	for(int i=0; fNpending && i< fNbanks; ++i) Ready(i);
+}
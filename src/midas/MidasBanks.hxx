@@ -0,0 +1,153 @@
+/// \file MidasBanks.hxx
+/// \author G. Christian
+/// \brief Directory of the data banks in one MIDAS event, built in a single pass.
+#ifndef DRAGON_RB_MIDASBANKS_HXX
+#define DRAGON_RB_MIDASBANKS_HXX
+#include <string.h>
+#include <stdint.h>
+
+
+namespace rb {
+
+/// \brief Table of the banks in one MIDAS event.
+//! \details Set() walks the bank headers once and records the name (as a 32-bit four
+//! character code), type, length and data pointer of each bank, indexed by a small
+//! hash table, so every later lookup is a single probe instead of a scan of the event.
+//! Nothing is copied: the pointers refer to the event data passed to Set(), which has
+//! to outlive the directory (or the next call to Set()). Data still in the wrong byte
+//! order (see TMidasEvent::SwapBytes()) is converted in place, bank by bank, the first
+//! time each bank is looked up.
+//!
+//! Example (in a MidasBuffer::UnpackEvent() implementation, see MidasBuffer::GetBanks()):
+//! \code
+//! Int_t nadc;
+//! const uint32_t* adc = GetBanks().Get<uint32_t>("ADC0", &nadc);
+//! for(Int_t i=0; i< nadc; ++i) { ... }
+//! \endcode
+class MidasBanks
+{
+public:
+	/// One data bank
+	struct Bank {
+		/// Name as a four character code (see MakeName())
+		uint32_t fName;
+		/// MIDAS data type (TID_xxx)
+		uint32_t fType;
+		/// Number of elements (bytes for types without a fixed size)
+		uint32_t fLength;
+		/// Size of the data in bytes
+		uint32_t fSize;
+		/// Start of the data, inside the event
+		char* fData;
+	};
+
+	/// Banks held in the table; events with more are still handled, see Find()
+	static const int kMaxBanks = 64;
+
+private:
+	/// Slots in the hash table (power of two, at least twice kMaxBanks)
+	static const int kNslots = 256;
+
+	/// Banks in event order
+	Bank fBanks[kMaxBanks];
+
+	/// Index into fBanks + 1 for each hash slot, 0 if empty
+	uint8_t fSlots[kNslots];
+
+	/// Is the data of each bank still in the wrong byte order?
+	mutable bool fPending[kMaxBanks];
+
+	/// Number of banks with fPending set
+	mutable int fNpending;
+
+	/// Number of banks in fBanks
+	int fNbanks;
+
+	/// Bank header of the event
+	char* fEvent;
+
+	/// Did the event have more than kMaxBanks banks?
+	bool fOverflow;
+
+	/// Are the banks 32-bit?
+	bool fBank32;
+
+	/// Fill _bank_ from the bank header at _pbk_ and return the next header
+	char* Read(char* pbk, Bank* bank) const;
+
+	/// Convert the data of bank _i_ if it is still pending
+	void Ready(int i) const;
+
+	/// Search the banks past the last tabulated one (only when fOverflow)
+	const Bank* FindOverflow(uint32_t name) const;
+
+	/// Bank returned by FindOverflow()
+	mutable Bank fOverflowBank;
+
+public:
+	/// Empty directory
+	MidasBanks();
+
+	/// \brief Build the directory for event data at _data_ (the bank header following the event header).
+	//! \param data Start of the event data
+	//! \param size Size of the event data in bytes (the event header's fDataSize)
+	//! \param swap Are the bank headers converted already, but not the bank data?
+	//! \returns The number of banks, or -1 if the data isn't a valid (native byte order) bank list
+	int Set(char* data, uint32_t size, bool swap = false);
+
+	/// Forget all banks
+	void Clear();
+
+	/// Number of banks in the table (all of them unless IsOverflow())
+	int GetNbanks() const { return fNbanks; }
+
+	/// Bank number _i_ (event order, i < GetNbanks())
+	const Bank& At(int i) const { Ready(i); return fBanks[i]; }
+
+	/// Convert the data of all banks not looked up yet
+	void SwapAll() const;
+
+	/// Event data the directory refers to (0 if Set() failed or wasn't called)
+	char* GetEvent() const { return fEvent; }
+
+	/// Did the event hold more than kMaxBanks banks?
+	bool IsOverflow() const { return fOverflow; }
+
+	/// Are the banks 32-bit?
+	bool IsBank32() const { return fBank32; }
+
+	/// Find bank _name_ (four character code); 0 if it isn't there
+	const Bank* Find(uint32_t name) const;
+
+	/// Find bank _name_ (four characters); 0 if it isn't there
+	const Bank* Find(const char* name) const { return Find(MakeName(name)); }
+
+	/// \brief Typed pointer to the data of bank _name_, without copying.
+	//! \param name Bank name (four characters)
+	//! \param [out] length Number of elements, 0 if the bank isn't there (may be null)
+	//! \returns Start of the data, 0 if the bank isn't there
+	template <class T>
+	T* Get(const char* name, int* length = 0) const {
+		const Bank* bank = Find(name);
+		if(length) *length = bank ? bank->fLength : 0;
+		return bank ? reinterpret_cast<T*>(bank->fData) : 0;
+	}
+
+	/// Four character code of _name_ (the first four bytes, as stored in the bank header)
+	static uint32_t MakeName(const char* name) {
+		uint32_t code;
+		memcpy(&code, name, 4);
+		return code;
+	}
+
+	/// Hash slot of the four character code _name_
+	static int Slot(uint32_t name) { return (name * 2654435761u) >> 24; }
+
+	/// Size in bytes of one element of MIDAS type _type_ (0 for types without a fixed size)
+	static unsigned TypeSize(uint32_t type);
+};
+
+} // namespace rb
+
+
+#endif
@@ -1,9 +1,18 @@
 /// \file MidasBuffer.cxx
 /// \author G. Christian
 /// \brief Implements MidasBuffer.hxx
+#include <ctime>
 #include <cassert>
+#include <cfloat>
+#include <cstring>
+#include <algorithm>
 #include "TMidasFile.h"
 #include "TMidasEvent.h"
+#include "MidasWriter.hxx"
+#include "Merger.hxx"
+#include "Rint.hxx"
+#include "Event.hxx"
+#include "Formula.hxx"
 #include "Attach.hxx"
 #include "MidasBuffer.hxx"
 
@@ -13,6 +22,39 @@
 
 
 
+namespace {
+/// One file of a time-ordered merge
+class MidasStream: public rb::Merger::Stream {
+	rb::TMidasFile fFile;
+	rb::MidasBuffer* fOwner;
+	Double_t fLast;
+public:
+	MidasStream(rb::MidasBuffer* owner): fFile(), fOwner(owner), fLast(-DBL_MAX) { }
+	bool Open(const char* filename) { return fFile.Open(filename); }
+	Bool_t Read(std::vector<char>& event, Double_t& time) {
+		rb::TMidasEvent temp;
+		if(!fFile.Read(&temp)) return kFALSE;
+		const size_t hsize = sizeof(rb::TMidas_EVENT_HEADER);
+		event.resize(hsize + temp.GetDataSize());
+		memcpy(&event[0], temp.GetEventHeader(), hsize);
+		if(temp.GetDataSize()) memcpy(&event[hsize], temp.GetData(), temp.GetDataSize());
+
+		rb::TMidas_EVENT_HEADER* header = reinterpret_cast<rb::TMidas_EVENT_HEADER*>(&event[0]);
+		switch(header->fEventId & 0xffff) {
+		case 0x8000: time = -DBL_MAX; break; // begin-of-run ODB dumps go first,
+		case 0x8001: time = DBL_MAX;  break; // end-of-run ones last
+		default:
+			if((header->fEventId & 0xffff) < 0x8000)
+				fLast = fOwner->GetEventTime(header, &event[0] + hsize);
+			time = fLast; // messages stay next to the event before them
+			break;
+		}
+		return kTRUE;
+	}
+};
+}
+
+
 rb::MidasBuffer* rb::MidasBuffer::fgInstance = 0;
 
 
@@ -20,8 +62,19 @@ rb::MidasBuffer::MidasBuffer(ULong_t size, Int_t trpStart, Int_t trpStop, Int_t
 	fIsConnected(false),
 	fBufferSize(size),
 	fIsTruncated(false),
+	fLazySwap(false),
+	fSwapPending(false),
 	fFile(0),
-	fType(MidasBuffer::NONE)
+	fType(MidasBuffer::NONE),
+	fSkim(0),
+	fSkimFilter(0),
+	fSkimIds(),
+	fSkimPrescale(1),
+	fSkimNselected(0),
+	fMerger(0),
+	fMergeEvent(),
+	fMergeWindow(0.),
+	fMergeDepth(10000)
 {
 	/*!
 	 * \param size Size of the internal buffer in bytes. This should be larger than the
@@ -40,6 +93,9 @@ rb::MidasBuffer::MidasBuffer(ULong_t size, Int_t trpStart, Int_t trpStop, Int_t
 
 rb::MidasBuffer::~MidasBuffer()
 {
+	CloseSkim();
+	delete fSkimFilter;
+	delete fMerger;
 	if(fgInstance) {
 		delete[] fBuffer;
 		fgInstance = 0;
@@ -57,10 +113,12 @@ Bool_t rb::MidasBuffer::ReadBufferOffline()
 	 * Reads event data into fBuffer
 	 * \todo Could be made more efficient (no copy)??
 	 */
+	if(fMerger) return ReadBufferMerged();
 	assert(fFile);
 	rb::TMidasEvent temp;
 	TMidasFile* pFile = (TMidasFile*)fFile;
-	Bool_t have_event = pFile->Read(&temp);
+	Bool_t have_event = pFile->Read(&temp, !fLazySwap);
+	fSwapPending = have_event && temp.IsSwapPending();
 
 	if(have_event) {
 		memcpy (fBuffer, temp.GetEventHeader(), sizeof(rb::TMidas_EVENT_HEADER));
@@ -79,23 +137,177 @@ Bool_t rb::MidasBuffer::ReadBufferOffline()
 	return have_event;
 }
 
+Bool_t rb::MidasBuffer::ReadBufferMerged()
+{
+	/*! Copies the next event in time order from fMerger into fBuffer */
+	if(!fMerger->Next(fMergeEvent)) return false;
+	fSwapPending = false; // the streams convert whole events
+	ULong_t size = fMergeEvent.size();
+	if(size > fBufferSize) {
+		rb::TMidas_EVENT_HEADER* pHeader = reinterpret_cast<rb::TMidas_EVENT_HEADER*>(&fMergeEvent[0]);
+		err::Warning("rb::MidasBuffer::ReadBufferOffline")
+			<< "Received a truncated event: event size = " << size
+			<< ", max size = " << fBufferSize << " (Id, serial = "
+			<< pHeader->fEventId << ", " << pHeader->fSerialNumber << ")";
+		fIsTruncated = true;
+		size = fBufferSize;
+	}
+	memcpy(fBuffer, &fMergeEvent[0], size);
+	return true;
+}
+
+Double_t rb::MidasBuffer::GetEventTime(void* header, char*)
+{
+	return reinterpret_cast<rb::TMidas_EVENT_HEADER*>(header)->fTimeStamp;
+}
+
+void rb::MidasBuffer::SetMergeWindow(Double_t window, Int_t depth)
+{
+	/*! Takes effect for the next files opened */
+	fMergeWindow = window;
+	fMergeDepth = depth;
+}
+
+ULong64_t rb::MidasBuffer::GetMergeNlate() const
+{
+	return fMerger ? fMerger->GetNlate() : 0;
+}
+
 Bool_t rb::MidasBuffer::UnpackBuffer()
 {
 	/*!
-	 * Compose a TMidasEvent and then let the user handle it.
+	 * Index the banks (see GetBanks()) and then let the user handle the event.
 	 */
 	rb::TMidas_EVENT_HEADER* pHeader = reinterpret_cast<rb::TMidas_EVENT_HEADER*>(fBuffer);
 	char* pEvent = fBuffer + sizeof(rb::TMidas_EVENT_HEADER);
-	return UnpackEvent(pHeader, pEvent);
+	if((pHeader->fEventId & 0xffff) < 0x8000) {
+		// Don't index past the end of fBuffer for truncated events
+		ULong_t size = std::min<ULong_t>(pHeader->fDataSize, fBufferSize - sizeof(rb::TMidas_EVENT_HEADER));
+		fBanks.Set(pEvent, size, fSwapPending);
+	}
+	else fBanks.Clear();
+	Bool_t unpacked = UnpackEvent(pHeader, pEvent);
+	if(fSkim) Skim(unpacked);
+	return unpacked;
+}
+
+Bool_t rb::MidasBuffer::OpenSkim(const char* filename, UInt_t prescale)
+{
+	/*! \returns false if the file can't be created */
+	CloseSkim();
+	MidasWriter* skim = new MidasWriter();
+	if(!skim->Open(filename)) {
+		err::Error("rb::MidasBuffer::OpenSkim")
+			<< "Couldn't open \"" << filename << "\": " << skim->GetError();
+		delete skim;
+		return false;
+	}
+	fSkim = skim;
+	fSkimPrescale = prescale ? prescale : 1;
+	fSkimNselected = 0;
+	err::Info("rb::MidasBuffer::OpenSkim") << "Skimming raw events to \"" << filename << "\"";
+	return true;
+}
+
+void rb::MidasBuffer::AddSkimEventId(Int_t id)
+{
+	if(std::find(fSkimIds.begin(), fSkimIds.end(), id) == fSkimIds.end())
+		fSkimIds.push_back(id);
+}
+
+Bool_t rb::MidasBuffer::SetSkimFilter(const char* formula, Int_t event_code)
+{
+	/*! \returns false (leaving the filter unchanged) if _formula_ isn't valid for _event_code_ */
+	if(!formula || !strcmp(formula, "")) {
+		delete fSkimFilter;
+		fSkimFilter = 0;
+		return true;
+	}
+	rb::Event* event = rb::Rint::gApp()->GetEvent(event_code);
+	if(!event) {
+		err::Error("rb::MidasBuffer::SetSkimFilter") << "Invalid event code: " << event_code;
+		return false;
+	}
+	DataFormula* filter = rb::Event::InitFormula::Operate(event, formula);
+	if(!filter || filter->IsZombie()) {
+		err::Error("rb::MidasBuffer::SetSkimFilter") << "Invalid filter: \"" << formula << "\"";
+		delete filter;
+		return false;
+	}
+	delete fSkimFilter;
+	fSkimFilter = filter;
+	return true;
+}
+
+void rb::MidasBuffer::CloseSkim()
+{
+	if(!fSkim) return;
+	fSkim->Close();
+	if(!fSkim->GetError().empty())
+		err::Error("rb::MidasBuffer::CloseSkim")
+			<< "Writing \"" << fSkim->GetFilename() << "\" failed: " << fSkim->GetError();
+	else
+		err::Info("rb::MidasBuffer::CloseSkim")
+			<< "Wrote " << fSkim->GetNevents() << " events (" << fSkim->GetNbytes()
+			<< " bytes) to \"" << fSkim->GetFilename() << "\"";
+	delete fSkim;
+	fSkim = 0;
+}
+
+void rb::MidasBuffer::Skim(Bool_t unpacked)
+{
+	/*!
+	 * Called after UnpackEvent(): selects the event in fBuffer by id, filter and prescale and
+	 * queues it for writing. Bank data left in the wrong byte order (SetLazySwap()) is converted
+	 * first, since the bank headers already have been.
+	 */
+	rb::TMidas_EVENT_HEADER* pHeader = reinterpret_cast<rb::TMidas_EVENT_HEADER*>(fBuffer);
+	if(pHeader->fDataSize + sizeof(rb::TMidas_EVENT_HEADER) > fBufferSize) return; // truncated
+
+	if((pHeader->fEventId & 0xffff) < 0x8000) { // transitions are always kept
+		if(!unpacked) return;
+		if(!fSkimIds.empty() &&
+			 std::find(fSkimIds.begin(), fSkimIds.end(), Int_t(pHeader->fEventId)) == fSkimIds.end()) return;
+		if(fSkimFilter && !fSkimFilter->Evaluate()) return;
+		if(fSkimNselected++ % fSkimPrescale) return;
+	}
+	if(fSwapPending) fBanks.SwapAll();
+	if(!fSkim->Write(pHeader, fBuffer + sizeof(rb::TMidas_EVENT_HEADER))) {
+		err::Error("rb::MidasBuffer::Skim")
+			<< "Writing \"" << fSkim->GetFilename() << "\" failed: " << fSkim->GetError()
+			<< "; closing the skim";
+		CloseSkim();
+	}
 }
 
 Bool_t rb::MidasBuffer::OpenFile(const char* file_name, char** other, int nother)
 {
 	/*!
 	 * Open MIDAS file w/ TMidasFile::Open(), call run start transition handler.
+	 * If _other_ holds more file names, all of them are read at once and merged in the
+	 * order of GetEventTime() (see SetMergeWindow()).
 	 */
 	fType = MidasBuffer::OFFLINE;
 	RunStartTransition(0);
+	if(nother > 0) {
+		Merger* merger = new Merger(fMergeWindow, fMergeDepth);
+		for(int i = -1; i< nother; ++i) {
+			const char* name = i < 0 ? file_name : other[i];
+			MidasStream* stream = new MidasStream(this);
+			merger->AddStream(stream);
+			if(!stream->Open(name)) {
+				err::Error("rb::MidasBuffer::OpenFile") << "Couldn't open \"" << name << "\" for merging";
+				delete merger;
+				fType = MidasBuffer::NONE;
+				return false;
+			}
+		}
+		fMerger = merger;
+		err::Info("rb::MidasBuffer::OpenFile")
+			<< "Merging " << merger->GetNstreams() << " MIDAS files in time order (window = "
+			<< fMergeWindow << ")";
+		return true;
+	}
 	TMidasFile* f = new TMidasFile();
 	bool status = f->Open(file_name);
 	if (status == kTRUE) {
@@ -111,6 +323,20 @@ Bool_t rb::MidasBuffer::OpenFile(const char* file_name, char** other, int nother
 void rb::MidasBuffer::CloseFile()
 {
 	/*! Close file, do run stop transition */
+	if(fMerger) {
+		err::Info("rb::MidasBuffer::CloseFile")
+			<< "Merged " << fMerger->GetNmerged() << " events from " << fMerger->GetNstreams() << " files";
+		if(fMerger->GetNlate())
+			err::Warning("rb::MidasBuffer::CloseFile")
+				<< fMerger->GetNlate() << " events were out of time order: "
+				<< "a larger window (SetMergeWindow()) may be needed";
+		delete fMerger;
+		fMerger = 0;
+		std::vector<char>().swap(fMergeEvent);
+		RunStopTransition(0);
+		fType = MidasBuffer::NONE;
+		return;
+	}
 	TMidasFile* pFile = (TMidasFile*)fFile;
 	err::Info("rb::MidasBuffer::CloseFile")
 		<< "Closing MIDAS file: \"" << pFile->GetFilename() << "\"";
@@ -122,6 +348,48 @@ void rb::MidasBuffer::CloseFile()
 	fType = MidasBuffer::NONE;
 }
 
+Long64_t rb::MidasBuffer::GetFileOffset()
+{
+	/*! \returns Uncompressed byte offset of the next event in the file, -1 if no file is open */
+	TMidasFile* pFile = (TMidasFile*)fFile;
+	return pFile ? pFile->Tell() : -1;
+}
+
+Bool_t rb::MidasBuffer::SetFileOffset(Long64_t offset)
+{
+	/*! Move to _offset_, which should come from GetFileOffset() on the same file. */
+	TMidasFile* pFile = (TMidasFile*)fFile;
+	if(!pFile) return kFALSE;
+	if(!pFile->Seek(offset)) {
+		err::Error("rb::MidasBuffer::SetFileOffset")
+			<< "Couldn't move to offset " << offset << " in \"" << pFile->GetFilename()
+			<< "\": " << pFile->GetLastError();
+		return kFALSE;
+	}
+	return kTRUE;
+}
+
+Long64_t rb::MidasBuffer::GetBufferSize()
+{
+	/*! \returns Size (header + data) of the event in fBuffer, 0 if no source is attached */
+	if(fType == MidasBuffer::NONE) return 0;
+	rb::TMidas_EVENT_HEADER* pHeader = reinterpret_cast<rb::TMidas_EVENT_HEADER*>(fBuffer);
+	return pHeader->fDataSize + sizeof(rb::TMidas_EVENT_HEADER);
+}
+
+Double_t rb::MidasBuffer::GetLag()
+{
+	/*!
+	 * \returns Seconds between the time stamp of the event in fBuffer and now, for online data
+	 * only (the time stamps in an offline file are always "late"). MIDAS time stamps have one
+	 * second resolution.
+	 */
+	if(fType != MidasBuffer::ONLINE) return -1;
+	rb::TMidas_EVENT_HEADER* pHeader = reinterpret_cast<rb::TMidas_EVENT_HEADER*>(fBuffer);
+	if(pHeader->fTimeStamp == 0) return -1;
+	return difftime(time(0), time_t(pHeader->fTimeStamp));
+}
+
 void rb::MidasBuffer::SetTransitionPriorities(Int_t prStart, Int_t prStop,
 																							Int_t prPause, Int_t prResume)
 {
@@ -247,6 +515,7 @@ Bool_t rb::MidasBuffer::ReadBufferOnline()
 	bool have_event = false;
 	const int timeout = 0;
 	INT size = fBufferSize, status;
+	fSwapPending = false; // online events are always in our byte order
 
 	/// - Check status of client w/ cm_yield()
 	status = cm_yield(timeout);
@@ -289,6 +558,15 @@ Bool_t rb::MidasBuffer::ReadBufferOnline()
 	return false;
 }
 
+Long64_t rb::MidasBuffer::GetBacklog()
+{
+	/*! \returns Bytes waiting in the "SYSTEM" shared memory buffer, -1 if not online */
+	if(fType != MidasBuffer::ONLINE || !fIsConnected) return -1;
+	INT level = 0;
+	if(bm_get_buffer_level(fBufferHandle, &level) != BM_SUCCESS) return -1;
+	return level;
+}
+
 #else // #ifdef MIDASSYS
 
 #define M_NO_MIDASSYS(FUNC) do {																				\
@@ -313,6 +591,11 @@ Bool_t rb::MidasBuffer::ReadBufferOnline()
 	return false;
 }
 
+Long64_t rb::MidasBuffer::GetBacklog()
+{
+	return -1;
+}
+
 #endif
 
 rb::MidasBuffer* rb::MidasBuffer::Instance()
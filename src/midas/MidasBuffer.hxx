@@ -3,7 +3,9 @@
 /// \brief Generic implementation of rb::BufferSource for MIDAS experiments.
 #ifndef DRAGON_RB_MIDASBUFFER_HXX
 #define DRAGON_RB_MIDASBUFFER_HXX
+#include <vector>
 #include "Buffer.hxx"
+#include "MidasBanks.hxx"
 
 #ifdef MIDASSYS
 #include <midas.h>
@@ -12,6 +14,10 @@
 
 namespace rb {
 
+class MidasWriter;
+class DataFormula;
+class Merger;
+
 class MidasBuffer: public rb::BufferSource
 {
 public:
@@ -43,6 +49,15 @@ protected:
 	/// Flag for truncated MIDAS events
 	Bool_t fIsTruncated;
 
+	/// Directory of the banks of the event in fBuffer
+	MidasBanks fBanks;
+
+	/// Leave foreign-endian bank data for fBanks to convert on lookup?
+	Bool_t fLazySwap;
+
+	/// Is the bank data in fBuffer still in the wrong byte order?
+	Bool_t fSwapPending;
+
 	/// Transition handler priorities
 	Int_t fTransitionPriorities[4];
 	
@@ -52,6 +67,33 @@ protected:
 	/// Type code (online or offline)
 	Int_t fType;
 
+	/// Output of the raw-event skim (0 if not skimming)
+	MidasWriter* fSkim;
+
+	/// Skim filter (0 to keep all selected events)
+	DataFormula* fSkimFilter;
+
+	/// Event ids to skim (empty for all)
+	std::vector<Int_t> fSkimIds;
+
+	/// Keep every fSkimPrescale'th selected event
+	UInt_t fSkimPrescale;
+
+	/// Selected events seen since OpenSkim()
+	ULong64_t fSkimNselected;
+
+	/// Time-ordered merge of several offline files (0 when reading a single file)
+	Merger* fMerger;
+
+	/// Event handed out by fMerger
+	std::vector<char> fMergeEvent;
+
+	/// Look-ahead window of the merge (see SetMergeWindow())
+	Double_t fMergeWindow;
+
+	/// Maximum events read ahead on one file of the merge
+	Int_t fMergeDepth;
+
 protected:
 	/// Sets fIsTruncated to false, and allocates the internal buffer
 	MidasBuffer(ULong_t size = 1024*1024, Int_t trpStart = 500, Int_t trpStop = 500, Int_t trpPause = 500, Int_t trpResume = 500);
@@ -60,7 +102,7 @@ protected:
 	virtual ~MidasBuffer();
 
 public:
-	/// Opens an offline MIDAS file
+	/// Opens an offline MIDAS file, or several to be merged in time order
 	virtual Bool_t OpenFile(const char* file_name, char** other = 0, int nother = 0);
 
 	/// Connects to an online MIDAS experiment
@@ -81,10 +123,53 @@ public:
 	/// Closes on offline MIDAS file
 	virtual void CloseFile();
 
+	/// Returns the byte offset of the next event in the offline MIDAS file
+	virtual Long64_t GetFileOffset();
+
+	/// Moves to a byte offset in the offline MIDAS file
+	virtual Bool_t SetFileOffset(Long64_t offset);
+
+	/// Returns the size of the event in the internal buffer
+	virtual Long64_t GetBufferSize();
+
+	/// Returns the number of bytes waiting in the online shared memory buffer
+	virtual Long64_t GetBacklog();
+
+	/// Returns the delay between the online event time stamp and now
+	virtual Double_t GetLag();
+
 public:
 	/// Pure virtual function to unpack a midas event
 	virtual Bool_t UnpackEvent(void* header, char* data) = 0;
 
+	/// \brief Banks of the event being unpacked, pointing straight into fBuffer.
+	//! \details Valid during UnpackEvent(); empty for events that have no banks or that
+	//! aren't in native byte order.
+	const MidasBanks& GetBanks() const { return fBanks; }
+
+	/// \brief Convert foreign-endian offline data only for the banks looked up through GetBanks().
+	//! \details Saves swapping banks that are never read. Only for UnpackEvent() implementations that
+	//! get all bank data from GetBanks(): anything read directly from fBuffer may be in the wrong
+	//! byte order.
+	void SetLazySwap(Bool_t lazy) { fLazySwap = lazy; }
+
+	/// \brief Time stamp by which the events of several files are merged (see rb::AttachMerged()).
+	//! \details Called for every event with an id below 0x8000 as it is read ahead, before it is
+	//! unpacked, so GetBanks() doesn't refer to it yet; a MidasBanks can be built from _data_ if
+	//! the time stamp is in a bank. The default is the one second resolution time stamp of the
+	//! event header, which only orders events that are more than a second apart: override it to
+	//! return e.g. the trigger time of the event.
+	virtual Double_t GetEventTime(void* header, char* data);
+
+	/// \brief Set the look-ahead window and read-ahead depth of merged files (see rb::Merger).
+	//! \param window Events are handed out once every file has read past them by this much (in
+	//! the unit of GetEventTime())
+	//! \param depth Maximum number of events read ahead on one file
+	void SetMergeWindow(Double_t window, Int_t depth = 10000);
+
+	/// Events handed out of time order by the current merge (0 if not merging)
+	ULong64_t GetMergeNlate() const;
+
 	/// Virtual run start transition handler
 	virtual void RunStartTransition(Int_t runnum);
 
@@ -97,6 +182,37 @@ public:
 	/// Virtual run resume transition handler
 	virtual void RunResumeTransition(Int_t runnum);
 
+	/// \brief Copy raw events to a new MIDAS file (a "skim") while they are analyzed.
+	//! \details Every event that passes the selection (see AddSkimEventId() and SetSkimFilter()) and
+	//! the prescale is written to _filename_ (compressed if it ends in ".gz") by a background thread.
+	//! Begin-of-run, end-of-run and message events (ids 0x8000 and up), which hold the ODB dumps, are
+	//! always kept. Any previous skim is closed first.
+	//! \code
+	//! rb::MidasBuffer::Instance()->OpenSkim("run123_skim.mid.gz");
+	//! rb::MidasBuffer::Instance()->AddSkimEventId(1);
+	//! rb::MidasBuffer::Instance()->SetSkimFilter("bgo.esort[0] > 100", 1);
+	//! // ... attach files ...
+	//! rb::MidasBuffer::Instance()->CloseSkim();
+	//! \endcode
+	//! \param filename Output file
+	//! \param prescale Keep only every _prescale_'th event that passes the selection
+	Bool_t OpenSkim(const char* filename, UInt_t prescale = 1);
+
+	/// Restrict the skim to events with id _id_ (call more than once for several ids)
+	void AddSkimEventId(Int_t id);
+
+	/// \brief Keep only events for which _formula_ (evaluated on event processor _event_code_) is nonzero.
+	//! \details The formula is evaluated after UnpackEvent(), so it sees the event just processed. With
+	//! more than one event type, also restrict the skim to the ids unpacked by _event_code_. An empty
+	//! _formula_ removes the filter.
+	Bool_t SetSkimFilter(const char* formula, Int_t event_code);
+
+	/// Write out everything still buffered and close the skim file
+	void CloseSkim();
+
+	/// Is a skim file open?
+	Bool_t IsSkimming() const { return fSkim != 0; }
+
 	/// Set transition handler priorities
 	void SetTransitionPriorities(Int_t prStart, Int_t prStop, Int_t prPause, Int_t prResume);
 
@@ -110,6 +226,12 @@ public:
 	static MidasBuffer* Create();
 
 private:
+	/// Write the event in fBuffer to the skim if it is selected
+	void Skim(Bool_t unpacked);
+
+	/// ReadBufferOffline() for merged files
+	Bool_t ReadBufferMerged();
+
 	/// Disallow copy
 	MidasBuffer(const MidasBuffer&) {  }
 
@@ -7,6 +7,7 @@
 #pragma link off all functions; 
 #pragma link C++ nestedclasses; 
 
+#pragma link C++ defined_in ../src/midas/MidasBanks.hxx;
 #pragma link C++ defined_in ../src/midas/MidasBuffer.hxx;
 #pragma link C++ defined_in ../src/midas/TMidasEvent.h;
 #pragma link C++ defined_in ../src/midas/TMidasFile.h;
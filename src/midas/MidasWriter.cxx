@@ -0,0 +1,242 @@
+/// \file MidasWriter.cxx
+/// \author G. Christian
+/// \brief Implements MidasWriter.hxx
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "MidasWriter.hxx"
+
+#ifndef O_LARGEFILE
+#define O_LARGEFILE 0
+#endif
+
+
+namespace {
+/// Does _name_ end in _suffix_?
+bool has_suffix(const std::string& name, const char* suffix) {
+	size_t n = strlen(suffix);
+	return name.size() >= n && name.compare(name.size() - n, n, suffix) == 0;
+}
+
+/// Scoped lock of a pthread mutex
+class Lock {
+	pthread_mutex_t* fMutex;
+public:
+	Lock(pthread_mutex_t* mutex): fMutex(mutex) { pthread_mutex_lock(fMutex); }
+	~Lock() { pthread_mutex_unlock(fMutex); }
+};
+}
+
+
+rb::MidasWriter::MidasWriter():
+	fFd(-1),
+	fGzFile(0),
+	fRunning(false),
+	fFill(0),
+	fNqueued(0),
+	fMaxQueued(0),
+	fStop(false),
+	fNevents(0),
+	fNbytes(0)
+{
+	pthread_mutex_init(&fMutex, 0);
+	pthread_cond_init(&fQueued, 0);
+	pthread_cond_init(&fWritten, 0);
+}
+
+rb::MidasWriter::~MidasWriter()
+{
+	Close();
+	for(size_t i=0; i< fFree.size(); ++i) delete fFree[i];
+	pthread_cond_destroy(&fWritten);
+	pthread_cond_destroy(&fQueued);
+	pthread_mutex_destroy(&fMutex);
+}
+
+bool rb::MidasWriter::Open(const char* filename, size_t maxBuffered)
+{
+	/*!
+	 * \returns false if the file can't be created (see GetError()), or if it should be
+	 * compressed but zlib support isn't compiled in.
+	 */
+	Close();
+	fFilename = filename;
+	fError = "";
+	fNevents = fNbytes = 0;
+	fMaxQueued = maxBuffered > kBlockSize ? maxBuffered : kBlockSize;
+
+	bool compress = has_suffix(fFilename, ".gz");
+#ifndef HAVE_ZLIB
+	if(compress) {
+		fError = "rootbeer was built without zlib (HAVE_ZLIB), can't write compressed files";
+		return false;
+	}
+#endif
+	fFd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_LARGEFILE, 0644);
+	if(fFd < 0) {
+		fError = strerror(errno);
+		return false;
+	}
+#ifdef HAVE_ZLIB
+	if(compress) {
+		gzFile gz = gzdopen(fFd, "wb1"); // fast compression: the thread has to keep up
+		if(!gz) {
+			fError = "zlib gzdopen() error";
+			close(fFd);
+			fFd = -1;
+			return false;
+		}
+		fGzFile = new gzFile(gz);
+	}
+#endif
+
+	fStop = false;
+	if(pthread_create(&fThread, 0, Run, this) != 0) {
+		fError = "Couldn't start the writer thread";
+		Close();
+		return false;
+	}
+	fRunning = true;
+	return true;
+}
+
+void rb::MidasWriter::Close()
+{
+	if(fRunning) {
+		Flush();
+		{
+			Lock lock(&fMutex);
+			fStop = true;
+			pthread_cond_signal(&fQueued);
+		}
+		pthread_join(fThread, 0);
+		fRunning = false;
+	}
+#ifdef HAVE_ZLIB
+	if(fGzFile) {
+		gzFile* gz = static_cast<gzFile*>(fGzFile);
+		gzclose(*gz); // also closes fFd
+		delete gz;
+		fGzFile = 0;
+		fFd = -1;
+	}
+#endif
+	if(fFd >= 0) close(fFd);
+	fFd = -1;
+	delete fFill;
+	fFill = 0;
+}
+
+bool rb::MidasWriter::Write(const TMidas_EVENT_HEADER* header, const char* data)
+{
+	/*!
+	 * Blocks only if the thread is more than the buffer limit behind.
+	 * \returns false if no file is open or a previous write failed.
+	 */
+	if(!fRunning) return false;
+	if(!fFill) {
+		Lock lock(&fMutex);
+		if(!fError.empty()) return false;
+		if(fFree.empty()) fFill = new std::vector<char>();
+		else { fFill = fFree.back(); fFree.pop_back(); }
+		fFill->clear();
+		fFill->reserve(kBlockSize);
+	}
+	fFill->insert(fFill->end(), reinterpret_cast<const char*>(header), reinterpret_cast<const char*>(header + 1));
+	fFill->insert(fFill->end(), data, data + header->fDataSize);
+	++fNevents;
+	if(fFill->size() >= kBlockSize) Flush();
+	return true;
+}
+
+void rb::MidasWriter::Flush()
+{
+	if(!fFill) return;
+	Lock lock(&fMutex);
+	while(fNqueued > fMaxQueued && fError.empty())
+		pthread_cond_wait(&fWritten, &fMutex);
+	fNqueued += fFill->size();
+	fQueue.push_back(fFill);
+	fFill = 0;
+	pthread_cond_signal(&fQueued);
+}
+
+void* rb::MidasWriter::Run(void* writer)
+{
+	static_cast<MidasWriter*>(writer)->Loop();
+	return 0;
+}
+
+void rb::MidasWriter::Loop()
+{
+	Lock lock(&fMutex);
+	while(1) {
+		while(fQueue.empty() && !fStop) pthread_cond_wait(&fQueued, &fMutex);
+		if(fQueue.empty()) break; // stopped and drained
+		std::vector<char>* block = fQueue.front();
+		fQueue.pop_front();
+		bool ok = true;
+		if(fError.empty()) { // after an error, just drain the queue
+			pthread_mutex_unlock(&fMutex);
+			ok = WriteBlock(*block);
+			pthread_mutex_lock(&fMutex);
+		}
+		if(ok && fError.empty()) fNbytes += block->size();
+		fNqueued -= block->size();
+		fFree.push_back(block);
+		pthread_cond_signal(&fWritten);
+	}
+}
+
+bool rb::MidasWriter::WriteBlock(const std::vector<char>& block)
+{
+	/*! Runs on the writer thread, without holding fMutex. */
+	const char* p = &block[0];
+	size_t left = block.size();
+	while(left) {
+		int n;
+#ifdef HAVE_ZLIB
+		if(fGzFile) {
+			n = gzwrite(*static_cast<gzFile*>(fGzFile), p, left);
+			if(n <= 0) {
+				Lock lock(&fMutex);
+				fError = "zlib gzwrite() error";
+				return false;
+			}
+		}
+		else
+#endif
+		{
+			n = write(fFd, p, left);
+			if(n < 0 && errno == EINTR) continue;
+			if(n < 0) {
+				Lock lock(&fMutex);
+				fError = strerror(errno);
+				return false;
+			}
+		}
+		p += n;
+		left -= n;
+	}
+	return true;
+}
+
+std::string rb::MidasWriter::GetError()
+{
+	Lock lock(&fMutex);
+	return fError;
+}
+
+uint64_t rb::MidasWriter::GetNbytes()
+{
+	Lock lock(&fMutex);
+	return fNbytes;
+}
@@ -0,0 +1,104 @@
+/// \file MidasWriter.hxx
+/// \author G. Christian
+/// \brief Writes raw MIDAS events to a new file from a background thread.
+#ifndef DRAGON_RB_MIDASWRITER_HXX
+#define DRAGON_RB_MIDASWRITER_HXX
+#ifndef __MAKECINT__
+#include <deque>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <pthread.h>
+#include "TMidasStructs.h"
+
+
+namespace rb {
+
+/// \brief Buffered writer of MIDAS events (.mid, or .mid.gz when built with HAVE_ZLIB).
+//! \details Write() only copies the event into a memory block; full blocks are handed to a
+//! thread that writes (and compresses) them, so the analysis never waits on the disk unless
+//! more than the buffer limit given to Open() is waiting to be written.
+class MidasWriter
+{
+private:
+	/// Size of the blocks handed to the writer thread
+	static const size_t kBlockSize = 1024*1024;
+
+	/// Output file descriptor
+	int fFd;
+	/// zlib stream (gzFile*), 0 for uncompressed output
+	void* fGzFile;
+	/// Name of the output file
+	std::string fFilename;
+	/// Writer thread
+	pthread_t fThread;
+	/// Is the thread running?
+	bool fRunning;
+	/// Guards everything below
+	pthread_mutex_t fMutex;
+	/// Signalled when a block is queued or the writer should stop
+	pthread_cond_t fQueued;
+	/// Signalled when a block has been written
+	pthread_cond_t fWritten;
+	/// Block being filled by Write() (only touched by the caller's thread)
+	std::vector<char>* fFill;
+	/// Blocks waiting for the thread
+	std::deque<std::vector<char>*> fQueue;
+	/// Written blocks, for reuse
+	std::vector<std::vector<char>*> fFree;
+	/// Bytes in fQueue
+	size_t fNqueued;
+	/// Limit of fNqueued before Write() waits
+	size_t fMaxQueued;
+	/// Should the thread stop once fQueue is empty?
+	bool fStop;
+	/// Last write error ("" if none)
+	std::string fError;
+	/// Events passed to Write()
+	uint64_t fNevents;
+	/// Bytes written to the file (before compression)
+	uint64_t fNbytes;
+
+	/// Queue fFill for writing
+	void Flush();
+	/// Thread body: write blocks until told to stop
+	void Loop();
+	/// Write one block; false on error
+	bool WriteBlock(const std::vector<char>& block);
+	/// pthread entry point
+	static void* Run(void* writer);
+	/// Disallow copy
+	MidasWriter(const MidasWriter&);
+	/// Disallow assign
+	MidasWriter& operator= (const MidasWriter&);
+
+public:
+	/// Closed
+	MidasWriter();
+	/// Calls Close()
+	~MidasWriter();
+	/// \brief Create _filename_ and start the writer thread.
+	//! \param filename Output file; compressed if it ends in ".gz"
+	//! \param maxBuffered Bytes that may wait for the thread before Write() blocks
+	bool Open(const char* filename, size_t maxBuffered = 64*1024*1024);
+	/// Write everything still buffered, stop the thread and close the file
+	void Close();
+	/// Is a file open?
+	bool IsOpen() const { return fRunning; }
+	/// Queue a copy of one event (_header_ followed by header->fDataSize bytes at _data_)
+	bool Write(const TMidas_EVENT_HEADER* header, const char* data);
+	/// Name of the output file
+	const std::string& GetFilename() const { return fFilename; }
+	/// Last write error ("" if none)
+	std::string GetError();
+	/// Events written so far
+	uint64_t GetNevents() const { return fNevents; }
+	/// Bytes written so far (uncompressed)
+	uint64_t GetNbytes();
+};
+
+} // namespace rb
+
+
+#endif // #ifndef __MAKECINT__
+#endif
@@ -11,6 +11,7 @@
 #include <assert.h>
 
 #include "TMidasEvent.h"
+#include "ByteSwap.hxx"
 
 using namespace rb;
 
@@ -21,6 +22,8 @@ TMidasEvent::TMidasEvent()
 
   fBanksN = 0;
   fBankList = NULL;
+  fHaveBanks = false;
+  fSwapPending = false;
 
   fEventHeader.fEventId      = 0;
   fEventHeader.fTriggerMask  = 0;
@@ -31,6 +34,7 @@ TMidasEvent::TMidasEvent()
 
 void TMidasEvent::Copy(const TMidasEvent& rhs)
 {
+  rhs.FinishSwap();
   fEventHeader = rhs.fEventHeader;
 
   fData        = (char*)malloc(fEventHeader.fDataSize);
@@ -39,8 +43,12 @@ void TMidasEvent::Copy(const TMidasEvent& rhs)
   fAllocatedByUs = true;
 
   fBanksN      = rhs.fBanksN;
-  fBankList    = strdup(rhs.fBankList);
-  assert(fBankList);
+  fBankList    = rhs.fBankList ? strdup(rhs.fBankList) : NULL;
+  assert(fBankList || !rhs.fBankList);
+
+  fBanks.Clear(); // points into rhs.fData
+  fHaveBanks   = false;
+  fSwapPending = false;
 }
 
 TMidasEvent::TMidasEvent(const TMidasEvent &rhs)
@@ -74,6 +82,9 @@ void TMidasEvent::Clear()
 
   fAllocatedByUs = false;
   fBanksN = 0;
+  fBanks.Clear();
+  fHaveBanks = false;
+  fSwapPending = false;
 
   fEventHeader.fEventId      = 0;
   fEventHeader.fTriggerMask  = 0;
@@ -90,6 +101,7 @@ void TMidasEvent::SetData(uint32_t size, char* data)
   fData = data;
   fAllocatedByUs = false;
   SwapBytes(false);
+  SetBanks();
 }
 
 uint16_t TMidasEvent::GetEventId() const
@@ -169,6 +181,20 @@ int TMidasEvent::FindBank(const char* name, int *bklen, int *bktype, void **pdat
   /// \returns 1 if bank found, 0 otherwise.
   ///
 
+  const MidasBanks& banks = GetBanks();
+  if (fData && banks.GetEvent() == fData) {
+    const MidasBanks::Bank* bank = banks.Find(name);
+    if (!bank) {
+      *pdata = NULL;
+      return 0;
+    }
+    *pdata = bank->fData;
+    *bklen = bank->fLength;
+    *bktype = bank->fType;
+    return 1;
+  }
+
+  // no directory (data not in native byte order): scan the banks
   const TMidas_BANK_HEADER *pbkh = (const TMidas_BANK_HEADER*)fData; 
   TMidas_BANK *pbk;
   //uint32_t dname;
@@ -334,6 +360,34 @@ const char* TMidasEvent::GetBankList() const
   return fBankList;
 }
 
+const MidasBanks& TMidasEvent::GetBanks() const
+{
+  if (!fHaveBanks)
+    SetBanks();
+  return fBanks;
+}
+
+int TMidasEvent::SetBanks() const
+{
+  /// Index all data banks in one pass, so FindBank() needs a single
+  /// lookup per bank instead of a scan from the start of the event.
+  /// Called by GetBanks() the first time the directory is needed, and by SetData().
+  /// Does nothing while a lazy swap is pending on an existing directory:
+  /// it alone knows which banks FindBank() has swapped already.
+  /// \returns Number of banks, -1 if the data is not a valid bank list.
+  ///
+
+  if (fHaveBanks && fSwapPending)
+    return fBanks.GetNbanks();
+  fHaveBanks = true;
+  if (!fData || (fEventHeader.fEventId & 0xffff) >= 0x8000) // no banks in run transitions
+    {
+      fBanks.Clear();
+      return -1;
+    }
+  return fBanks.Set(fData, fEventHeader.fDataSize, fSwapPending);
+}
+
 int TMidasEvent::SetBankList()
 {
   if (fEventHeader.fEventId <= 0)
@@ -342,6 +396,18 @@ int TMidasEvent::SetBankList()
   if (fBankList)
     return fBanksN;
 
+  const MidasBanks& banks = GetBanks();
+  if (fData && banks.GetEvent() == fData && !banks.IsOverflow())
+    {
+      fBanksN = banks.GetNbanks();
+      fBankList = (char*)malloc(fBanksN*4 + 1);
+      assert(fBankList);
+      for (int i = 0; i < fBanksN; i++)
+	memcpy(fBankList+i*4, &banks.At(i).fName, 4);
+      fBankList[fBanksN*4] = 0;
+      return fBanksN;
+    }
+
   int listSize = 0;
 
   fBanksN = 0;
@@ -458,22 +524,6 @@ int TMidasEvent::IterateBank32(TMidas_BANK32 **pbk, char **pdata) const
 
 typedef uint8_t BYTE;
 
-/// Byte swapping routine.
-///
-#define QWORD_SWAP(x) { BYTE _tmp;       \
-_tmp= *((BYTE *)(x));                    \
-*((BYTE *)(x)) = *(((BYTE *)(x))+7);     \
-*(((BYTE *)(x))+7) = _tmp;               \
-_tmp= *(((BYTE *)(x))+1);                \
-*(((BYTE *)(x))+1) = *(((BYTE *)(x))+6); \
-*(((BYTE *)(x))+6) = _tmp;               \
-_tmp= *(((BYTE *)(x))+2);                \
-*(((BYTE *)(x))+2) = *(((BYTE *)(x))+5); \
-*(((BYTE *)(x))+5) = _tmp;               \
-_tmp= *(((BYTE *)(x))+3);                \
-*(((BYTE *)(x))+3) = *(((BYTE *)(x))+4); \
-*(((BYTE *)(x))+4) = _tmp; }
-
 /// Byte swapping routine.
 ///
 #define DWORD_SWAP(x) { BYTE _tmp;       \
@@ -500,12 +550,20 @@ void TMidasEvent::SwapBytesEventHeader()
   DWORD_SWAP(&fEventHeader.fDataSize);
 }
 
-int TMidasEvent::SwapBytes(bool force)
+int TMidasEvent::SwapBytes(bool force, bool data)
 {
+  /// Convert the bank headers and (if data is "true") the bank data.
+  /// With data "false" the bank data is left for the bank directory to
+  /// convert bank by bank, the first time each is looked up (see GetBanks()),
+  /// so banks that are never read are never swapped.
+  /// \returns 1 if the event was swapped (or cannot be swapped), 0 otherwise.
+  ///
+
   TMidas_BANK_HEADER *pbh;
   TMidas_BANK *pbk;
   TMidas_BANK32 *pbk32;
   void *pdata;
+  uint32_t size;
   uint16_t type;
 
   pbh = (TMidas_BANK_HEADER *) fData;
@@ -532,6 +590,8 @@ int TMidasEvent::SwapBytes(bool force)
   if (dssw > fEventHeader.fDataSize + 100) // swapped data size looks wrong. do not swap.
     return 1;
 
+  fHaveBanks = false; // sizes change below
+
   //
   // swap bank header
   //
@@ -555,11 +615,13 @@ int TMidasEvent::SwapBytes(bool force)
       DWORD_SWAP(&pbk32->fType);
       DWORD_SWAP(&pbk32->fDataSize);
       pdata = pbk32 + 1;
+      size = pbk32->fDataSize;
       type = (uint16_t) pbk32->fType;
     } else {
       WORD_SWAP(&pbk->fType);
       WORD_SWAP(&pbk->fDataSize);
       pdata = pbk + 1;
+      size = pbk->fDataSize;
       type = pbk->fType;
     }
     //
@@ -576,32 +638,25 @@ int TMidasEvent::SwapBytes(bool force)
       pbk32 = (TMidas_BANK32 *) pbk;
     }
 
-    switch (type) {
-    case 4:
-    case 5:
-      while (pdata < pbk) {
-        WORD_SWAP(pdata);
-        pdata = ((char*)pdata) + 2;
-      }
-      break;
-    case 6:
-    case 7:
-    case 8:
-    case 9:
-      while (pdata < pbk) {
-        DWORD_SWAP(pdata);
-        pdata = ((char*)pdata) + 4;
-      }
-      break;
-    case 10:
-      while (pdata < pbk) {
-        QWORD_SWAP(pdata);
-        pdata = ((char*)pdata) + 8;
-      }
-      break;
-    }
+    if (data)
+      SwapBankData(pdata, size, type);
   }
+
+  fSwapPending = !data;
   return 1;
 }
 
+void TMidasEvent::FinishSwap() const
+{
+  /// Convert the bank data left in the wrong byte order by SwapBytes(force, false).
+  /// Needed before using the data other than through FindBank()/GetBanks(),
+  /// e.g. IterateBank() or writing the event out.
+  ///
+
+  if (!fSwapPending)
+    return;
+  GetBanks().SwapAll();
+  fSwapPending = false;
+}
+
 // end
@@ -6,6 +6,7 @@
 #define TMIDASEVENT_H
 
 #include "TMidasStructs.h"
+#include "MidasBanks.hxx"
 
 namespace rb {
 
@@ -45,6 +46,7 @@ class TMidasEvent
   // get data banks
 
   const char* GetBankList() const; ///< return a list of data banks
+  const MidasBanks& GetBanks() const; ///< return the directory of data banks (built on first use)
   int FindBank(const char* bankName, int* bankLength, int* bankType, void **bankPtr) const;
   int LocateBank(const void *unused, const char* bankName, void **bankPtr) const;
 
@@ -61,10 +63,13 @@ class TMidasEvent
   void SetData(uint32_t dataSize, char* dataBuffer); ///< set an externally allocated data buffer
 
   int SetBankList(); ///< create the list of data banks, return number of banks
+  int SetBanks() const; ///< build the directory of data banks (kept while a swap is pending), return number of banks (-1 if invalid)
   bool IsGoodSize() const; ///< validate the event length
 
   void SwapBytesEventHeader(); ///< convert event header between little-endian (Linux-x86) and big endian (MacOS-PPC) 
-  int  SwapBytes(bool); ///< convert event data between little-endian (Linux-x86) and big endian (MacOS-PPC) 
+  int  SwapBytes(bool, bool data = true); ///< convert event data between little-endian (Linux-x86) and big endian (MacOS-PPC) 
+  void FinishSwap() const; ///< convert bank data left unswapped by SwapBytes(force, false)
+  bool IsSwapPending() const { return fSwapPending; } ///< "true" if some bank data may still be in the wrong byte order
 
 protected:
 
@@ -73,6 +78,9 @@ protected:
   int  fBanksN;    ///< number of banks in this event
   char* fBankList; ///< list of bank names in this event
   bool fAllocatedByUs; ///< "true" if we own the data buffer
+  mutable MidasBanks fBanks; ///< directory of the data banks in this event
+  mutable bool fHaveBanks; ///< "true" if fBanks is up to date
+  mutable bool fSwapPending; ///< "true" if the bank data is left for fBanks to swap
 };
 
 }
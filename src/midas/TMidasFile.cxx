@@ -7,6 +7,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <unistd.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -27,6 +28,7 @@ TMidasFile::TMidasFile()
   fGzFile = NULL;
   fPoFile = NULL;
   fLastErrno = 0;
+  fOffset = 0;
 
   fOutFile = -1;
   fOutGzFile = NULL;
@@ -73,6 +75,7 @@ bool TMidasFile::Open(const char *filename)
     Close();
 
   fFilename = filename;
+  fOffset = 0;
 
   std::string pipe;
 
@@ -278,9 +281,11 @@ static int readpipe(int fd, char* buf, int length)
   return count;
 }
 
-bool TMidasFile::Read(TMidasEvent *midasEvent)
+bool TMidasFile::Read(TMidasEvent *midasEvent, bool swapData)
 {
   /// \param [in] midasEvent Pointer to an empty TMidasEvent 
+  /// \param [in] swapData If "false", bank data in the wrong byte order is only
+  /// converted when the bank is looked up (see TMidasEvent::SwapBytes())
   /// \returns "true" for success, "false" for failure, see GetLastError() to see why
 
   midasEvent->Clear();
@@ -309,6 +314,8 @@ bool TMidasFile::Read(TMidasEvent *midasEvent)
       return false;
     }
 
+  fOffset += rd;
+
   if (fDoByteSwap)
     midasEvent->SwapBytesEventHeader();
 
@@ -335,8 +342,71 @@ bool TMidasFile::Read(TMidasEvent *midasEvent)
       return false;
     }
 
-  midasEvent->SwapBytes(false);
+  fOffset += rd;
+
+  midasEvent->SwapBytes(false, swapData); // banks are indexed when first looked up (GetBanks())
+
+  return true;
+}
+
+bool TMidasFile::Seek(long long offset)
+{
+  /// Pipes (and files read through them) can only move forward, by reading and
+  /// discarding data; compressed files are positioned by uncompressed offset.
+  ///
+  /// \param [in] offset Byte offset, as returned by Tell()
+  /// \returns "true" for success, "false" for failure, see GetLastError() to see why
+
+  if (fFile < 0)
+    {
+      fLastErrno = -1;
+      fLastError = "TMidasFile::Seek: No file is open";
+      return false;
+    }
+
+  if (fGzFile)
+    {
+#ifdef HAVE_ZLIB
+      if (gzseek(*(gzFile*)fGzFile, offset, SEEK_SET) != offset)
+        {
+          fLastErrno = -1;
+          fLastError = "zlib gzseek() error";
+          return false;
+        }
+#else
+      assert(!"Cannot get here");
+#endif
+    }
+  else if (fPoFile)
+    {
+      if (offset < fOffset)
+        {
+          fLastErrno = -1;
+          fLastError = "TMidasFile::Seek: Cannot move backwards in a pipe";
+          return false;
+        }
+      char buf[64*1024];
+      while (fOffset < offset)
+        {
+          long long want = offset - fOffset;
+          int rd = readpipe(fFile, buf, want < (long long)sizeof(buf) ? (int)want : (int)sizeof(buf));
+          if (rd <= 0)
+            {
+              fLastErrno = errno;
+              fLastError = rd == 0 ? "EOF" : strerror(errno);
+              return false;
+            }
+          fOffset += rd;
+        }
+    }
+  else if (lseek(fFile, offset, SEEK_SET) != offset)
+    {
+      fLastErrno = errno;
+      fLastError = strerror(errno);
+      return false;
+    }
 
+  fOffset = offset;
   return true;
 }
 
@@ -344,6 +414,8 @@ bool TMidasFile::Write(TMidasEvent *midasEvent)
 {
   int wr = -2;
 
+  midasEvent->FinishSwap();
+
   if (fOutGzFile)
 #ifdef HAVE_ZLIB
     wr = gzwrite(*(gzFile*)fOutGzFile, (char*)midasEvent->GetEventHeader(), sizeof(TMidas_EVENT_HEADER));
@@ -387,6 +459,7 @@ void TMidasFile::Close()
     close(fFile);
   fFile = -1;
   fFilename = "";
+  fOffset = 0;
 }
 
 void TMidasFile::OutClose()
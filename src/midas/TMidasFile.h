@@ -25,9 +25,12 @@ public:
   void Close(); ///< Close input file
   void OutClose(); ///< Close output file
 
-  bool Read(TMidasEvent *event); ///< Read one event from the file
+  bool Read(TMidasEvent *event, bool swapData = true); ///< Read one event from the file
   bool Write(TMidasEvent *event); ///< Write one event to the output file
 
+  long long Tell() const { return fOffset; } ///< Byte offset (uncompressed) of the next event in the input file
+  bool Seek(long long offset); ///< Move to a byte offset (as returned by Tell()) in the input file
+
   const char* GetFilename()  const { return fFilename.c_str();  } ///< Get the name of this file
   int         GetLastErrno() const { return fLastErrno; }         ///< Get error value for the last file error
   const char* GetLastError() const { return fLastError.c_str(); } ///< Get error text for the last file error
@@ -42,6 +45,8 @@ protected:
 
   bool fDoByteSwap; ///< "true" if file has to be byteswapped
 
+  long long   fOffset; ///< bytes read from the input file so far
+
   int         fFile; ///< open input file descriptor
   void*       fGzFile; ///< zlib compressed input file reader
   void*       fPoFile; ///< popen() input file reader
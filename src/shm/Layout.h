@@ -0,0 +1,114 @@
+//! \file Layout.h
+//! \brief Layout of the shared-memory histogram segment.
+//! \details Shared between the publisher in rootbeer (rb::shm::Server) and the stand-alone reader
+//! library (rb::shm::Reader), so it uses only fixed-width types and depends on nothing from ROOT.
+//!
+//! The segment is a Header, followed by Header::fNentries Entry structs (the directory), followed by
+//! the bin arrays. Each bin array is Entry::fNcells doubles, including underflow and overflow, in the
+//! same order as TH1::GetBin(). Two seqlocks keep readers consistent without ever blocking the writer:
+//! Header::fLayoutSeq covers the directory and Entry::fSeq covers one bin array. Each is odd while the
+//! writer is changing what it covers; a reader copies what it needs and retries if the counter was odd
+//! or changed in the meantime. The segment only ever grows, so a reader's mapping stays valid until it
+//! notices Header::fSize has grown and remaps.
+#ifndef RB_SHM_LAYOUT_H
+#define RB_SHM_LAYOUT_H
+#include <stdint.h>
+#include <string.h>
+
+namespace rb
+{
+namespace shm
+{
+/// Identifies a rootbeer histogram segment
+const char kMagic[8] = "RBSHM01";
+
+/// Layout version
+const uint32_t kVersion = 1;
+
+/// Maximum length of a histogram path (directory/name) including the terminating null
+const uint32_t kNameLength = 128;
+
+/// Maximum length of a histogram title including the terminating null
+const uint32_t kTitleLength = 128;
+
+/// Segment header
+struct Header {
+	/// kMagic
+	char fMagic[8];
+	/// kVersion
+	uint32_t fVersion;
+	/// Number of directory entries
+	uint32_t fNentries;
+	/// Number of bytes in use (readers remap if this is larger than their mapping)
+	uint64_t fSize;
+	/// Directory seqlock, odd while the directory is being rewritten
+	volatile uint64_t fLayoutSeq;
+	/// Number of publishing passes made by the writer
+	volatile uint64_t fPublished;
+	/// Process id of the writer, 0 once it has stopped publishing
+	int32_t fPid;
+	/// Padding (keeps the entries 8-byte aligned)
+	uint32_t fReserved;
+};
+
+/// Directory entry for one histogram
+struct Entry {
+	/// Bin seqlock, odd while the bins are being copied
+	volatile uint64_t fSeq;
+	/// Fill generation of the published contents (see rb::hist::Base::GetGeneration())
+	uint64_t fGeneration;
+	/// Offset of the bin array from the start of the segment
+	uint64_t fOffset;
+	/// Number of bins, including underflow and overflow
+	uint64_t fNcells;
+	/// Number of entries
+	double fEntries;
+	/// Lower edge of each axis
+	double fLow[3];
+	/// Upper edge of each axis
+	double fHigh[3];
+	/// Number of bins on each axis (excluding underflow and overflow), 1 for unused axes
+	int32_t fNbins[3];
+	/// Number of dimensions
+	uint32_t fDimensions;
+	/// Path of the histogram, e.g. "dir/subdir/name"
+	char fName[kNameLength];
+	/// Histogram title
+	char fTitle[kTitleLength];
+};
+
+/// Number of bins, including underflow and overflow, of a histogram with _dimensions_ axes of _nbins_ bins
+inline uint64_t NumCells(uint32_t dimensions, const int32_t* nbins) {
+	uint64_t n = 1;
+	for(uint32_t i=0; i< dimensions && i< 3; ++i) n *= uint64_t(nbins[i] + 2);
+	return n;
+}
+
+/// Full memory barrier (orders the seqlock counter against the data it protects)
+inline void Barrier() { __sync_synchronize(); }
+
+/// Directory of a mapped segment
+inline Entry* GetEntries(Header* header) {
+	return reinterpret_cast<Entry*>(header + 1);
+}
+
+/// Bin array of an entry in a mapped segment
+inline double* GetBins(Header* header, Entry* entry) {
+	return reinterpret_cast<double*>(reinterpret_cast<char*>(header) + entry->fOffset);
+}
+
+/// Does _header_ start a segment this code understands?
+inline bool IsValid(const Header* header) {
+	return memcmp(header->fMagic, kMagic, sizeof(kMagic)) == 0 && header->fVersion == kVersion;
+}
+
+/// Is _name_ a POSIX shared memory name ("/name", no further slashes) rather than a file path?
+inline bool IsShmName(const char* name) {
+	return name[0] == '/' && strchr(name + 1, '/') == 0;
+}
+
+} // namespace shm
+} // namespace rb
+
+
+#endif
@@ -0,0 +1,196 @@
+//! \file Reader.cxx
+//! \brief Implements Reader.hxx
+#include <cerrno>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "shm/Layout.h"
+#include "shm/Reader.hxx"
+
+
+namespace {
+/// Times to retry a copy the writer interfered with before giving up
+const int kMaxAttempts = 1000;
+
+/// Wait a little for the writer to finish
+inline void backoff(int attempt) {
+	if(attempt > 10) usleep(100);
+}
+
+/// Project a 2d histogram onto _axis_ (0 = x, 1 = y), summing the other axis over bins _first_ to _last_
+rb::shm::Histogram project(const rb::shm::Histogram& h, int axis, int first, int last) {
+	if(h.fDimensions != 2) throw std::invalid_argument("rb::shm::Histogram: can only project 2d histograms");
+	const int other = 1 - axis;
+	if(last < 0 || last > h.fNbins[other] + 1) last = h.fNbins[other];
+	if(first < 0) first = 0;
+	rb::shm::Histogram out;
+	out.fName = h.fName + (axis == 0 ? "_px" : "_py");
+	out.fTitle = h.fTitle;
+	out.fDimensions = 1;
+	out.fNbins[0] = h.fNbins[axis];
+	out.fLow[0] = h.fLow[axis];
+	out.fHigh[0] = h.fHigh[axis];
+	out.fGeneration = h.fGeneration;
+	out.fBins.assign(h.fNbins[axis] + 2, 0.);
+	for(int i=0; i< h.fNbins[axis] + 2; ++i) {
+		for(int j=first; j<= last; ++j)
+			out.fBins[i] += axis == 0 ? h.GetBinContent(i, j) : h.GetBinContent(j, i);
+		out.fEntries += out.fBins[i];
+	}
+	return out;
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::shm::Histogram                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::shm::Histogram::Histogram():
+	fName(), fTitle(), fDimensions(0), fEntries(0), fGeneration(0), fBins()
+{
+	for(int i=0; i< 3; ++i) { fNbins[i] = 1; fLow[i] = 0; fHigh[i] = 1; }
+}
+
+size_t rb::shm::Histogram::GetBin(int x, int y, int z) const {
+	size_t nx = fNbins[0] + 2;
+	size_t ny = fDimensions > 1 ? fNbins[1] + 2 : 1;
+	return x + nx * (y + ny * z);
+}
+
+double rb::shm::Histogram::GetBinLowEdge(int bin, int axis) const {
+	return fLow[axis] + (bin - 1) * (fHigh[axis] - fLow[axis]) / fNbins[axis];
+}
+
+rb::shm::Histogram rb::shm::Histogram::ProjectionX(int first, int last) const {
+	return project(*this, 0, first, last);
+}
+
+rb::shm::Histogram rb::shm::Histogram::ProjectionY(int first, int last) const {
+	return project(*this, 1, first, last);
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::shm::Reader                                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::shm::Reader::Reader(): fName(), fFd(-1), fHeader(0), fMapped(0) { }
+
+rb::shm::Reader::~Reader() {
+	Close();
+}
+
+bool rb::shm::Reader::Open(const char* name) {
+	Close();
+	fName = name;
+	fFd = IsShmName(name) ? shm_open(name, O_RDONLY, 0) : open(name, O_RDONLY);
+	if(fFd < 0) return false;
+	struct stat st;
+	if(fstat(fFd, &st) < 0 || size_t(st.st_size) < sizeof(Header)) { Close(); return false; }
+	void* addr = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fFd, 0);
+	if(addr == MAP_FAILED) { Close(); return false; }
+	fHeader = static_cast<Header*>(addr);
+	fMapped = st.st_size;
+	if(!IsValid(fHeader)) { Close(); return false; }
+	return true;
+}
+
+void rb::shm::Reader::Close() {
+	if(fHeader) munmap(fHeader, fMapped);
+	if(fFd >= 0) close(fFd);
+	fHeader = 0;
+	fMapped = 0;
+	fFd = -1;
+}
+
+bool rb::shm::Reader::Remap() {
+	if(fHeader->fSize <= fMapped) return true;
+	struct stat st;
+	if(fstat(fFd, &st) < 0 || size_t(st.st_size) < fHeader->fSize) return false;
+	void* addr = mmap(0, st.st_size, PROT_READ, MAP_SHARED, fFd, 0);
+	if(addr == MAP_FAILED) return false;
+	munmap(fHeader, fMapped);
+	fHeader = static_cast<Header*>(addr);
+	fMapped = st.st_size;
+	return true;
+}
+
+bool rb::shm::Reader::IsLive() const {
+	if(!fHeader || fHeader->fPid == 0) return false;
+	return kill(fHeader->fPid, 0) == 0 || errno == EPERM;
+}
+
+uint64_t rb::shm::Reader::GetPublished() const {
+	return fHeader ? fHeader->fPublished : 0;
+}
+
+bool rb::shm::Reader::List(std::vector<std::string>& names) {
+	if(!fHeader) return false;
+	for(int attempt = 0; attempt < kMaxAttempts; ++attempt, backoff(attempt)) {
+		uint64_t seq = fHeader->fLayoutSeq;
+		if(seq & 1) continue;
+		Barrier();
+		if(!Remap()) return false;
+		uint32_t n = fHeader->fNentries;
+		if(sizeof(Header) + n * sizeof(Entry) > fMapped) continue;
+		std::vector<std::string> out;
+		Entry* entries = GetEntries(fHeader);
+		for(uint32_t i=0; i< n; ++i)
+			out.push_back(std::string(entries[i].fName, strnlen(entries[i].fName, kNameLength)));
+		Barrier();
+		if(fHeader->fLayoutSeq != seq) continue;
+		names.swap(out);
+		return true;
+	}
+	return false;
+}
+
+bool rb::shm::Reader::Get(const char* name, Histogram& out) {
+	if(!fHeader) return false;
+	for(int attempt = 0; attempt < kMaxAttempts; ++attempt, backoff(attempt)) {
+		uint64_t layout = fHeader->fLayoutSeq;
+		if(layout & 1) continue;
+		Barrier();
+		if(!Remap()) return false;
+		uint32_t n = fHeader->fNentries;
+		if(sizeof(Header) + n * sizeof(Entry) > fMapped) continue;
+		Entry* entries = GetEntries(fHeader);
+		Entry* entry = 0;
+		for(uint32_t i=0; i< n && !entry; ++i)
+			if(strncmp(entries[i].fName, name, kNameLength) == 0) entry = entries + i;
+		if(!entry) {
+			Barrier();
+			if(fHeader->fLayoutSeq != layout) continue;
+			return false;
+		}
+
+		uint64_t seq = entry->fSeq;
+		if(seq & 1) continue;
+		Barrier();
+		if(entry->fOffset + entry->fNcells * sizeof(double) > fMapped) continue;
+		Histogram h;
+		h.fName.assign(entry->fName, strnlen(entry->fName, kNameLength));
+		h.fTitle.assign(entry->fTitle, strnlen(entry->fTitle, kTitleLength));
+		h.fDimensions = entry->fDimensions;
+		for(int i=0; i< 3; ++i) {
+			h.fNbins[i] = entry->fNbins[i];
+			h.fLow[i] = entry->fLow[i];
+			h.fHigh[i] = entry->fHigh[i];
+		}
+		h.fEntries = entry->fEntries;
+		h.fGeneration = entry->fGeneration;
+		const double* bins = GetBins(fHeader, entry);
+		h.fBins.assign(bins, bins + entry->fNcells);
+		Barrier();
+		if(entry->fSeq != seq || fHeader->fLayoutSeq != layout) continue;
+		std::swap(out, h);
+		return true;
+	}
+	return false;
+}
@@ -0,0 +1,106 @@
+//! \file Reader.hxx
+//! \brief Stand-alone reader for histograms published by rb::shm::Server.
+//! \details Does not depend on ROOT or on the rest of rootbeer, so it can be linked into any viewer
+//! (librbShm.so). Readers never block the publishing process: they copy what they need from the
+//! segment and retry if the writer changed it in the meantime.
+//! \code
+//! rb::shm::Reader reader;
+//! if(reader.Open("/rootbeer")) {
+//! 	rb::shm::Histogram h;
+//! 	if(reader.Get("bgo/e0", h)) std::cout << h.GetBinContent(100) << "\n";
+//! }
+//! \endcode
+#ifndef RB_SHM_READER_HXX
+#define RB_SHM_READER_HXX
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace rb
+{
+namespace shm
+{
+struct Header;
+
+/// Copy of one published histogram
+struct Histogram {
+	/// Path, e.g. "dir/subdir/name"
+	std::string fName;
+	/// Title
+	std::string fTitle;
+	/// Number of dimensions (1-3)
+	unsigned fDimensions;
+	/// Number of bins on each axis (excluding underflow and overflow)
+	int fNbins[3];
+	/// Lower edge of each axis
+	double fLow[3];
+	/// Upper edge of each axis
+	double fHigh[3];
+	/// Number of entries
+	double fEntries;
+	/// Fill generation (changes whenever the contents change)
+	uint64_t fGeneration;
+	/// Bin contents including underflow and overflow, ordered as TH1::GetBin()
+	std::vector<double> fBins;
+
+	/// Zeros everything
+	Histogram();
+	/// Global bin number of bin (x, y, z), as TH1::GetBin()
+	size_t GetBin(int x, int y = 0, int z = 0) const;
+	/// Content of bin (x, y, z) (0 is underflow, nbins+1 overflow)
+	double GetBinContent(int x, int y = 0, int z = 0) const { return fBins.at(GetBin(x, y, z)); }
+	/// Low edge of bin _bin_ on axis _axis_ (0 = x, 1 = y, 2 = z)
+	double GetBinLowEdge(int bin, int axis = 0) const;
+	/// Project a 2d histogram onto x, summing y bins _first_ to _last_ (-1 means the last bin)
+	Histogram ProjectionX(int first = 1, int last = -1) const;
+	/// Project a 2d histogram onto y, summing x bins _first_ to _last_ (-1 means the last bin)
+	Histogram ProjectionY(int first = 1, int last = -1) const;
+};
+
+/// Maps a histogram segment read-only and copies histograms out of it.
+class Reader
+{
+private:
+	/// Segment name
+	std::string fName;
+	/// File descriptor
+	int fFd;
+	/// Mapped segment
+	Header* fHeader;
+	/// Size of the mapping
+	size_t fMapped;
+
+	/// Remap if the segment has grown past the current mapping
+	bool Remap();
+	/// Disallow copy
+	Reader(const Reader&);
+	/// Disallow assign
+	Reader& operator= (const Reader&);
+
+public:
+	/// Nothing open
+	Reader();
+	/// Calls Close()
+	~Reader();
+	/// Open the segment _name_ ("/name" for POSIX shared memory, otherwise a file path)
+	bool Open(const char* name);
+	/// Unmap and close
+	void Close();
+	/// Is a segment open?
+	bool IsOpen() const { return fHeader != 0; }
+	/// Is the process that publishes to the segment still running?
+	bool IsLive() const;
+	/// Number of publishing passes so far (changes each time the writer updates the segment)
+	uint64_t GetPublished() const;
+	/// Get the paths of all published histograms
+	bool List(std::vector<std::string>& names);
+	/// Copy the histogram _name_ into _out_; returns false if there isn't one (or no consistent copy could be made)
+	bool Get(const char* name, Histogram& out);
+};
+
+} // namespace shm
+} // namespace rb
+
+
+#endif
@@ -0,0 +1,215 @@
+//! \file Server.cxx
+//! \brief Implements Server.hxx
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hist/Hist.hxx"
+#include "utils/Error.hxx"
+#include "Rint.hxx"
+#include "shm/Layout.h"
+#include "shm/Server.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions and Classes                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace {
+/// Initial size of the segment
+const size_t kInitialSize = 1024*1024;
+
+/// Copy _src_ into the fixed-length field _dest_, truncating if needed
+void copy_string(char* dest, const char* src, size_t length) {
+	strncpy(dest, src, length - 1);
+	dest[length - 1] = '\0';
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::shm::Server                                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+rb::shm::Server* rb::shm::Server::fgInstance = 0;
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::shm::Server::Server(const char* name, Long_t interval):
+	rb::Timer(interval), fName(name), fFd(-1), fHeader(0), fMapped(0), fSlots()
+{
+	if(IsShmName(name)) fFd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	else fFd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if(fFd < 0) {
+		err::Error("rb::shm::Server") << "Couldn't open \"" << name << "\": " << strerror(errno);
+		return;
+	}
+	if(!Reserve(kInitialSize)) return;
+	memcpy(fHeader->fMagic, kMagic, sizeof(kMagic));
+	fHeader->fVersion = kVersion;
+	fHeader->fNentries = 0;
+	fHeader->fSize = sizeof(Header);
+	fHeader->fLayoutSeq = 0;
+	fHeader->fPublished = 0;
+	fHeader->fPid = getpid();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::shm::Server::~Server() {
+	TurnOff();
+	if(fHeader) {
+		fHeader->fPid = 0;
+		munmap(fHeader, fMapped);
+	}
+	if(fFd >= 0) {
+		close(fFd);
+		if(IsShmName(fName.c_str())) shm_unlink(fName.c_str());
+	}
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::shm::Server::Reserve()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::shm::Server::Reserve(size_t size) {
+	/*!
+	 * The segment is only ever grown (at least doubling), never shrunk, so that pages a reader
+	 * has mapped always stay backed.
+	 */
+	if(size <= fMapped) return kTRUE;
+	size_t newsize = fMapped ? fMapped : kInitialSize;
+	while(newsize < size) newsize *= 2;
+	if(ftruncate(fFd, newsize) < 0) {
+		err::Error("rb::shm::Server::Reserve")
+			<< "Couldn't grow \"" << fName << "\" to " << newsize << " bytes: " << strerror(errno);
+		return kFALSE;
+	}
+	void* addr = mmap(0, newsize, PROT_READ | PROT_WRITE, MAP_SHARED, fFd, 0);
+	if(addr == MAP_FAILED) {
+		err::Error("rb::shm::Server::Reserve") << "Couldn't map \"" << fName << "\": " << strerror(errno);
+		return kFALSE;
+	}
+	if(fHeader) munmap(fHeader, fMapped);
+	fHeader = static_cast<Header*>(addr);
+	fMapped = newsize;
+	return kTRUE;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::shm::Server::Layout()                      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::shm::Server::Layout(std::vector<Slot>& slots) {
+	size_t size = sizeof(Header) + slots.size() * sizeof(Entry);
+	for(size_t i=0; i< slots.size(); ++i)
+		size += NumCells(slots[i].fDimensions, slots[i].fNbins) * sizeof(double);
+	if(!Reserve(size)) return kFALSE;
+
+	++fHeader->fLayoutSeq;
+	Barrier();
+	Entry* entries = GetEntries(fHeader);
+	uint64_t offset = sizeof(Header) + slots.size() * sizeof(Entry);
+	for(size_t i=0; i< slots.size(); ++i) {
+		Entry& entry = entries[i];
+		Int_t nbins[3];
+		Double_t low[3], high[3];
+		slots[i].fHist->GetAxes(nbins, low, high);
+		entry.fSeq = 0;
+		entry.fGeneration = 0;
+		entry.fOffset = offset;
+		entry.fNcells = NumCells(slots[i].fDimensions, slots[i].fNbins);
+		entry.fEntries = 0;
+		for(Int_t j=0; j< 3; ++j) {
+			entry.fNbins[j] = nbins[j];
+			entry.fLow[j] = low[j];
+			entry.fHigh[j] = high[j];
+		}
+		entry.fDimensions = slots[i].fDimensions;
+		copy_string(entry.fName, slots[i].fName.c_str(), kNameLength);
+		copy_string(entry.fTitle, slots[i].fHist->GetTitle(), kTitleLength);
+		offset += entry.fNcells * sizeof(double);
+		slots[i].fGeneration = ~ULong64_t(0); // force a copy of the contents
+	}
+	fHeader->fNentries = slots.size();
+	fHeader->fSize = size;
+	Barrier();
+	++fHeader->fLayoutSeq;
+	fSlots.swap(slots);
+	return kTRUE;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::shm::Server::Publish()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::shm::Server::Publish() {
+	if(!fHeader) return;
+
+	std::vector<rb::hist::Base*> hists;
+	rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it)
+		rb::Rint::gApp()->GetEvent(it->first)->GetHistManager()->GetAll(hists);
+
+	// Rewrite the directory if histograms were added, removed, renamed or rebinned
+	std::vector<Slot> slots(hists.size());
+	Bool_t changed = hists.size() != fSlots.size();
+	for(size_t i=0; i< hists.size(); ++i) {
+		Slot& slot = slots[i];
+		Double_t low[3], high[3];
+		slot.fHist = hists[i];
+		slot.fName = hists[i]->GetPath();
+		slot.fDimensions = hists[i]->GetNdimensions();
+		hists[i]->GetAxes(slot.fNbins, low, high);
+		slot.fGeneration = changed ? 0 : fSlots[i].fGeneration;
+		if(!changed) {
+			const Slot& old = fSlots[i];
+			changed = old.fHist != slot.fHist || old.fName != slot.fName || old.fDimensions != slot.fDimensions ||
+				old.fNbins[0] != slot.fNbins[0] || old.fNbins[1] != slot.fNbins[1] || old.fNbins[2] != slot.fNbins[2];
+		}
+	}
+	if(changed && !Layout(slots)) return;
+
+	// Copy the contents of histograms filled or cleared since the last pass
+	Entry* entries = GetEntries(fHeader);
+	for(size_t i=0; i< fSlots.size(); ++i) {
+		ULong64_t generation = fSlots[i].fHist->GetGeneration();
+		if(generation == fSlots[i].fGeneration) continue;
+		Entry& entry = entries[i];
+		++entry.fSeq;
+		Barrier();
+		fSlots[i].fHist->CopyBins(GetBins(fHeader, &entry));
+		entry.fEntries = fSlots[i].fHist->GetEntries();
+		entry.fGeneration = generation;
+		Barrier();
+		++entry.fSeq;
+		fSlots[i].fGeneration = generation;
+	}
+	++fHeader->fPublished;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::shm::Server::Start() [static]              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::shm::Server::Start(const char* name, Long_t interval) {
+	Stop();
+	Server* server = new Server(name, interval > 0 ? interval : 1000);
+	if(!server->fHeader) {
+		delete server;
+		return kFALSE;
+	}
+	fgInstance = server;
+	fgInstance->Publish();
+	fgInstance->TurnOn();
+	err::Info("rb::shm::Server::Start") << "Publishing histograms to \"" << name << "\"";
+	return kTRUE;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::shm::Server::Stop() [static]                 //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::shm::Server::Stop() {
+	delete fgInstance;
+	fgInstance = 0;
+}
@@ -0,0 +1,73 @@
+//! \file Server.hxx
+//! \brief Publishes histograms to shared memory for external viewers.
+//! \details See Layout.h for the segment layout and Reader.hxx for the reading side.
+#ifndef RB_SHM_SERVER_HXX
+#define RB_SHM_SERVER_HXX
+#include <string>
+#include <vector>
+#include <Rtypes.h>
+#include "utils/Timer.hxx"
+
+namespace rb
+{
+namespace hist { class Base; }
+
+namespace shm
+{
+struct Header;
+
+/// \brief Copies histograms into a shared-memory segment (or memory-mapped file) at a fixed interval.
+//! \details Runs as a timer on the main thread, so it never races with filling. Only histograms whose
+//! fill generation changed since the last pass are copied, each under its own seqlock, so readers in
+//! other processes see consistent spectra without taking any lock the analysis could wait on.
+class Server: public rb::Timer
+{
+private:
+	/// What is published in one directory entry
+	struct Slot {
+		rb::hist::Base* fHist;
+		std::string fName;
+		UInt_t fDimensions;
+		Int_t fNbins[3];
+		ULong64_t fGeneration;
+	};
+	/// Segment name ("/name" for POSIX shared memory, otherwise a file path)
+	std::string fName;
+	/// File descriptor of the segment
+	int fFd;
+	/// Mapped segment
+	Header* fHeader;
+	/// Size of the mapping in bytes
+	size_t fMapped;
+	/// Histograms in directory order
+	std::vector<Slot> fSlots;
+	/// The running server, if any
+	static Server* fgInstance;
+
+	/// Open (creating) the segment
+	Server(const char* name, Long_t interval);
+	/// Mark the segment stopped, unmap it, and remove it if it is POSIX shared memory
+	~Server();
+	/// Grow the segment to at least _size_ bytes and remap
+	Bool_t Reserve(size_t size);
+	/// Rewrite the directory for the histograms in _slots_
+	Bool_t Layout(std::vector<Slot>& slots);
+	/// Copy the histograms that changed into the segment
+	void Publish();
+	/// Called by the timer
+	void DoAction() { Publish(); }
+
+public:
+	/// Start publishing to _name_ every _interval_ milliseconds (stops any running server first)
+	static Bool_t Start(const char* name, Long_t interval);
+	/// Stop publishing
+	static void Stop();
+	/// Is a server running?
+	static Bool_t IsRunning() { return fgInstance != 0; }
+};
+
+} // namespace shm
+} // namespace rb
+
+
+#endif
@@ -0,0 +1,111 @@
+//! \file rbshm.cxx
+//! \brief Command-line viewer for histograms published with rb::StartHistServer().
+//! \details Usage:
+//! \code
+//! rbshm <segment>                       # list the published histograms
+//! rbshm <segment> <histogram> [x|y]     # print the bins (or the x/y projection of a 2d histogram)
+//! rbshm -s <endpoint> [<histogram> [ms]] # list, or follow a histogram from rb::StartHistStream()
+//! \endcode
+//! Bins are printed one per line as "low_edge[ low_edge[ low_edge]] content", ready for gnuplot.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "shm/Reader.hxx"
+#include "stream/Client.hxx"
+
+namespace {
+void usage(const char* argv0) {
+	fprintf(stderr, "usage: %s <segment> [<histogram> [x|y]]\n"
+					"       %s -s <endpoint> [<histogram> [ms]]\n", argv0, argv0);
+	exit(1);
+}
+
+void print(const rb::shm::Histogram& h) {
+	printf("# %s: %s (%g entries)\n", h.fName.c_str(), h.fTitle.c_str(), h.fEntries);
+	int nz = h.fDimensions > 2 ? h.fNbins[2] : 1;
+	int ny = h.fDimensions > 1 ? h.fNbins[1] : 1;
+	for(int z = 1; z <= nz; ++z) {
+		for(int y = 1; y <= ny; ++y) {
+			for(int x = 1; x <= h.fNbins[0]; ++x) {
+				printf("%g", h.GetBinLowEdge(x, 0));
+				if(h.fDimensions > 1) printf(" %g", h.GetBinLowEdge(y, 1));
+				if(h.fDimensions > 2) printf(" %g", h.GetBinLowEdge(z, 2));
+				printf(" %g\n", h.GetBinContent(x, h.fDimensions > 1 ? y : 0, h.fDimensions > 2 ? z : 0));
+			}
+			if(h.fDimensions > 1) printf("\n");
+		}
+	}
+}
+
+/// List, or print every update of a streamed histogram
+int follow(const char* argv0, int argc, char** argv) {
+	rb::stream::Client client;
+	if(!client.Connect(argv[0])) {
+		fprintf(stderr, "%s: couldn't connect to \"%s\"\n", argv0, argv[0]);
+		return 1;
+	}
+	if(argc == 1) client.RequestList();
+	else {
+		client.Subscribe(argv[1]);
+		if(argc > 2) client.SetRate(atol(argv[2]));
+	}
+	std::vector<std::string> updated;
+	while(client.Poll(1000, &updated) >= 0) {
+		if(!client.GetError().empty()) {
+			fprintf(stderr, "%s: %s\n", argv0, client.GetError().c_str());
+			return 1;
+		}
+		if(argc == 1 && !client.GetList().empty()) {
+			for(size_t i=0; i< client.GetList().size(); ++i) printf("%s\n", client.GetList()[i].c_str());
+			return 0;
+		}
+		if(!updated.empty() && client.Get(argv[1])) {
+			print(*client.Get(argv[1]));
+			printf("\n\n");
+			fflush(stdout);
+		}
+		updated.clear();
+	}
+	fprintf(stderr, "%s: connection closed\n", argv0);
+	return 1;
+}
+}
+
+int main(int argc, char** argv) {
+	if(argc > 2 && argc < 6 && !strcmp(argv[1], "-s")) return follow(argv[0], argc - 2, argv + 2);
+	if(argc < 2 || argc > 4) usage(argv[0]);
+	rb::shm::Reader reader;
+	if(!reader.Open(argv[1])) {
+		fprintf(stderr, "%s: couldn't open histogram segment \"%s\"\n", argv[0], argv[1]);
+		return 1;
+	}
+	if(!reader.IsLive())
+		fprintf(stderr, "%s: warning: the publishing process has stopped\n", argv[0]);
+
+	if(argc == 2) {
+		std::vector<std::string> names;
+		if(!reader.List(names)) {
+			fprintf(stderr, "%s: couldn't read the histogram directory\n", argv[0]);
+			return 1;
+		}
+		for(size_t i=0; i< names.size(); ++i) printf("%s\n", names[i].c_str());
+		return 0;
+	}
+
+	rb::shm::Histogram h;
+	if(!reader.Get(argv[2], h)) {
+		fprintf(stderr, "%s: no histogram \"%s\" in \"%s\"\n", argv[0], argv[2], argv[1]);
+		return 1;
+	}
+	try {
+		if(argc == 4 && !strcmp(argv[3], "x")) print(h.ProjectionX());
+		else if(argc == 4 && !strcmp(argv[3], "y")) print(h.ProjectionY());
+		else if(argc == 4) usage(argv[0]);
+		else print(h);
+	} catch (std::exception& e) {
+		fprintf(stderr, "%s: %s\n", argv[0], e.what());
+		return 1;
+	}
+	return 0;
+}
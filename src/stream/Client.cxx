@@ -0,0 +1,197 @@
+//! \file Client.cxx
+//! \brief Implements Client.hxx
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "utils/Socket.hxx"
+#include "stream/Protocol.h"
+#include "stream/Client.hxx"
+
+
+namespace {
+/// Open a TCP connection to _host_:_port_
+int connect_tcp(const std::string& host, const std::string& port) {
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	addrinfo* result = 0;
+	if(getaddrinfo(host.c_str(), port.c_str(), &hints, &result) != 0) return -1;
+	int fd = -1;
+	for(addrinfo* ai = result; ai && fd < 0; ai = ai->ai_next) {
+		fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if(fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) < 0) { close(fd); fd = -1; }
+	}
+	freeaddrinfo(result);
+	return fd;
+}
+
+/// Open a connection to the Unix socket at _path_
+int connect_unix(const char* path) {
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	if(strlen(path) >= sizeof(addr.sun_path)) return -1;
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd >= 0 && connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) { close(fd); fd = -1; }
+	return fd;
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::stream::Client                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::stream::Client::Client(): fFd(-1), fIn(), fHists(), fList(), fError(), fNbytes(0) { }
+
+rb::stream::Client::~Client() {
+	Close();
+}
+
+bool rb::stream::Client::Connect(const char* endpoint) {
+	Close();
+	if(rb::net::IsTcp(endpoint)) {
+		const char* colon = strrchr(endpoint, ':');
+		if(colon) fFd = connect_tcp(std::string(endpoint, colon), colon + 1);
+		else fFd = connect_tcp("localhost", endpoint);
+	}
+	else fFd = connect_unix(endpoint);
+	return fFd >= 0;
+}
+
+void rb::stream::Client::Close() {
+	if(fFd >= 0) close(fFd);
+	fFd = -1;
+	fIn.clear();
+	fHists.clear();
+	fList.clear();
+	fNbytes = 0;
+}
+
+bool rb::stream::Client::Send(const std::string& line) {
+	if(fFd < 0) return false;
+	return rb::net::SendAll(fFd, line + "\n");
+}
+
+bool rb::stream::Client::Subscribe(const std::string& path) {
+	return Send("subscribe " + path);
+}
+
+bool rb::stream::Client::Unsubscribe(const std::string& path) {
+	fHists.erase(path);
+	return Send("unsubscribe " + path);
+}
+
+bool rb::stream::Client::SetRate(long ms) {
+	std::stringstream line;
+	line << "rate " << ms;
+	return Send(line.str());
+}
+
+bool rb::stream::Client::RequestList() {
+	return Send("list");
+}
+
+const rb::shm::Histogram* rb::stream::Client::Get(const std::string& path) const {
+	std::map<std::string, rb::shm::Histogram>::const_iterator it = fHists.find(path);
+	return it == fHists.end() ? 0 : &it->second;
+}
+
+bool rb::stream::Client::Decode(unsigned type, const char* payload, size_t length, std::vector<std::string>* updated) {
+	Decoder in(payload, length);
+	switch(type) {
+	case kList: {
+		uint64_t n = in.GetVarint();
+		std::vector<std::string> list;
+		for(uint64_t i=0; in.Good() && i< n; ++i) list.push_back(in.GetString());
+		if(in.Good()) fList.swap(list);
+		break;
+	}
+	case kSnapshot: {
+		rb::shm::Histogram h;
+		h.fName = in.GetString();
+		h.fTitle = in.GetString();
+		h.fDimensions = in.GetByte();
+		for(int i=0; i< 3; ++i) h.fNbins[i] = in.GetVarint();
+		for(int i=0; i< 3; ++i) h.fLow[i] = in.GetDouble();
+		for(int i=0; i< 3; ++i) h.fHigh[i] = in.GetDouble();
+		h.fGeneration = in.GetVarint();
+		h.fEntries = in.GetDouble();
+		uint64_t ncells = in.GetVarint();
+		if(!in.Good() || h.fDimensions < 1 || h.fDimensions > 3) return false;
+		uint64_t expected = 1;
+		for(unsigned i=0; i< h.fDimensions; ++i) expected *= uint64_t(h.fNbins[i]) + 2;
+		if(ncells != expected || ncells > kMaxFrame) return false;
+		h.fBins.assign(ncells, 0.);
+		if(!in.GetBins(h.fBins)) return false;
+		if(updated) updated->push_back(h.fName);
+		std::swap(fHists[h.fName], h);
+		break;
+	}
+	case kDelta: {
+		std::string name = in.GetString();
+		uint64_t generation = in.GetVarint();
+		double entries = in.GetDouble();
+		std::map<std::string, rb::shm::Histogram>::iterator it = fHists.find(name);
+		if(!in.Good()) return false;
+		if(it == fHists.end()) break; // unsubscribed in the meantime
+		if(!in.GetBins(it->second.fBins)) return false;
+		it->second.fGeneration = generation;
+		it->second.fEntries = entries;
+		if(updated) updated->push_back(name);
+		break;
+	}
+	case kRemoved:
+		fHists.erase(in.GetString());
+		break;
+	case kError:
+		fError = in.GetString();
+		break;
+	default: // ignore frames from newer servers
+		return true;
+	}
+	return in.Good();
+}
+
+int rb::stream::Client::Poll(int timeout, std::vector<std::string>* updated) {
+	if(fFd < 0) return -1;
+	pollfd pfd;
+	pfd.fd = fFd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	int ready = poll(&pfd, 1, timeout);
+	if(ready < 0) return errno == EINTR ? 0 : -1;
+	if(ready == 0) return 0;
+
+	char buf[65536];
+	ssize_t n = recv(fFd, buf, sizeof(buf), 0);
+	if(n < 0 && errno == EINTR) return 0;
+	if(n <= 0) { Close(); return -1; }
+	fIn.append(buf, n);
+	fNbytes += n;
+
+	int nupdated = 0;
+	size_t pos = 0;
+	while(fIn.size() - pos >= kFrameHeader) {
+		const unsigned char* head = reinterpret_cast<const unsigned char*>(fIn.data() + pos);
+		uint32_t length = head[0] | (head[1] << 8) | (head[2] << 16) | (uint32_t(head[3]) << 24);
+		if(length > kMaxFrame) { Close(); return -1; }
+		if(fIn.size() - pos - kFrameHeader < length) break;
+		std::vector<std::string> names;
+		if(!Decode(head[4], fIn.data() + pos + kFrameHeader, length, &names)) { Close(); return -1; }
+		nupdated += names.size();
+		if(updated) updated->insert(updated->end(), names.begin(), names.end());
+		pos += kFrameHeader + length;
+	}
+	fIn.erase(0, pos);
+	return nupdated;
+}
@@ -0,0 +1,92 @@
+//! \file Client.hxx
+//! \brief Stand-alone client for the histogram stream served by rb::StartHistStream().
+//! \details Like rb::shm::Reader, it depends on nothing from ROOT and is part of librbShm.so, so a
+//! remote viewer can link it on its own. It keeps a local copy of each subscribed histogram, which
+//! it brings up to date from the deltas the server sends.
+//! \code
+//! rb::stream::Client client;
+//! if(client.Connect("daq.example.org:9102")) {
+//! 	client.Subscribe("bgo/e0");
+//! 	client.SetRate(500);
+//! 	std::vector<std::string> updated;
+//! 	while(client.Poll(1000, &updated) >= 0)
+//! 		if(!updated.empty()) std::cout << client.Get("bgo/e0")->fEntries << "\n";
+//! }
+//! \endcode
+#ifndef RB_STREAM_CLIENT_HXX
+#define RB_STREAM_CLIENT_HXX
+#include <map>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "shm/Reader.hxx"
+
+namespace rb
+{
+namespace stream
+{
+/// Connects to a histogram stream and keeps copies of the subscribed histograms.
+class Client
+{
+private:
+	/// Socket
+	int fFd;
+	/// Received bytes not yet decoded
+	std::string fIn;
+	/// Local copies of the subscribed histograms, by path
+	std::map<std::string, rb::shm::Histogram> fHists;
+	/// Paths from the last list reply
+	std::vector<std::string> fList;
+	/// Last error message from the server
+	std::string fError;
+	/// Bytes received so far
+	uint64_t fNbytes;
+
+	/// Send a command line
+	bool Send(const std::string& line);
+	/// Decode one frame; false if it is malformed
+	bool Decode(unsigned type, const char* payload, size_t length, std::vector<std::string>* updated);
+	/// Disallow copy
+	Client(const Client&);
+	/// Disallow assign
+	Client& operator= (const Client&);
+
+public:
+	/// Not connected
+	Client();
+	/// Calls Close()
+	~Client();
+	/// \brief Connect to _endpoint_.
+	//! \details "host:port" or "port" (on localhost) for TCP, otherwise the path of a Unix socket.
+	bool Connect(const char* endpoint);
+	/// Disconnect and forget all histograms
+	void Close();
+	/// Is the client connected?
+	bool IsConnected() const { return fFd >= 0; }
+	/// Receive a snapshot of _path_ and then its changes
+	bool Subscribe(const std::string& path);
+	/// Stop receiving changes of _path_ (and forget the local copy)
+	bool Unsubscribe(const std::string& path);
+	/// Ask for updates at most every _ms_ milliseconds
+	bool SetRate(long ms);
+	/// Ask for the paths of all histograms (read them with GetList() once Poll() has received them)
+	bool RequestList();
+	/// \brief Wait up to _timeout_ ms for data and apply everything received.
+	//! \returns The number of histograms updated (their paths are added to _updated_ if given), or -1
+	//! if the connection closed or the server sent something malformed.
+	int Poll(int timeout, std::vector<std::string>* updated = 0);
+	/// Local copy of _path_, 0 if none has been received
+	const rb::shm::Histogram* Get(const std::string& path) const;
+	/// Paths from the last list reply
+	const std::vector<std::string>& GetList() const { return fList; }
+	/// Last error message sent by the server
+	const std::string& GetError() const { return fError; }
+	/// Bytes received since connecting
+	uint64_t GetNbytes() const { return fNbytes; }
+};
+
+} // namespace stream
+} // namespace rb
+
+
+#endif
@@ -0,0 +1,199 @@
+//! \file Protocol.h
+//! \brief Wire format of the histogram stream served by rb::stream::Server.
+//! \details Shared between the server in rootbeer and the stand-alone client (rb::stream::Client),
+//! so it depends on nothing from ROOT.
+//!
+//! Clients send text commands, one per line:
+//! \code
+//! list                 # ask for the paths of all histograms
+//! subscribe <path>     # receive a snapshot of <path>, then deltas whenever it changes
+//! unsubscribe <path>
+//! rate <ms>            # send updates at most every <ms> milliseconds (default 1000)
+//! \endcode
+//! The server sends binary frames: a 4-byte little-endian payload length, a 1-byte FrameType and
+//! the payload. Integers in payloads are unsigned LEB128 varints, strings are a varint length and
+//! the bytes, and doubles are 8 little-endian bytes. See the FrameType values for the payloads.
+//!
+//! Bin contents (including underflow and overflow, ordered as TH1::GetBin()) are sent as changes
+//! against what the client already has (all zeros for a snapshot): a varint number of runs, then for
+//! each run a varint count of unchanged bins to skip, a varint count of changed bins, and one value
+//! per changed bin. A value is a varint whose low bit is 0 if the rest is the zigzag-encoded integer
+//! difference from the old content (the common case for counts), or 1 if it is followed by the new
+//! content as a double.
+#ifndef RB_STREAM_PROTOCOL_H
+#define RB_STREAM_PROTOCOL_H
+#include <string>
+#include <vector>
+#include <cmath>
+#include <string.h>
+#include <stdint.h>
+
+namespace rb
+{
+namespace stream
+{
+/// Frames sent by the server
+enum FrameType {
+	/// Payload: varint count, then that many path strings
+	kList = 1,
+	/// Payload: path, title, 1-byte dimensions, 3 varint bin counts, 3 double lower edges,
+	/// 3 double upper edges, varint generation, double entries, varint number of bins, bin changes
+	kSnapshot = 2,
+	/// Payload: path, varint generation, double entries, bin changes
+	kDelta = 3,
+	/// Payload: path (the histogram was deleted; a new snapshot follows if it comes back)
+	kRemoved = 4,
+	/// Payload: message string
+	kError = 5
+};
+
+/// Frames larger than this are treated as corrupt
+const uint32_t kMaxFrame = 256*1024*1024;
+
+/// Length of the frame header (length and type)
+const size_t kFrameHeader = 5;
+
+/// Append _value_ as a varint
+inline void PutVarint(std::string& out, uint64_t value) {
+	while(value >= 0x80) {
+		out += char((value & 0x7f) | 0x80);
+		value >>= 7;
+	}
+	out += char(value);
+}
+
+/// Append _value_ as 8 little-endian bytes
+inline void PutDouble(std::string& out, double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	for(int i=0; i< 8; ++i) out += char((bits >> (8*i)) & 0xff);
+}
+
+/// Append _str_ as a varint length and the bytes
+inline void PutString(std::string& out, const std::string& str) {
+	PutVarint(out, str.size());
+	out += str;
+}
+
+/// Start a frame of type _type_ in _out_; returns the offset to pass to EndFrame()
+inline size_t BeginFrame(std::string& out, FrameType type) {
+	size_t start = out.size();
+	out.append(4, '\0');
+	out += char(type);
+	return start;
+}
+
+/// Fill in the length of the frame started at _start_
+inline void EndFrame(std::string& out, size_t start) {
+	uint32_t length = out.size() - start - kFrameHeader;
+	for(int i=0; i< 4; ++i) out[start + i] = char((length >> (8*i)) & 0xff);
+}
+
+/// \brief Append the changes from _old_ to _now_ (_n_ bins each; _old_ = 0 means all zeros).
+//! \returns The number of changed bins.
+inline size_t PutBins(std::string& out, const double* old, const double* now, size_t n) {
+	std::string runs;
+	size_t nruns = 0, nchanged = 0, last = 0;
+	for(size_t i=0; i< n; ) {
+		if(now[i] == (old ? old[i] : 0.)) { ++i; continue; }
+		size_t first = i;
+		while(i < n && now[i] != (old ? old[i] : 0.)) ++i;
+		PutVarint(runs, first - last);
+		PutVarint(runs, i - first);
+		for(size_t j = first; j < i; ++j) {
+			double before = old ? old[j] : 0.;
+			double diff = now[j] - before;
+			if(diff == floor(diff) && fabs(diff) < 4503599627370496. && before + diff == now[j]) {
+				int64_t d = int64_t(diff);
+				uint64_t zigzag = (uint64_t(d) << 1) ^ uint64_t(d >> 63);
+				PutVarint(runs, zigzag << 1);
+			}
+			else {
+				PutVarint(runs, 1);
+				PutDouble(runs, now[j]);
+			}
+		}
+		nchanged += i - first;
+		last = i;
+		++nruns;
+	}
+	PutVarint(out, nruns);
+	out += runs;
+	return nchanged;
+}
+
+/// Reads the fields of a frame payload, remembering if it ran past the end
+class Decoder
+{
+private:
+	const unsigned char* fPos;
+	const unsigned char* fEnd;
+	bool fGood;
+public:
+	/// Decode _length_ bytes at _data_
+	Decoder(const char* data, size_t length):
+		fPos(reinterpret_cast<const unsigned char*>(data)), fEnd(fPos + length), fGood(true) { }
+	/// Has everything read so far been well formed?
+	bool Good() const { return fGood; }
+	/// Is the whole payload consumed?
+	bool Done() const { return fPos == fEnd; }
+	/// Read a single byte
+	unsigned GetByte() {
+		if(fPos >= fEnd) { fGood = false; return 0; }
+		return *fPos++;
+	}
+	/// Read a varint
+	uint64_t GetVarint() {
+		uint64_t value = 0;
+		for(int shift = 0; shift < 64; shift += 7) {
+			if(fPos >= fEnd) break;
+			unsigned char c = *fPos++;
+			value |= uint64_t(c & 0x7f) << shift;
+			if(!(c & 0x80)) return value;
+		}
+		fGood = false;
+		return 0;
+	}
+	/// Read a double
+	double GetDouble() {
+		if(fEnd - fPos < 8) { fGood = false; fPos = fEnd; return 0; }
+		uint64_t bits = 0;
+		for(int i=0; i< 8; ++i) bits |= uint64_t(*fPos++) << (8*i);
+		double value;
+		memcpy(&value, &bits, sizeof(value));
+		return value;
+	}
+	/// Read a string
+	std::string GetString() {
+		uint64_t length = GetVarint();
+		if(!fGood || length > uint64_t(fEnd - fPos)) { fGood = false; fPos = fEnd; return std::string(); }
+		std::string str(reinterpret_cast<const char*>(fPos), length);
+		fPos += length;
+		return str;
+	}
+	/// Apply bin changes written by PutBins() to _bins_
+	bool GetBins(std::vector<double>& bins) {
+		uint64_t nruns = GetVarint();
+		size_t pos = 0;
+		for(uint64_t r=0; fGood && r< nruns; ++r) {
+			uint64_t skip = GetVarint(), count = GetVarint();
+			if(!fGood || skip > bins.size() - pos || count > bins.size() - pos - skip) { fGood = false; break; }
+			pos += skip;
+			for(uint64_t j=0; fGood && j< count; ++j, ++pos) {
+				uint64_t value = GetVarint();
+				if(value & 1) bins[pos] = GetDouble();
+				else {
+					uint64_t zz = value >> 1;
+					bins[pos] += double(int64_t(zz >> 1) ^ -int64_t(zz & 1));
+				}
+			}
+		}
+		return fGood;
+	}
+};
+
+} // namespace stream
+} // namespace rb
+
+
+#endif
@@ -0,0 +1,307 @@
+//! \file Server.cxx
+//! \brief Implements Server.hxx
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <algorithm>
+#include "hist/Hist.hxx"
+#include "utils/Error.hxx"
+#include "utils/Socket.hxx"
+#include "Rint.hxx"
+#include "stream/Protocol.h"
+#include "stream/Server.hxx"
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Helper Functions and Classes                          //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+namespace {
+/// Poll the sockets every 50 ms
+const Long_t POLL_TIME = 50;
+/// Default milliseconds between updates
+const Long_t kDefaultRate = 1000;
+/// Accept at most this many connections per poll
+const Int_t kMaxConnections = 16;
+/// Don't queue more updates for a client with this many bytes still unsent
+const size_t kMaxPending = 1024*1024;
+/// Drop a client that sends a command longer than this
+const size_t kMaxCommand = 4096;
+
+typedef std::map<std::string, rb::hist::Base*> HistMap_t;
+
+/// Map the path of every histogram to the histogram
+void get_hists(HistMap_t& hists) {
+	std::vector<rb::hist::Base*> all;
+	rb::EventVector_t events = rb::Rint::gApp()->GetEventVector();
+	for(rb::EventVector_t::iterator it = events.begin(); it != events.end(); ++it)
+		rb::Rint::gApp()->GetEvent(it->first)->GetHistManager()->GetAll(all);
+	for(std::vector<rb::hist::Base*>::iterator it = all.begin(); it != all.end(); ++it)
+		hists[(*it)->GetPath()] = *it;
+}
+
+/// Number of bins, including underflow and overflow, of a histogram with _dimensions_ axes of _nbins_ bins
+size_t num_cells(UInt_t dimensions, const Int_t* nbins) {
+	size_t n = 1;
+	for(UInt_t i=0; i< dimensions && i< 3; ++i) n *= nbins[i] + 2;
+	return n;
+}
+
+/// Append an error frame with _message_
+void put_error(std::string& out, const std::string& message) {
+	size_t frame = rb::stream::BeginFrame(out, rb::stream::kError);
+	rb::stream::PutString(out, message);
+	rb::stream::EndFrame(out, frame);
+}
+}
+
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Class                                                 //
+// rb::stream::Server                                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+
+rb::stream::Server* rb::stream::Server::fgInstance = 0;
+
+rb::stream::Server::Subscription::Subscription():
+	fSent(kFALSE), fGeneration(0), fBins()
+{
+	for(Int_t i=0; i< 3; ++i) { fNbins[i] = 1; fLow[i] = 0; fHigh[i] = 1; }
+}
+
+rb::stream::Server::Connection::Connection(int fd):
+	fFd(fd), fIn(), fOut(), fRate(kDefaultRate), fLast(), fSubscriptions() { }
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Constructor                                           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::stream::Server::Server(int sock, const std::string& path):
+	rb::Timer(POLL_TIME), fSocket(sock), fPath(path), fConnections(), fNbytes(0) { }
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Destructor                                            //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+rb::stream::Server::~Server() {
+	TurnOff();
+	for(size_t i=0; i< fConnections.size(); ++i) {
+		close(fConnections[i]->fFd);
+		delete fConnections[i];
+	}
+	close(fSocket);
+	if(!fPath.empty()) unlink(fPath.c_str());
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stream::Server::Command()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stream::Server::Command(Connection* connection, const std::string& line, const HistMap_t& hists) {
+	std::string command, arg;
+	std::stringstream in(line);
+	in >> command;
+	std::getline(in >> std::ws, arg);
+
+	if(command == "list") {
+		size_t frame = BeginFrame(connection->fOut, kList);
+		PutVarint(connection->fOut, hists.size());
+		for(HistMap_t::const_iterator it = hists.begin(); it != hists.end(); ++it)
+			PutString(connection->fOut, it->first);
+		EndFrame(connection->fOut, frame);
+	}
+	else if(command == "subscribe") {
+		if(hists.count(arg)) connection->fSubscriptions[arg];
+		else put_error(connection->fOut, "No histogram \"" + arg + "\"");
+	}
+	else if(command == "unsubscribe") {
+		connection->fSubscriptions.erase(arg);
+	}
+	else if(command == "rate") {
+		Long_t rate = atol(arg.c_str());
+		connection->fRate = rate > POLL_TIME ? rate : POLL_TIME;
+	}
+	else if(!command.empty()) {
+		put_error(connection->fOut, "Unknown command \"" + command + "\"");
+	}
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stream::Server::Update()                     //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stream::Server::Update(Connection* connection, const HistMap_t& hists) {
+	/*!
+	 * Sends a snapshot of each subscribed histogram that is new (or was rebinned), and a delta of
+	 * each one whose fill generation changed since it was last sent.
+	 */
+	std::string& out = connection->fOut;
+	std::vector<Double_t> bins;
+	for(SubscriptionMap_t::iterator it = connection->fSubscriptions.begin(); it != connection->fSubscriptions.end(); ++it) {
+		Subscription& sub = it->second;
+		HistMap_t::const_iterator itHist = hists.find(it->first);
+		if(itHist == hists.end()) {
+			if(sub.fSent) {
+				size_t frame = BeginFrame(out, kRemoved);
+				PutString(out, it->first);
+				EndFrame(out, frame);
+				sub = Subscription();
+			}
+			continue;
+		}
+		rb::hist::Base* hist = itHist->second;
+		ULong64_t generation = hist->GetGeneration();
+		Int_t nbins[3];
+		Double_t low[3], high[3];
+		hist->GetAxes(nbins, low, high);
+		Bool_t rebinned = kFALSE;
+		for(Int_t i=0; i< 3; ++i)
+			rebinned = rebinned || nbins[i] != sub.fNbins[i] || low[i] != sub.fLow[i] || high[i] != sub.fHigh[i];
+
+		if(!sub.fSent || rebinned) {
+			UInt_t dimensions = hist->GetNdimensions();
+			sub.fBins.resize(num_cells(dimensions, nbins));
+			hist->CopyBins(&sub.fBins[0]);
+			size_t frame = BeginFrame(out, kSnapshot);
+			PutString(out, it->first);
+			PutString(out, hist->GetTitle());
+			out += char(dimensions);
+			for(Int_t i=0; i< 3; ++i) PutVarint(out, nbins[i]);
+			for(Int_t i=0; i< 3; ++i) PutDouble(out, low[i]);
+			for(Int_t i=0; i< 3; ++i) PutDouble(out, high[i]);
+			PutVarint(out, generation);
+			PutDouble(out, hist->GetEntries());
+			PutVarint(out, sub.fBins.size());
+			PutBins(out, 0, &sub.fBins[0], sub.fBins.size());
+			EndFrame(out, frame);
+			sub.fSent = kTRUE;
+			sub.fGeneration = generation;
+			std::copy(nbins, nbins + 3, sub.fNbins);
+			std::copy(low, low + 3, sub.fLow);
+			std::copy(high, high + 3, sub.fHigh);
+		}
+		else if(generation != sub.fGeneration) {
+			bins.resize(sub.fBins.size());
+			hist->CopyBins(&bins[0]);
+			size_t frame = BeginFrame(out, kDelta);
+			PutString(out, it->first);
+			PutVarint(out, generation);
+			PutDouble(out, hist->GetEntries());
+			if(PutBins(out, &sub.fBins[0], &bins[0], bins.size())) {
+				EndFrame(out, frame);
+				sub.fBins.swap(bins);
+			}
+			else out.resize(frame); // nothing changed
+			sub.fGeneration = generation;
+		}
+	}
+	connection->fLast = rb::Time();
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::stream::Server::Flush()                    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::stream::Server::Flush(Connection* connection) {
+	size_t sent = 0;
+	while(sent < connection->fOut.size()) {
+		ssize_t n = send(connection->fFd, connection->fOut.data() + sent, connection->fOut.size() - sent, MSG_NOSIGNAL);
+		if(n < 0 && errno == EINTR) continue;
+		if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		if(n <= 0) return kFALSE;
+		sent += n;
+	}
+	connection->fOut.erase(0, sent);
+	fNbytes += sent;
+	return kTRUE;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stream::Server::Poll()                       //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stream::Server::Poll() {
+	for(Int_t i=0; i< kMaxConnections; ++i) {
+		int fd = accept(fSocket, 0, 0);
+		if(fd < 0) break;
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+		fConnections.push_back(new Connection(fd));
+	}
+
+	HistMap_t hists;
+	Bool_t haveHists = kFALSE;
+	rb::Time now;
+	for(std::vector<Connection*>::iterator it = fConnections.begin(); it != fConnections.end(); ) {
+		Connection* connection = *it;
+		Bool_t open = kTRUE;
+		char buf[1024];
+		while(open) {
+			ssize_t n = recv(connection->fFd, buf, sizeof(buf), 0);
+			if(n < 0 && errno == EINTR) continue;
+			if(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			if(n <= 0 || connection->fIn.size() > kMaxCommand) open = kFALSE;
+			else connection->fIn.append(buf, n);
+		}
+
+		size_t nsubscriptions = connection->fSubscriptions.size();
+		size_t newline;
+		while(open && (newline = connection->fIn.find('\n')) != std::string::npos) {
+			std::string line = connection->fIn.substr(0, newline);
+			connection->fIn.erase(0, newline + 1);
+			if(!line.empty() && line[line.size()-1] == '\r') line.erase(line.size()-1);
+			if(!haveHists) { get_hists(hists); haveHists = kTRUE; }
+			Command(connection, line, hists);
+		}
+
+		// Snapshots of new subscriptions go out right away, deltas at the client's rate
+		Bool_t due = connection->fSubscriptions.size() > nsubscriptions ||
+			1e3*(now - connection->fLast) >= connection->fRate;
+		if(open && due && connection->fOut.size() < kMaxPending) {
+			if(!haveHists) { get_hists(hists); haveHists = kTRUE; }
+			Update(connection, hists);
+		}
+
+		if(open) open = Flush(connection);
+		if(open) ++it;
+		else {
+			close(connection->fFd);
+			delete connection;
+			it = fConnections.erase(it);
+		}
+	}
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Bool_t rb::stream::Server::Start() [static]           //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Bool_t rb::stream::Server::Start(const char* endpoint) {
+	Stop();
+	std::string path;
+	int sock = rb::net::Listen(endpoint, path);
+	if(sock < 0) {
+		err::Error("rb::stream::Server::Start")
+			<< "Couldn't listen on \"" << endpoint << "\": " << strerror(errno);
+		return kFALSE;
+	}
+	fgInstance = new Server(sock, path);
+	fgInstance->TurnOn();
+	err::Info("rb::stream::Server::Start")
+		<< "Streaming histograms on " << (rb::net::IsPort(endpoint) ? "127.0.0.1:" : "") << endpoint;
+	return kTRUE;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// void rb::stream::Server::Stop() [static]              //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+void rb::stream::Server::Stop() {
+	delete fgInstance;
+	fgInstance = 0;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// Int_t rb::stream::Server::GetNclients() [static]      //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+Int_t rb::stream::Server::GetNclients() {
+	return fgInstance ? fgInstance->fConnections.size() : 0;
+}
+
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+// ULong64_t rb::stream::Server::GetNbytes() [static]    //
+//\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\//
+ULong64_t rb::stream::Server::GetNbytes() {
+	return fgInstance ? fgInstance->fNbytes : 0;
+}
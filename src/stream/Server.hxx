@@ -0,0 +1,101 @@
+//! \file Server.hxx
+//! \brief Streams histogram contents to remote viewers over a socket.
+//! \details See Protocol.h for the wire format and Client.hxx for the receiving side.
+#ifndef RB_STREAM_SERVER_HXX
+#define RB_STREAM_SERVER_HXX
+#include <map>
+#include <string>
+#include <vector>
+#include <Rtypes.h>
+#include "utils/Timer.hxx"
+
+namespace rb
+{
+namespace hist { class Base; }
+
+namespace stream
+{
+/// \brief Serves snapshots and deltas of subscribed histograms.
+//! \details Runs as a timer on the main thread, like rb::shm::Server, so it never races with filling.
+//! All sockets are non-blocking: a client that can't keep up just receives its next delta later
+//! (against the contents it was last sent), so a slow link never stalls the analysis.
+class Server: public rb::Timer
+{
+private:
+	/// What a client was last sent for one histogram
+	struct Subscription {
+		/// Has a snapshot been sent (since the histogram last appeared)?
+		Bool_t fSent;
+		/// Generation of the contents sent
+		ULong64_t fGeneration;
+		/// Axes sent
+		Int_t fNbins[3];
+		Double_t fLow[3];
+		Double_t fHigh[3];
+		/// Contents sent
+		std::vector<Double_t> fBins;
+		Subscription();
+	};
+	typedef std::map<std::string, Subscription> SubscriptionMap_t;
+
+	/// One connected client
+	struct Connection {
+		/// Socket
+		int fFd;
+		/// Unparsed commands
+		std::string fIn;
+		/// Frames not yet sent
+		std::string fOut;
+		/// Milliseconds between updates
+		Long_t fRate;
+		/// Time of the last update
+		rb::Time fLast;
+		/// Subscribed histograms, by path
+		SubscriptionMap_t fSubscriptions;
+		Connection(int fd);
+	};
+
+	/// Listening socket
+	int fSocket;
+	/// Path of the Unix socket (empty for TCP)
+	std::string fPath;
+	/// Connected clients
+	std::vector<Connection*> fConnections;
+	/// Bytes sent so far
+	ULong64_t fNbytes;
+	/// The running server, if any
+	static Server* fgInstance;
+
+	/// Serve on the listening socket _sock_
+	Server(int sock, const std::string& path);
+	/// Close all connections and the listening socket
+	~Server();
+	/// Handle one command line from _connection_
+	void Command(Connection* connection, const std::string& line, const std::map<std::string, rb::hist::Base*>& hists);
+	/// Append updates of the histograms _connection_ subscribes to
+	void Update(Connection* connection, const std::map<std::string, rb::hist::Base*>& hists);
+	/// Send as much of _connection_'s pending output as the socket takes; false if it has closed
+	Bool_t Flush(Connection* connection);
+	/// Accept connections, read commands and send updates
+	void Poll();
+	/// Called by the timer
+	void DoAction() { Poll(); }
+
+public:
+	/// Start serving on _endpoint_ (stops any running server first)
+	static Bool_t Start(const char* endpoint);
+	/// Stop serving
+	static void Stop();
+	/// Is a server running?
+	static Bool_t IsRunning() { return fgInstance != 0; }
+	/// Number of connected clients
+	static Int_t GetNclients();
+	/// Bytes sent to clients since the server started
+	static ULong64_t GetNbytes();
+};
+
+} // namespace stream
+} // namespace rb
+
+
+#endif
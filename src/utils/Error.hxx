@@ -7,6 +7,7 @@
 #include <string>
 #include <sstream>
 #include <stdexcept>
+#include "Logger.hxx"
 
 
 #define OP__(STRM, CLASS, ARGTYPE) CLASS& operator<< (ARGTYPE arg) {	\
@@ -33,25 +34,17 @@ namespace rb
 {
 namespace err
 {
-  struct Strm
+  /// \brief Message printed to stderr (see Logger.hxx)
+  //! \details Info and errors are printed before the constructing statement ends; warnings are
+  //! queued for the logging thread, and rate limited per _where_.
+  struct Strm: public rb::log::Message
   {
-  protected:
-    typedef std::basic_ostream<char, std::char_traits<char> > CoutType;
-    typedef CoutType& (*StandardEndLine)(CoutType&);
-  public:
-    Strm(const char* what, const char* where) {
-      std::cerr << what << " in <" << where << ">: ";
-    }
-    OPS__(std::cerr, Strm)
-    Strm& operator<<(StandardEndLine manip) {
-        manip(std::cerr);
-        return *this;
-    }
-    virtual ~Strm() { std::endl(std::cerr); }
+    Strm(const char* what, const char* where, int level):
+      rb::log::Message(level, what, where) { }
   };
-  struct Info: public Strm { Info(const char* where) : Strm("Info", where) {} };
-  struct Error: public Strm { Error(const char* where) : Strm("Error", where) {} };
-  struct Warning: public Strm { Warning(const char* where) : Strm("Warning", where) {} };
+  struct Info: public Strm { Info(const char* where) : Strm("Info", where, rb::log::kInfo) {} };
+  struct Error: public Strm { Error(const char* where) : Strm("Error", where, rb::log::kError) {} };
+  struct Warning: public Strm { Warning(const char* where) : Strm("Warning", where, rb::log::kWarning) {} };
 
   struct Throw
   {
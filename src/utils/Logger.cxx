@@ -0,0 +1,343 @@
+//! \file Logger.cxx
+//! \brief Implements Logger.hxx
+#include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+#include <pthread.h>
+#include <iostream>
+#include "Logger.hxx"
+
+
+namespace {
+/// Queued messages (a power of two)
+const unsigned kRingSize = 1024;
+/// Call sites tracked for rate limiting (a power of two)
+const unsigned kNsites = 1024;
+/// Time between writes by the logging thread (microseconds)
+const useconds_t kPeriod = 50000;
+/// Messages allowed from one call site per second, by default
+const int kDefaultRateLimit = 10;
+/// Size of the output buffers
+const size_t kBatchSize = 64*1024;
+
+/// One queued message
+struct Record {
+	/// Position in the queue this slot is waiting for (+1 once the message is written)
+	volatile unsigned fSeq;
+	int fLevel;
+	unsigned fSite;
+	int fSuppressed;
+	int fLength;
+	char fText[rb::log::kTextSize];
+};
+
+/// Rate limit state of a call site
+struct SiteState {
+	/// Key of the site (sites with the same slot replace each other)
+	volatile unsigned fKey;
+	/// Current second
+	volatile time_t fSecond;
+	/// Messages from the site in the current second
+	volatile int fCount;
+	/// Messages dropped since the last one allowed
+	volatile int fSuppressed;
+};
+
+/// Queue, filled by any thread, emptied by the logging thread (or Flush()).
+//! \details Each slot has a sequence number telling whether it is free for position _n_ of the
+//! queue (fSeq == n) or holds the message at position _n_ (fSeq == n + 1). Writers claim a
+//! position by compare-and-swap on gTail, so they never wait for each other or for the writer.
+Record gRing[kRingSize];
+/// Next position to write
+volatile unsigned gTail = 0;
+/// Next position to read (under gDrainMutex)
+unsigned gHead = 0;
+/// Messages lost because the queue was full
+volatile int gDropped = 0;
+
+SiteState gSites[kNsites];
+volatile int gRateLimit = kDefaultRateLimit;
+
+/// Serializes reading the queue and writing the output
+pthread_mutex_t gDrainMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_once_t gOnce = PTHREAD_ONCE_INIT;
+pthread_t gThread;
+/// Tells the logging thread to finish
+volatile bool gStop = false;
+/// No logging thread (anymore), messages are written when posted
+volatile bool gStopped = false;
+/// start() was called
+volatile bool gStarted = false;
+
+/// Debug output file (opened at the first debug message)
+FILE* gDebugFile = 0;
+
+/// Last message written, for collapsing repeats (under gDrainMutex)
+Record gLast;
+/// Repeats of gLast not written yet
+int gRepeats = 0;
+/// Messages suppressed at the site of gLast while it repeated
+int gRepeatSuppressed = 0;
+/// When gLast was written, or its repeats last reported
+time_t gRepeatSince = 0;
+
+/// Output being collected by a drain, for one stream
+class Batch {
+private:
+	FILE* fFile;
+	char fData[kBatchSize];
+	size_t fSize;
+public:
+	Batch(): fFile(0), fSize(0) { }
+	void SetFile(FILE* file) { fFile = file; }
+	void Clear() { fSize = 0; }
+	void Write() {
+		if(fFile && fSize) {
+			fwrite(fData, 1, fSize, fFile);
+			fflush(fFile);
+		}
+		fSize = 0;
+	}
+	void Append(const char* text, size_t length) {
+		if(fSize + length + 1 > kBatchSize) Write();
+		if(length + 1 > kBatchSize) length = kBatchSize - 1;
+		memcpy(fData + fSize, text, length);
+		fSize += length;
+	}
+	void Line(const char* text, size_t length) {
+		Append(text, length);
+		fData[fSize++] = '\n';
+	}
+};
+
+Batch gBatches[2];
+
+/// Batch for messages of _level_
+Batch& batch(int level) {
+	if(level == rb::log::kDebug) {
+		if(!gDebugFile) {
+			gDebugFile = fopen("rbeer.log", "w");
+			gBatches[0].SetFile(gDebugFile);
+		}
+		return gBatches[0];
+	}
+	return gBatches[1];
+}
+
+/// Write the "repeated" line for gLast, if there were repeats
+void write_repeats() {
+	if(gRepeats) {
+		char line[128];
+		int n = gRepeatSuppressed ?
+			snprintf(line, sizeof(line), "last message repeated %d times, %d similar ones suppressed", gRepeats, gRepeatSuppressed) :
+			snprintf(line, sizeof(line), "last message repeated %d times", gRepeats);
+		batch(gLast.fLevel).Line(line, n);
+	}
+	gRepeats = gRepeatSuppressed = 0;
+}
+
+/// Write one message (or count it as a repeat of the last one)
+void write_record(const Record& record) {
+	if(record.fSite == gLast.fSite && record.fLevel == gLast.fLevel &&
+		 record.fLength == gLast.fLength && memcmp(record.fText, gLast.fText, record.fLength) == 0) {
+		++gRepeats;
+		gRepeatSuppressed += record.fSuppressed;
+		return;
+	}
+	write_repeats();
+	Batch& out = batch(record.fLevel);
+	out.Line(record.fText, record.fLength);
+	if(record.fSuppressed) {
+		char line[64];
+		out.Line(line, snprintf(line, sizeof(line), "  (%d similar messages suppressed)", record.fSuppressed));
+	}
+	gLast.fSite = record.fSite;
+	gLast.fLevel = record.fLevel;
+	gLast.fLength = record.fLength;
+	memcpy(gLast.fText, record.fText, record.fLength);
+	gRepeatSince = time(0);
+}
+
+/// Write everything in the queue
+void drain() {
+	pthread_mutex_lock(&gDrainMutex);
+	for(;;) {
+		Record& record = gRing[gHead % kRingSize];
+		if(int(record.fSeq - (gHead + 1)) < 0) break; // empty
+		__sync_synchronize();
+		write_record(record);
+		__sync_synchronize();
+		record.fSeq = gHead + kRingSize;
+		++gHead;
+	}
+	const time_t now = time(0);
+	if(gRepeats && now - gRepeatSince >= 1) {
+		write_repeats();
+		gRepeatSince = now;
+	}
+	const int dropped = __sync_lock_test_and_set(&gDropped, 0);
+	if(dropped) {
+		char line[96];
+		gBatches[1].Line(line, snprintf(line, sizeof(line), "Warning in <rb::log>: %d messages lost (queue full)", dropped));
+	}
+	gBatches[0].Write();
+	gBatches[1].Write();
+	pthread_mutex_unlock(&gDrainMutex);
+}
+
+/// Logging thread
+void* run(void*) {
+	while(!gStop) {
+		usleep(kPeriod);
+		drain();
+	}
+	return 0;
+}
+
+/// Empty the queue
+void reset_queue() {
+	for(unsigned i = 0; i< kRingSize; ++i) gRing[i].fSeq = i;
+	gHead = gTail = 0;
+	gLast.fSite = 0;
+	gLast.fLevel = -1;
+	gRepeats = gRepeatSuppressed = 0;
+}
+
+/// \brief In the child after fork(): write every message when posted.
+//! \details The logging thread isn't copied, and the drain mutex may have been held by it. The
+//! queue is emptied (its messages are the parent's to write).
+void forked_child() {
+	pthread_mutex_init(&gDrainMutex, 0);
+	reset_queue();
+	gBatches[0].Clear();
+	gBatches[1].Clear();
+	gStop = true;
+	gStopped = true;
+}
+
+/// Set up the queue and start the logging thread
+void start() {
+	reset_queue();
+	gBatches[1].SetFile(stderr);
+	gStarted = true;
+	pthread_atfork(0, 0, forked_child);
+	if(pthread_create(&gThread, 0, run, 0) != 0) gStopped = true;
+}
+
+/// Queue a message, false if the queue is full
+bool push(int level, unsigned site, int suppressed, const char* text, int length) {
+	unsigned pos = gTail;
+	Record* record;
+	for(;;) {
+		record = &gRing[pos % kRingSize];
+		const int diff = int(record->fSeq - pos);
+		if(diff == 0) {
+			if(__sync_bool_compare_and_swap(&gTail, pos, pos + 1)) break;
+			pos = gTail;
+		}
+		else if(diff < 0) return false; // slot still holds the message kRingSize positions back
+		else pos = gTail;
+	}
+	record->fLevel = level;
+	record->fSite = site;
+	record->fSuppressed = suppressed;
+	record->fLength = length;
+	memcpy(record->fText, text, length);
+	__sync_synchronize();
+	record->fSeq = pos + 1;
+	return true;
+}
+
+/// Stops the logging thread when the program exits (if rb::log::Stop() wasn't called)
+struct Stopper { ~Stopper() { rb::log::Stop(); } } gStopper;
+}
+
+
+int rb::log::Admit(unsigned site, int* suppressed) {
+	/*!
+	 * Approximate when several threads log from the same site at the same time, or two sites
+	 * share a slot: at worst a few extra messages get through, or a suppressed count is lost.
+	 */
+	SiteState& state = gSites[site % kNsites];
+	const time_t now = time(0);
+	if(state.fKey != site) {
+		state.fKey = site;
+		state.fSuppressed = 0;
+		state.fSecond = 0;
+	}
+	if(state.fSecond != now) {
+		state.fSecond = now;
+		state.fCount = 0;
+	}
+	const int count = __sync_add_and_fetch(&state.fCount, 1);
+	const int limit = gRateLimit;
+	if(limit > 0 && count > limit) {
+		__sync_fetch_and_add(&state.fSuppressed, 1);
+		return 0;
+	}
+	*suppressed = __sync_lock_test_and_set(&state.fSuppressed, 0);
+	return count;
+}
+
+void rb::log::Post(int level, unsigned site, int suppressed, bool first, const char* text, int length) {
+	/*!
+	 * Info messages (mostly replies to commands), errors, the first warning of a call site in a
+	 * second, and everything if the logging thread isn't running are written before returning,
+	 * after what was printed to std::cout. That is at most one write per site and second for
+	 * warnings. Otherwise a full queue drops the message, counting it; the writer never waits
+	 * for the output.
+	 */
+	pthread_once(&gOnce, start);
+	const bool wait = level >= kError || level == kInfo || (first && level > kDebug) || gStopped;
+	if(wait) {
+		std::cout.flush();
+		fflush(stdout);
+	}
+	if(!push(level, site, suppressed, text, length)) {
+		if(!wait) {
+			__sync_fetch_and_add(&gDropped, 1);
+			return;
+		}
+		drain();
+		if(!push(level, site, suppressed, text, length)) __sync_fetch_and_add(&gDropped, 1);
+	}
+	if(wait) drain();
+}
+
+void rb::log::Flush() {
+	pthread_once(&gOnce, start);
+	drain();
+}
+
+void rb::log::Stop() {
+	if(!gStarted) return;
+	if(gStopped) {
+		drain();
+		return;
+	}
+	gStop = true;
+	pthread_join(gThread, 0);
+	gStopped = true;
+	drain();
+
+	pthread_mutex_lock(&gDrainMutex);
+	write_repeats();
+	int suppressed = 0;
+	for(unsigned i = 0; i< kNsites; ++i) suppressed += gSites[i].fSuppressed;
+	if(suppressed) {
+		char line[96];
+		gBatches[1].Line(line, snprintf(line, sizeof(line), "Info in <rb::log>: %d more messages were suppressed", suppressed));
+	}
+	gBatches[0].Write();
+	gBatches[1].Write();
+	pthread_mutex_unlock(&gDrainMutex);
+}
+
+void rb::log::SetRateLimit(int perSecond) {
+	gRateLimit = perSecond > 0 ? perSecond : 0;
+}
+
+int rb::log::GetRateLimit() {
+	return gRateLimit;
+}
@@ -1,75 +1,169 @@
 //! \file Logger.hxx
-//! \brief Defines a very simple class for error message logging.
+//! \brief Asynchronous, rate limited logging of diagnostic messages.
+//! \details Messages are formatted by the thread writing them into a fixed-size record, which is
+//! queued in a lock-free ring buffer; a background thread writes the queued records in batches
+//! (debug messages to "rbeer.log", the rest to stderr). Every call site of a debug message,
+//! warning or error may post at most rb::log::GetRateLimit() messages per second; the others are
+//! only counted (and not even formatted), and reported with the next message from the site that
+//! gets through. Consecutive identical messages are collapsed into "last message repeated N times".
+//! Info messages are neither limited nor queued: they are written at once, in order with std::cout.
+//!
+//! Messages below RB_LOG_LEVEL are compiled out. It defaults to rb::log::kDebug when RB_LOGGING is
+//! defined and to rb::log::kInfo otherwise, so "-DRB_LOG_LEVEL=2" leaves only warnings and errors.
 #ifndef LOGGER_HXX
 #define LOGGER_HXX
+#ifndef __MAKECINT__
+#include <cstdio>
+#include <cstring>
+#include <string>
 #include <iostream>
-#ifndef RB_LOGGING
-#define RB_LOG if(0) std::cerr
+
+#ifndef RB_LOG_LEVEL
+#ifdef RB_LOGGING
+#define RB_LOG_LEVEL 0
 #else
-#include <fstream>
-#include <string>
+#define RB_LOG_LEVEL 1
+#endif
+#endif
 
-#ifndef __MAKECINT__
+namespace rb
+{
+namespace log
+{
+/// Message levels
+enum ELevel { kDebug = 0, kInfo = 1, kWarning = 2, kError = 3 };
+
+/// Size of a message, including the prefix (longer ones are truncated)
+const int kTextSize = 512;
+
+/// \brief Key identifying the call site _where_ (+ _line_) of a message
+inline unsigned Site(int level, const char* where, int line) {
+	unsigned hash = 2166136261u + level;
+	for(; where && *where; ++where) hash = (hash ^ (unsigned char)*where) * 16777619u;
+	return (hash ^ line) * 16777619u;
+}
+
+/// \brief May the site with key _site_ post a message now?
+//! \details If so, _suppressed_ is set to the number of messages from the site dropped since the
+//! last one was allowed.
+//! \returns 0 if not, else the number of messages from the site in the current second (with this one)
+int Admit(unsigned site, int* suppressed);
+
+/// \brief Queue a message, which is written by the logging thread.
+//! \details Info messages, errors, and the _first_ warning from a site in a second, are written
+//! (with everything queued before them) before returning.
+void Post(int level, unsigned site, int suppressed, bool first, const char* text, int length);
 
-#define LOG_OP__(CLASS, ARGTYPE) CLASS& operator<< (ARGTYPE arg) {	\
-    fStrm << arg; return *this;					\
-  }
-#define LOG_OPS__(CL)				\
-  LOG_OP__(CL, const char*)			\
-  LOG_OP__(CL, long long)			\
-  LOG_OP__(CL, long)				\
-  LOG_OP__(CL, int)				\
-  LOG_OP__(CL, short)				\
-  LOG_OP__(CL, char)				\
-  LOG_OP__(CL, unsigned long long)		\
-  LOG_OP__(CL, unsigned long)			\
-  LOG_OP__(CL, unsigned int)			\
-  LOG_OP__(CL, unsigned short)			\
-  LOG_OP__(CL, unsigned char)			\
-  LOG_OP__(CL, bool)				\
-  LOG_OP__(CL, double)				\
-  LOG_OP__(CL, float)				\
-  LOG_OP__(CL, const std::string&)
-
-
-class Logger
+/// Write every queued message now
+void Flush();
+
+/// Write every queued message and stop the logging thread (later messages are written at once)
+void Stop();
+
+/// Set the number of messages (but info) allowed from each call site per second (0 means no limit)
+void SetRateLimit(int perSecond);
+
+/// Number of messages (but info) allowed from each call site per second
+int GetRateLimit();
+
+/// \brief A message, queued when it goes out of scope.
+//! \details Formats into a fixed buffer, without allocating. Nothing is done by a message that
+//! is rate limited.
+class Message
 {
-private:
-  typedef std::basic_ostream<char, std::char_traits<char> > CoutType;
-  typedef CoutType& (*StandardEndLine)(CoutType&);
-  const char* const kFileName;
-  std::ofstream fStrm;
+protected:
+	typedef std::basic_ostream<char, std::char_traits<char> > CoutType;
+	typedef CoutType& (*StandardEndLine)(CoutType&);
+	/// Level
+	const int fLevel;
+	/// Call site key
+	unsigned fSite;
+	/// Messages dropped at this site before this one (-1 if this one is dropped too)
+	int fSuppressed;
+	/// First message from the site in the current second?
+	bool fFirst;
+	/// Length of the text
+	int fLength;
+	/// Text
+	char fText[kTextSize];
+
+	/// Append _length_ characters of _text_
+	void Append(const char* text, size_t length) {
+		if(length > size_t(kTextSize - fLength)) length = kTextSize - fLength;
+		memcpy(fText + fLength, text, length);
+		fLength += length;
+	}
+	/// Append a formatted value
+	template <class T> Message& Print(const char* format, T value) {
+		if(fSuppressed >= 0 && fLength < kTextSize) {
+			int n = snprintf(fText + fLength, kTextSize - fLength, format, value);
+			if(n > 0) fLength += n < kTextSize - fLength ? n : kTextSize - fLength - 1;
+		}
+		return *this;
+	}
+
 public:
-  static Logger& Instance();
-  LOG_OPS__(Logger)
-  Logger& operator<<(StandardEndLine manip);
-  ~Logger();
- 
-private:
-  Logger(const char* fname);
-};  
+	/// \brief Start message "_what_ in <_where_>: " (with ", line _line_" if it is positive)
+	//! \details Below RB_LOG_LEVEL, the message is dropped before looking at the call site. Info
+	//! messages aren't rate limited.
+	Message(int level, const char* what, const char* where, int line = 0):
+		fLevel(level), fSite(0), fSuppressed(-1), fFirst(false), fLength(0) {
+		if(level < RB_LOG_LEVEL) return;
+		fSite = Site(level, where, line);
+		if(level == kInfo) fSuppressed = 0;
+		else fFirst = Admit(fSite, &fSuppressed) == 1;
+		*this << what << " in <" << where << ">";
+		if(line > 0) *this << ", line " << line;
+		*this << ": ";
+	}
+	/// Queue the message (unless it was dropped)
+	virtual ~Message() {
+		if(fSuppressed < 0) return;
+		while(fLength > 0 && fText[fLength-1] == '\n') --fLength;
+		Post(fLevel, fSite, fSuppressed, fFirst, fText, fLength);
+	}
+	Message& operator<< (const char* arg) {
+		if(fSuppressed >= 0) Append(arg ? arg : "(null)", arg ? strlen(arg) : 6);
+		return *this;
+	}
+	Message& operator<< (const std::string& arg) {
+		if(fSuppressed >= 0) Append(arg.data(), arg.size());
+		return *this;
+	}
+	Message& operator<< (char arg)               { if(fSuppressed >= 0) Append(&arg, 1); return *this; }
+	Message& operator<< (unsigned char arg)      { return *this << char(arg); }
+	Message& operator<< (bool arg)               { return *this << (arg ? '1' : '0'); }
+	Message& operator<< (short arg)              { return Print("%d", int(arg)); }
+	Message& operator<< (int arg)                { return Print("%d", arg); }
+	Message& operator<< (long arg)               { return Print("%ld", arg); }
+	Message& operator<< (long long arg)          { return Print("%lld", arg); }
+	Message& operator<< (unsigned short arg)     { return Print("%u", unsigned(arg)); }
+	Message& operator<< (unsigned int arg)       { return Print("%u", arg); }
+	Message& operator<< (unsigned long arg)      { return Print("%lu", arg); }
+	Message& operator<< (unsigned long long arg) { return Print("%llu", arg); }
+	Message& operator<< (float arg)              { return Print("%g", double(arg)); }
+	Message& operator<< (double arg)             { return Print("%g", arg); }
+	/// std::endl starts a new line (the message ends with one anyway)
+	Message& operator<< (StandardEndLine) { return *this << '\n'; }
 
-inline Logger::Logger(const char* fname): kFileName(fname),
-					  fStrm(kFileName) { }
+private:
+	/// Disallow copy
+	Message(const Message&);
+	/// Disallow assign
+	Message& operator= (const Message&);
+};
 
-inline Logger::~Logger() {
-  fStrm.close();
-}
+} // namespace log
 
-inline Logger& Logger::Instance() {
-  static Logger logger("rbeer.log");
-  return logger;
-}
+} // namespace rb
 
-inline Logger& Logger::operator<<(StandardEndLine manip) {
-  manip(fStrm);
-  fStrm.flush();
-  return *this;
-}
 
-#define RB_LOG  Logger::Instance() << "Logging in <" << __func__ << "> (" << __FILE__ << ", line " << __LINE__ << "): "
+/// Nothing after it in the statement is compiled in unless _LEVEL_ is at least RB_LOG_LEVEL
+#define RB_LOG_IF(LEVEL) if((LEVEL) < RB_LOG_LEVEL) ; else
 
-#endif // #ifdef RB_LOGGING
+/// Debug message ("rbeer.log"), compiled in only with RB_LOGGING (or RB_LOG_LEVEL 0)
+#define RB_LOG RB_LOG_IF(rb::log::kDebug)																\
+	rb::log::Message(rb::log::kDebug, "Logging", __FILE__, __LINE__) << "<" << __func__ << "> "
 
 #endif // #ifndef __MAKECINT__
-#endif // #ifndeg LOGGER_HXX
+#endif // #ifndef LOGGER_HXX
@@ -0,0 +1,120 @@
+/*! \file Socket.hxx
+ *  \brief Helpers for the local listening sockets used by rb::metrics and rb::stream.
+ */
+#ifndef RB_SOCKET_HEADER
+#define RB_SOCKET_HEADER
+#ifndef __MAKECINT__
+#include <string>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+namespace rb
+{
+namespace net
+{
+//! Is _str_ a non-empty string of digits?
+inline bool IsPort(const char* str) {
+	if(!*str) return false;
+	for(const char* c = str; *c; ++c)
+		if(*c < '0' || *c > '9') return false;
+	return true;
+}
+
+//! Is _endpoint_ a TCP endpoint ("port" or "address:port") rather than the path of a Unix socket?
+inline bool IsTcp(const char* endpoint) {
+	const char* colon = strrchr(endpoint, ':');
+	return IsPort(colon ? colon + 1 : endpoint) && !strchr(endpoint, '/');
+}
+
+//! Create a listening socket on _address_:_port_ (an IPv4 address, default 127.0.0.1)
+inline int ListenTcp(int port, const char* address = "127.0.0.1") {
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if(inet_pton(AF_INET, address, &addr.sin_addr) != 1) { errno = EINVAL; return -1; }
+	int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) return -1;
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	if(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+		int e = errno; close(fd); errno = e;
+		return -1;
+	}
+	return fd;
+}
+
+//! Create a listening Unix socket at _path_, replacing a stale socket (but nothing else) there
+inline int ListenUnix(const char* path) {
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	if(strlen(path) >= sizeof(addr.sun_path)) { errno = ENAMETOOLONG; return -1; }
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	struct stat st;
+	if(lstat(path, &st) == 0) {
+		if(!S_ISSOCK(st.st_mode)) { errno = EEXIST; return -1; }
+		unlink(path);
+	}
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0) return -1;
+	if(bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+		int e = errno; close(fd); errno = e;
+		return -1;
+	}
+	return fd;
+}
+
+//! \brief Create a non-blocking listening socket for _endpoint_.
+//! \details "port" listens on 127.0.0.1:port, "address:port" on the given IPv4 address, and anything
+//! else is the path of a Unix socket, which is stored in _path_ so the caller can remove it when done.
+inline int Listen(const char* endpoint, std::string& path) {
+	int fd;
+	path = "";
+	if(IsTcp(endpoint)) {
+		const char* colon = strrchr(endpoint, ':');
+		if(colon) fd = ListenTcp(atoi(colon + 1), std::string(endpoint, colon).c_str());
+		else fd = ListenTcp(atoi(endpoint));
+	}
+	else {
+		fd = ListenUnix(endpoint);
+		if(fd >= 0) path = endpoint;
+	}
+	if(fd >= 0) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+//! \brief Write all of _data_ to the (blocking) socket _fd_
+//! \returns false if the peer is gone, or stalled past the socket's send timeout (SO_SNDTIMEO)
+inline bool SendAll(int fd, const std::string& data) {
+	const char* p = data.c_str();
+	size_t left = data.size();
+	while(left) {
+		ssize_t n = send(fd, p, left, MSG_NOSIGNAL);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) return false;
+		p += n; left -= n;
+	}
+	return true;
+}
+
+} // namespace net
+} // namespace rb
+
+
+#endif // #ifndef __MAKECINT__
+#endif // #ifndef RB_SOCKET_HEADER